@@ -97,7 +97,11 @@ function initWebSocket() {
             
             const data = JSON.parse(event.data);
             if (data.type === 'amsData') {
-                displayAmsData(data.payload);
+                displayAmsData(data.printer || 0, data.serial, data.payload);
+                markActiveTray(data.printer || 0, data.trayNow);
+            } else if (data.type === 'amsTrayDelta') {
+                updateAmsTrays(data.printer || 0, data.payload);
+                markActiveTray(data.printer || 0, data.trayNow);
             } else if (data.type === 'nfcTag') {
                 updateNfcStatusIndicator(data.payload);
             } else if (data.type === 'nfcData') {
@@ -240,121 +244,166 @@ function updateNfcInfo() {
     }
 }
 
-function displayAmsData(amsData) {
+function renderTray(printer, ams, tray) {
+    // Prüfe ob überhaupt Daten vorhanden sind
+    const relevantFields = ['tray_type', 'tray_sub_brands', 'tray_info_idx', 'setting_id', 'cali_idx'];
+    const hasAnyContent = relevantFields.some(field => 
+        tray[field] !== null && 
+        tray[field] !== undefined && 
+        tray[field] !== '' &&
+        tray[field] !== 'null'
+    );
+
+    // Bestimme den Anzeigenamen für das Tray
+    const trayDisplayName = (ams.ams_id === 255) ? 'External' : `Tray ${tray.id}`;
+
+    // Nur für nicht-leere Trays den Button-HTML erstellen
+    const buttonHtml = `
+        <button class="spool-button" onclick="handleSpoolIn(${printer}, ${ams.ams_id}, ${tray.id})" 
+                style="position: absolute; top: -30px; left: -15px; 
+                       background: none; border: none; padding: 0; 
+                       cursor: pointer; display: none;">
+            <img src="spool_in.png" alt="Spool In" style="width: 48px; height: 48px;">
+        </button>`;
+    
+    // Nur für nicht-leere Trays den Button-HTML erstellen
+    const outButtonHtml = `
+        <button class="spool-button" onclick="handleSpoolOut(${printer})" 
+                style="position: absolute; top: -35px; right: -15px; 
+                       background: none; border: none; padding: 0; 
+                       cursor: pointer; display: block;">
+            <img src="spool_in.png" alt="Spool In" style="width: 48px; height: 48px; transform: rotate(180deg) scaleX(-1);">
+        </button>`;
+
+    const spoolmanButtonHtml = `
+        <button class="spool-button" onclick="handleSpoolmanSettings('${tray.tray_info_idx}', '${tray.setting_id}', '${tray.cali_idx}', '${tray.nozzle_temp_min}', '${tray.nozzle_temp_max}')" 
+                style="position: absolute; bottom: 0px; right: 0px; 
+                       background: none; border: none; padding: 0; 
+                       cursor: pointer; display: none;">
+            <img src="set_spoolman.png" alt="Spool In" style="width: 38px; height: 38px;">
+        </button>`;
+
+    if (!hasAnyContent) {
+        return `
+            <div class="tray">
+                <p class="tray-head">${trayDisplayName}</p>
+                <p>
+                    ${(ams.ams_id === 255 && tray.tray_type === '') ? buttonHtml : ''}
+                    Empty
+                </p>
+            </div>
+            <hr>`;
+    }
+
+    // Generiere den Type mit Color-Box zusammen
+    const typeWithColor = tray.tray_type ? 
+        `<p>Typ: ${tray.tray_type} ${tray.tray_color ? `<span style="
+            background-color: #${tray.tray_color}; 
+            width: 20px; 
+            height: 20px; 
+            display: inline-block; 
+            vertical-align: middle;
+            border: 1px solid #333;
+            border-radius: 3px;
+            margin-left: 5px;"></span>` : ''}</p>` : '';
+
+    // Array mit restlichen Tray-Eigenschaften
+    const trayProperties = [
+        { key: 'tray_sub_brands', label: 'Sub Brands' },
+        { key: 'tray_info_idx', label: 'Filament IDX' },
+        { key: 'setting_id', label: 'Setting ID' },
+        { key: 'cali_idx', label: 'Calibration IDX' }
+    ];
+
+    // Nur gültige Felder anzeigen
+    const trayDetails = trayProperties
+        .filter(prop => 
+            tray[prop.key] !== null && 
+            tray[prop.key] !== undefined && 
+            tray[prop.key] !== '' &&
+            tray[prop.key] !== 'null'
+        )
+        .map(prop => {
+            // Spezielle Behandlung für setting_id
+            if (prop.key === 'cali_idx' && tray[prop.key] === '-1') {
+                return `<p>${prop.label}: not calibrated</p>`;
+            }
+            return `<p>${prop.label}: ${tray[prop.key]}</p>`;
+        })
+        .join('');
+
+    // Restmenge nur anzeigen, wenn der Drucker sie kennt (-1 = unbekannt)
+    const remainHTML = (tray.remain >= 0) ? `<p>Remaining: ${tray.remain}%</p>` : '';
+
+    // Temperaturen nur anzeigen, wenn beide nicht 0 sind
+    const tempHTML = (tray.nozzle_temp_min > 0 && tray.nozzle_temp_max > 0) 
+        ? `<p>Nozzle Temp: ${tray.nozzle_temp_min}°C - ${tray.nozzle_temp_max}°C</p>`
+        : '';
+
+    return `
+        <div class="tray" ${tray.tray_color ? `style="border-left: 4px solid #${tray.tray_color};"` : 'style="border-left: 4px solid #007bff;"'}>
+            <div style="position: relative;">
+                ${buttonHtml}
+                <p class="tray-head">${trayDisplayName}</p>
+                ${typeWithColor}
+                ${trayDetails}
+                ${tempHTML}
+                ${remainHTML}
+                ${(ams.ams_id === 255 && tray.tray_type !== '') ? outButtonHtml : ''}
+                ${(tray.setting_id != "" && tray.setting_id != "null") ? spoolmanButtonHtml : ''}
+            </div>
+            
+        </div>`;
+}
+
+// Jedes Tray bekommt einen eigenen Container, damit Deltas nur dieses Tray ersetzen
+function renderTrayWrapper(printer, ams, tray) {
+    // tray_now des Druckers: AMS * 4 + Tray, 254 für die externe Spule
+    const slot = (ams.ams_id === 255) ? 254 : ams.ams_id * 4 + tray.id;
+    return `<div id="tray-${printer}-${ams.ams_id}-${tray.id}" class="tray-slot" data-slot="${slot}">${renderTray(printer, ams, tray)}</div>`;
+}
+
+// Hebt das Tray hervor, aus dem der Drucker gerade druckt
+function markActiveTray(printer, trayNow) {
+    const printerContainer = document.getElementById(`amsData-${printer}`);
+    if (!printerContainer || trayNow === undefined) return;
+    printerContainer.querySelectorAll('.tray-slot').forEach(el => {
+        el.classList.toggle('tray-active', parseInt(el.dataset.slot) === trayNow);
+    });
+}
+
+// Jeder Drucker bekommt einen eigenen Bereich im amsData-Container
+function getPrinterContainer(printer) {
     const amsDataContainer = document.getElementById('amsData');
-    amsDataContainer.innerHTML = ''; 
+    let printerContainer = document.getElementById(`amsData-${printer}`);
+    if (!printerContainer) {
+        // Platzhalter "Wait for AMS-Data..." entfernen
+        if (!amsDataContainer.querySelector('.printerAms')) {
+            amsDataContainer.innerHTML = '';
+        }
+        printerContainer = document.createElement('div');
+        printerContainer.id = `amsData-${printer}`;
+        printerContainer.className = 'printerAms';
+        printerContainer.dataset.printer = printer;
+
+        // Nach Drucker-Index sortiert einfügen
+        const next = Array.from(amsDataContainer.querySelectorAll('.printerAms'))
+            .find(el => parseInt(el.dataset.printer) > printer);
+        amsDataContainer.insertBefore(printerContainer, next || null);
+    }
+    return printerContainer;
+}
+
+function displayAmsData(printer, serial, amsData) {
+    const printerContainer = getPrinterContainer(printer);
+    printerContainer.innerHTML = ''; 
 
     amsData.forEach((ams) => {
         // Bestimme den Anzeigenamen für das AMS
-        const amsDisplayName = ams.ams_id === 255 ? 'External Spool' : `AMS ${ams.ams_id}`;
+        const amsName = ams.ams_id === 255 ? 'External Spool' : `AMS ${ams.ams_id}`;
+        const amsDisplayName = (printer > 0 || serial) ? `${serial || 'Printer ' + (printer + 1)} - ${amsName}` : amsName;
         
-        const trayHTML = ams.tray.map(tray => {
-            // Prüfe ob überhaupt Daten vorhanden sind
-            const relevantFields = ['tray_type', 'tray_sub_brands', 'tray_info_idx', 'setting_id', 'cali_idx'];
-            const hasAnyContent = relevantFields.some(field => 
-                tray[field] !== null && 
-                tray[field] !== undefined && 
-                tray[field] !== '' &&
-                tray[field] !== 'null'
-            );
-
-            // Bestimme den Anzeigenamen für das Tray
-            const trayDisplayName = (ams.ams_id === 255) ? 'External' : `Tray ${tray.id}`;
-
-            // Nur für nicht-leere Trays den Button-HTML erstellen
-            const buttonHtml = `
-                <button class="spool-button" onclick="handleSpoolIn(${ams.ams_id}, ${tray.id})" 
-                        style="position: absolute; top: -30px; left: -15px; 
-                               background: none; border: none; padding: 0; 
-                               cursor: pointer; display: none;">
-                    <img src="spool_in.png" alt="Spool In" style="width: 48px; height: 48px;">
-                </button>`;
-            
-                        // Nur für nicht-leere Trays den Button-HTML erstellen
-            const outButtonHtml = `
-                <button class="spool-button" onclick="handleSpoolOut()" 
-                        style="position: absolute; top: -35px; right: -15px; 
-                               background: none; border: none; padding: 0; 
-                               cursor: pointer; display: block;">
-                    <img src="spool_in.png" alt="Spool In" style="width: 48px; height: 48px; transform: rotate(180deg) scaleX(-1);">
-                </button>`;
-
-            const spoolmanButtonHtml = `
-                <button class="spool-button" onclick="handleSpoolmanSettings('${tray.tray_info_idx}', '${tray.setting_id}', '${tray.cali_idx}', '${tray.nozzle_temp_min}', '${tray.nozzle_temp_max}')" 
-                        style="position: absolute; bottom: 0px; right: 0px; 
-                               background: none; border: none; padding: 0; 
-                               cursor: pointer; display: none;">
-                    <img src="set_spoolman.png" alt="Spool In" style="width: 38px; height: 38px;">
-                </button>`;
-
-            if (!hasAnyContent) {
-                return `
-                    <div class="tray">
-                        <p class="tray-head">${trayDisplayName}</p>
-                        <p>
-                            ${(ams.ams_id === 255 && tray.tray_type === '') ? buttonHtml : ''}
-                            Empty
-                        </p>
-                    </div>
-                    <hr>`;
-            }
-
-            // Generiere den Type mit Color-Box zusammen
-            const typeWithColor = tray.tray_type ? 
-                `<p>Typ: ${tray.tray_type} ${tray.tray_color ? `<span style="
-                    background-color: #${tray.tray_color}; 
-                    width: 20px; 
-                    height: 20px; 
-                    display: inline-block; 
-                    vertical-align: middle;
-                    border: 1px solid #333;
-                    border-radius: 3px;
-                    margin-left: 5px;"></span>` : ''}</p>` : '';
-
-            // Array mit restlichen Tray-Eigenschaften
-            const trayProperties = [
-                { key: 'tray_sub_brands', label: 'Sub Brands' },
-                { key: 'tray_info_idx', label: 'Filament IDX' },
-                { key: 'setting_id', label: 'Setting ID' },
-                { key: 'cali_idx', label: 'Calibration IDX' }
-            ];
-
-            // Nur gültige Felder anzeigen
-            const trayDetails = trayProperties
-                .filter(prop => 
-                    tray[prop.key] !== null && 
-                    tray[prop.key] !== undefined && 
-                    tray[prop.key] !== '' &&
-                    tray[prop.key] !== 'null'
-                )
-                .map(prop => {
-                    // Spezielle Behandlung für setting_id
-                    if (prop.key === 'cali_idx' && tray[prop.key] === '-1') {
-                        return `<p>${prop.label}: not calibrated</p>`;
-                    }
-                    return `<p>${prop.label}: ${tray[prop.key]}</p>`;
-                })
-                .join('');
-
-            // Temperaturen nur anzeigen, wenn beide nicht 0 sind
-            const tempHTML = (tray.nozzle_temp_min > 0 && tray.nozzle_temp_max > 0) 
-                ? `<p>Nozzle Temp: ${tray.nozzle_temp_min}°C - ${tray.nozzle_temp_max}°C</p>`
-                : '';
-
-            return `
-                <div class="tray" ${tray.tray_color ? `style="border-left: 4px solid #${tray.tray_color};"` : 'style="border-left: 4px solid #007bff;"'}>
-                    <div style="position: relative;">
-                        ${buttonHtml}
-                        <p class="tray-head">${trayDisplayName}</p>
-                        ${typeWithColor}
-                        ${trayDetails}
-                        ${tempHTML}
-                        ${(ams.ams_id === 255 && tray.tray_type !== '') ? outButtonHtml : ''}
-                        ${(tray.setting_id != "" && tray.setting_id != "null") ? spoolmanButtonHtml : ''}
-                    </div>
-                    
-                </div>`;
-        }).join('');
+        const trayHTML = ams.tray.map(tray => renderTrayWrapper(printer, ams, tray)).join('');
 
         const amsInfo = `
             <div class="feature">
@@ -364,7 +413,18 @@ function displayAmsData(amsData) {
                 </div>
             </div>`;
         
-        amsDataContainer.innerHTML += amsInfo;
+        printerContainer.innerHTML += amsInfo;
+    });
+}
+
+// Ersetzt nur die geänderten Trays aus einer amsTrayDelta-Nachricht
+function updateAmsTrays(printer, trayDeltas) {
+    trayDeltas.forEach((delta) => {
+        const ams = { ams_id: delta.ams_id };
+        const trayElement = document.getElementById(`tray-${printer}-${delta.ams_id}-${delta.tray.id}`);
+        if (trayElement) {
+            trayElement.innerHTML = renderTray(printer, ams, delta.tray);
+        }
     });
 }
 
@@ -406,11 +466,12 @@ function handleSpoolmanSettings(tray_info_idx, setting_id, cali_idx, nozzle_temp
     }
 }
 
-function handleSpoolOut() {
+function handleSpoolOut(printer) {
     // Erstelle Payload
     const payload = {
         type: 'setBambuSpool',
         payload: {
+            printer: printer,
             amsId: 255,
             trayId: 254,
             color: "FFFFFF",
@@ -431,7 +492,7 @@ function handleSpoolOut() {
 }
 
 // Neue Funktion zum Behandeln des Spool-In-Klicks
-function handleSpoolIn(amsId, trayId) {
+function handleSpoolIn(printer, amsId, trayId) {
     // Prüfe WebSocket Verbindung zuerst
     if (!socket || socket.readyState !== WebSocket.OPEN) {
         showNotification("No active WebSocket connection!", false);
@@ -470,6 +531,7 @@ function handleSpoolIn(amsId, trayId) {
     const payload = {
         type: 'setBambuSpool',
         payload: {
+            printer: printer,
             amsId: amsId,
             trayId: trayId,
             color: selectedSpool.filament.color_hex || "FFFFFF",
@@ -0,0 +1,431 @@
+import argparse
+import base64
+import json
+import os
+import random
+import socket
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from bambu_tls_broker import Broker, format_summary, listen, report_results, summarize  # noqa: E402
+
+# Simuliert einen Bambu-Drucker für Lasttests ohne echte Hardware.
+# Startet den lokalen TLS-Broker (bambu_tls_broker.py), sendet push_status-Berichte auf
+# device/<serial>/report und beantwortet ams_filament_setting, extrusion_cali_sel und pushall.
+# Simulates a Bambu printer for load tests without real hardware.
+# Starts the local TLS broker (bambu_tls_broker.py), publishes push_status reports on
+# device/<serial>/report and answers ams_filament_setting, extrusion_cali_sel and pushall.
+#
+# In FilaMan die IP dieses Rechners, die Seriennummer (--serial) und einen beliebigen
+# Access Code eintragen. Mit --device misst das Skript über den WebSocket von FilaMan
+# die Ende-zu-Ende-Latenz bis zur Slot-Aktualisierung sowie Durchsatz und Heap.
+#
+#   python scripts/bambu_simulator.py --serial SIM00000001 --rate 2 --scenario mixed --device 192.168.1.50
+#   python scripts/bambu_simulator.py --replay capture.jsonl --rate 5
+#
+# Replay-Dateien enthalten einen Bericht pro Zeile, entweder das Payload-Objekt selbst
+# oder {"t": <Sekunden>, "payload": {...}}; mit --realtime werden die Zeitabstände übernommen.
+#
+# Mit --dump schreibt das Skript einen Strom in diesem Format, ohne Broker, für den nativen
+# Replay-Test (test/test_bambu_replay) -- with --dump the script writes a stream in this format,
+# without a broker, for the native replay test:
+#
+#   python scripts/bambu_simulator.py --dump test/fixtures/bambu_stream.jsonl --count 400 --partial --seed 1
+#
+# Vorher/nachher wie beim Broker: --save before.json, danach --compare before.json.
+# Before/after as with the broker: --save before.json, then --compare before.json.
+
+FILAMENTS = [
+    ("PLA", "PLA Basic", "GFA00", "GFSA00", 190, 230),
+    ("PLA", "PLA Matte", "GFA01", "GFSA01", 190, 230),
+    ("PETG", "PETG HF", "GFG02", "GFSG02", 230, 260),
+    ("ABS", "ABS", "GFB00", "GFSB00", 240, 270),
+    ("TPU", "TPU 95A", "GFU01", "GFSU01", 200, 250),
+    ("PLA", "", "GFL99", "", 190, 240),
+]
+
+COLORS = ["FF0000FF", "00FF00FF", "0000FFFF", "FFFFFFFF", "000000FF", "F4EE2AFF", "FF6A13FF"]
+
+
+class PrinterSim:
+    def __init__(self, ams_count, partial):
+        self.partial = partial
+        self.sequence = 0
+        self.marker = 0
+        self.lock = threading.Lock()
+        self.ams = [[self.random_tray(t) for t in range(4)] for _ in range(ams_count)]
+        self.vt_tray = self.random_tray(254)
+        self.tray_now = "255"
+
+    def next_marker(self):
+        self.marker += 1
+        return f"sim#{self.marker}"
+
+    def random_tray(self, tray_id, marker=None):
+        tray_type, sub_brand, idx, setting, tmin, tmax = random.choice(FILAMENTS)
+        return {
+            "id": str(tray_id),
+            "tray_type": tray_type,
+            "tray_sub_brands": f"{sub_brand} {marker}".strip() if marker else sub_brand,
+            "tray_color": random.choice(COLORS),
+            "tray_info_idx": idx,
+            "setting_id": setting,
+            "nozzle_temp_min": str(tmin),
+            "nozzle_temp_max": str(tmax),
+            "cali_idx": -1,
+            "remain": random.randint(0, 100),
+        }
+
+    def empty_tray(self, tray_id):
+        return {"id": str(tray_id)}
+
+    def report(self, changed=None, full=False):
+        # changed: Liste von (ams_index, tray_index), ams_index None = vt_tray
+        self.sequence += 1
+        print_obj = {"command": "push_status", "msg": 0 if full else 1, "sequence_id": str(self.sequence)}
+
+        if full or not self.partial or changed is None:
+            units = [{"id": str(a), "humidity": "4", "temp": "0.0", "tray": trays} for a, trays in enumerate(self.ams)]
+            print_obj["ams"] = {"ams": units, "ams_exist_bits": format((1 << len(self.ams)) - 1, "x"), "tray_now": self.tray_now}
+            if self.vt_tray is not None:
+                print_obj["vt_tray"] = self.vt_tray
+        else:
+            # Teilbericht wie zwischen zwei vollen Berichten -- partial report as sent between full reports
+            units = {}
+            for ams_index, tray_index in changed:
+                if ams_index is None:
+                    print_obj["vt_tray"] = self.vt_tray if self.vt_tray is not None else self.empty_tray(254)
+                    continue
+                units.setdefault(ams_index, []).append(self.ams[ams_index][tray_index])
+            if units:
+                print_obj["ams"] = {"ams": [{"id": str(a), "tray": trays} for a, trays in units.items()], "tray_now": self.tray_now}
+        return {"print": print_obj}
+
+    def step(self, scenario):
+        # Gibt (Bericht, Marker oder None) zurück -- returns (report, marker or None)
+        with self.lock:
+            event = scenario if scenario != "mixed" else random.choice(["steady", "swap", "swap", "vt", "ams"])
+            if event == "swap":
+                a = random.randrange(len(self.ams))
+                t = random.randrange(4)
+                marker = self.next_marker()
+                self.ams[a][t] = self.random_tray(t, marker)
+                self.tray_now = str(a * 4 + t)
+                return self.report([(a, t)]), marker
+            if event == "vt":
+                if self.vt_tray is None or not self.vt_tray.get("tray_type"):
+                    marker = self.next_marker()
+                    self.vt_tray = self.random_tray(254, marker)
+                    return self.report([(None, 0)]), marker
+                self.vt_tray = self.empty_tray(254)
+                return self.report([(None, 0)]), None
+            if event == "ams":
+                # AMS anstecken oder abziehen, immer als voller Bericht -- plug or unplug an AMS, always a full report
+                if len(self.ams) < 4 and (len(self.ams) == 1 or random.random() < 0.5):
+                    self.ams.append([self.random_tray(t) for t in range(4)])
+                else:
+                    self.ams.pop()
+                return self.report(full=True), None
+            return self.report(full=True), None
+
+    def handle_request(self, payload):
+        # Gibt die Antworten als Liste von Payloads zurück -- returns the replies as a list of payloads
+        if payload.get("pushing", {}).get("command") == "pushall":
+            with self.lock:
+                return [self.report(full=True)]
+
+        request = payload.get("print", {})
+        command = request.get("command")
+        with self.lock:
+            if command == "ams_filament_setting":
+                ams_id = int(request.get("ams_id", 0))
+                tray_id = int(request.get("tray_id", 0))
+                if tray_id == 254 or ams_id == 255:
+                    tray = self.vt_tray if self.vt_tray is not None else self.empty_tray(254)
+                    self.vt_tray = tray
+                    changed = (None, 0)
+                elif ams_id < len(self.ams) and 0 <= tray_id < 4:
+                    tray = self.ams[ams_id][tray_id]
+                    changed = (ams_id, tray_id)
+                else:
+                    return []
+                for key in ("tray_type", "tray_color", "tray_info_idx", "setting_id", "nozzle_temp_min", "nozzle_temp_max"):
+                    if key in request:
+                        tray[key] = str(request[key])
+                echo = {"print": {"command": "ams_filament_setting", "ams_id": ams_id, "tray_id": tray_id,
+                                  "setting_id": request.get("setting_id", ""), "tray_info_idx": request.get("tray_info_idx", ""),
+                                  "result": "success", "sequence_id": request.get("sequence_id", "0")}}
+                return [echo, self.report([changed])]
+            if command == "extrusion_cali_sel":
+                tray_id = int(request.get("tray_id", 0))
+                if tray_id == 254 and self.vt_tray is not None:
+                    self.vt_tray["cali_idx"] = request.get("cali_idx", -1)
+                    return [self.report([(None, 0)])]
+        return []
+
+
+class WsClient:
+    # Minimaler WebSocket-Client ohne Abhängigkeiten -- minimal dependency-free WebSocket client
+    def __init__(self, host, port=80, path="/ws"):
+        self.sock = socket.create_connection((host, port), timeout=10)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall((f"GET {path} HTTP/1.1\r\nHost: {host}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n").encode())
+        response = b""
+        while b"\r\n\r\n" not in response:
+            chunk = self.sock.recv(1024)
+            if not chunk:
+                raise ConnectionError("WebSocket handshake failed")
+            response += chunk
+        head, self.buf = response.split(b"\r\n\r\n", 1)
+        if b" 101 " not in head.split(b"\r\n")[0]:
+            raise ConnectionError(head.split(b"\r\n")[0].decode())
+        self.sock.settimeout(None)
+        self.send_lock = threading.Lock()
+
+    def _read(self, n):
+        while len(self.buf) < n:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("closed")
+            self.buf += chunk
+        data, self.buf = self.buf[:n], self.buf[n:]
+        return data
+
+    def _send_frame(self, opcode, data):
+        mask = os.urandom(4)
+        header = bytearray([0x80 | opcode])
+        if len(data) < 126:
+            header.append(0x80 | len(data))
+        elif len(data) < 65536:
+            header.append(0x80 | 126)
+            header += len(data).to_bytes(2, "big")
+        else:
+            header.append(0x80 | 127)
+            header += len(data).to_bytes(8, "big")
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(data))
+        with self.send_lock:
+            self.sock.sendall(bytes(header) + mask + masked)
+
+    def send(self, text):
+        self._send_frame(0x1, text.encode())
+
+    def recv(self):
+        message = b""
+        while True:
+            b0, b1 = self._read(2)
+            length = b1 & 0x7F
+            if length == 126:
+                length = int.from_bytes(self._read(2), "big")
+            elif length == 127:
+                length = int.from_bytes(self._read(8), "big")
+            data = self._read(length)
+            opcode = b0 & 0x0F
+            if opcode == 0x9:
+                self._send_frame(0xA, data)
+                continue
+            if opcode == 0x8:
+                raise ConnectionError("closed")
+            if opcode in (0x0, 0x1, 0x2):
+                message += data
+                if b0 & 0x80:
+                    return message.decode(errors="replace")
+
+
+class Harness:
+    # Misst Latenz bis zur Slot-Aktualisierung im FilaMan-WebSocket -- measures latency until the slot update in FilaMan's WebSocket
+    def __init__(self, device):
+        self.ws = WsClient(device)
+        self.lock = threading.Lock()
+        self.pending = {}
+        self.latencies = []
+        self.stats = None
+        threading.Thread(target=self.reader, daemon=True).start()
+
+    def expect(self, marker):
+        with self.lock:
+            self.pending[marker] = time.monotonic()
+
+    def reader(self):
+        while True:
+            try:
+                message = json.loads(self.ws.recv())
+            except (ConnectionError, OSError):
+                print("WebSocket getrennt -- WebSocket closed")
+                return
+            except ValueError:
+                continue
+
+            if message.get("type") == "bambuStats":
+                # Bei "busy" die letzten gültigen Zähler behalten -- on "busy" keep the last valid counters
+                if message.get("error"):
+                    print(f"bambuStats: {message['error']}")
+                    if self.stats:
+                        continue
+                self.stats = message
+                continue
+
+            trays = []
+            if message.get("type") == "amsTrayDelta":
+                trays = [entry["tray"] for entry in message.get("payload", [])]
+            elif message.get("type") == "amsData":
+                trays = [tray for ams in message.get("payload", []) for tray in ams.get("tray", [])]
+
+            now = time.monotonic()
+            with self.lock:
+                for tray in trays:
+                    for marker in [m for m in self.pending if tray.get("tray_sub_brands", "").endswith(m)]:
+                        self.latencies.append((now - self.pending.pop(marker)) * 1000)
+
+    def request_stats(self):
+        self.ws.send(json.dumps({"type": "bambuStats"}))
+
+    def summary(self, sent, elapsed):
+        self.request_stats()
+        time.sleep(1)
+        with self.lock:
+            latency = summarize(self.latencies)
+            missed = len(self.pending)
+        results = {"sent": sent, "rate": round(sent / elapsed, 2), "latency_ms": latency, "missed": missed}
+        print(f"Berichte gesendet -- reports sent: {sent} in {elapsed:.1f} s ({sent / elapsed:.1f}/s)")
+        if latency:
+            print(f"Slot-Latenz -- slot latency: {format_summary(latency)}, ohne Update -- missed: {missed}")
+        if self.stats:
+            print(f"Heap frei -- free heap: {self.stats.get('freeHeap')} B, Tiefstwert -- low-water mark: {self.stats.get('minFreeHeap')} B, "
+                  f"größter Block -- largest block: {self.stats.get('maxAllocHeap')} B, "
+                  f"MQTT-Stack frei -- stack free: {self.stats.get('mqttStackFree')}")
+            results["device"] = {key: self.stats.get(key) for key in ("freeHeap", "minFreeHeap", "maxAllocHeap", "mqttStackFree")}
+            for index, printer in enumerate(self.stats.get("printers", [])):
+                if printer.get("reports"):
+                    print(f"Drucker {index}: {printer['reports']} Berichte, {printer['bytes']} B, "
+                          f"{printer['parseErrors']} Parserfehler, Ø {printer['avgUs']} µs, max {printer['maxUs']} µs, TLS {printer.get('tlsHeap')} B")
+                    results[f"printer{index}"] = printer
+        return results
+
+def load_replay(path):
+    entries = []
+    with open(path, "r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            entry = json.loads(line)
+            if "payload" in entry and "t" in entry:
+                entries.append((float(entry["t"]), entry["payload"]))
+            else:
+                entries.append((None, entry))
+    return entries
+
+
+def stream_lines(printer, scenario, count, rate):
+    # Beginnt wie nach pushall mit einem vollen Bericht; Payloads exakt wie sie publiziert würden
+    # Starts with a full report as after pushall; payloads exactly as they would be published
+    for i in range(count):
+        payload = printer.report(full=True) if i == 0 else printer.step(scenario)[0]
+        yield f'{{"t": {i / rate:.3f}, "payload": {json.dumps(payload)}}}\n'
+
+
+def dump_stream(path, printer, scenario, count, rate):
+    with open(path, "w", encoding="utf-8") as f:
+        f.writelines(stream_lines(printer, scenario, count, rate))
+    print(f"{count} Berichte nach {path} geschrieben -- reports written")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bambu printer simulator / MQTT replay harness")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--serial", default="SIM00000001")
+    parser.add_argument("--ams", type=int, default=2, help="Anzahl AMS zu Beginn -- initial AMS count")
+    parser.add_argument("--rate", type=float, default=1.0, help="Berichte pro Sekunde -- reports per second")
+    parser.add_argument("--duration", type=float, default=60, help="Sekunden, 0 = endlos -- seconds, 0 = forever")
+    parser.add_argument("--scenario", choices=["steady", "swap", "vt", "ams", "mixed"], default="mixed")
+    parser.add_argument("--partial", action="store_true", help="Zwischen vollen Berichten nur Deltas senden -- send only deltas between full reports")
+    parser.add_argument("--replay", help="push_status-Aufzeichnung abspielen -- replay a recorded push_status stream")
+    parser.add_argument("--realtime", action="store_true", help="Zeitstempel der Aufzeichnung nutzen -- use the recorded timestamps")
+    parser.add_argument("--device", help="FilaMan-IP für Latenz- und Heap-Messung -- FilaMan IP for latency and heap measurement")
+    parser.add_argument("--save", help="Ergebnisse als JSON speichern -- save the results as JSON")
+    parser.add_argument("--compare", help="mit einem gespeicherten Lauf vergleichen -- compare with a saved run")
+    parser.add_argument("--dump", help="Strom als Replay-Datei schreiben statt zu senden -- write the stream as a replay file instead of sending")
+    parser.add_argument("--count", type=int, default=400, help="Berichte für --dump -- reports for --dump")
+    parser.add_argument("--seed", type=int, help="Zufallsstartwert für reproduzierbare Ströme -- random seed for reproducible streams")
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+    if args.dump:
+        dump_stream(args.dump, PrinterSim(args.ams, args.partial), args.scenario, args.count, args.rate)
+        return
+
+    report_topic = f"device/{args.serial}/report"
+    request_topic = f"device/{args.serial}/request"
+    printer = PrinterSim(args.ams, args.partial)
+    broker = Broker(0)
+
+    def on_publish(topic, payload):
+        if topic != request_topic:
+            return
+        try:
+            request = json.loads(payload)
+        except ValueError:
+            return
+        print(f"Anfrage -- request: {request}")
+        for reply in printer.handle_request(request):
+            broker.publish(report_topic, json.dumps(reply))
+
+    broker.on_publish = on_publish
+    server = listen(args.host, args.port, broker)
+
+    # Warten bis FilaMan abonniert hat -- wait until FilaMan has subscribed
+    print(f"Warte auf Abo von {report_topic} -- waiting for a subscription")
+    while not any(report_topic in topics for topics in list(broker.subscriptions.values())):
+        time.sleep(0.2)
+
+    harness = Harness(args.device) if args.device else None
+    replay = load_replay(args.replay) if args.replay else None
+    interval = 1.0 / args.rate
+    start = time.monotonic()
+    sent = 0
+
+    try:
+        while args.duration == 0 or time.monotonic() - start < args.duration:
+            tick = time.monotonic()
+            marker = None
+            if replay is not None:
+                if sent >= len(replay):
+                    break
+                stamp, payload = replay[sent]
+                if args.realtime and stamp is not None and sent > 0 and replay[sent - 1][0] is not None:
+                    time.sleep(max(0.0, stamp - replay[sent - 1][0]))
+            else:
+                payload, marker = printer.step(args.scenario)
+
+            if harness and marker:
+                harness.expect(marker)
+            broker.publish(report_topic, json.dumps(payload))
+            sent += 1
+
+            if harness and sent % max(1, int(args.rate * 10)) == 0:
+                harness.request_stats()
+            if replay is None or not args.realtime:
+                time.sleep(max(0.0, interval - (time.monotonic() - tick)))
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = time.monotonic() - start
+    if harness:
+        time.sleep(2)
+        results = harness.summary(sent, elapsed)
+    else:
+        print(f"Berichte gesendet -- reports sent: {sent} in {elapsed:.1f} s")
+        results = {"sent": sent, "rate": round(sent / elapsed, 2)}
+    broker.print_stats()
+    results["broker"] = broker.results()
+    report_results(results, args.save, args.compare)
+    server.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,297 @@
+import argparse
+import hashlib
+import json
+import os
+import socket
+import ssl
+import statistics
+import subprocess
+import threading
+import time
+
+# Minimaler MQTT-over-TLS Broker als Ersatz für einen Bambu-Drucker im lokalen Netz.
+# Misst pro Verbindung die Handshake-Dauer und ob die TLS-Session wiederaufgenommen wurde,
+# damit sich Reconnects der Firmware vorher/nachher vergleichen lassen.
+# Minimal MQTT-over-TLS broker standing in for a Bambu printer on the local network.
+# Logs handshake time and TLS session reuse per connection to compare firmware reconnects.
+#
+#   python scripts/bambu_tls_broker.py --port 8883
+#
+# Das Zertifikat wird beim ersten Start mit openssl erzeugt; der ausgegebene
+# SHA-256 Fingerprint kann in den Bambu-Einstellungen zum Pinning eingetragen werden.
+# Mit --drop N trennt der Broker jede Verbindung nach N Sekunden, um Reconnects zu erzwingen.
+#
+# Vorher/nachher: einen Lauf mit --save before.json aufzeichnen, den zweiten mit
+# --compare before.json starten; beim Beenden werden die Werte gegenübergestellt.
+# Before/after: record one run with --save before.json, start the second with
+# --compare before.json; on exit both runs are printed side by side.
+
+CERT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), ".bambu_broker")
+
+MQTT_CONNECT = 0x10
+MQTT_PUBLISH = 0x30
+MQTT_SUBSCRIBE = 0x80
+MQTT_PINGREQ = 0xC0
+MQTT_DISCONNECT = 0xE0
+
+
+def ensure_certificate():
+    cert = os.path.join(CERT_DIR, "cert.pem")
+    key = os.path.join(CERT_DIR, "key.pem")
+    if not os.path.exists(cert):
+        os.makedirs(CERT_DIR, exist_ok=True)
+        subprocess.run(["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1",
+                        "-nodes", "-days", "3650", "-subj", "/CN=BBLSTANDIN", "-keyout", key, "-out", cert],
+                       check=True, capture_output=True)
+    return cert, key
+
+
+def certificate_fingerprint(cert):
+    with open(cert, "r") as f:
+        der = ssl.PEM_cert_to_DER_cert(f.read())
+    return hashlib.sha256(der).hexdigest().upper()
+
+
+class Broker:
+    def __init__(self, drop_after, on_publish=None):
+        self.drop_after = drop_after
+        self.on_publish = on_publish    # Rückruf für Publishes der Clients, z.B. vom Simulator
+        self.lock = threading.Lock()
+        self.subscriptions = {}     # Verbindung -> Topics
+        self.stats = {"connections": 0, "resumed": 0, "full_ms": [], "resumed_ms": []}
+
+    def publish(self, topic, payload, sender=None):
+        packet = encode_publish(topic, payload)
+        with self.lock:
+            targets = [c for c, topics in self.subscriptions.items() if c is not sender and any(topic_matches(t, topic) for t in topics)]
+        for conn in targets:
+            try:
+                conn.sendall(packet)
+            except OSError:
+                pass
+
+    def serve_client(self, raw, addr, context):
+        start = time.monotonic()
+        try:
+            conn = context.wrap_socket(raw, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            print(f"{addr[0]}: Handshake fehlgeschlagen -- handshake failed: {e}")
+            raw.close()
+            return
+
+        elapsed = (time.monotonic() - start) * 1000
+        with self.lock:
+            self.stats["connections"] += 1
+            if conn.session_reused:
+                self.stats["resumed"] += 1
+                self.stats["resumed_ms"].append(elapsed)
+            else:
+                self.stats["full_ms"].append(elapsed)
+            self.subscriptions[conn] = []
+        print(f"{addr[0]}: {conn.version()} Handshake {elapsed:.0f} ms, session_reused={conn.session_reused}")
+
+        if self.drop_after:
+            timer = threading.Timer(self.drop_after, lambda: conn.shutdown(socket.SHUT_RDWR))
+            timer.daemon = True
+            timer.start()
+
+        try:
+            self.handle_mqtt(conn, addr)
+        except (OSError, ValueError):
+            pass
+        finally:
+            with self.lock:
+                self.subscriptions.pop(conn, None)
+            conn.close()
+            print(f"{addr[0]}: getrennt -- disconnected")
+
+    def handle_mqtt(self, conn, addr):
+        while True:
+            header, body = read_packet(conn)
+            kind = header & 0xF0
+            if kind == MQTT_CONNECT:
+                conn.sendall(bytes([0x20, 0x02, 0x00, 0x00]))
+            elif kind == MQTT_SUBSCRIBE:
+                packet_id = body[:2]
+                topics = []
+                pos = 2
+                while pos < len(body):
+                    length = int.from_bytes(body[pos:pos + 2], "big")
+                    topics.append(body[pos + 2:pos + 2 + length].decode())
+                    pos += 2 + length + 1
+                with self.lock:
+                    self.subscriptions[conn].extend(topics)
+                print(f"{addr[0]}: subscribe {topics}")
+                conn.sendall(bytes([0x90, 2 + len(topics)]) + packet_id + bytes(len(topics)))
+            elif kind == MQTT_PUBLISH:
+                length = int.from_bytes(body[:2], "big")
+                topic = body[2:2 + length].decode()
+                pos = 2 + length + (2 if header & 0x06 else 0)
+                if self.on_publish:
+                    self.on_publish(topic, body[pos:])
+                self.publish(topic, body[pos:], sender=conn)
+            elif kind == MQTT_PINGREQ:
+                conn.sendall(bytes([0xD0, 0x00]))
+            elif kind == MQTT_DISCONNECT:
+                return
+
+    def results(self):
+        with self.lock:
+            s = self.stats
+            return {"connections": s["connections"], "resumed": s["resumed"],
+                    "full_ms": summarize(s["full_ms"]), "resumed_ms": summarize(s["resumed_ms"])}
+
+    def print_stats(self):
+        r = self.results()
+        print(f"Verbindungen {r['connections']}, wiederaufgenommen {r['resumed']}, "
+              f"voller Handshake {format_summary(r['full_ms'])}, Wiederaufnahme {format_summary(r['resumed_ms'])}")
+
+
+def summarize(values):
+    if not values:
+        return None
+    ordered = sorted(values)
+    p95 = ordered[min(len(ordered) - 1, int(len(ordered) * 0.95))]
+    return {"n": len(ordered), "p50": round(statistics.median(ordered), 1), "p95": round(p95, 1), "max": round(ordered[-1], 1)}
+
+
+def format_summary(summary):
+    if not summary:
+        return "-"
+    return f"n={summary['n']} p50={summary['p50']:.0f} ms p95={summary['p95']:.0f} ms max={summary['max']:.0f} ms"
+
+
+def flatten(results, prefix=""):
+    out = {}
+    for key, value in results.items():
+        if isinstance(value, dict):
+            out.update(flatten(value, f"{prefix}{key}."))
+        elif isinstance(value, (int, float)) and not isinstance(value, bool):
+            out[prefix + key] = value
+    return out
+
+
+def save_results(path, results):
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(results, f, indent=2)
+    print(f"Ergebnisse gespeichert -- results saved: {path}")
+
+
+def compare_results(path, results):
+    with open(path, "r", encoding="utf-8") as f:
+        before = flatten(json.load(f))
+    after = flatten(results)
+    print(f"Vorher -- before: {path}, nachher -- after: dieser Lauf -- this run")
+    for key in sorted(set(before) | set(after)):
+        old, new = before.get(key), after.get(key)
+        change = f" ({(new - old) / old * 100:+.0f} %)" if old and new is not None else ""
+        print(f"  {key:28} {old if old is not None else '-':>10} -> {new if new is not None else '-':>10}{change}")
+
+
+def report_results(results, save=None, compare=None):
+    if compare:
+        compare_results(compare, results)
+    if save:
+        save_results(save, results)
+
+def read_exact(conn, n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            raise ValueError("closed")
+        data += chunk
+    return data
+
+
+def read_packet(conn):
+    header = read_exact(conn, 1)[0]
+    length = 0
+    shift = 0
+    while True:
+        b = read_exact(conn, 1)[0]
+        length |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            break
+    return header, read_exact(conn, length) if length else b""
+
+
+def encode_length(n):
+    out = bytearray()
+    while True:
+        digit = n % 128
+        n //= 128
+        out.append(digit | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def encode_publish(topic, payload):
+    if isinstance(payload, str):
+        payload = payload.encode()
+    topic = topic.encode()
+    body = len(topic).to_bytes(2, "big") + topic + payload
+    return bytes([MQTT_PUBLISH]) + encode_length(len(body)) + body
+
+
+def topic_matches(pattern, topic):
+    if pattern == "#" or pattern == topic:
+        return True
+    return pattern.endswith("/#") and topic.startswith(pattern[:-1])
+
+
+def make_context(cert, key):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    # Wie die Drucker: TLS 1.2, damit Session-IDs/Tickets wie auf dem Gerät greifen
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(cert, key)
+    return context
+
+
+def listen(host, port, broker):
+    cert, key = ensure_certificate()
+    print(f"Zertifikat SHA-256 -- certificate fingerprint: {certificate_fingerprint(cert)}")
+    context = make_context(cert, key)
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((host, port))
+    server.listen()
+    print(f"Broker lauscht auf {host}:{port}")
+
+    def accept_loop():
+        while True:
+            try:
+                raw, addr = server.accept()
+            except OSError:
+                return
+            threading.Thread(target=broker.serve_client, args=(raw, addr, context), daemon=True).start()
+
+    threading.Thread(target=accept_loop, daemon=True).start()
+    return server
+
+
+def serve(host, port, drop_after, save=None, compare=None):
+    broker = Broker(drop_after)
+    server = listen(host, port, broker)
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        broker.print_stats()
+        report_results(broker.results(), save, compare)
+        server.close()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Bambu MQTT/TLS broker stand-in")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--drop", type=float, default=0, help="Verbindung nach N Sekunden trennen -- drop each connection after N seconds")
+    parser.add_argument("--save", help="Ergebnisse als JSON speichern -- save the results as JSON")
+    parser.add_argument("--compare", help="mit einem gespeicherten Lauf vergleichen -- compare with a saved run")
+    args = parser.parse_args()
+    serve(args.host, args.port, args.drop, args.save, args.compare)
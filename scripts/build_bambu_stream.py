@@ -0,0 +1,38 @@
+import os
+import random
+import sys
+
+# Erzeugt test/fixtures/bambu_stream.jsonl mit scripts/bambu_simulator.py für den nativen
+# Replay-Test. Fester Startwert, damit jeder Lauf denselben Strom abspielt.
+# Generates test/fixtures/bambu_stream.jsonl with scripts/bambu_simulator.py for the native
+# replay test. Fixed seed so every run replays the same stream.
+# Kann auch direkt aufgerufen werden: python scripts/build_bambu_stream.py
+
+STREAM_FILE = "./test/fixtures/bambu_stream.jsonl"
+STREAM_SEED = 1
+STREAM_COUNT = 400
+STREAM_AMS = 2
+
+def build_bambu_stream(source=None, target=None, env=None):
+    sys.path.insert(0, os.path.abspath("scripts"))
+    from bambu_simulator import PrinterSim, stream_lines
+
+    random.seed(STREAM_SEED)
+    content = "".join(stream_lines(PrinterSim(STREAM_AMS, True), "mixed", STREAM_COUNT, 1.0))
+
+    # Nur schreiben wenn sich etwas geändert hat -- only write when something changed
+    if os.path.exists(STREAM_FILE):
+        with open(STREAM_FILE, "r", encoding="utf-8") as f:
+            if f.read() == content:
+                return
+
+    with open(STREAM_FILE, "w", encoding="utf-8") as f:
+        f.write(content)
+    print(f"Wrote {STREAM_FILE} ({STREAM_COUNT} reports)")
+
+try:
+    Import("env")
+    build_bambu_stream()
+except NameError:
+    if __name__ == "__main__":
+        build_bambu_stream()
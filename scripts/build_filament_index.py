@@ -0,0 +1,98 @@
+import json
+import os
+
+# Erzeugt src/bambu_filament_index.h aus html/bambu_filaments.json, damit
+# findFilamentIdx() zur Laufzeit weder Dateien lesen noch JSON parsen muss.
+# Kann auch direkt aufgerufen werden: python scripts/build_filament_index.py
+
+SOURCE_FILE = "./html/bambu_filaments.json"
+HEADER_FILE = "./src/bambu_filament_index.h"
+
+def c_string(value):
+    escaped = value.replace("\\", "\\\\").replace('"', '\\"')
+    return '"' + escaped + '"'
+
+def strcmp_key(value):
+    # Gleiche Reihenfolge wie strcmp() auf dem ESP32
+    return value.encode("utf-8")
+
+def build_filament_index(source=None, target=None, env=None):
+    print("BUILD FILAMENT INDEX")
+
+    with open(SOURCE_FILE, "r", encoding="utf-8") as f:
+        filaments = list(json.load(f).items())
+
+    by_key = sorted(filaments, key=lambda kv: strcmp_key(kv[0]))
+
+    # Pro Name gewinnt der erste Eintrag der JSON, wie bei der linearen Suche
+    first_by_value = {}
+    for key, value in filaments:
+        first_by_value.setdefault(value, key)
+    by_value = sorted(first_by_value.items(), key=lambda vk: strcmp_key(vk[0]))
+
+    # Bekannte Typen: Name ohne Markenpräfix, in JSON-Reihenfolge, Treffer vorberechnet
+    known_types = []
+    for _, value in filaments:
+        known = value[value.index(" ") + 1:] if " " in value else value
+        if known and known not in (t for t, _ in known_types):
+            match = next(key for key, v in filaments if known in v)
+            known_types.append((known, match))
+
+    lines = [
+        "// Automatisch erzeugt von scripts/build_filament_index.py aus html/bambu_filaments.json",
+        "// Nicht von Hand bearbeiten -- do not edit by hand",
+        "#ifndef BAMBU_FILAMENT_INDEX_H",
+        "#define BAMBU_FILAMENT_INDEX_H",
+        "",
+        "struct FilamentIndexEntry {",
+        "    const char* key;",
+        "    const char* value;",
+        "};",
+        "",
+        "// Nach Filament-IDX sortiert -- sorted by filament idx",
+        "static constexpr FilamentIndexEntry filamentByKey[] = {",
+    ]
+    lines += ["    {%s, %s}," % (c_string(k), c_string(v)) for k, v in by_key]
+    lines += [
+        "};",
+        "",
+        "// Nach Name sortiert, bei doppelten Namen der erste Eintrag -- sorted by name, first entry wins on duplicates",
+        "static constexpr FilamentIndexEntry filamentByValue[] = {",
+    ]
+    lines += ["    {%s, %s}," % (c_string(k), c_string(v)) for v, k in by_value]
+    lines += [
+        "};",
+        "",
+        "// Typ ohne Marke -> erster passender Filament-IDX, in JSON-Reihenfolge",
+        "// Type without brand -> first matching filament idx, in JSON order",
+        "static constexpr FilamentIndexEntry filamentKnownTypes[] = {",
+    ]
+    lines += ["    {%s, %s}," % (c_string(k), c_string(t)) for t, k in known_types]
+    lines += [
+        "};",
+        "",
+        "#define FILAMENT_BY_KEY_COUNT       %d" % len(by_key),
+        "#define FILAMENT_BY_VALUE_COUNT     %d" % len(by_value),
+        "#define FILAMENT_KNOWN_TYPES_COUNT  %d" % len(known_types),
+        "",
+        "#endif",
+        "",
+    ]
+    content = "\n".join(lines)
+
+    # Nur schreiben wenn sich etwas geändert hat, sonst baut PlatformIO alles neu
+    if os.path.exists(HEADER_FILE):
+        with open(HEADER_FILE, "r", encoding="utf-8") as f:
+            if f.read() == content:
+                return
+
+    with open(HEADER_FILE, "w", encoding="utf-8") as f:
+        f.write(content)
+    print(f"Wrote {HEADER_FILE} ({len(by_key)} filaments, {len(known_types)} known types)")
+
+try:
+    Import("env")
+    build_filament_index()
+except NameError:
+    if __name__ == "__main__":
+        build_filament_index()
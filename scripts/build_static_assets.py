@@ -0,0 +1,101 @@
+import gzip
+import hashlib
+import os
+import re
+
+# Erzeugt src/static_asset_data.h: CSS, JS und Bilder aus html/ gzip-komprimiert als Tabelle im Flash,
+# jeweils mit Inhalts-Hash für ETag und die gehashte URL (name.<hash>.ext, immutable gecacht).
+# Generates src/static_asset_data.h: CSS, JS and images from html/ gzip compressed as a table in flash,
+# each with a content hash for the ETag and the hashed URL (name.<hash>.ext, cached as immutable).
+# Kann auch direkt aufgerufen werden: python scripts/build_static_assets.py
+
+SOURCE_DIR = "./html"
+HEADER_FILE = "./src/static_asset_data.h"
+HASH_LEN = 16
+
+# Datei -> Content-Type; diese Dateien landen nicht mehr im LittleFS-Image
+STATIC_ASSETS = {
+    "style.css": "text/css",
+    "spoolman.js": "text/javascript",
+    "rfid.js": "text/javascript",
+    "logo.png": "image/png",
+    "spool_in.png": "image/png",
+    "set_spoolman.png": "image/png",
+    "favicon.ico": "image/x-icon",
+}
+
+def asset_hash(name):
+    with open(os.path.join(SOURCE_DIR, name), "rb") as f:
+        return hashlib.sha256(f.read()).hexdigest()[:HASH_LEN]
+
+def hashed_name(name, digest):
+    base, ext = os.path.splitext(name)
+    return f"{base}.{digest}{ext}"
+
+def rewrite_asset_links(html):
+    # Verweise in den Seiten auf die gehashten URLs umstellen -- point page references to the hashed URLs
+    for name in STATIC_ASSETS:
+        pattern = r'((?:href|src)=["\']/?)' + re.escape(name) + r'(["\'])'
+        html = re.sub(pattern, lambda m: m.group(1) + hashed_name(name, asset_hash(name)) + m.group(2), html)
+    return html
+
+def c_identifier(name):
+    return "asset_" + re.sub(r"[^0-9A-Za-z]", "_", name)
+
+def build_static_assets(source=None, target=None, env=None):
+    print("BUILD STATIC ASSETS")
+
+    lines = [
+        "// Automatisch erzeugt von scripts/build_static_assets.py aus html/",
+        "// Nicht von Hand bearbeiten -- do not edit by hand",
+        "#ifndef STATIC_ASSET_DATA_H",
+        "#define STATIC_ASSET_DATA_H",
+        "",
+        '#include "static_assets.h"',
+        "",
+    ]
+    entries = []
+    for name, content_type in STATIC_ASSETS.items():
+        with open(os.path.join(SOURCE_DIR, name), "rb") as f:
+            raw = f.read()
+        # mtime=0, damit gleiche Quellen den gleichen Header ergeben
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        digest = asset_hash(name)
+        ident = c_identifier(name)
+
+        lines.append(f"static const uint8_t {ident}[] = {{")
+        for i in range(0, len(data), 20):
+            lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 20]) + ",")
+        lines.append("};")
+        lines.append("")
+        entries.append(f'    {{"/{name}", "/{hashed_name(name, digest)}", "{content_type}", "\\"{digest}\\"", {ident}, sizeof({ident})}},')
+        print(f"  {name}: {len(raw)} -> {len(data)} bytes, {digest}")
+
+    lines.append("static const StaticAsset staticAssets[] = {")
+    lines += entries
+    lines += [
+        "};",
+        "",
+        "#define STATIC_ASSET_COUNT  %d" % len(entries),
+        "",
+        "#endif",
+        "",
+    ]
+    content = "\n".join(lines)
+
+    # Nur schreiben wenn sich etwas geändert hat, sonst baut PlatformIO alles neu
+    if os.path.exists(HEADER_FILE):
+        with open(HEADER_FILE, "r", encoding="utf-8") as f:
+            if f.read() == content:
+                return
+
+    with open(HEADER_FILE, "w", encoding="utf-8") as f:
+        f.write(content)
+    print(f"Wrote {HEADER_FILE} ({len(entries)} assets)")
+
+try:
+    Import("env")
+    build_static_assets()
+except NameError:
+    if __name__ == "__main__":
+        build_static_assets()
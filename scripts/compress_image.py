@@ -0,0 +1,58 @@
+"""Komprimiert ein Firmware- oder LittleFS-Abbild für das OTA-Update -- compresses a firmware or LittleFS image for OTA.
+
+    python scripts/compress_image.py upgrade_filaman_firmware_v1.5.11.bin [ausgabe.bin.gz]
+
+Ergebnis ist eine gewöhnliche gzip-Datei (gunzip kann sie lesen). Im FEXTRA-Feld des Headers
+stehen Länge und SHA-256 des unkomprimierten Abbilds; src/gzip_inflater.cpp prüft beides
+nach dem Entpacken, bevor das Update abgeschlossen wird.
+The result is a plain gzip file. Its FEXTRA header field carries length and SHA-256 of the
+uncompressed image, which src/gzip_inflater.cpp checks before the update is finalized.
+"""
+
+import hashlib
+import struct
+import sys
+import zlib
+
+# Muss zu GZIP_IMAGE_INFO_* in src/gzip_inflater.h passen -- must match GZIP_IMAGE_INFO_* in src/gzip_inflater.h
+IMAGE_INFO_ID = b'FM'
+FLAG_EXTRA = 0x04
+OS_UNKNOWN = 255
+
+
+def compress_image(data):
+    info = struct.pack('<I', len(data)) + hashlib.sha256(data).digest()
+    extra = IMAGE_INFO_ID + struct.pack('<H', len(info)) + info
+
+    # MTIME 0, damit gleiche Abbilder gleiche Dateien ergeben -- MTIME 0 so equal images give equal files
+    header = struct.pack('<BBBBIBB', 0x1f, 0x8b, 8, FLAG_EXTRA, 0, 2, OS_UNKNOWN)
+    header += struct.pack('<H', len(extra)) + extra
+
+    # Rohes Deflate mit 32 KB Fenster, so groß wie das des Entpackers -- raw deflate with a 32 KB window, as large as the inflater's
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -15, 9)
+    body = compressor.compress(data) + compressor.flush()
+
+    trailer = struct.pack('<II', zlib.crc32(data) & 0xffffffff, len(data) & 0xffffffff)
+    return header + body + trailer
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    input_file = sys.argv[1]
+    output_file = sys.argv[2] if len(sys.argv) > 2 else input_file + '.gz'
+
+    with open(input_file, 'rb') as f:
+        data = f.read()
+    compressed = compress_image(data)
+    with open(output_file, 'wb') as f:
+        f.write(compressed)
+
+    print(f"{input_file}: {len(data)} -> {len(compressed)} Bytes ({100 * len(compressed) / len(data):.0f}%), "
+          f"SHA-256 {hashlib.sha256(data).hexdigest()}")
+
+
+if __name__ == '__main__':
+    main()
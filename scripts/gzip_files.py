@@ -1,6 +1,14 @@
 import gzip
 import os
+import re
 import shutil
+import struct
+import sys
+import zlib
+
+# CSS, JS und Bilder bettet scripts/build_static_assets.py in die Firmware ein
+sys.path.insert(0, os.path.join(os.getcwd(), 'scripts'))
+from build_static_assets import STATIC_ASSETS, rewrite_asset_links
 
 ## gzip files
 
@@ -9,13 +17,66 @@ def compress_file(input_file, output_file):
         with gzip.open(output_file, 'wb') as f_out:
             f_out.writelines(f_in)
 
+def read_page(input_file):
+    # Seiten verweisen auf die gehashten Asset-URLs -- pages reference the hashed asset URLs
+    with open(input_file, 'r', encoding='utf-8') as f:
+        return rewrite_asset_links(f.read())
+
+def compress_page(input_file, output_file):
+    with gzip.open(output_file, 'wb') as f_out:
+        f_out.write(read_page(input_file).encode('utf-8'))
+
 def copy_file(input_file, output_file):
     shutil.copy2(input_file, output_file)
 
+## Vorlagen mit {{platzhalter}} -- templates with {{placeholder}}
+#
+# Seiten mit Platzhaltern werden als <name>.tpl abgelegt: die statischen Teile sind
+# einzeln deflate-komprimiert (jeder mit eigenem Wörterbuch), die Firmware setzt die
+# Werte zur Laufzeit als unkomprimierte Blöcke dazwischen (src/html_template.cpp).
+# Pages with placeholders are stored as <name>.tpl: the static parts are deflate
+# compressed one by one (each with its own dictionary), the firmware splices the values
+# in between as stored blocks at runtime (src/html_template.cpp).
+#
+# Aufbau -- layout (little endian):
+#   "FTP1", uint16 Anzahl Segmente, uint16 0
+#   je Segment: uint32 Offset ab Dateianfang, uint32 Länge komprimiert, uint32 Länge roh, uint32 Adler-32,
+#               char[24] Platzhalter danach ("" beim letzten Segment)
+#   danach die komprimierten Segmente
+
+TEMPLATE_FILES = ('spoolman.html', 'waage.html')
+TEMPLATE_MAGIC = b'FTP1'
+TEMPLATE_NAME_LEN = 24
+PLACEHOLDER = re.compile(r'\{\{(\w+)\}\}')
+
+def deflate_segment(data, last):
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -15)
+    # Z_FULL_FLUSH endet byteweise ausgerichtet, Z_FINISH setzt BFINAL
+    return compressor.compress(data) + compressor.flush(zlib.Z_FINISH if last else zlib.Z_FULL_FLUSH)
+
+def build_template(input_file, output_file):
+    content = read_page(input_file)
+
+    parts = PLACEHOLDER.split(content)
+    statics = [p.encode('utf-8') for p in parts[0::2]]
+    names = parts[1::2] + ['']
+
+    table = b''
+    body = b''
+    header_len = 8 + len(statics) * (16 + TEMPLATE_NAME_LEN)
+    for i, (static, name) in enumerate(zip(statics, names)):
+        encoded = name.encode('ascii')
+        if len(encoded) >= TEMPLATE_NAME_LEN:
+            raise ValueError(f'Platzhalter zu lang -- placeholder too long: {name}')
+        compressed = deflate_segment(static, i == len(statics) - 1)
+        table += struct.pack('<IIII', header_len + len(body), len(compressed), len(static), zlib.adler32(static))
+        table += encoded.ljust(TEMPLATE_NAME_LEN, b'\0')
+        body += compressed
+
+    with open(output_file, 'wb') as f:
+        f.write(TEMPLATE_MAGIC + struct.pack('<HH', len(statics), 0) + table + body)
+
 def should_compress(file):
-     # Skip compression for spoolman.html
-    if file == 'spoolman.html' or file == 'waage.html':
-        return False
     # Komprimiere nur bestimmte Dateitypen
     return file.endswith(('.js', '.png', '.css', '.html'))
 
@@ -29,7 +90,15 @@ def main(source_dir, target_dir):
             
             os.makedirs(os.path.dirname(output_file_compressed), exist_ok=True)
 
-            if should_compress(file):
+            if file in STATIC_ASSETS:
+                print(f'Skipped {input_file}, embedded in firmware')
+            elif file in TEMPLATE_FILES:
+                build_template(input_file, output_file_original + '.tpl')
+                print(f'Built template {input_file} to {output_file_original}.tpl')
+            elif file.endswith('.html'):
+                compress_page(input_file, output_file_compressed)
+                print(f'Compressed {input_file} to {output_file_compressed}')
+            elif should_compress(file):
                 compress_file(input_file, output_file_compressed)
                 print(f'Compressed {input_file} to {output_file_compressed}')
             else:
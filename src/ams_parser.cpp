@@ -0,0 +1,430 @@
+#include "ams_parser.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Feldnamen in der Reihenfolge von AmsTrayField -- field names in AmsTrayField order
+static const char* const trayFieldNames[AMS_FIELD_COUNT] = {
+    "id",
+    "tray_info_idx",
+    "tray_type",
+    "tray_sub_brands",
+    "tray_color",
+    "nozzle_temp_min",
+    "nozzle_temp_max",
+    "setting_id",
+    "cali_idx",
+    "remain"
+};
+
+static const char* const printFieldNames[AMS_PRINT_FIELD_COUNT] = {
+    "command",
+    "ams_id",
+    "tray_id",
+    "setting_id",
+    "msg",
+    "gcode_state"
+};
+
+static const char* const statusFieldNames[AMS_STATUS_FIELD_COUNT] = {
+    "tray_now",
+    "ams_exist_bits"
+};
+
+static bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isScalarChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '-' || c == '+' || c == '.';
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+AmsReportParser::AmsReportParser() : _trayCallback(nullptr), _trayCtx(nullptr) {
+    begin();
+}
+
+void AmsReportParser::setTrayCallback(AmsTrayCallback callback, void* ctx) {
+    _trayCallback = callback;
+    _trayCtx = ctx;
+}
+
+void AmsReportParser::begin() {
+    _depth = 0;
+    _state = TOK_VALUE;
+    _stringIsKey = false;
+    _keyLen = 0;
+    _keyTruncated = false;
+    _key[0] = '\0';
+    _target = nullptr;
+    _targetLen = 0;
+    _targetCap = 0;
+    _scalarLen = 0;
+    _amsIndex = 0;
+    _amsId = -1;
+    _amsIdText[0] = '\0';
+    _hasAmsList = false;
+    _amsCount = 0;
+    _hasUpgradeState = false;
+    _printPresent = 0;
+    memset(_printValues, 0, sizeof(_printValues));
+    _statusPresent = 0;
+    memset(_statusValues, 0, sizeof(_statusValues));
+    memset(&_tray, 0, sizeof(_tray));
+}
+
+bool AmsReportParser::finish() {
+    return _state == TOK_DONE;
+}
+
+void AmsReportParser::feed(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len && _state != TOK_ERROR; i++) {
+        processChar((char)data[i]);
+    }
+}
+
+bool AmsReportParser::keyIs(const char* name) const {
+    return !_keyTruncated && strcmp(_key, name) == 0;
+}
+
+void AmsReportParser::processChar(char c) {
+    switch (_state) {
+        case TOK_STRING:
+            if (c == '"') {
+                if (_stringIsKey) {
+                    _state = TOK_COLON;
+                } else {
+                    valueDone();
+                }
+            } else if (c == '\\') {
+                _state = TOK_STRING_ESCAPE;
+            } else {
+                appendChar(c);
+            }
+            return;
+
+        case TOK_STRING_ESCAPE:
+            _state = TOK_STRING;
+            switch (c) {
+                case '"': case '\\': case '/': appendChar(c); break;
+                case 'b': appendChar('\b'); break;
+                case 'f': appendChar('\f'); break;
+                case 'n': appendChar('\n'); break;
+                case 'r': appendChar('\r'); break;
+                case 't': appendChar('\t'); break;
+                case 'u':
+                    _unicodeDigits = 0;
+                    _unicodeValue = 0;
+                    _state = TOK_STRING_UNICODE;
+                    break;
+                default: _state = TOK_ERROR; break;
+            }
+            return;
+
+        case TOK_STRING_UNICODE: {
+            int v = hexValue(c);
+            if (v < 0) {
+                _state = TOK_ERROR;
+                return;
+            }
+            _unicodeValue = (_unicodeValue << 4) | v;
+            if (++_unicodeDigits == 4) {
+                appendCodepoint(_unicodeValue);
+                _state = TOK_STRING;
+            }
+            return;
+        }
+
+        case TOK_SCALAR:
+            if (isScalarChar(c)) {
+                if (_scalarLen < sizeof(_scalarBuf) - 1) _scalarBuf[_scalarLen++] = c;
+                appendChar(c);
+                return;
+            }
+            // Trennzeichen beendet den Wert und wird danach normal verarbeitet
+            _scalarBuf[_scalarLen] = '\0';
+            if (_target && strcmp(_scalarBuf, "null") == 0) {
+                _target[0] = '\0';
+                _targetLen = 0;
+            }
+            valueDone();
+            processChar(c);
+            return;
+
+        default:
+            break;
+    }
+
+    if (isWhitespace(c)) return;
+
+    switch (_state) {
+        case TOK_VALUE_OR_END:
+            if (c == ']') {
+                closeContainer();
+                return;
+            }
+            // fall through
+        case TOK_VALUE:
+            beginValue(c);
+            return;
+
+        case TOK_KEY_OR_END:
+            if (c == '}') {
+                closeContainer();
+                return;
+            }
+            // fall through
+        case TOK_KEY:
+            if (c != '"') {
+                _state = TOK_ERROR;
+                return;
+            }
+            _stringIsKey = true;
+            _keyLen = 0;
+            _keyTruncated = false;
+            _key[0] = '\0';
+            _state = TOK_STRING;
+            return;
+
+        case TOK_COLON:
+            _state = (c == ':') ? TOK_VALUE : TOK_ERROR;
+            return;
+
+        case TOK_AFTER_VALUE: {
+            bool inArray = _depth > 0 && _stack[_depth - 1].isArray;
+            if (c == ',') {
+                _state = inArray ? TOK_VALUE : TOK_KEY;
+            } else if (c == '}' && _depth > 0 && !inArray) {
+                closeContainer();
+            } else if (c == ']' && inArray) {
+                closeContainer();
+            } else {
+                _state = TOK_ERROR;
+            }
+            return;
+        }
+
+        default:
+            // TOK_DONE: nach dem Wurzelobjekt sind nur noch Leerzeichen erlaubt
+            _state = TOK_ERROR;
+            return;
+    }
+}
+
+void AmsReportParser::beginValue(char c) {
+    if (c == '{') {
+        openContainer(false);
+    } else if (c == '[') {
+        openContainer(true);
+    } else if (c == '"') {
+        _stringIsKey = false;
+        selectTarget();
+        _state = TOK_STRING;
+    } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        _stringIsKey = false;
+        selectTarget();
+        _scalarLen = 0;
+        _scalarBuf[_scalarLen++] = c;
+        appendChar(c);
+        _state = TOK_SCALAR;
+    } else {
+        _state = TOK_ERROR;
+    }
+}
+
+void AmsReportParser::selectTarget() {
+    _target = nullptr;
+    _targetLen = 0;
+    _targetCap = 0;
+    if (_depth == 0 || _stack[_depth - 1].isArray) return;
+
+    switch (_stack[_depth - 1].ctx) {
+        case CTX_PRINT:
+            for (uint8_t f = 0; f < AMS_PRINT_FIELD_COUNT; f++) {
+                if (keyIs(printFieldNames[f])) {
+                    _printPresent |= (1U << f);
+                    _target = _printValues[f];
+                    _targetCap = AMS_PARSER_VALUE_LEN;
+                    break;
+                }
+            }
+            break;
+
+        case CTX_AMS_WRAPPER:
+            for (uint8_t f = 0; f < AMS_STATUS_FIELD_COUNT; f++) {
+                if (keyIs(statusFieldNames[f])) {
+                    _statusPresent |= (1U << f);
+                    _target = _statusValues[f];
+                    _targetCap = AMS_PARSER_VALUE_LEN;
+                    break;
+                }
+            }
+            break;
+
+        case CTX_AMS_UNIT:
+            if (keyIs("id")) {
+                _target = _amsIdText;
+                _targetCap = sizeof(_amsIdText);
+            }
+            break;
+
+        case CTX_TRAY:
+        case CTX_VT_TRAY:
+            for (uint8_t f = 0; f < AMS_FIELD_COUNT; f++) {
+                if (keyIs(trayFieldNames[f])) {
+                    _tray.present |= (1U << f);
+                    _target = _tray.values[f];
+                    _targetCap = AMS_PARSER_VALUE_LEN;
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (_target) _target[0] = '\0';
+}
+
+void AmsReportParser::appendChar(char c) {
+    if (_stringIsKey) {
+        if (_keyLen < AMS_PARSER_KEY_LEN - 1) {
+            _key[_keyLen++] = c;
+            _key[_keyLen] = '\0';
+        } else {
+            _keyTruncated = true;
+        }
+        return;
+    }
+
+    if (_target && _targetLen < _targetCap - 1) {
+        _target[_targetLen++] = c;
+        _target[_targetLen] = '\0';
+    }
+}
+
+void AmsReportParser::appendCodepoint(uint16_t cp) {
+    // Als UTF-8 ablegen, Surrogates werden nicht zusammengesetzt
+    if (cp < 0x80) {
+        appendChar((char)cp);
+    } else if (cp < 0x800) {
+        appendChar((char)(0xC0 | (cp >> 6)));
+        appendChar((char)(0x80 | (cp & 0x3F)));
+    } else {
+        appendChar((char)(0xE0 | (cp >> 12)));
+        appendChar((char)(0x80 | ((cp >> 6) & 0x3F)));
+        appendChar((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+AmsReportParser::Context AmsReportParser::childContext(bool isArray) {
+    if (_depth == 0) return isArray ? CTX_IGNORE : CTX_ROOT;
+
+    const Frame& parent = _stack[_depth - 1];
+    switch (parent.ctx) {
+        case CTX_ROOT:
+            if (!isArray && keyIs("print")) return CTX_PRINT;
+            break;
+        case CTX_PRINT:
+            if (isArray) break;
+            if (keyIs("ams")) return CTX_AMS_WRAPPER;
+            if (keyIs("vt_tray")) return CTX_VT_TRAY;
+            if (keyIs("upgrade_state")) _hasUpgradeState = true;
+            break;
+        case CTX_AMS_WRAPPER:
+            if (isArray && keyIs("ams")) return CTX_AMS_LIST;
+            break;
+        case CTX_AMS_LIST:
+            if (!isArray) return CTX_AMS_UNIT;
+            break;
+        case CTX_AMS_UNIT:
+            if (isArray && keyIs("tray")) return CTX_TRAY_LIST;
+            break;
+        case CTX_TRAY_LIST:
+            if (!isArray) return CTX_TRAY;
+            break;
+        default:
+            break;
+    }
+    return CTX_IGNORE;
+}
+
+void AmsReportParser::openContainer(bool isArray) {
+    if (_depth >= AMS_PARSER_MAX_DEPTH) {
+        _state = TOK_ERROR;
+        return;
+    }
+
+    Context ctx = childContext(isArray);
+    uint8_t parentIndex = (_depth > 0) ? _stack[_depth - 1].index : 0;
+
+    switch (ctx) {
+        case CTX_AMS_LIST:
+            _hasAmsList = true;
+            _amsCount = 0;
+            break;
+        case CTX_AMS_UNIT:
+            _amsIndex = parentIndex;
+            _amsId = -1;
+            _amsIdText[0] = '\0';
+            break;
+        case CTX_TRAY:
+        case CTX_VT_TRAY:
+            memset(&_tray, 0, sizeof(_tray));
+            _tray.amsIndex = (ctx == CTX_VT_TRAY) ? AMS_PARSER_VT_INDEX : _amsIndex;
+            _tray.amsId = (ctx == CTX_VT_TRAY) ? AMS_PARSER_VT_INDEX : _amsId;
+            _tray.trayIndex = (ctx == CTX_VT_TRAY) ? 0 : parentIndex;
+            break;
+        default:
+            break;
+    }
+
+    _stack[_depth].ctx = ctx;
+    _stack[_depth].isArray = isArray;
+    _stack[_depth].index = 0;
+    _depth++;
+    _state = isArray ? TOK_VALUE_OR_END : TOK_KEY_OR_END;
+}
+
+void AmsReportParser::closeContainer() {
+    Frame frame = _stack[--_depth];
+
+    switch (frame.ctx) {
+        case CTX_TRAY:
+        case CTX_VT_TRAY:
+            if (_trayCallback) _trayCallback(_tray, _trayCtx);
+            break;
+        case CTX_AMS_LIST:
+            _amsCount = frame.index;
+            break;
+        default:
+            break;
+    }
+
+    _target = nullptr;
+    valueDone();
+}
+
+void AmsReportParser::valueDone() {
+    if (_target == _amsIdText) {
+        _amsId = (int16_t)atoi(_amsIdText);
+    }
+    _target = nullptr;
+    _stringIsKey = false;
+
+    if (_depth == 0) {
+        _state = TOK_DONE;
+        return;
+    }
+
+    Frame& top = _stack[_depth - 1];
+    if (top.isArray && top.index < 255) top.index++;
+    _state = TOK_AFTER_VALUE;
+}
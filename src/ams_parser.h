@@ -0,0 +1,163 @@
+#ifndef AMS_PARSER_H
+#define AMS_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Inkrementeller JSON-Tokenizer für Bambu push_status Berichte.
+// Bekommt den MQTT-Payload in beliebigen Stücken und zieht die AMS/Tray-Felder
+// heraus, ohne jemals den ganzen Bericht im Speicher zu halten.
+// Incremental JSON tokenizer for Bambu push_status reports. Accepts the MQTT
+// payload in arbitrary chunks and extracts the AMS/tray fields with a fixed,
+// small memory footprint.
+
+#define AMS_PARSER_MAX_DEPTH    12
+#define AMS_PARSER_KEY_LEN      24
+#define AMS_PARSER_VALUE_LEN    24
+#define AMS_PARSER_VT_INDEX     255
+
+typedef enum {
+    AMS_FIELD_ID,
+    AMS_FIELD_TRAY_INFO_IDX,
+    AMS_FIELD_TRAY_TYPE,
+    AMS_FIELD_TRAY_SUB_BRANDS,
+    AMS_FIELD_TRAY_COLOR,
+    AMS_FIELD_NOZZLE_TEMP_MIN,
+    AMS_FIELD_NOZZLE_TEMP_MAX,
+    AMS_FIELD_SETTING_ID,
+    AMS_FIELD_CALI_IDX,
+    AMS_FIELD_REMAIN,
+    AMS_FIELD_COUNT
+} AmsTrayField;
+
+typedef enum {
+    AMS_PRINT_COMMAND,
+    AMS_PRINT_AMS_ID,
+    AMS_PRINT_TRAY_ID,
+    AMS_PRINT_SETTING_ID,
+    AMS_PRINT_MSG,              // 0 = voller Bericht, sonst Teilbericht -- 0 = full report, otherwise partial
+    AMS_PRINT_GCODE_STATE,      // RUNNING, PAUSE, FINISH, ...
+    AMS_PRINT_FIELD_COUNT
+} AmsPrintField;
+
+// Felder direkt unter print.ams -- fields directly below print.ams
+typedef enum {
+    AMS_STATUS_TRAY_NOW,
+    AMS_STATUS_EXIST_BITS,
+    AMS_STATUS_FIELD_COUNT
+} AmsStatusField;
+
+struct AmsTrayReport {
+    uint8_t amsIndex;       // Position in print.ams.ams, AMS_PARSER_VT_INDEX für vt_tray
+    int16_t amsId;          // "id" des AMS, -1 wenn (noch) nicht gesehen
+    uint8_t trayIndex;      // Position im tray-Array, in Teilberichten nicht die Tray-ID
+    uint16_t present;       // Bitmaske der gesehenen Felder (1 << AmsTrayField)
+    char values[AMS_FIELD_COUNT][AMS_PARSER_VALUE_LEN];
+
+    bool has(AmsTrayField field) const { return present & (1U << field); }
+    const char* get(AmsTrayField field) const { return values[field]; }
+};
+
+typedef void (*AmsTrayCallback)(const AmsTrayReport& tray, void* ctx);
+
+class AmsReportParser {
+public:
+    AmsReportParser();
+
+    void setTrayCallback(AmsTrayCallback callback, void* ctx);
+
+    // Neuen Bericht beginnen -- start a new report
+    void begin();
+    // Nächstes Stück des Payloads verarbeiten -- process the next payload chunk
+    void feed(const uint8_t* data, size_t len);
+    // Bericht abschließen, false bei ungültigem oder unvollständigem JSON
+    bool finish();
+
+    bool hasAmsList() const { return _hasAmsList; }
+    uint8_t amsCount() const { return _amsCount; }
+    bool hasUpgradeState() const { return _hasUpgradeState; }
+    bool hasPrintField(AmsPrintField field) const { return _printPresent & (1U << field); }
+    const char* printField(AmsPrintField field) const { return _printValues[field]; }
+    bool hasStatusField(AmsStatusField field) const { return _statusPresent & (1U << field); }
+    const char* statusField(AmsStatusField field) const { return _statusValues[field]; }
+
+private:
+    typedef enum {
+        CTX_IGNORE,
+        CTX_ROOT,
+        CTX_PRINT,
+        CTX_AMS_WRAPPER,
+        CTX_AMS_LIST,
+        CTX_AMS_UNIT,
+        CTX_TRAY_LIST,
+        CTX_TRAY,
+        CTX_VT_TRAY
+    } Context;
+
+    typedef enum {
+        TOK_VALUE,          // Wert erwartet
+        TOK_KEY_OR_END,     // Schlüssel oder '}' erwartet
+        TOK_KEY,            // Schlüssel erwartet (nach ',')
+        TOK_COLON,          // ':' erwartet
+        TOK_VALUE_OR_END,   // Wert oder ']' erwartet
+        TOK_AFTER_VALUE,    // ',' oder Containerende erwartet
+        TOK_STRING,
+        TOK_STRING_ESCAPE,
+        TOK_STRING_UNICODE,
+        TOK_SCALAR,         // Zahl oder Literal
+        TOK_DONE,
+        TOK_ERROR
+    } TokenState;
+
+    struct Frame {
+        Context ctx;
+        bool isArray;
+        uint8_t index;
+    };
+
+    void processChar(char c);
+    void beginValue(char c);
+    void openContainer(bool isArray);
+    void closeContainer();
+    void valueDone();
+    void selectTarget();
+    void appendChar(char c);
+    void appendCodepoint(uint16_t cp);
+    bool keyIs(const char* name) const;
+    Context childContext(bool isArray);
+
+    AmsTrayCallback _trayCallback;
+    void* _trayCtx;
+
+    Frame _stack[AMS_PARSER_MAX_DEPTH];
+    uint8_t _depth;
+    TokenState _state;
+    bool _stringIsKey;
+    uint8_t _unicodeDigits;
+    uint16_t _unicodeValue;
+
+    char _key[AMS_PARSER_KEY_LEN];
+    uint8_t _keyLen;
+    bool _keyTruncated;
+
+    char* _target;          // Zielpuffer für den aktuellen Wert oder nullptr
+    uint8_t _targetLen;
+    uint8_t _targetCap;
+    char _scalarBuf[6];
+    uint8_t _scalarLen;
+
+    uint8_t _amsIndex;
+    int16_t _amsId;
+    char _amsIdText[6];
+    AmsTrayReport _tray;
+
+    bool _hasAmsList;
+    uint8_t _amsCount;
+    bool _hasUpgradeState;
+    uint8_t _printPresent;
+    char _printValues[AMS_PRINT_FIELD_COUNT][AMS_PARSER_VALUE_LEN];
+    uint8_t _statusPresent;
+    char _statusValues[AMS_STATUS_FIELD_COUNT][AMS_PARSER_VALUE_LEN];
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "ams_tray.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Kopiert mit Nullauffüllung, damit der Hash über die ganze Struktur stabil bleibt
+// Copies with zero padding so the hash over the whole struct stays stable
+void copyTrayField(char* dst, size_t size, const char* src) {
+    strncpy(dst, src, size);
+    dst[size - 1] = '\0';
+}
+
+// FNV-1a über alle Bytes hinter dem Hash -- FNV-1a over all bytes after the hash
+uint32_t trayHash(const TrayData& tray) {
+    const uint8_t* bytes = (const uint8_t*)&tray + sizeof(tray.hash);
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < sizeof(TrayData) - sizeof(tray.hash); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Leerer Slot: keine Filamentdaten, Kalibrierung und Restmenge unbekannt
+// Empty slot: no filament data, calibration and remaining amount unknown
+void clearTray(TrayData& tray, uint8_t id) {
+    memset(&tray, 0, sizeof(tray));
+    tray.id = id;
+    tray.cali_idx = TRAY_CALI_UNSET;
+    tray.remain = TRAY_REMAIN_UNKNOWN;
+    tray.hash = trayHash(tray);
+}
+
+// Andere Spule im Slot: Filament, Farbe, Einstellung oder Kalibrierung. Restmenge und
+// Temperaturen ändern sich auch ohne Spulenwechsel und zählen nicht.
+// A different spool in the slot: filament, color, setting or calibration. Remaining amount
+// and temperatures also change without a spool swap and do not count.
+bool trayIdentityChanged(const TrayData& a, const TrayData& b) {
+    return strcmp(a.tray_info_idx, b.tray_info_idx) != 0 ||
+           strcmp(a.tray_type, b.tray_type) != 0 ||
+           strcmp(a.setting_id, b.setting_id) != 0 ||
+           a.tray_color != b.tray_color ||
+           (a.flags & TRAY_FLAG_HAS_COLOR) != (b.flags & TRAY_FLAG_HAS_COLOR) ||
+           a.cali_idx != b.cali_idx;
+}
+
+// Führt ein Tray aus dem Bericht mit dem gespeicherten Stand zusammen, true wenn sich der Hash geändert hat.
+// loaded wird gesetzt, wenn danach eine andere Spule im Slot liegt (Auslöser für Auto-Set).
+// Teilberichte enthalten nur geänderte Felder, fehlende Felder behalten ihren Wert.
+// Merges a tray from the report into the stored state, true if its hash changed.
+// loaded is set if a different spool sits in the slot afterwards (trigger for auto-set).
+// Partial reports only carry changed fields, missing fields keep their value.
+bool applyTrayReport(TrayData& stored, const AmsTrayReport& tray, uint8_t id, bool external, bool& loaded) {
+    TrayData next = stored;
+
+    // Nur die ID oder ein leerer tray_type: Slot wurde geleert -- only the id or an empty tray_type: slot was emptied
+    bool emptied = !(tray.present & ~(1U << AMS_FIELD_ID));
+    if (tray.has(AMS_FIELD_TRAY_TYPE) && tray.get(AMS_FIELD_TRAY_TYPE)[0] == '\0') emptied = true;
+    if (emptied) clearTray(next, id);
+    next.id = id;
+
+    if (tray.has(AMS_FIELD_TRAY_INFO_IDX)) copyTrayField(next.tray_info_idx, sizeof(next.tray_info_idx), tray.get(AMS_FIELD_TRAY_INFO_IDX));
+    if (tray.has(AMS_FIELD_TRAY_TYPE)) copyTrayField(next.tray_type, sizeof(next.tray_type), tray.get(AMS_FIELD_TRAY_TYPE));
+    if (tray.has(AMS_FIELD_TRAY_SUB_BRANDS)) copyTrayField(next.tray_sub_brands, sizeof(next.tray_sub_brands), tray.get(AMS_FIELD_TRAY_SUB_BRANDS));
+    if (tray.has(AMS_FIELD_NOZZLE_TEMP_MIN)) next.nozzle_temp_min = atoi(tray.get(AMS_FIELD_NOZZLE_TEMP_MIN));
+    if (tray.has(AMS_FIELD_NOZZLE_TEMP_MAX)) next.nozzle_temp_max = atoi(tray.get(AMS_FIELD_NOZZLE_TEMP_MAX));
+
+    if (tray.has(AMS_FIELD_TRAY_COLOR)) {
+        const char* trayColor = tray.get(AMS_FIELD_TRAY_COLOR);
+        next.tray_color = (trayColor[0] != '\0') ? strtoul(trayColor, nullptr, 16) : 0;
+        if (trayColor[0] != '\0') next.flags |= TRAY_FLAG_HAS_COLOR;
+        else next.flags &= ~TRAY_FLAG_HAS_COLOR;
+    }
+
+    // Leere setting_id im Bericht behält den bekannten Wert -- an empty setting_id keeps the known value
+    if (tray.has(AMS_FIELD_SETTING_ID) && tray.get(AMS_FIELD_SETTING_ID)[0] != '\0') {
+        copyTrayField(next.setting_id, sizeof(next.setting_id), tray.get(AMS_FIELD_SETTING_ID));
+    }
+
+    if (tray.has(AMS_FIELD_CALI_IDX)) {
+        const char* caliIdx = tray.get(AMS_FIELD_CALI_IDX);
+        next.cali_idx = (caliIdx[0] == '\0') ? TRAY_CALI_UNSET : (int16_t)atoi(caliIdx);
+    }
+
+    // Der Drucker meldet -1, wenn er die Restmenge nicht kennt -- the printer reports -1 if it does not know the remaining amount
+    if (tray.has(AMS_FIELD_REMAIN)) {
+        int remain = atoi(tray.get(AMS_FIELD_REMAIN));
+        next.remain = (remain < 0 || remain > 100) ? TRAY_REMAIN_UNKNOWN : (int8_t)remain;
+    }
+
+    // Ohne Filament keine Einstellungen -- no settings without filament
+    if (next.tray_type[0] == '\0') {
+        memset(next.setting_id, 0, sizeof(next.setting_id));
+        if (external) next.cali_idx = TRAY_CALI_UNSET;
+    }
+
+    next.hash = trayHash(next);
+    loaded = false;
+    if (next.hash == stored.hash) return false;
+
+    // Ein geleerter Slot ist kein Ziel für Auto-Set -- an emptied slot is no target for auto-set
+    loaded = next.tray_type[0] != '\0' && trayIdentityChanged(stored, next);
+    stored = next;
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef AMS_TRAY_H
+#define AMS_TRAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ams_parser.h"
+
+// Gespeicherter Zustand eines AMS-Slots und das Zusammenführen mit Tray-Berichten des Parsers.
+// Ohne Arduino-Abhängigkeiten, damit die native Umgebung es mitbauen kann.
+// Stored state of one AMS slot and the merge with tray reports from the parser.
+// Free of Arduino dependencies so the native env can build it as well.
+
+#define TRAY_CALI_UNSET         INT16_MIN   // cali_idx nicht gesetzt
+#define TRAY_REMAIN_UNKNOWN     -1          // remain nicht gemeldet
+#define TRAY_FLAG_HAS_COLOR     0x01
+#define TRAY_NOW_NONE           255         // kein Tray aktiv -- no tray active
+
+// Feste Struktur ohne Heap-Strings -- fixed layout without heap Strings
+struct TrayData {
+    uint32_t hash;              // FNV-1a über den Rest der Struktur, muss vorne stehen
+    uint32_t tray_color;        // RGBA, z.B. 0xFF0000FF
+    int16_t nozzle_temp_min;
+    int16_t nozzle_temp_max;
+    int16_t cali_idx;           // TRAY_CALI_UNSET wenn leer
+    uint8_t id;
+    uint8_t flags;              // TRAY_FLAG_*
+    int8_t remain;              // Restmenge in %, TRAY_REMAIN_UNKNOWN wenn unbekannt
+    uint8_t reserved[3];        // kein Padding, der Hash deckt alle Bytes ab -- no padding, the hash covers every byte
+    char tray_info_idx[12];
+    char tray_type[16];
+    char tray_sub_brands[24];
+    char setting_id[24];
+};
+
+// Kopiert mit Nullauffüllung -- copies with zero padding
+void copyTrayField(char* dst, size_t size, const char* src);
+uint32_t trayHash(const TrayData& tray);
+void clearTray(TrayData& tray, uint8_t id);
+// Andere Spule im Slot, Restmenge und Temperaturen zählen nicht -- a different spool in the slot, remain and temperatures do not count
+bool trayIdentityChanged(const TrayData& a, const TrayData& b);
+// true wenn sich der Hash geändert hat, loaded bei einer neu eingelegten Spule
+// true if the hash changed, loaded when a different spool was inserted
+bool applyTrayReport(TrayData& stored, const AmsTrayReport& tray, uint8_t id, bool external, bool& loaded);
+
+#endif
@@ -5,6 +5,11 @@
 #include <Preferences.h>
 #include "debug.h"
 #include "scale.h"
+#include "consumption.h"
+#include "metrics.h"
+#include "json_writer.h"
+#include "logger.h"
+#include "ws_topics.h"
 
 volatile spoolmanApiStateType spoolmanApiState = API_IDLE;
 //bool spoolman_connected = false;
@@ -16,38 +21,57 @@ String octoToken = "";
 uint16_t remainingWeight = 0;
 bool spoolmanConnected = false;
 bool spoolmanExtraFieldsChecked = false;
+volatile bool spoolmanExtraFieldsFailed = false;
 TaskHandle_t* apiTask;
 
+// Health monitor / circuit breaker
+volatile spoolmanCircuitStateType spoolmanCircuitState = SPOOLMAN_CIRCUIT_CLOSED;
+TaskHandle_t spoolmanHealthTask = NULL;
+static portMUX_TYPE spoolmanHealthMux = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long spoolmanLastSuccess = 0;
+static unsigned long spoolmanNextProbe = 0;
+static uint32_t spoolmanRetryInterval = SPOOLMAN_HEALTHCHECK_RETRY_MIN;
+static uint8_t spoolmanFailureCount = 0;
+
 struct SendToApiParams {
     SpoolmanApiRequestType requestType;
-    String httpType;
+    const char* httpType;
     String spoolsUrl;
-    String updatePayload;
+    char updatePayload[API_PAYLOAD_MAX];    // JsonWriter schreibt direkt hierher -- JsonWriter writes straight into it
+    size_t payloadLength;
     String octoToken;
     // Weight update parameters for sequential execution
     bool triggerWeightUpdate;
     String spoolIdForWeight;
     uint16_t weightValue;
+    float useWeight;    // gebuchte Menge für API_REQUEST_SPOOL_USE_UPDATE
+    uint32_t useGeneration; // Wiege-Generation der Buchung -- weigh-in generation of the booking
 };
 
 JsonDocument fetchSingleSpoolInfo(int spoolId) {
+    JsonDocument filteredDoc;
+    if (spoolmanCircuitOpen()) {
+        LOG_W(LOG_MOD_API, "Spoolman nicht erreichbar, überspringe Spool-Abfrage -- unreachable, skipping spool fetch");
+        return filteredDoc;
+    }
+
     HTTPClient http;
     String spoolsUrl = spoolmanUrl + apiUrl + "/spool/" + spoolId;
 
-    Serial.print("Rufe Spool-Daten von: ");
-    Serial.println(spoolsUrl);
+    LOG_D(LOG_MOD_API, "Rufe Spool-Daten von -- fetching spool from %s", spoolsUrl.c_str());
 
     http.begin(spoolsUrl);
     int httpCode = http.GET();
 
-    JsonDocument filteredDoc;
+    if (httpCode > 0) spoolmanReportSuccess();
+    else spoolmanReportFailure();
+
     if (httpCode == HTTP_CODE_OK) {
         String payload = http.getString();
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, payload);
         if (error) {
-            Serial.print("Fehler beim Parsen der JSON-Antwort: ");
-            Serial.println(error.c_str());
+            LOG_W(LOG_MOD_API, "Fehler beim Parsen der JSON-Antwort -- JSON parse error: %s", error.c_str());
         } else {
             String filamentType = doc["filament"]["material"].as<String>();
             String filamentBrand = doc["filament"]["vendor"]["name"].as<String>();
@@ -78,6 +102,10 @@ JsonDocument fetchSingleSpoolInfo(int spoolId) {
             String bambu_setting_id = doc["filament"]["extra"]["bambu_setting_id"].as<String>(); // "\"PFUSf40e9953b40d3d\""
             bambu_setting_id.replace("\"", "");
 
+            // Filamentgewicht der vollen Spule, für die Verbrauchsschätzung aus remain%
+            float filament_weight = doc["initial_weight"] | 0.0f;
+            if (filament_weight <= 0) filament_weight = doc["filament"]["weight"] | 0.0f;
+
             doc.clear();
 
             filteredDoc["color"] = filamentColor;
@@ -88,10 +116,10 @@ JsonDocument fetchSingleSpoolInfo(int spoolId) {
             filteredDoc["tray_info_idx"] = tray_info_idx;
             filteredDoc["cali_idx"] = cali_idx;
             filteredDoc["bambu_setting_id"] = bambu_setting_id;
+            filteredDoc["filament_weight"] = filament_weight;
         }
     } else {
-        Serial.print("Fehler beim Abrufen der Spool-Daten. HTTP-Code: ");
-        Serial.println(httpCode);
+        LOG_W(LOG_MOD_API, "Fehler beim Abrufen der Spool-Daten -- spool fetch failed, HTTP %d", httpCode);
     }
 
     http.end();
@@ -102,22 +130,25 @@ void sendToApi(void *parameter) {
     HEAP_DEBUG_MESSAGE("sendToApi begin");
 
     // Wait until API is IDLE
+    if (spoolmanApiState != API_IDLE) LOG_D(LOG_MOD_API, "Warte auf freie API -- waiting for the API");
     while(spoolmanApiState != API_IDLE){
-        Serial.println("Waiting!");
-        yield();
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
     spoolmanApiState = API_TRANSMITTING;
     SendToApiParams* params = (SendToApiParams*)parameter;
 
     // Extract values including weight update parameters
     SpoolmanApiRequestType requestType = params->requestType;
-    String httpType = params->httpType;
+    const char* httpType = params->httpType;
     String spoolsUrl = params->spoolsUrl;
-    String updatePayload = params->updatePayload;
+    uint8_t* updatePayload = (uint8_t*)params->updatePayload;
+    size_t payloadLength = params->payloadLength;
     String octoToken = params->octoToken;
     bool triggerWeightUpdate = params->triggerWeightUpdate;
     String spoolIdForWeight = params->spoolIdForWeight;
     uint16_t weightValue = params->weightValue;    
+    float useWeight = params->useWeight;
+    uint32_t useGeneration = params->useGeneration;
 
     HTTPClient http;
     http.setReuse(false);
@@ -127,26 +158,30 @@ void sendToApi(void *parameter) {
     if (octoEnabled && octoToken != "") http.addHeader("X-Api-Key", octoToken);
 
     int httpCode;
-    if (httpType == "PATCH") httpCode = http.PATCH(updatePayload);
-    else if (httpType == "POST") httpCode = http.POST(updatePayload);
-    else httpCode = http.PUT(updatePayload);
+    if (strcmp(httpType, "PATCH") == 0) httpCode = http.PATCH(updatePayload, payloadLength);
+    else if (strcmp(httpType, "POST") == 0) httpCode = http.POST(updatePayload, payloadLength);
+    else httpCode = http.PUT(updatePayload, payloadLength);
+
+    // Jede Antwort von Spoolman zählt als Lebenszeichen, Verbindungsfehler öffnen den Circuit
+    if (requestType != API_REQUEST_OCTO_SPOOL_UPDATE) {
+        if (httpCode > 0) spoolmanReportSuccess();
+        else spoolmanReportFailure();
+    }
 
     if (httpCode == HTTP_CODE_OK) {
-        Serial.println("Spoolman erfolgreich aktualisiert");
+        LOG_I(LOG_MOD_API, "Spoolman erfolgreich aktualisiert -- updated");
 
         // Restgewicht der Spule auslesen
         String payload = http.getString();
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, payload);
         if (error) {
-            Serial.print("Fehler beim Parsen der JSON-Antwort: ");
-            Serial.println(error.c_str());
+            LOG_W(LOG_MOD_API, "Fehler beim Parsen der JSON-Antwort -- JSON parse error: %s", error.c_str());
         } else {
             switch(requestType){
             case API_REQUEST_SPOOL_WEIGHT_UPDATE:
                 remainingWeight = doc["remaining_weight"].as<uint16_t>();
-                Serial.print("Aktuelles Gewicht: ");
-                Serial.println(remainingWeight);
+                LOG_I(LOG_MOD_API, "Aktuelles Gewicht -- current weight: %u g", remainingWeight);
                 //oledShowMessage("Remaining: " + String(remaining_weight) + "g");
                 if(!octoEnabled){
                     // TBD: Do not use Strings...
@@ -163,6 +198,10 @@ void sendToApi(void *parameter) {
             case API_REQUEST_SPOOL_TAG_ID_UPDATE:
                 oledShowProgressBar(1, 1, "Write Tag", "Done!");
                 break;
+            case API_REQUEST_SPOOL_USE_UPDATE:
+                // Läuft im Hintergrund, keine Anzeige -- runs in the background, no display
+                LOG_I(LOG_MOD_API, "Verbrauch gebucht, Restgewicht -- use booked, remaining: %.1f g", doc["remaining_weight"].as<float>());
+                break;
             case API_REQUEST_OCTO_SPOOL_UPDATE:
                 // TBD: Do not use Strings...
                 oledShowProgressBar(5, 5, "Spool Tag", ("Done: " + String(remainingWeight) + " g remain").c_str());
@@ -174,37 +213,31 @@ void sendToApi(void *parameter) {
 
         // Execute weight update if requested and tag update was successful
         if (triggerWeightUpdate && requestType == API_REQUEST_SPOOL_TAG_ID_UPDATE && weightValue > 10) {
-            Serial.println("Executing weight update after successful tag update");
+            LOG_I(LOG_MOD_API, "Gewicht nach dem Tag-Update senden -- executing weight update after tag update");
             
             // Prepare weight update request
             String weightUrl = spoolmanUrl + apiUrl + "/spool/" + spoolIdForWeight + "/measure";
-            JsonDocument weightDoc;
-            weightDoc["weight"] = weightValue;
-            
-            String weightPayload;
-            serializeJson(weightDoc, weightPayload);
+            char weightPayload[32];
+            JsonWriter weightJson(weightPayload, sizeof(weightPayload));
+            weightJson.beginObject().add("weight", weightValue).endObject();
             
-            Serial.print("Weight update URL: ");
-            Serial.println(weightUrl);
-            Serial.print("Weight update payload: ");
-            Serial.println(weightPayload);
+            LOG_D(LOG_MOD_API, "Weight update %s %s", weightUrl.c_str(), weightJson.c_str());
 
             // Execute weight update
             http.begin(weightUrl);
             http.addHeader("Content-Type", "application/json");
             
-            int weightHttpCode = http.PUT(weightPayload);
+            int weightHttpCode = http.PUT((uint8_t*)weightPayload, weightJson.length());
             
             if (weightHttpCode == HTTP_CODE_OK) {
-                Serial.println("Weight update successful");
+                LOG_I(LOG_MOD_API, "Weight update successful");
                 String weightResponse = http.getString();
                 JsonDocument weightResponseDoc;
                 DeserializationError weightError = deserializeJson(weightResponseDoc, weightResponse);
                 
                 if (!weightError) {
                     remainingWeight = weightResponseDoc["remaining_weight"].as<uint16_t>();
-                    Serial.print("Updated weight: ");
-                    Serial.println(remainingWeight);
+                    LOG_I(LOG_MOD_API, "Updated weight: %u g", remainingWeight);
                     
                     if (!octoEnabled) {
                         oledShowProgressBar(1, 1, "Spool Tag", ("Done: " + String(remainingWeight) + " g remain").c_str());
@@ -215,12 +248,9 @@ void sendToApi(void *parameter) {
                 }
                 weightResponseDoc.clear();
             } else {
-                Serial.print("Weight update failed with HTTP code: ");
-                Serial.println(weightHttpCode);
+                LOG_W(LOG_MOD_API, "Weight update failed, HTTP %d", weightHttpCode);
                 oledShowProgressBar(1, 1, "Failure!", "Weight update");
             }
-            
-            weightDoc.clear();
         }
     } else {
         switch(requestType){
@@ -235,8 +265,14 @@ void sendToApi(void *parameter) {
         case API_REQUEST_BAMBU_UPDATE:
             oledShowProgressBar(1, 1, "Failure!", "Bambu update");
             break;
+        case API_REQUEST_SPOOL_USE_UPDATE:
+            // Nur Verbindungsfehler und 5xx wiederholen, 4xx wird nie gelingen (z.B. Spule gelöscht)
+            // Only retry transport errors and 5xx, a 4xx will never succeed (e.g. spool deleted)
+            if (httpCode <= 0 || httpCode >= 500) consumptionRestore(spoolIdForWeight.toInt(), useWeight, useGeneration);
+            else LOG_W(LOG_MOD_API, "Verbrauch: %.1f g für Spule %s abgelehnt -- rejected", useWeight, spoolIdForWeight.c_str());
+            break;
         }
-        Serial.println("Fehler beim Senden an Spoolman! HTTP Code: " + String(httpCode));
+        LOG_W(LOG_MOD_API, "Fehler beim Senden an Spoolman -- request failed, HTTP %d", httpCode);
 
         // TBD: really required?
         vTaskDelay(2000 / portTICK_PERIOD_MS);
@@ -252,54 +288,78 @@ void sendToApi(void *parameter) {
     vTaskDelete(NULL);
 }
 
+// Nutzlast steht schon in params->updatePayload, false wenn sie nicht hineinpasst
+// The payload is already in params->updatePayload, false if it did not fit
+static bool finishPayload(SendToApiParams* params, JsonWriter& json) {
+    if (json.overflowed()) {
+        LOG_E(LOG_MOD_API, "Fehler: Nutzlast zu groß -- payload too large");
+        return false;
+    }
+    params->payloadLength = json.length();
+    LOG_D(LOG_MOD_API, "Update Payload: %s", json.c_str());
+    return true;
+}
+
+// Wie as<String>(), aber ohne Heap -- like as<String>(), but without the heap
+static const char* variantText(JsonVariantConst value, char* out, size_t cap) {
+    if (value.is<const char*>()) return value.as<const char*>();
+    serializeJson(value, out, cap);
+    return out;
+}
+
 bool updateSpoolTagId(String uidString, const char* payload) {
+    if (spoolmanCircuitOpen()) {
+        oledShowProgressBar(1, 1, "Failure!", "Spoolman unavailable");
+        return false;
+    }
+
     oledShowProgressBar(2, 3, "Write Tag", "Update Spoolman");
 
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, payload);
     
     if (error) {
-        Serial.print("Fehler beim JSON-Parsing: ");
-        Serial.println(error.c_str());
+        LOG_W(LOG_MOD_API, "Fehler beim JSON-Parsing -- JSON parse error: %s", error.c_str());
         return false;
     }
     
     // Überprüfe, ob die erforderlichen Felder vorhanden sind
     if (!doc["sm_id"].is<String>() || doc["sm_id"].as<String>() == "") {
-        Serial.println("Keine Spoolman-ID gefunden.");
+        LOG_W(LOG_MOD_API, "Keine Spoolman-ID gefunden -- no Spoolman id");
         return false;
     }
 
     String spoolId = doc["sm_id"].as<String>();
     String spoolsUrl = spoolmanUrl + apiUrl + "/spool/" + spoolId;
-    Serial.print("Update Spule mit URL: ");
-    Serial.println(spoolsUrl);
+    LOG_D(LOG_MOD_API, "Update Spule mit URL: %s", spoolsUrl.c_str());
     
     doc.clear();
 
-    // Update Payload erstellen
-    JsonDocument updateDoc;
-    updateDoc["extra"]["nfc_id"] = "\""+uidString+"\"";
-    
-    String updatePayload;
-    serializeJson(updateDoc, updatePayload);
-    Serial.print("Update Payload: ");
-    Serial.println(updatePayload);
-
     SendToApiParams* params = new SendToApiParams();  
     if (params == nullptr) {
-        Serial.println("Fehler: Kann Speicher für Task-Parameter nicht allokieren.");
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
+        return false;
+    }
+
+    // Update Payload erstellen, Spoolman-Extrafelder sind JSON-Texte -- Spoolman extra fields are JSON text
+    char nfcId[48];
+    snprintf(nfcId, sizeof(nfcId), "\"%s\"", uidString.c_str());
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().beginObject("extra").add("nfc_id", nfcId).endObject().endObject();
+    if (!finishPayload(params, json)) {
+        delete params;
         return false;
     }
+
     params->requestType = API_REQUEST_SPOOL_TAG_ID_UPDATE;
     params->httpType = "PATCH";
     params->spoolsUrl = spoolsUrl;
-    params->updatePayload = updatePayload;
     
     // Add weight update parameters for sequential execution
     params->triggerWeightUpdate = (weight > 10);
     params->spoolIdForWeight = spoolId;
     params->weightValue = weight;
+    if (params->triggerWeightUpdate) consumptionWeighIn(spoolId.toInt(), weight);
 
     // Erstelle die Task mit erhöhter Stackgröße für zusätzliche HTTP-Anfrage
     BaseType_t result = xTaskCreate(
@@ -311,8 +371,6 @@ bool updateSpoolTagId(String uidString, const char* payload) {
         apiTask                   // Task-Handle (nicht benötigt)
     );
 
-    updateDoc.clear();
-
     // Update Spool weight now handled sequentially in sendToApi task
     // to prevent parallel API access issues
 
@@ -321,30 +379,33 @@ bool updateSpoolTagId(String uidString, const char* payload) {
 
 uint8_t updateSpoolWeight(String spoolId, uint16_t weight) {
     HEAP_DEBUG_MESSAGE("updateSpoolWeight begin");
+    if (spoolmanCircuitOpen()) {
+        LOG_W(LOG_MOD_API, "Spoolman nicht erreichbar, Gewicht wird nicht gesendet -- unreachable, weight not sent");
+        return 0;
+    }
+
+    // Das gemessene Gewicht ersetzt die Verbrauchsschätzung -- the measured weight replaces the consumption estimate
+    consumptionWeighIn(spoolId.toInt(), weight);
+
     oledShowProgressBar(3, octoEnabled?5:4, "Spool Tag", "Spoolman update");
     String spoolsUrl = spoolmanUrl + apiUrl + "/spool/" + spoolId + "/measure";
-    Serial.print("Update Spule mit URL: ");
-    Serial.println(spoolsUrl);
-
-    // Update Payload erstellen
-    JsonDocument updateDoc;
-    updateDoc["weight"] = weight;
-    
-    String updatePayload;
-    serializeJson(updateDoc, updatePayload);
-    Serial.print("Update Payload: ");
-    Serial.println(updatePayload);
+    LOG_D(LOG_MOD_API, "Update Spule mit URL: %s", spoolsUrl.c_str());
 
     SendToApiParams* params = new SendToApiParams();
     if (params == nullptr) {
         // TBD: reset ESP instead of showing a message
-        Serial.println("Fehler: Kann Speicher für Task-Parameter nicht allokieren.");
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
         return 0;
     }
+
+    // Update Payload erstellen
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().add("weight", weight).endObject();
+    finishPayload(params, json);
+
     params->requestType = API_REQUEST_SPOOL_WEIGHT_UPDATE;
     params->httpType = "PUT";
     params->spoolsUrl = spoolsUrl;
-    params->updatePayload = updatePayload;
 
     // Erstelle die Task
     BaseType_t result = xTaskCreate(
@@ -356,39 +417,81 @@ uint8_t updateSpoolWeight(String spoolId, uint16_t weight) {
         apiTask                      // Task-Handle (nicht benötigt)
     );
 
-    updateDoc.clear();
     HEAP_DEBUG_MESSAGE("updateSpoolWeight end");
 
     return 1;
 }
 
+bool updateSpoolUse(int spoolId, float grams, uint32_t generation) {
+    if (spoolmanCircuitOpen()) return false;
+
+    String spoolsUrl = spoolmanUrl + apiUrl + "/spool/" + spoolId + "/use";
+    LOG_D(LOG_MOD_API, "Verbrauch buchen mit URL -- booking use via %s", spoolsUrl.c_str());
+
+    SendToApiParams* params = new SendToApiParams();
+    if (params == nullptr) {
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
+        return false;
+    }
+
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().add("use_weight", grams, 2).endObject();
+    finishPayload(params, json);
+
+    params->requestType = API_REQUEST_SPOOL_USE_UPDATE;
+    params->httpType = "PUT";
+    params->spoolsUrl = spoolsUrl;
+    params->spoolIdForWeight = String(spoolId);
+    params->useWeight = grams;
+    params->useGeneration = generation;
+
+    // Erstelle die Task
+    BaseType_t result = xTaskCreate(
+        sendToApi,                // Task-Funktion
+        "SendToApiTask",          // Task-Name
+        6144,                     // Stackgröße in Bytes
+        (void*)params,            // Parameter
+        0,                        // Priorität
+        apiTask                   // Task-Handle (nicht benötigt)
+    );
+
+    if (result != pdPASS) {
+        delete params;
+        return false;
+    }
+    return true;
+}
+
 uint8_t updateSpoolLocation(String spoolId, String location){
     HEAP_DEBUG_MESSAGE("updateSpoolLocation begin");
+    if (spoolmanCircuitOpen()) {
+        oledShowProgressBar(1, 1, "Failure!", "Spoolman unavailable");
+        return 0;
+    }
 
     oledShowProgressBar(3, octoEnabled?5:4, "Loc. Tag", "Spoolman update");
 
     String spoolsUrl = spoolmanUrl + apiUrl + "/spool/" + spoolId;
-    Serial.print("Update Spule mit URL: ");
-    Serial.println(spoolsUrl);
-
-    // Update Payload erstellen
-    JsonDocument updateDoc;
-    updateDoc["location"] = location;
-    
-    String updatePayload;
-    serializeJson(updateDoc, updatePayload);
-    Serial.print("Update Payload: ");
-    Serial.println(updatePayload);
+    LOG_D(LOG_MOD_API, "Update Spule mit URL: %s", spoolsUrl.c_str());
 
     SendToApiParams* params = new SendToApiParams();
     if (params == nullptr) {
-        Serial.println("Fehler: Kann Speicher für Task-Parameter nicht allokieren.");
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
         return 0;
     }
+
+    // Update Payload erstellen
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().add("location", location.c_str()).endObject();
+    if (!finishPayload(params, json)) {
+        delete params;
+        oledShowProgressBar(1, 1, "Failure!", "Location too long");
+        return 0;
+    }
+
     params->requestType = API_REQUEST_SPOOL_LOCATION_UPDATE;
     params->httpType = "PATCH";
     params->spoolsUrl = spoolsUrl;
-    params->updatePayload = updatePayload;
 
 
     if(apiTask == nullptr){
@@ -402,11 +505,9 @@ uint8_t updateSpoolLocation(String spoolId, String location){
             apiTask                   // Task-Handle
         );
     }else{
-        Serial.println("Not spawning new task, API still active!");
+        LOG_W(LOG_MOD_API, "Not spawning new task, API still active!");
     }
 
-    updateDoc.clear();
-
     HEAP_DEBUG_MESSAGE("updateSpoolLocation end");
     return 1;
 }
@@ -415,27 +516,21 @@ bool updateSpoolOcto(int spoolId) {
     oledShowProgressBar(4, octoEnabled?5:4, "Spool Tag", "Octoprint update");
 
     String spoolsUrl = octoUrl + "/plugin/Spoolman/selectSpool";
-    Serial.print("Update Spule in Octoprint mit URL: ");
-    Serial.println(spoolsUrl);
-
-    JsonDocument updateDoc;
-    updateDoc["spool_id"] = spoolId;
-    updateDoc["tool"] = "tool0";
-
-    String updatePayload;
-    serializeJson(updateDoc, updatePayload);
-    Serial.print("Update Payload: ");
-    Serial.println(updatePayload);
+    LOG_D(LOG_MOD_API, "Update Spule in Octoprint mit URL: %s", spoolsUrl.c_str());
 
     SendToApiParams* params = new SendToApiParams();
     if (params == nullptr) {
-        Serial.println("Fehler: Kann Speicher für Task-Parameter nicht allokieren.");
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
         return false;
     }
+
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().add("spool_id", spoolId).add("tool", "tool0").endObject();
+    finishPayload(params, json);
+
     params->requestType = API_REQUEST_OCTO_SPOOL_UPDATE;
     params->httpType = "POST";
     params->spoolsUrl = spoolsUrl;
-    params->updatePayload = updatePayload;
     params->octoToken = octoToken;
 
     // Erstelle die Task
@@ -448,48 +543,57 @@ bool updateSpoolOcto(int spoolId) {
         apiTask                      // Task-Handle (nicht benötigt)
     );
 
-    updateDoc.clear();
-
     return true;
 }
 
 bool updateSpoolBambuData(String payload) {
+    if (spoolmanCircuitOpen()) {
+        LOG_W(LOG_MOD_API, "Spoolman nicht erreichbar, Bambu-Daten werden nicht gesendet -- unreachable, Bambu data not sent");
+        return false;
+    }
+
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, payload);
     if (error) {
-        Serial.print("Fehler beim JSON-Parsing: ");
-        Serial.println(error.c_str());
+        LOG_W(LOG_MOD_API, "Fehler beim JSON-Parsing -- JSON parse error: %s", error.c_str());
         return false;
     }
 
     String spoolsUrl = spoolmanUrl + apiUrl + "/filament/" + doc["filament_id"].as<String>();
-    Serial.print("Update Spule mit URL: ");
-    Serial.println(spoolsUrl);
+    LOG_D(LOG_MOD_API, "Update Spule mit URL: %s", spoolsUrl.c_str());
 
-    JsonDocument updateDoc;
-    updateDoc["extra"]["bambu_setting_id"] = "\"" + doc["setting_id"].as<String>() + "\"";
-    updateDoc["extra"]["bambu_cali_id"] = "\"" + doc["cali_idx"].as<String>() + "\"";
-    updateDoc["extra"]["bambu_idx"] = "\"" + doc["tray_info_idx"].as<String>() + "\"";
-    updateDoc["extra"]["nozzle_temperature"] = "[" + doc["temp_min"].as<String>() + "," + doc["temp_max"].as<String>() + "]";
-
-    String updatePayload;
-    serializeJson(updateDoc, updatePayload);
+    SendToApiParams* params = new SendToApiParams();
+    if (params == nullptr) {
+        LOG_E(LOG_MOD_API, "Fehler: Kann Speicher für Task-Parameter nicht allokieren -- out of memory");
+        return false;
+    }
 
+    // Spoolman-Extrafelder sind JSON-Texte: Strings samt Anführungszeichen, die Temperaturen als Array
+    // Spoolman extra fields are JSON text: strings with their quotes, the temperatures as an array
+    char text[2][24];
+    char settingId[40], caliId[40], trayIdx[40], nozzleTemp[40];
+    snprintf(settingId, sizeof(settingId), "\"%s\"", variantText(doc["setting_id"], text[0], sizeof(text[0])));
+    snprintf(caliId, sizeof(caliId), "\"%s\"", variantText(doc["cali_idx"], text[0], sizeof(text[0])));
+    snprintf(trayIdx, sizeof(trayIdx), "\"%s\"", variantText(doc["tray_info_idx"], text[0], sizeof(text[0])));
+    snprintf(nozzleTemp, sizeof(nozzleTemp), "[%s,%s]", variantText(doc["temp_min"], text[0], sizeof(text[0])),
+             variantText(doc["temp_max"], text[1], sizeof(text[1])));
     doc.clear();
-    updateDoc.clear();
-
-    Serial.print("Update Payload: ");
-    Serial.println(updatePayload);
 
-    SendToApiParams* params = new SendToApiParams();
-    if (params == nullptr) {
-        Serial.println("Fehler: Kann Speicher für Task-Parameter nicht allokieren.");
+    JsonWriter json(params->updatePayload, sizeof(params->updatePayload));
+    json.beginObject().beginObject("extra")
+        .add("bambu_setting_id", settingId)
+        .add("bambu_cali_id", caliId)
+        .add("bambu_idx", trayIdx)
+        .add("nozzle_temperature", nozzleTemp)
+        .endObject().endObject();
+    if (!finishPayload(params, json)) {
+        delete params;
         return false;
     }
+
     params->requestType = API_REQUEST_BAMBU_UPDATE;
     params->httpType = "PATCH";
     params->spoolsUrl = spoolsUrl;
-    params->updatePayload = updatePayload;
 
     // Erstelle die Task
     BaseType_t result = xTaskCreate(
@@ -580,13 +684,12 @@ bool checkSpoolmanExtraFields() {
             "\"key\": \"bambu_max_volspeed\"}"
         };
 
-        Serial.println("Überprüfe Extrafelder...");
+        LOG_I(LOG_MOD_API, "Überprüfe Extrafelder -- checking extra fields");
 
         int urlLength = sizeof(checkUrls) / sizeof(checkUrls[0]);
 
         for (uint8_t i = 0; i < urlLength; i++) {
-            Serial.println();
-            Serial.println("-------- Prüfe Felder für "+checkUrls[i]+" --------");
+            LOG_D(LOG_MOD_API, "Prüfe Felder für -- checking fields of %s", checkUrls[i].c_str());
             http.begin(checkUrls[i]);
             int httpCode = http.GET();
         
@@ -613,13 +716,13 @@ bool checkSpoolmanExtraFields() {
                         bool found = false;
                         for (JsonObject field : doc.as<JsonArray>()) {
                             if (field["key"].is<String>() && field["key"] == extraFields[s]) {
-                                Serial.println("Feld gefunden: " + extraFields[s]);
+                                LOG_D(LOG_MOD_API, "Feld gefunden -- field found: %s", extraFields[s].c_str());
                                 found = true;
                                 break;
                             }
                         }
                         if (!found) {
-                            Serial.println("Feld nicht gefunden: " + extraFields[s]);
+                            LOG_I(LOG_MOD_API, "Feld nicht gefunden, wird angelegt -- field missing, creating: %s", extraFields[s].c_str());
 
                             // Extrafeld hinzufügen
                             http.begin(checkUrls[i] + "/" + extraFields[s]);
@@ -637,7 +740,7 @@ bool checkSpoolmanExtraFields() {
                                 }
                             } else {
                                 // Fehler beim Senden der Anfrage
-                                Serial.println("Fehler beim Senden der Anfrage: " + String(http.errorToString(httpCode)));
+                                LOG_W(LOG_MOD_API, "Fehler beim Senden der Anfrage -- request failed: %s", http.errorToString(httpCode).c_str());
                                 return false;
                             }
                             //http.end();
@@ -650,8 +753,6 @@ bool checkSpoolmanExtraFields() {
             }
         }
         
-        Serial.println("-------- ENDE Prüfe Felder --------");
-        Serial.println();
 
         http.end();
 
@@ -671,9 +772,10 @@ bool checkSpoolmanInstance() {
         spoolmanApiState = API_TRANSMITTING;
         String healthUrl = spoolmanUrl + apiUrl + "/health";
 
-        Serial.print("Checking spoolman instance: ");
-        Serial.println(healthUrl);
+        LOG_D(LOG_MOD_API, "Checking spoolman instance: %s", healthUrl.c_str());
 
+        http.setConnectTimeout(SPOOLMAN_HEALTHCHECK_TIMEOUT);
+        http.setTimeout(SPOOLMAN_HEALTHCHECK_TIMEOUT);
         http.begin(healthUrl);
         int httpCode = http.GET();
 
@@ -683,47 +785,142 @@ bool checkSpoolmanInstance() {
                 JsonDocument doc;
                 DeserializationError error = deserializeJson(doc, payload);
                 if (!error && doc["status"].is<String>()) {
-                    const char* status = doc["status"];
+                    returnValue = strcmp(doc["status"].as<const char*>(), "healthy") == 0;
                     http.end();
 
                     if (!checkSpoolmanExtraFields()) {
-                        Serial.println("Fehler beim Überprüfen der Extrafelder.");
+                        LOG_W(LOG_MOD_API, "Fehler beim Überprüfen der Extrafelder -- extra field check failed");
+
+                        // Läuft auch im Health-Task, die Meldung zeigt loop() bzw. initSpoolman()
+                        spoolmanExtraFieldsFailed = true;
 
-                        // TBD
-                        oledShowMessage("Spoolman Error creating Extrafields");
-                        vTaskDelay(2000 / portTICK_PERIOD_MS);
-                        
+                        spoolmanApiState = API_IDLE;
                         return false;
                     }
-
-                    spoolmanApiState = API_IDLE;
-                    oledShowTopRow();
-                    spoolmanConnected = true;
-                    returnValue = strcmp(status, "healthy") == 0;
-                }else{
-                    spoolmanConnected = false;
                 }
 
                 doc.clear();
-            }else{
-                spoolmanConnected = false;
             }
         } else {
-            spoolmanConnected = false;
-            Serial.println("Error contacting spoolman instance! HTTP Code: " + String(httpCode));
+            LOG_W(LOG_MOD_API, "Error contacting spoolman instance, HTTP %d", httpCode);
         }
         http.end();
-        returnValue = false;
         spoolmanApiState = API_IDLE;
+
+        if (returnValue) spoolmanReportSuccess();
+        else spoolmanReportFailure();
     }else{
         // If the check is skipped, return the previous status
-        Serial.println("Skipping spoolman healthcheck, API is active.");
+        LOG_D(LOG_MOD_API, "Skipping spoolman healthcheck, API is active");
         returnValue = spoolmanConnected;
     }
-    Serial.println("Healthcheck completed!");
+    LOG_D(LOG_MOD_API, "Healthcheck completed");
     return returnValue;
 }
 
+void spoolmanReportSuccess() {
+    bool changed;
+    portENTER_CRITICAL(&spoolmanHealthMux);
+    changed = spoolmanCircuitState != SPOOLMAN_CIRCUIT_CLOSED || !spoolmanConnected;
+    spoolmanLastSuccess = millis();
+    spoolmanFailureCount = 0;
+    spoolmanRetryInterval = SPOOLMAN_HEALTHCHECK_RETRY_MIN;
+    spoolmanCircuitState = SPOOLMAN_CIRCUIT_CLOSED;
+    spoolmanConnected = true;
+    portEXIT_CRITICAL(&spoolmanHealthMux);
+
+    if (changed) LOG_I(LOG_MOD_API, "Spoolman erreichbar, Circuit geschlossen -- reachable, circuit closed");
+}
+
+void spoolmanReportFailure() {
+    bool opened = false;
+    uint32_t retryIn;
+    portENTER_CRITICAL(&spoolmanHealthMux);
+    if (spoolmanFailureCount < 255) spoolmanFailureCount++;
+
+    // Nächsten Probe-Zeitpunkt mit exponentiellem Backoff festlegen
+    retryIn = spoolmanRetryInterval;
+    spoolmanNextProbe = millis() + retryIn;
+    spoolmanRetryInterval = min((uint32_t)(spoolmanRetryInterval * 2), (uint32_t)SPOOLMAN_HEALTHCHECK_RETRY_MAX);
+
+    if (spoolmanFailureCount >= SPOOLMAN_CIRCUIT_FAILURE_THRESHOLD || spoolmanCircuitState == SPOOLMAN_CIRCUIT_HALF_OPEN) {
+        opened = spoolmanCircuitState != SPOOLMAN_CIRCUIT_OPEN;
+        spoolmanCircuitState = SPOOLMAN_CIRCUIT_OPEN;
+        spoolmanConnected = false;
+    }
+    portEXIT_CRITICAL(&spoolmanHealthMux);
+
+    if (opened) LOG_W(LOG_MOD_API, "Spoolman nicht erreichbar, Circuit geöffnet -- unreachable, circuit opened");
+    LOG_W(LOG_MOD_API, "Spoolman Fehler %u, nächster Versuch in %lu ms -- failure, next try in", spoolmanFailureCount, (unsigned long)retryIn);
+}
+
+bool spoolmanCircuitOpen() {
+    if (spoolmanCircuitState != SPOOLMAN_CIRCUIT_OPEN) return false;
+
+    // Backoff abgelaufen: einen Request als Probe durchlassen
+    portENTER_CRITICAL(&spoolmanHealthMux);
+    bool open = spoolmanCircuitState == SPOOLMAN_CIRCUIT_OPEN && (long)(millis() - spoolmanNextProbe) < 0;
+    if (!open) spoolmanCircuitState = SPOOLMAN_CIRCUIT_HALF_OPEN;
+    portEXIT_CRITICAL(&spoolmanHealthMux);
+    return open;
+}
+
+void spoolmanHealthLoop(void * parameter) {
+    LOG_I(LOG_MOD_API, "Spoolman Health Task gestartet -- started");
+    for(;;) {
+        // Neue URL aus dem Web-Handler weckt den Task sofort -- a new URL from the web handler wakes the task at once
+        bool requested = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) > 0;
+
+        if (requested) {
+            // Auf laufende API-Requests warten, das Ergebnis erwartet die Einstellungsseite
+            // Wait for running API requests, the settings page expects the result
+            while (spoolmanApiState != API_IDLE) vTaskDelay(pdMS_TO_TICKS(10));
+            bool healthy = spoolmanUrl != "" && checkSpoolmanInstance();
+            wsPublishText(WS_TOPIC_SYSTEM, healthy ? "{\"type\":\"spoolmanHealth\",\"healthy\":true}"
+                                                   : "{\"type\":\"spoolmanHealth\",\"healthy\":false}");
+            continue;
+        }
+
+        if (spoolmanUrl == "") continue;
+
+        unsigned long now = millis();
+        bool due;
+        portENTER_CRITICAL(&spoolmanHealthMux);
+        if (spoolmanFailureCount > 0) {
+            // Nach Fehlern nur im Backoff-Takt prüfen
+            due = (long)(now - spoolmanNextProbe) >= 0;
+        } else {
+            // Erfolgreiche API-Calls ersetzen den Healthcheck
+            due = now - spoolmanLastSuccess >= SPOOLMAN_HEALTHCHECK_INTERVAL;
+        }
+        if (due && spoolmanCircuitState == SPOOLMAN_CIRCUIT_OPEN) spoolmanCircuitState = SPOOLMAN_CIRCUIT_HALF_OPEN;
+        portEXIT_CRITICAL(&spoolmanHealthMux);
+
+        if (due && spoolmanApiState == API_IDLE) {
+            checkSpoolmanInstance();
+        }
+    }
+}
+
+void startSpoolmanHealthMonitor() {
+    if (spoolmanHealthTask != NULL) return;
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        spoolmanHealthLoop, /* Function to implement the task */
+        "SpoolmanHealth", /* Name of the task */
+        8192,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        spoolmanHealthTaskPrio,  /* Priority of the task */
+        &spoolmanHealthTask,  /* Task handle. */
+        spoolmanHealthTaskCore); /* Core where the task should run */
+
+    if (result != pdPASS) {
+        Serial.println("Fehler beim Erstellen des Spoolman Health Tasks");
+    } else {
+        metricsRegisterTask("SpoolmanHealth", spoolmanHealthTask);
+    }
+}
+
 bool saveSpoolmanUrl(const String& url, bool octoOn, const String& octo_url, const String& octoTk) {
     Preferences preferences;
     preferences.begin(NVS_NAMESPACE_API, false); // false = readwrite
@@ -735,12 +932,21 @@ bool saveSpoolmanUrl(const String& url, bool octoOn, const String& octo_url, con
 
     //TBD: This could be handled nicer in the future
     spoolmanExtraFieldsChecked = false;
+    portENTER_CRITICAL(&spoolmanHealthMux);
+    spoolmanFailureCount = 0;
+    spoolmanRetryInterval = SPOOLMAN_HEALTHCHECK_RETRY_MIN;
+    spoolmanCircuitState = SPOOLMAN_CIRCUIT_CLOSED;
+    portEXIT_CRITICAL(&spoolmanHealthMux);
     spoolmanUrl = url;
     octoEnabled = octoOn;
     octoUrl = octo_url;
     octoToken = octoTk;
 
-    return checkSpoolmanInstance();
+    // Der Healthcheck läuft im Health-Task, nicht im async_tcp-Task des Web-Handlers
+    // The health check runs in the health task, not in the web handler's async_tcp task
+    if (spoolmanHealthTask == NULL) return false;
+    xTaskNotifyGive(spoolmanHealthTask);
+    return true;
 }
 
 String loadSpoolmanUrl() {
@@ -762,6 +968,12 @@ bool initSpoolman() {
     spoolmanUrl = loadSpoolmanUrl();
     
     bool success = checkSpoolmanInstance();
+    if (spoolmanExtraFieldsFailed) {
+        spoolmanExtraFieldsFailed = false;
+        oledShowMessage("Spoolman Error creating Extrafields");
+        vTaskDelay(2000 / portTICK_PERIOD_MS);
+    }
+    startSpoolmanHealthMonitor();
     if (!success) {
         Serial.println("Spoolman not available");
         return false;
@@ -12,12 +12,19 @@ typedef enum {
     API_TRANSMITTING
 } spoolmanApiStateType;
 
+typedef enum {
+    SPOOLMAN_CIRCUIT_CLOSED,     // Spoolman erreichbar, Requests laufen normal
+    SPOOLMAN_CIRCUIT_OPEN,       // Zu viele Fehler, Requests schlagen sofort fehl
+    SPOOLMAN_CIRCUIT_HALF_OPEN   // Backoff abgelaufen, nächster Probe-Request entscheidet
+} spoolmanCircuitStateType;
+
 typedef enum {
     API_REQUEST_OCTO_SPOOL_UPDATE,
     API_REQUEST_BAMBU_UPDATE,
     API_REQUEST_SPOOL_TAG_ID_UPDATE,
     API_REQUEST_SPOOL_WEIGHT_UPDATE,
-    API_REQUEST_SPOOL_LOCATION_UPDATE
+    API_REQUEST_SPOOL_LOCATION_UPDATE,
+    API_REQUEST_SPOOL_USE_UPDATE
 } SpoolmanApiRequestType;
 
 extern volatile spoolmanApiStateType spoolmanApiState;
@@ -28,8 +35,16 @@ extern bool sendOctoUpdate;
 extern String octoUrl;
 extern String octoToken;
 extern bool spoolmanConnected;
+extern volatile bool spoolmanExtraFieldsFailed; // Extrafelder konnten nicht angelegt werden, loop() zeigt es an
+extern volatile spoolmanCircuitStateType spoolmanCircuitState;
 
 bool checkSpoolmanInstance();
+void startSpoolmanHealthMonitor(); // Startet den Hintergrund-Healthcheck
+void spoolmanReportSuccess(); // Erfolgreicher API-Call zählt als Lebenszeichen
+void spoolmanReportFailure(); // Fehlgeschlagener API-Call, erhöht Backoff
+bool spoolmanCircuitOpen(); // true = Spoolman gilt als nicht erreichbar, sofort abbrechen
+// Speichert und stößt den Healthcheck an, Ergebnis kommt als spoolmanHealth auf dem system-Thema
+// Stores and triggers the health check, the result arrives as spoolmanHealth on the system topic
 bool saveSpoolmanUrl(const String& url, bool octoOn, const String& octoWh, const String& octoTk);
 String loadSpoolmanUrl(); // Neue Funktion zum Laden der URL
 bool checkSpoolmanExtraFields(); // Neue Funktion zum Überprüfen der Extrafelder
@@ -37,6 +52,7 @@ JsonDocument fetchSingleSpoolInfo(int spoolId); // API-Funktion für die Webseit
 bool updateSpoolTagId(String uidString, const char* payload); // Neue Funktion zum Aktualisieren eines Spools
 uint8_t updateSpoolWeight(String spoolId, uint16_t weight); // Neue Funktion zum Aktualisieren des Gewichts
 uint8_t updateSpoolLocation(String spoolId, String location);
+bool updateSpoolUse(int spoolId, float grams, uint32_t generation); // Geschätzten Verbrauch buchen
 bool initSpoolman(); // Neue Funktion zum Initialisieren von Spoolman
 bool updateSpoolBambuData(String payload); // Neue Funktion zum Aktualisieren der Bambu-Daten
 bool updateSpoolOcto(int spoolId); // Neue Funktion zum Aktualisieren der Octo-Daten
@@ -1,9 +1,7 @@
 #include "bambu.h"
 #include <ArduinoJson.h>
-#include <PubSubClient.h>
 #include <WiFiManager.h>
-#include <SSLClient.h>
-#include "bambu_cert.h"
+#include "bambu_tls.h"
 #include "website.h"
 #include "nfc.h"
 #include "commonFS.h"
@@ -11,10 +9,50 @@
 #include "config.h"
 #include "display.h"
 #include <Preferences.h>
-
-WiFiClient espClient;
-SSLClient sslClient(&espClient);
-PubSubClient client(sslClient);
+#include "mqtt_stream.h"
+#include "ams_parser.h"
+#include "bambu_filament.h"
+#include "consumption.h"
+#include "metrics.h"
+#include "logger.h"
+
+// Verbindungsaufbau als Zustandsmaschine im MQTT-Task, kein Schritt wartet auf das Netz
+// Connection setup as a state machine in the MQTT task, no step waits for the network
+typedef enum {
+    BAMBU_LINK_BACKOFF,     // wartet bis nextAttempt -- waits until nextAttempt
+    BAMBU_LINK_TLS,         // TCP-Connect und TLS-Handshake laufen -- TCP connect and TLS handshake in progress
+    BAMBU_LINK_MQTT,        // CONNECT gesendet, CONNACK ausstehend -- CONNECT sent, CONNACK pending
+    BAMBU_LINK_ONLINE
+} BambuLinkState;
+
+#define EXTERNAL_DIRTY_INDEX (MAX_AMS - 1)
+
+// Verbindung und Parserzustand eines Druckers -- Connection and parser state of one printer
+struct BambuSession {
+    explicit BambuSession(uint8_t printerIndex) : printer(printerIndex), mqtt(tls) {}
+
+    uint8_t printer;
+    BambuCredentials credentials;   // Kopie für den MQTT-Task -- copy owned by the MQTT task
+    BambuTlsClient tls;
+    MqttStreamClient mqtt;
+    AmsReportParser parser;
+
+    BambuLinkState link = BAMBU_LINK_BACKOFF;
+    uint32_t backoff = BAMBU_RECONNECT_BACKOFF_MIN;
+    unsigned long nextAttempt = 0;
+
+    // Zustand des gerade empfangenen Berichts -- State of the report currently being received
+    int reportPrevAmsCount = 0;
+    int reportMaxUnit = 0;          // höchste AMS-ID + 1 in diesem Bericht -- highest AMS id + 1 in this report
+    bool reportTrayNowChanged = false;
+    uint32_t reportUs = 0;          // reine Verarbeitungszeit ohne Wartezeit auf Daten -- processing time without waiting for data
+    uint8_t reportDirty[MAX_AMS];  // Bitmaske geänderter Trays pro AMS, letzter Eintrag externe Spule -- bitmask of changed trays per AMS, last entry external spool
+    int autoSetAmsId = -1;
+    int autoSetTrayId = -1;
+    bool vtTrayStaged = false;
+    AmsTrayReport vtTrayReport;
+    bool printing = false;          // letzter gcode_state war RUNNING -- last gcode_state was RUNNING
+};
 
 TaskHandle_t BambuMqttTask;
 
@@ -23,669 +61,1112 @@ bool bambuDisabled = false;
 bool bambu_connected = false;
 int autoSetToBambuSpoolId = 0;
 
-BambuCredentials bambuCredentials;
+BambuAutoSend bambuAutoSend = { false, BAMBU_DEFAULT_AUTOSEND_TIME };
+BambuPrinter bambuPrinters[BAMBU_MAX_PRINTERS];
+
+static BambuSession* bambuSessions[BAMBU_MAX_PRINTERS];
+static SemaphoreHandle_t amsDataMutex = nullptr;
+
+// Ausgehende Nachricht anderer Tasks, nur der MQTT-Task fasst Session und TLS-Kontext an
+// Outbound message from other tasks, only the MQTT task touches the session and its TLS context
+struct BambuPublish {
+    uint8_t printer;
+    char* payload;          // malloc, gibt der MQTT-Task frei -- malloc'd, freed by the MQTT task
+};
+
+static QueueHandle_t publishQueue = nullptr;
+
+// Beenden des MQTT-Tasks, siehe bambuStopMqtt() -- stopping the MQTT task, see bambuStopMqtt()
+static volatile bool mqttStopRequested = false;
+static SemaphoreHandle_t mqttStopped = nullptr;
+
+// Drucker, deren Session der MQTT-Task neu aufbauen soll -- printers whose session the MQTT task should rebuild
+static uint8_t sessionReloadMask = 0;
+static portMUX_TYPE sessionReloadMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const printerLabels[BAMBU_MAX_PRINTERS] = { "0", "1", "2", "3" };
+// Verarbeitungszeit eines Berichts in µs -- processing time of one report in µs
+static const uint32_t reportBuckets[] = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 };
+static Metric* parsedMetrics[BAMBU_MAX_PRINTERS];
+static Metric* droppedMetrics[BAMBU_MAX_PRINTERS];
+static Metric* reportTimeMetric = nullptr;
+
+void bambuLockAmsData() {
+    if (amsDataMutex) xSemaphoreTake(amsDataMutex, portMAX_DELAY);
+}
+
+bool bambuTryLockAmsData(uint32_t timeoutMs) {
+    return !amsDataMutex || xSemaphoreTake(amsDataMutex, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void bambuUnlockAmsData() {
+    if (amsDataMutex) xSemaphoreGive(amsDataMutex);
+}
+
+bool bambuPrinterConfigured(uint8_t printer) {
+    return printer < BAMBU_MAX_PRINTERS && bambuPrinters[printer].credentials.ip != "" &&
+           bambuPrinters[printer].credentials.accesscode != "" && bambuPrinters[printer].credentials.serial != "";
+}
+
+// Drucker 0 nutzt die bisherigen NVS-Schlüssel, weitere hängen ihren Index an
+// Printer 0 keeps the legacy NVS keys, further printers append their index
+static String printerKey(const char* key, uint8_t printer) {
+    return (printer == 0) ? String(key) : String(key) + String(printer);
+}
+
+static void requestSessionReload(uint8_t printer) {
+    portENTER_CRITICAL(&sessionReloadMux);
+    sessionReloadMask |= (1 << printer);
+    portEXIT_CRITICAL(&sessionReloadMux);
+}
+
+static bool sessionReloadPending(uint8_t printer) {
+    portENTER_CRITICAL(&sessionReloadMux);
+    bool pending = sessionReloadMask & (1 << printer);
+    portEXIT_CRITICAL(&sessionReloadMux);
+    return pending;
+}
+
+static uint8_t takeSessionReloads() {
+    portENTER_CRITICAL(&sessionReloadMux);
+    uint8_t mask = sessionReloadMask;
+    sessionReloadMask = 0;
+    portEXIT_CRITICAL(&sessionReloadMux);
+    return mask;
+}
+
+// AMS-Speicher wächst nur, wenn der Drucker mehr Einheiten meldet -- AMS storage only grows when the printer reports more units
+static bool ensureAmsCapacity(BambuPrinter& printer, int count) {
+    if (count <= printer.ams_capacity) return true;
+    if (count > MAX_AMS - 1) return false;
+
+    AMSData* grown = (AMSData*)realloc(printer.ams_data, count * sizeof(AMSData));
+    if (!grown) {
+        LOG_E(LOG_MOD_BAMBU, "Kein Speicher für AMS-Daten -- No memory for AMS data");
+        return false;
+    }
+    for (int i = printer.ams_capacity; i < count; i++) {
+        grown[i].ams_id = i;
+        for (int j = 0; j < 4; j++) clearTray(grown[i].trays[j], j);
+    }
+    printer.ams_data = grown;
+    printer.ams_capacity = count;
+    return true;
+}
 
-// Globale Variablen für AMS-Daten -- Global variables for AMS data
-int ams_count = 0;
-String amsJsonData;  // Speichert das fertige JSON für WebSocket-Clients -- Stores the finished JSON for WebSocket clients
-AMSData ams_data[MAX_AMS];  // Definition des Arrays -- Definition of Arrays
+static void freePrinterState(uint8_t printer) {
+    if (bambuSessions[printer]) {
+        bambuSessions[printer]->mqtt.disconnect();
+        delete bambuSessions[printer];
+        bambuSessions[printer] = nullptr;
+    }
+
+    bambuLockAmsData();
+    free(bambuPrinters[printer].ams_data);
+    bambuPrinters[printer].ams_data = nullptr;
+    bambuPrinters[printer].ams_capacity = 0;
+    bambuPrinters[printer].ams_count = 0;
+    bambuPrinters[printer].has_external = false;
+    bambuPrinters[printer].tray_now = TRAY_NOW_NONE;
+    bambuPrinters[printer].connected = false;
+    memset(&bambuPrinters[printer].stats, 0, sizeof(BambuReportStats));
+    bambuUnlockAmsData();
+}
 
-bool removeBambuCredentials() {
-    if (BambuMqttTask) {
-        vTaskDelete(BambuMqttTask);
+static void updateConnectedState() {
+    bool anyConnected = false;
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        anyConnected |= bambuPrinters[i].connected;
     }
-    
+    if (anyConnected != bambu_connected) {
+        bambu_connected = anyConnected;
+        oledShowTopRow();
+    }
+}
+
+static bool anyPrinterConfigured() {
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        if (bambuPrinterConfigured(i)) return true;
+    }
+    return false;
+}
+
+static void startMqttTask() {
+    if (BambuMqttTask) return;
+
+    // Einmal registrieren, auch wenn der Task nicht starten konnte -- register once, even if the task failed to start
+    if (!reportTimeMetric) {
+        for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+            parsedMetrics[i] = metricsCounter("filaman_mqtt_messages_parsed_total", "MQTT reports parsed",
+                                              "printer", printerLabels[i]);
+        }
+        for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+            droppedMetrics[i] = metricsCounter("filaman_mqtt_messages_dropped_total", "MQTT reports dropped as unparseable",
+                                               "printer", printerLabels[i]);
+        }
+        reportTimeMetric = metricsHistogram("filaman_mqtt_report_duration_seconds", "Time to parse and apply one MQTT report",
+                                            reportBuckets, sizeof(reportBuckets) / sizeof(reportBuckets[0]), 1000000);
+    }
+
+    // Ein Task für alle Drucker, er lebt bis zum Neustart
+    // One task for all printers, it lives until reboot
+    xTaskCreatePinnedToCore(
+        mqtt_loop, /* Function to implement the task */
+        "BambuMqtt", /* Name of the task */
+        8192,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        mqttTaskPrio,  /* Priority of the task */
+        &BambuMqttTask,  /* Task handle. */
+        mqttTaskCore); /* Core where the task should run */
+    metricsRegisterTask("BambuMqtt", BambuMqttTask);
+}
+
+bool removeBambuCredentials(uint8_t printer) {
+    if (printer >= BAMBU_MAX_PRINTERS) return false;
+
     Preferences preferences;
     preferences.begin(NVS_NAMESPACE_BAMBU, false); // false = readwrite
-    preferences.remove(NVS_KEY_BAMBU_IP);
-    preferences.remove(NVS_KEY_BAMBU_SERIAL);
-    preferences.remove(NVS_KEY_BAMBU_ACCESSCODE);
-    preferences.remove(NVS_KEY_BAMBU_AUTOSEND_ENABLE);
-    preferences.remove(NVS_KEY_BAMBU_AUTOSEND_TIME);
+    preferences.remove(printerKey(NVS_KEY_BAMBU_IP, printer).c_str());
+    preferences.remove(printerKey(NVS_KEY_BAMBU_SERIAL, printer).c_str());
+    preferences.remove(printerKey(NVS_KEY_BAMBU_ACCESSCODE, printer).c_str());
+    preferences.remove(printerKey(NVS_KEY_BAMBU_FINGERPRINT, printer).c_str());
     preferences.end();
 
     // Löschen der globalen Variablen -- Delete the global variable
-    bambuCredentials.ip = "";
-    bambuCredentials.serial = "";
-    bambuCredentials.accesscode = "";
-    bambuCredentials.autosend_enable = false;
-    bambuCredentials.autosend_time = BAMBU_DEFAULT_AUTOSEND_TIME;
+    bambuLockAmsData();
+    bambuPrinters[printer].credentials.ip = "";
+    bambuPrinters[printer].credentials.serial = "";
+    bambuPrinters[printer].credentials.accesscode = "";
+    bambuPrinters[printer].credentials.fingerprint = "";
+    bambuUnlockAmsData();
 
     autoSetToBambuSpoolId = 0;
-    ams_count = 0;
-    amsJsonData = "";
+    bambuDisabled = !anyPrinterConfigured();
 
-    bambuDisabled = true;
+    // Der MQTT-Task baut die Session ab, die übrigen Drucker laufen weiter
+    // The MQTT task tears the session down, the remaining printers keep running
+    requestSessionReload(printer);
 
     return true;
 }
 
-bool saveBambuCredentials(const String& ip, const String& serialnr, const String& accesscode, bool autoSend, const String& autoSendTime) {
-    if (BambuMqttTask) {
-        vTaskDelete(BambuMqttTask);
-    }
+bool bambuFingerprintValid(const String& fingerprint) {
+    uint8_t digest[BAMBU_TLS_FINGERPRINT_LEN];
+    return fingerprint == "" || BambuTlsClient::parseFingerprint(fingerprint.c_str(), digest);
+}
+
+bool saveBambuCredentials(uint8_t printer, const String& ip, const String& serialnr, const String& accesscode, const String& fingerprint, bool autoSend, const String& autoSendTime) {
+    if (printer >= BAMBU_MAX_PRINTERS || !bambuFingerprintValid(fingerprint)) return false;
 
-    bambuCredentials.ip = ip.c_str();
-    bambuCredentials.serial = serialnr.c_str();
-    bambuCredentials.accesscode = accesscode.c_str();
-    bambuCredentials.autosend_enable = autoSend;
-    bambuCredentials.autosend_time = autoSendTime.toInt();
+    bambuLockAmsData();
+    bambuPrinters[printer].credentials.ip = ip.c_str();
+    bambuPrinters[printer].credentials.serial = serialnr.c_str();
+    bambuPrinters[printer].credentials.accesscode = accesscode.c_str();
+    bambuPrinters[printer].credentials.fingerprint = fingerprint.c_str();
+    bambuUnlockAmsData();
+    bambuAutoSend.enable = autoSend;
+    bambuAutoSend.time = autoSendTime.toInt();
 
     Preferences preferences;
     preferences.begin(NVS_NAMESPACE_BAMBU, false); // false = readwrite
-    preferences.putString(NVS_KEY_BAMBU_IP, bambuCredentials.ip);
-    preferences.putString(NVS_KEY_BAMBU_SERIAL, bambuCredentials.serial);
-    preferences.putString(NVS_KEY_BAMBU_ACCESSCODE, bambuCredentials.accesscode);
-    preferences.putBool(NVS_KEY_BAMBU_AUTOSEND_ENABLE, bambuCredentials.autosend_enable);
-    preferences.putInt(NVS_KEY_BAMBU_AUTOSEND_TIME, bambuCredentials.autosend_time);
+    preferences.putString(printerKey(NVS_KEY_BAMBU_IP, printer).c_str(), bambuPrinters[printer].credentials.ip);
+    preferences.putString(printerKey(NVS_KEY_BAMBU_SERIAL, printer).c_str(), bambuPrinters[printer].credentials.serial);
+    preferences.putString(printerKey(NVS_KEY_BAMBU_ACCESSCODE, printer).c_str(), bambuPrinters[printer].credentials.accesscode);
+    preferences.putString(printerKey(NVS_KEY_BAMBU_FINGERPRINT, printer).c_str(), bambuPrinters[printer].credentials.fingerprint);
+    preferences.putBool(NVS_KEY_BAMBU_AUTOSEND_ENABLE, bambuAutoSend.enable);
+    preferences.putInt(NVS_KEY_BAMBU_AUTOSEND_TIME, bambuAutoSend.time);
     preferences.end();
 
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-    if (!setupMqtt()) return false;
-
+    bambuDisabled = !anyPrinterConfigured();
+    requestSessionReload(printer);
+    // Verbindungsaufbau läuft im MQTT-Task, der Status kommt über bambu_connected/AMS-Updates
+    // Connecting happens in the MQTT task, the result arrives via bambu_connected/AMS updates
+    startMqttTask();
     return true;
 }
 
 bool loadBambuCredentials() {
+    bool found = false;
+
     Preferences preferences;
     preferences.begin(NVS_NAMESPACE_BAMBU, true);
-    String ip = preferences.getString(NVS_KEY_BAMBU_IP, "");
-    String serial = preferences.getString(NVS_KEY_BAMBU_SERIAL, "");
-    String code = preferences.getString(NVS_KEY_BAMBU_ACCESSCODE, "");
-    bool autosendEnable = preferences.getBool(NVS_KEY_BAMBU_AUTOSEND_ENABLE, false);
-    int autosendTime = preferences.getInt(NVS_KEY_BAMBU_AUTOSEND_TIME, BAMBU_DEFAULT_AUTOSEND_TIME);
+    bambuAutoSend.enable = preferences.getBool(NVS_KEY_BAMBU_AUTOSEND_ENABLE, false);
+    bambuAutoSend.time = preferences.getInt(NVS_KEY_BAMBU_AUTOSEND_TIME, BAMBU_DEFAULT_AUTOSEND_TIME);
+
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        String ip = preferences.getString(printerKey(NVS_KEY_BAMBU_IP, i).c_str(), "");
+        if (ip == "") continue;
+
+        bambuPrinters[i].credentials.ip = ip;
+        bambuPrinters[i].credentials.serial = preferences.getString(printerKey(NVS_KEY_BAMBU_SERIAL, i).c_str(), "");
+        bambuPrinters[i].credentials.accesscode = preferences.getString(printerKey(NVS_KEY_BAMBU_ACCESSCODE, i).c_str(), "");
+        bambuPrinters[i].credentials.fingerprint = preferences.getString(printerKey(NVS_KEY_BAMBU_FINGERPRINT, i).c_str(), "");
+        found = true;
+
+        LOG_I(LOG_MOD_BAMBU, "credentials loaded loadCredentials! Printer %u", i);
+        LOG_D(LOG_MOD_BAMBU, "%s %s %s", bambuPrinters[i].credentials.ip.c_str(), bambuPrinters[i].credentials.serial.c_str(),
+              bambuPrinters[i].credentials.accesscode.c_str());
+    }
     preferences.end();
 
-    if(ip != ""){
-        bambuCredentials.ip = ip.c_str();
-        bambuCredentials.serial = serial.c_str();
-        bambuCredentials.accesscode = code.c_str();
-        bambuCredentials.autosend_enable = autosendEnable;
-        bambuCredentials.autosend_time = autosendTime;
-
-        Serial.println("credentials loaded loadCredentials!");
-        Serial.println(bambuCredentials.ip);
-        Serial.println(bambuCredentials.serial);
-        Serial.println(bambuCredentials.accesscode);
-        Serial.println(String(bambuCredentials.autosend_enable));
-        Serial.println(String(bambuCredentials.autosend_time));
-
+    if (found) {
+        LOG_D(LOG_MOD_BAMBU, "Auto send %d, %d s", bambuAutoSend.enable, bambuAutoSend.time);
         return true;
     }
-    else
-    {
-        Serial.println("Keine gültigen Bambu-Credentials gefunden. -- No valid Bambu credentials found");
-        return false;
-    }
+
+    LOG_W(LOG_MOD_BAMBU, "Keine gültigen Bambu-Credentials gefunden. -- No valid Bambu credentials found");
+    return false;
 }
 
-struct FilamentResult {
-    String key;
-    String type;
+// Eigene Zuordnungen Typ -> Filament-IDX, einmalig aus own_filaments.json geladen
+// Own type -> filament idx overrides, loaded once from own_filaments.json
+struct OwnFilament {
+    char type[24];
+    char key[12];
 };
 
-FilamentResult findFilamentIdx(String brand, String type) {
-    // JSON-Dokument für die Filament-Daten erstellen -- Create a JSON document for the filament data
+static OwnFilament* ownFilaments = nullptr;
+static size_t ownFilamentCount = 0;
+static bool ownFilamentsLoaded = false;
+
+static void loadOwnFilaments() {
+    if (ownFilamentsLoaded) return;
+    ownFilamentsLoaded = true;
+
     JsonDocument doc;
-    
-    // Laden der own_filaments.json -- Loading the own_filaments.json
-    String ownFilament = "";
     if (!loadJsonValue("/own_filaments.json", doc)) 
     {
-        Serial.println("Fehler beim Laden der eigenen Filament-Daten -- Error loading custom filament data");
-    }
-    else
-    {
-        // Durchsuche direkt nach dem Type als Schlüssel -- Search directly for the type as key
-        if (doc[type].is<String>()) {
-            ownFilament = doc[type].as<String>();
-        }
-        doc.clear();
+        LOG_W(LOG_MOD_BAMBU, "Fehler beim Laden der eigenen Filament-Daten -- Error loading custom filament data");
+        return;
     }
-    doc.clear();
 
-    // Laden der bambu_filaments.json -- Loading the bambu_filaments.json
-    if (!loadJsonValue("/bambu_filaments.json", doc)) 
-    {
-        Serial.println("Fehler beim Laden der Filament-Daten -- Error loading filament data");
-        return {"GFL99", "PLA"}; // Fallback auf Generic PLA
+    JsonObject own = doc.as<JsonObject>();
+    ownFilaments = (OwnFilament*)calloc(own.size(), sizeof(OwnFilament));
+    if (!ownFilaments) return;
+
+    for (JsonPair kv : own) {
+        if (!kv.value().is<const char*>()) continue;
+        OwnFilament& entry = ownFilaments[ownFilamentCount++];
+        strlcpy(entry.type, kv.key().c_str(), sizeof(entry.type));
+        strlcpy(entry.key, kv.value().as<const char*>(), sizeof(entry.key));
     }
+    LOG_I(LOG_MOD_BAMBU, "Eigene Filamente geladen: %u", (unsigned)ownFilamentCount);
+}
 
+FilamentResult findFilamentIdx(const char* brand, const char* type) {
     // Wenn eigener Typ -- If own type
-    if (ownFilament != "")
-    {
-        if (doc[ownFilament].is<String>()) 
-        {
-            return {ownFilament, doc[ownFilament].as<String>()};
+    for (size_t i = 0; i < ownFilamentCount; i++) {
+        if (strcmp(ownFilaments[i].type, type) == 0) {
+            const char* name = findFilamentName(ownFilaments[i].key);
+            if (name) return {ownFilaments[i].key, name};
+            break;
         }
     }
+    return lookupFilament(brand, type);
+}
 
-    // 1. Erst versuchen wir die exakte Brand + Type Kombination zu finden -- 1. First we try to find the exact brand + type combination
-    String searchKey;
-    if (brand == "Bambu" || brand == "Bambulab") {
-        searchKey = "Bambu " + type;
-    } else if (brand == "PolyLite") {
-        searchKey = "PolyLite " + type;
-    } else if (brand == "eSUN") {
-        searchKey = "eSUN " + type;
-    } else if (brand == "Overture") {
-        searchKey = "Overture " + type;
-    } else if (brand == "PolyTerra") {
-        searchKey = "PolyTerra " + type;
-    }
-
-    // Durchsuche alle Einträge nach der Brand + Type Kombination -- Search all entries for the Brand + Type combination
-    for (JsonPair kv : doc.as<JsonObject>()) {
-        if (kv.value().as<String>() == searchKey) {
-            return {kv.key().c_str(), kv.value().as<String>()};
-        }
-    }
+// Nur im MQTT-Task aufrufen -- only call from the MQTT task
+static bool publishRequest(uint8_t printer, const char* payload) {
+    BambuSession* session = (printer < BAMBU_MAX_PRINTERS) ? bambuSessions[printer] : nullptr;
+    if (!session || session->link != BAMBU_LINK_ONLINE) return false;
 
-    // 2. Wenn nicht gefunden, zerlege den type String in Wörter und suche nach jedem Wort -- If not found, split the type string into words and search for each word
-    // Sammle alle vorhandenen Filamenttypen aus der JSON -- Collect all existing filament types from the JSON
-    std::vector<String> knownTypes;
-    for (JsonPair kv : doc.as<JsonObject>()) {
-        String value = kv.value().as<String>();
-        // Extrahiere den Typ ohne Markennamen
-        if (value.indexOf(" ") != -1) {
-            value = value.substring(value.indexOf(" ") + 1);
-        }
-        if (!value.isEmpty()) {
-            knownTypes.push_back(value);
-        }
-    }
+    LOG_I(LOG_MOD_BAMBU, "Sending MQTT message to printer %u", printer);
+    LOG_D(LOG_MOD_BAMBU, "%s", payload);
+    return session->mqtt.publish(("device/" + session->credentials.serial + "/request").c_str(), payload);
+}
 
-    // Zerlege den Input-Type in Wörter -- Split the input type into words
-    String typeStr = type;
-    typeStr.trim();
-    
-    // Durchsuche für jedes bekannte Filament, ob es im Input vorkommt -- For each known filament, search whether it appears in the input
-    for (const String& knownType : knownTypes) {
-        if (typeStr.indexOf(knownType) != -1) {
-            // Suche nach diesem Typ in der Original-JSON -- Search for this type in the original JSON
-            for (JsonPair kv : doc.as<JsonObject>()) {
-                String value = kv.value().as<String>();
-                if (value.indexOf(knownType) != -1) {
-                    return {kv.key().c_str(), knownType};
-                }
-            }
-        }
-    }
+// Aus dem MQTT-Task direkt, sonst über publishQueue; true heißt dann nur eingereiht
+// Directly from the MQTT task, otherwise through publishQueue; true then only means queued
+bool sendMqttMessage(uint8_t printer, const String& payload) {
+    if (printer >= BAMBU_MAX_PRINTERS) return false;
+    if (BambuMqttTask && xTaskGetCurrentTaskHandle() == BambuMqttTask) return publishRequest(printer, payload.c_str());
 
-    // 3. Wenn immer noch nichts gefunden, gebe GFL99 zurück (Generic PLA) -- 3. If still nothing found, return GFL99 (Generic PLA)
-    return {"GFL99", "PLA"};
-}
+    if (!publishQueue || !bambuPrinters[printer].connected) return false;
 
-bool sendMqttMessage(const String& payload) {
-    Serial.println("Sending MQTT message");
-    Serial.println(payload);
-    if (client.publish(("device/"+bambuCredentials.serial+"/request").c_str(), payload.c_str())) 
-    {
-        return true;
+    BambuPublish msg = { printer, (char*)malloc(payload.length() + 1) };
+    if (!msg.payload) return false;
+    memcpy(msg.payload, payload.c_str(), payload.length() + 1);
+
+    // Nicht warten, der Aufrufer bekommt sofort Bescheid -- do not wait, the caller learns right away
+    if (xQueueSend(publishQueue, &msg, 0) != pdTRUE) {
+        LOG_W(LOG_MOD_BAMBU, "MQTT-Nachricht verworfen, Warteschlange voll -- MQTT message dropped, queue full");
+        free(msg.payload);
+        return false;
     }
-    
-    return false;
+    return true;
 }
 
-bool setBambuSpool(String payload) {
-    Serial.println("Spool settings in");
-    Serial.println(payload);
-
-    // Parse the JSON
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
-    if (error) {
-        Serial.print("Error parsing JSON: ");
-        Serial.println(error.c_str());
-        return false;
+// Sendet, was andere Tasks eingereiht haben; nur im MQTT-Task aufrufen
+// Publishes what other tasks queued; only call from the MQTT task
+static void servicePublishQueue() {
+    BambuPublish msg;
+    while (publishQueue && xQueueReceive(publishQueue, &msg, 0) == pdTRUE) {
+        if (!publishRequest(msg.printer, msg.payload)) {
+            LOG_E(LOG_MOD_BAMBU, "MQTT message to printer %u failed", msg.printer);
+        }
+        free(msg.payload);
     }
+}
 
-    int amsId = doc["amsId"];
-    int trayId = doc["trayId"];
-    String color = doc["color"].as<String>();
+// Serialisiert ein JSON-Objekt ohne die äußeren Klammern -- serializes a JSON object without the outer braces
+static String jsonFields(const JsonDocument& doc) {
+    String output;
+    serializeJson(doc, output);
+    return output.substring(1, output.length() - 1);
+}
+
+// Baut die Felder für ams_filament_setting und extrusion_cali_sel aus den Spooldaten, ohne ams_id/tray_id.
+// caliFields bleibt leer, wenn die Spule keine Kalibrierung hat.
+// Builds the ams_filament_setting and extrusion_cali_sel fields from the spool data, without ams_id/tray_id.
+// caliFields stays empty if the spool has no calibration.
+static void buildSpoolFields(JsonDocument& spool, String& filamentFields, String& caliFields) {
+    String color = spool["color"].as<String>();
     color.toUpperCase();
-    int minTemp = doc["nozzle_temp_min"];
-    int maxTemp = doc["nozzle_temp_max"];
-    String type = doc["type"].as<String>();
+    int minTemp = spool["nozzle_temp_min"];
+    int maxTemp = spool["nozzle_temp_max"];
+    String type = spool["type"].as<String>();
     // Normalize PLA variants only for Bambu AMS
     type.toUpperCase(); // optional, ensures "pla", "Pla+" also match
     if (type.startsWith("PLA")) {
         type = "PLA";
     }
-    String brand = doc["brand"].as<String>();
-    String tray_info_idx = (doc["tray_info_idx"].as<String>() != "-1") ? doc["tray_info_idx"].as<String>() : "";
+    String brand = spool["brand"].as<String>();
+    String tray_info_idx = (spool["tray_info_idx"].as<String>() != "-1") ? spool["tray_info_idx"].as<String>() : "";
     if (tray_info_idx == "") {
         if (brand != "" && type != "") {
-            FilamentResult result = findFilamentIdx(brand, type);
+            FilamentResult result = findFilamentIdx(brand.c_str(), type.c_str());
             tray_info_idx = result.key;
             type = result.type;  // Aktualisiere den type mit dem gefundenen Basistyp -- Update the type with the found base type
         }
     }
-    String setting_id = doc["bambu_setting_id"].as<String>();
-    String cali_idx = doc["cali_idx"].as<String>();
-
-    doc.clear();
+    String setting_id = spool["bambu_setting_id"].as<String>();
+    String cali_idx = spool["cali_idx"].as<String>();
+
+    JsonDocument fields;
+    fields["tray_color"] = color.length() == 8 ? color : color+"FF";
+    fields["nozzle_temp_min"] = minTemp;
+    fields["nozzle_temp_max"] = maxTemp;
+    fields["tray_type"] = type;
+    fields["tray_info_idx"] = tray_info_idx;
+    fields["setting_id"] = setting_id;
+    filamentFields = jsonFields(fields);
+
+    caliFields = "";
+    if (cali_idx != "") {
+        fields.clear();
+        fields["filament_id"] = tray_info_idx;
+        fields["nozzle_diameter"] = "0.4";
+        fields["cali_idx"] = cali_idx.toInt();
+        caliFields = jsonFields(fields);
+    }
+}
 
-    doc["print"]["sequence_id"] = "0";
-    doc["print"]["command"] = "ams_filament_setting";
-    doc["print"]["ams_id"] = amsId < 200 ? amsId : 255;
-    doc["print"]["tray_id"] = trayId < 200 ? trayId : 254;
-    doc["print"]["tray_color"] = color.length() == 8 ? color : color+"FF";
-    doc["print"]["nozzle_temp_min"] = minTemp;
-    doc["print"]["nozzle_temp_max"] = maxTemp;
-    doc["print"]["tray_type"] = type;
-    //doc["print"]["cali_idx"] = (cali_idx != "") ? cali_idx : "";
-    doc["print"]["tray_info_idx"] = tray_info_idx;
-    doc["print"]["setting_id"] = setting_id;
-    
-    // Serialize the JSON
-    String output;
-    serializeJson(doc, output);
+// Setzt nur noch ams_id/tray_id ein und sendet -- only fills in ams_id/tray_id and publishes
+static bool publishSpoolSetting(uint8_t printer, int amsId, int trayId, const String& filamentFields, const String& caliFields) {
+    String amsField = String(amsId < 200 ? amsId : 255);
+    String trayField = String(trayId < 200 ? trayId : 254);
 
-    if (sendMqttMessage(output)) {
-        Serial.println("Spool successfully set");
+    String output = "{\"print\":{\"sequence_id\":\"0\",\"command\":\"ams_filament_setting\",\"ams_id\":" + amsField +
+                    ",\"tray_id\":" + trayField + "," + filamentFields + "}}";
+    if (sendMqttMessage(printer, output)) {
+        LOG_I(LOG_MOD_BAMBU, "Spool successfully set");
     }
     else
     {
-        Serial.println("Failed to set spool");
+        LOG_E(LOG_MOD_BAMBU, "Failed to set spool");
         return false;
     }
-    
-    doc.clear();
     yield();
 
-    if (cali_idx != "") {
-        yield();
-        doc["print"]["sequence_id"] = "0";
-        doc["print"]["command"] = "extrusion_cali_sel";
-        doc["print"]["filament_id"] = tray_info_idx;
-        doc["print"]["nozzle_diameter"] = "0.4";
-        doc["print"]["cali_idx"] = cali_idx.toInt();
-        doc["print"]["tray_id"] = trayId < 200 ? trayId : 254;
-        //doc["print"]["ams_id"] = amsId < 200 ? amsId : 255;
-
-        // Serialize the JSON
-        String output;
-        serializeJson(doc, output);
-
-        if (sendMqttMessage(output)) {
-            Serial.println("Extrusion calibration successfully set");
+    if (caliFields != "") {
+        output = "{\"print\":{\"sequence_id\":\"0\",\"command\":\"extrusion_cali_sel\",\"tray_id\":" + trayField + "," + caliFields + "}}";
+        if (sendMqttMessage(printer, output)) {
+            LOG_I(LOG_MOD_BAMBU, "Extrusion calibration successfully set");
         }
         else
         {
-            Serial.println("Failed to set extrusion calibration");
+            LOG_E(LOG_MOD_BAMBU, "Failed to set extrusion calibration");
             return false;
         }
-
-        doc.clear();
         yield();
     }
 
     return true;
 }
 
-void autoSetSpool(int spoolId, uint8_t trayId) {
-    // wenn neue spule erkannt und autoSetToBambu > 0 -- if new spool detected and autoSetToBambu > 0
+bool setBambuSpool(String payload) {
+    LOG_I(LOG_MOD_BAMBU, "Spool settings in");
+    LOG_D(LOG_MOD_BAMBU, "%s", payload.c_str());
+
+    // Parse the JSON
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, payload);
+    if (error) {
+        LOG_W(LOG_MOD_BAMBU, "Error parsing JSON: %s", error.c_str());
+        return false;
+    }
+
+    // Ohne Angabe gilt der erste Drucker -- Defaults to the first printer
+    int printer = doc["printer"] | 0;
+    if (printer < 0 || printer >= BAMBU_MAX_PRINTERS) {
+        LOG_W(LOG_MOD_BAMBU, "Ungültiger Drucker -- Invalid printer");
+        return false;
+    }
+
+    int amsId = doc["amsId"];
+    int trayId = doc["trayId"];
+    String filamentFields;
+    String caliFields;
+    buildSpoolFields(doc, filamentFields, caliFields);
+    doc.clear();
+
+    return publishSpoolSetting(printer, amsId, trayId, filamentFields, caliFields);
+}
+
+// Auto-Set Nachricht, die schon beim Lesen des Tags vorbereitet wird. Der Spoolman-Abruf
+// läuft in einem eigenen Task, der MQTT-Task setzt beim Traywechsel nur noch das Ziel ein.
+// Auto-set message prepared as soon as the tag is read. The Spoolman fetch runs in its
+// own task, on a tray change the MQTT task only fills in the target.
+struct BambuAutoSetPayload {
+    int spoolId;            // 0 = nichts vorbereitet
+    bool ready;             // Abruf beendet -- fetch finished
+    bool valid;             // Abruf erfolgreich -- fetch succeeded
+    String filamentFields;
+    String caliFields;
+    float spoolWeight;      // für die Verbrauchsschätzung -- for the consumption estimate
+    bool pending;           // Ziel wartet auf den Abruf -- target waits for the fetch
+    uint8_t printer;
+    int amsId;
+    int trayId;
+};
+
+static BambuAutoSetPayload autoSetPayload = { 0, false, false, "", "", 0, false, 0, -1, -1 };
+
+static void prepareAutoSetTask(void* parameter) {
+    int spoolId = (int)(intptr_t)parameter;
     JsonDocument spoolInfo = fetchSingleSpoolInfo(spoolId);
+    String filamentFields;
+    String caliFields;
+    bool valid = !spoolInfo.isNull();
+    if (valid) buildSpoolFields(spoolInfo, filamentFields, caliFields);
+    float spoolWeight = spoolInfo["filament_weight"] | 0.0f;
+    spoolInfo.clear();
+
+    bambuLockAmsData();
+    // Inzwischen kann ein anderer Tag gelesen worden sein -- another tag may have been read meanwhile
+    if (autoSetPayload.spoolId == spoolId) {
+        autoSetPayload.filamentFields = filamentFields;
+        autoSetPayload.caliFields = caliFields;
+        autoSetPayload.spoolWeight = spoolWeight;
+        autoSetPayload.valid = valid;
+        autoSetPayload.ready = true;
+    }
+    bambuUnlockAmsData();
 
-    if (!spoolInfo.isNull())
-    {
-        // AMS und TRAY id ergänzen -- AMS and TRAY id complement
-        spoolInfo["amsId"] = 0;
-        spoolInfo["trayId"] = trayId;
+    LOG_I(LOG_MOD_BAMBU, "Auto set payload for spool %d %s", spoolId, valid ? "ready" : "failed");
+    vTaskDelete(NULL);
+}
+
+// Nur aufrufen, wenn der Lock gehalten wird -- only call with the lock held
+static void startAutoSetPrepare(int spoolId) {
+    autoSetPayload.spoolId = spoolId;
+    autoSetPayload.ready = false;
+    autoSetPayload.valid = false;
+
+    BaseType_t result = xTaskCreate(
+        prepareAutoSetTask,         // Task-Funktion
+        "AutoSetPrepare",           // Task-Name
+        6144,                       // Stackgröße in Bytes
+        (void*)(intptr_t)spoolId,   // Parameter
+        0,                          // Priorität
+        NULL                        // Task-Handle (nicht benötigt)
+    );
+    if (result != pdPASS) {
+        LOG_E(LOG_MOD_BAMBU, "Auto set prepare task could not be started");
+        autoSetPayload.ready = true;
+    }
+}
+
+void bambuPrepareAutoSet(int spoolId) {
+    if (spoolId <= 0) return;
 
-        Serial.println("Auto set spool");
-        Serial.println(spoolInfo.as<String>());
+    bambuLockAmsData();
+    // Ein Ziel für eine andere Spule ist hinfällig -- a target for another spool is void
+    if (autoSetPayload.spoolId != spoolId) autoSetPayload.pending = false;
+    // Bei jedem Lesen neu holen, die Spooldaten können sich geändert haben -- refetch on every read, the spool data may have changed
+    startAutoSetPrepare(spoolId);
+    bambuUnlockAmsData();
+}
 
-        setBambuSpool(spoolInfo.as<String>());
+// Nur mit gehaltenem Lock aufrufen -- only call with the lock held
+static int8_t trayRemain(const BambuPrinter& printer, int amsId, int trayId) {
+    if (trayId == 254) return printer.has_external ? printer.external_tray.remain : TRAY_REMAIN_UNKNOWN;
+    if (amsId < 0 || amsId >= printer.ams_count || trayId < 0 || trayId >= 4) return TRAY_REMAIN_UNKNOWN;
+    return printer.ams_data[amsId].trays[trayId].remain;
+}
 
+// Sendet die vorbereitete Nachricht, sobald Ziel und Abruf da sind; nur im MQTT-Task aufrufen
+// Publishes the prepared message once target and fetch are available; only call from the MQTT task
+static void serviceAutoSet() {
+    bambuLockAmsData();
+    if (!autoSetPayload.pending || !autoSetPayload.ready) {
+        bambuUnlockAmsData();
+        return;
+    }
+    autoSetPayload.pending = false;
+    // Auto-Set kann inzwischen abgelaufen sein -- auto set may have timed out meanwhile
+    bool valid = autoSetPayload.valid && autoSetPayload.spoolId == autoSetToBambuSpoolId;
+    uint8_t printer = autoSetPayload.printer;
+    int amsId = autoSetPayload.amsId;
+    int trayId = autoSetPayload.trayId;
+    String filamentFields = autoSetPayload.filamentFields;
+    String caliFields = autoSetPayload.caliFields;
+    int spoolId = autoSetPayload.spoolId;
+    float spoolWeight = autoSetPayload.spoolWeight;
+    bambuUnlockAmsData();
+
+    if (valid && publishSpoolSetting(printer, amsId, trayId, filamentFields, caliFields)) {
+        LOG_I(LOG_MOD_BAMBU, "Auto set spool");
         oledShowMessage("Spool set");
+
+        // Ab jetzt wird der Verbrauch dieses Trays der Spule zugerechnet -- from now on this tray's consumption is booked to the spool
+        bambuLockAmsData();
+        int8_t remain = trayRemain(bambuPrinters[printer], amsId, trayId);
+        bambuUnlockAmsData();
+        consumptionAssignTray(printer, amsId, trayId, spoolId, spoolWeight, remain);
     }
 
     // id wieder zurücksetzen damit abgeschlossen -- reset id again and completed
     autoSetToBambuSpoolId = 0;
 }
 
-void updateAmsWsData(JsonDocument& doc, JsonArray& amsArray, int& ams_count, JsonObject& vtTray) {
-    // Fortfahren mit der bestehenden Verarbeitung, da Änderungen gefunden wurden -- Continue with existing processing because changes were found
-    ams_count = amsArray.size();
-        
-    for (int i = 0; i < ams_count && i < 16; i++) {
-        JsonObject amsObj = amsArray[i];
-        JsonArray trayArray = amsObj["tray"].as<JsonArray>();
-
-        ams_data[i].ams_id = i; // Setze die AMS-ID -- Set the AMS ID
-        for (int j = 0; j < trayArray.size() && j < 4; j++) { // Annahme: Maximal 4 Trays pro AMS -- Acceptance: Maximum 4 trays per AMS
-            JsonObject trayObj = trayArray[j];
-
-            ams_data[i].trays[j].id = trayObj["id"].as<uint8_t>();
-            ams_data[i].trays[j].tray_info_idx = trayObj["tray_info_idx"].as<String>();
-            ams_data[i].trays[j].tray_type = trayObj["tray_type"].as<String>();
-            ams_data[i].trays[j].tray_sub_brands = trayObj["tray_sub_brands"].as<String>();
-            ams_data[i].trays[j].tray_color = trayObj["tray_color"].as<String>();
-            ams_data[i].trays[j].nozzle_temp_min = trayObj["nozzle_temp_min"].as<int>();
-            ams_data[i].trays[j].nozzle_temp_max = trayObj["nozzle_temp_max"].as<int>();
-            if (trayObj["tray_type"].as<String>() == "") ams_data[i].trays[j].setting_id = "";
-            ams_data[i].trays[j].cali_idx = trayObj["cali_idx"].as<String>();
-        }
+// Wird beim Traywechsel aus dem MQTT-Callback aufgerufen und blockiert nicht
+// Called from the MQTT callback on a tray change and never blocks
+static void autoSetSpool(uint8_t printer, int spoolId, int amsId, int trayId) {
+    bambuLockAmsData();
+    // wenn neue spule erkannt und der Tag nicht vorab gelesen wurde -- if a new spool was detected and the tag was not prepared yet
+    if (autoSetPayload.spoolId != spoolId) startAutoSetPrepare(spoolId);
+    autoSetPayload.pending = true;
+    autoSetPayload.printer = printer;
+    autoSetPayload.amsId = amsId;
+    autoSetPayload.trayId = trayId;
+    bambuUnlockAmsData();
+
+    serviceAutoSet();
+}
+
+static void serializeTray(JsonWriter& json, const TrayData& tray) {
+    char tmp[12];
+
+    json.beginObject();
+    json.add("id", tray.id);
+    json.add("tray_info_idx", tray.tray_info_idx);
+    json.add("tray_type", tray.tray_type);
+    json.add("tray_sub_brands", tray.tray_sub_brands);
+    if (tray.flags & TRAY_FLAG_HAS_COLOR) {
+        snprintf(tmp, sizeof(tmp), "%08X", (unsigned int)tray.tray_color);
+        json.add("tray_color", tmp);
+    } else {
+        json.add("tray_color", "");
     }
-    
-    // Setze ams_count auf die Anzahl der normalen AMS -- Set ams_count to the number of normal AMS
-    ams_count = amsArray.size();
-
-    // Wenn externe Spule vorhanden, füge sie hinzu -- If external spool is present, add it
-    if (doc["print"]["vt_tray"].is<JsonObject>()) {
-        //JsonObject vtTray = doc["print"]["vt_tray"];
-        int extIdx = ams_count;  // Index für externe Spule
-        ams_data[extIdx].ams_id = 255;  // Spezielle ID für externe Spule
-        ams_data[extIdx].trays[0].id = 254;  // Spezielle ID für externes Tray
-        ams_data[extIdx].trays[0].tray_info_idx = vtTray["tray_info_idx"].as<String>();
-        ams_data[extIdx].trays[0].tray_type = vtTray["tray_type"].as<String>();
-        ams_data[extIdx].trays[0].tray_sub_brands = vtTray["tray_sub_brands"].as<String>();
-        ams_data[extIdx].trays[0].tray_color = vtTray["tray_color"].as<String>();
-        ams_data[extIdx].trays[0].nozzle_temp_min = vtTray["nozzle_temp_min"].as<int>();
-        ams_data[extIdx].trays[0].nozzle_temp_max = vtTray["nozzle_temp_max"].as<int>();
-
-        if (doc["print"]["vt_tray"]["tray_type"].as<String>() != "")
-        {
-            //ams_data[extIdx].trays[0].setting_id = vtTray["setting_id"].as<String>();
-            ams_data[extIdx].trays[0].cali_idx = vtTray["cali_idx"].as<String>();
-        }
-        else
-        {
-            ams_data[extIdx].trays[0].setting_id = "";
-            ams_data[extIdx].trays[0].cali_idx = "";
+    json.add("nozzle_temp_min", tray.nozzle_temp_min);
+    json.add("nozzle_temp_max", tray.nozzle_temp_max);
+    json.add("remain", tray.remain);
+    json.add("setting_id", tray.setting_id);
+    // cali_idx bleibt für das Frontend ein String, "" wenn unbekannt
+    if (tray.cali_idx != TRAY_CALI_UNSET) {
+        snprintf(tmp, sizeof(tmp), "%d", tray.cali_idx);
+        json.add("cali_idx", tmp);
+    } else {
+        json.add("cali_idx", "");
+    }
+    json.endObject();
+}
+
+static void serializeAmsUnit(JsonWriter& json, int amsId, const TrayData* trays, int count) {
+    json.beginObject();
+    json.add("ams_id", amsId);
+    json.beginArray("tray");
+    for (int j = 0; j < count; j++) {
+        serializeTray(json, trays[j]);
+    }
+    json.endArray();
+    json.endObject();
+}
+
+void serializeAmsData(uint8_t printer, JsonWriter& json) {
+    const BambuPrinter& state = bambuPrinters[printer];
+
+    json.beginArray();
+    for (int i = 0; i < state.ams_count; i++) {
+        serializeAmsUnit(json, state.ams_data[i].ams_id, state.ams_data[i].trays, 4);
+    }
+    // Externe Spule als eigenes "AMS" 255 mit einem Tray -- External spool as its own "AMS" 255 with one tray
+    if (state.has_external) {
+        serializeAmsUnit(json, 255, &state.external_tray, 1);
+    }
+    json.endArray();
+}
+
+static void serializeTrayDelta(JsonWriter& json, int amsId, const TrayData& tray) {
+    json.beginObject();
+    json.add("ams_id", amsId);
+    json.key("tray");
+    serializeTray(json, tray);
+    json.endObject();
+}
+
+static void serializeAmsTrayDelta(uint8_t printer, JsonWriter& json) {
+    const BambuPrinter& state = bambuPrinters[printer];
+    const BambuSession* session = bambuSessions[printer];
+
+    json.beginArray();
+    for (int i = 0; session && i < state.ams_count; i++) {
+        if (!session->reportDirty[i]) continue;
+        for (int j = 0; j < 4; j++) {
+            if (session->reportDirty[i] & (1 << j)) serializeTrayDelta(json, state.ams_data[i].ams_id, state.ams_data[i].trays[j]);
         }
-        ams_count++;  // Erhöhe ams_count für die externe Spule -- Increase ams_count for the external spool
-    }
-
-    // Erstelle JSON für WebSocket-Clients -- Create JSON for WebSocket clients
-    JsonDocument wsDoc;
-    JsonArray wsArray = wsDoc.to<JsonArray>();
-
-    for (int i = 0; i < ams_count; i++) {
-        JsonObject amsObj = wsArray.add<JsonObject>();
-        amsObj["ams_id"] = ams_data[i].ams_id;
-
-        JsonArray trays = amsObj["tray"].to<JsonArray>();
-        int maxTrays = (ams_data[i].ams_id == 255) ? 1 : 4;
-        
-        for (int j = 0; j < maxTrays; j++) {
-            JsonObject trayObj = trays.add<JsonObject>();
-            trayObj["id"] = ams_data[i].trays[j].id;
-            trayObj["tray_info_idx"] = ams_data[i].trays[j].tray_info_idx;
-            trayObj["tray_type"] = ams_data[i].trays[j].tray_type;
-            trayObj["tray_sub_brands"] = ams_data[i].trays[j].tray_sub_brands;
-            trayObj["tray_color"] = ams_data[i].trays[j].tray_color;
-            trayObj["nozzle_temp_min"] = ams_data[i].trays[j].nozzle_temp_min;
-            trayObj["nozzle_temp_max"] = ams_data[i].trays[j].nozzle_temp_max;
-            trayObj["setting_id"] = ams_data[i].trays[j].setting_id;
-            trayObj["cali_idx"] = ams_data[i].trays[j].cali_idx;
+    }
+    if (session && state.has_external && session->reportDirty[EXTERNAL_DIRTY_INDEX]) {
+        serializeTrayDelta(json, 255, state.external_tray);
+    }
+    json.endArray();
+}
+
+// Sendet nur die geänderten Trays an die WebSocket-Clients -- Sends only the changed trays to the WebSocket clients
+static void sendAmsTrayDeltas(BambuSession& session) {
+    // Auch ein Wechsel des aktiven Trays allein ist eine Änderung -- a change of the active tray alone is a change too
+    bool anyDirty = session.reportTrayNowChanged;
+    for (int i = 0; i < MAX_AMS && !anyDirty; i++) {
+        anyDirty = session.reportDirty[i] != 0;
+    }
+    if (!anyDirty) return;
+
+    LOG_D(LOG_MOD_BAMBU, "AMS tray delta, printer %u", session.printer);
+    sendAmsMessage("amsTrayDelta", session.printer, serializeAmsTrayDelta, nullptr);
+}
+
+// Wird vom Parser für jedes abgeschlossene Tray-Objekt aufgerufen -- Called by the parser for every completed tray object
+static void mqtt_tray_callback(const AmsTrayReport& tray, void* ctx) {
+    BambuSession& session = *(BambuSession*)ctx;
+    BambuPrinter& printer = bambuPrinters[session.printer];
+
+    // Externe Spule erst am Ende übernehmen, erst dann steht fest, ob der Bericht vollständig ist
+    // External spool is applied at the end, only then it is known whether the report is complete
+    if (tray.amsIndex == AMS_PARSER_VT_INDEX) {
+        session.vtTrayReport = tray;
+        session.vtTrayStaged = true;
+        return;
+    }
+
+    // Teilberichte lassen unveränderte AMS und Trays weg, daher über die IDs statt die Position zuordnen
+    // Partial reports omit unchanged AMS units and trays, so map by id instead of position
+    int unit = (tray.amsId >= 0) ? tray.amsId : tray.amsIndex;
+    int trayId = tray.has(AMS_FIELD_ID) ? atoi(tray.get(AMS_FIELD_ID)) : tray.trayIndex;
+    if (unit >= MAX_AMS - 1 || trayId < 0 || trayId >= 4) return;
+
+    bambuLockAmsData();
+    if (ensureAmsCapacity(printer, unit + 1)) {
+        AMSData& ams = printer.ams_data[unit];
+        bool isNew = unit >= session.reportPrevAmsCount;
+        ams.ams_id = unit;
+        if (unit + 1 > session.reportMaxUnit) session.reportMaxUnit = unit + 1;
+
+        bool loaded;
+        if (applyTrayReport(ams.trays[trayId], tray, trayId, false, loaded)) {
+            session.reportDirty[unit] |= (1 << trayId);
+            if (loaded && !isNew && session.autoSetTrayId < 0) {
+                session.autoSetAmsId = unit;
+                session.autoSetTrayId = trayId;
+            }
         }
     }
+    bambuUnlockAmsData();
+}
 
-    serializeJson(wsArray, amsJsonData);
-    wsDoc.clear();
-    Serial.println("AMS data updated");
-    sendAmsData(nullptr);
+static void mqtt_message_begin(const char* topic, uint32_t length, void* ctx) {
+    BambuSession& session = *(BambuSession*)ctx;
+
+    session.reportPrevAmsCount = bambuPrinters[session.printer].ams_count;
+    session.reportMaxUnit = 0;
+    session.reportTrayNowChanged = false;
+    session.reportUs = 0;
+    bambuPrinters[session.printer].stats.bytes += length;
+    memset(session.reportDirty, 0, sizeof(session.reportDirty));
+    session.autoSetAmsId = -1;
+    session.autoSetTrayId = -1;
+    session.vtTrayStaged = false;
+    session.parser.begin();
 }
 
-// init
-void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-    String message;
-    
-    for (int i = 0; i < length; i++) {
-        message += (char)payload[i];
+static void mqtt_message_data(const uint8_t* data, size_t len, void* ctx) {
+    BambuSession& session = *(BambuSession*)ctx;
+    unsigned long start = micros();
+    session.parser.feed(data, len);
+    session.reportUs += micros() - start;
+}
+
+// Anzahl der AMS nach diesem Bericht -- number of AMS units after this report
+static int reportedAmsCount(const BambuSession& session, bool fullReport) {
+    const AmsReportParser& parser = session.parser;
+
+    // ams_exist_bits ist maßgeblich: höchstes gesetztes Bit + 1 -- ams_exist_bits is authoritative: highest set bit + 1
+    if (parser.hasStatusField(AMS_STATUS_EXIST_BITS)) {
+        unsigned long bits = strtoul(parser.statusField(AMS_STATUS_EXIST_BITS), nullptr, 16);
+        int count = 0;
+        while (bits) {
+            count++;
+            bits >>= 1;
+        }
+        return count;
     }
+    if (fullReport) return parser.amsCount();
 
-    // JSON-Dokument parsen -- Parse JSON document
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, message);
-    message = "";
-    if (error) 
+    // Teilbericht ohne Bitmaske: nur wachsen -- partial report without bitmask: only grow
+    return max(session.reportPrevAmsCount, session.reportMaxUnit);
+}
+
+static void mqtt_message_end(void* ctx) {
+    BambuSession& session = *(BambuSession*)ctx;
+    BambuPrinter& printer = bambuPrinters[session.printer];
+    AmsReportParser& parser = session.parser;
+    bool structureChanged = false;
+    bool autoSet = false;
+    unsigned long start = micros();
+    bool parsed = parser.finish();
+
+    if (!parsed) 
     {
-        Serial.print("Fehler beim Parsen des JSON: ");
-        Serial.println(error.c_str());
-        return;
+        LOG_W(LOG_MOD_BAMBU, "Fehler beim Parsen des JSON -- Error parsing JSON");
     }
 
-    // Prüfen, ob "print->upgrade_state" und "print.ams.ams" existieren -- Check if "print->upgrade_state" and "print.ams.ams" exist
-    if (doc["print"]["upgrade_state"].is<JsonObject>() || (doc["print"]["command"].is<String>() && doc["print"]["command"] == "push_status")) 
+    // msg 0 kennzeichnet einen vollständigen Bericht, ältere Firmware sendet kein msg
+    // msg 0 marks a complete report, older firmware sends no msg at all
+    bool fullReport = parsed && parser.hasAmsList() &&
+                      (!parser.hasPrintField(AMS_PRINT_MSG) || strcmp(parser.printField(AMS_PRINT_MSG), "0") == 0);
+
+    bambuLockAmsData();
+    if (parsed && (parser.hasAmsList() || parser.hasStatusField(AMS_STATUS_EXIST_BITS) || session.vtTrayStaged)) 
     {
-        // Prüfen ob AMS-Daten vorhanden sind -- Check whether AMS data is available
-        if (!doc["print"]["ams"].is<JsonObject>() || !doc["print"]["ams"]["ams"].is<JsonArray>()) 
-        {
-            return;
+        int prevCount = session.reportPrevAmsCount;
+        bool hadExternal = printer.has_external;
+        int count = min(reportedAmsCount(session, fullReport), MAX_AMS - 1);
+
+        // Auch AMS ohne gemeldete Trays brauchen einen Platz -- AMS units without reported trays need a slot too
+        if (!ensureAmsCapacity(printer, count)) {
+            count = min(count, (int)printer.ams_capacity);
+        }
+        for (int i = 0; i < count; i++) {
+            printer.ams_data[i].ams_id = i;
+        }
+        // Entfernte AMS leeren, damit sie beim Wiederanstecken nicht alte Daten zeigen
+        // Clear removed AMS units so they do not show stale data when plugged in again
+        for (int i = count; i < prevCount; i++) {
+            for (int j = 0; j < 4; j++) clearTray(printer.ams_data[i].trays[j], j);
         }
+        printer.ams_count = count;
 
-        JsonArray amsArray = doc["print"]["ams"]["ams"].as<JsonArray>();
-
-        // Prüfe ob sich die AMS-Daten geändert haben -- Check if the AMS data has changed
-        bool hasChanges = false;
-        
-        // Vergleiche jedes AMS und seine Trays -- Compare each AMS and its trays
-        for (int i = 0; i < amsArray.size() && !hasChanges; i++) {
-            JsonObject amsObj = amsArray[i];
-            int amsId = amsObj["id"].as<uint8_t>();
-            JsonArray trayArray = amsObj["tray"].as<JsonArray>();
-            
-            // Finde das entsprechende AMS in unseren Daten -- Find the corresponding AMS in our data
-            int storedIndex = -1;
-            for (int k = 0; k < ams_count; k++) {
-                if (ams_data[k].ams_id == amsId) {
-                    storedIndex = k;
-                    break;
-                }
-            }
-            
-            if (storedIndex == -1) {
-                hasChanges = true;
-                break;
-            }
+        // Teilberichte ohne vt_tray lassen die externe Spule unverändert -- partial reports without vt_tray leave the external spool as is
+        bool external = session.vtTrayStaged || (hadExternal && !fullReport);
+        if (count != prevCount || external != hadExternal) structureChanged = true;
 
-            // Vergleiche die Trays -- Compare the trays
-            for (int j = 0; j < trayArray.size() && j < 4 && !hasChanges; j++) {
-                JsonObject trayObj = trayArray[j];
-
-                if (trayObj["tray_type"].as<String>() == "") ams_data[storedIndex].trays[j].setting_id = "";
-                if (trayObj["setting_id"].isNull()) trayObj["setting_id"] = "";
-                if (trayObj["tray_info_idx"].as<String>() != ams_data[storedIndex].trays[j].tray_info_idx ||
-                    trayObj["tray_type"].as<String>() != ams_data[storedIndex].trays[j].tray_type ||
-                    trayObj["tray_color"].as<String>() != ams_data[storedIndex].trays[j].tray_color ||
-                    (trayObj["setting_id"].as<String>() != "" && trayObj["setting_id"].as<String>() != ams_data[storedIndex].trays[j].setting_id) ||
-                    trayObj["cali_idx"].as<String>() != ams_data[storedIndex].trays[j].cali_idx) {
-                    hasChanges = true;
-
-                    if (bambuCredentials.autosend_enable && autoSetToBambuSpoolId > 0 && hasChanges)
-                    {
-                        autoSetSpool(autoSetToBambuSpoolId, ams_data[storedIndex].trays[j].id);
-                    }
-
-                    break;
+        if (session.vtTrayStaged) 
+        {
+            if (!hadExternal) clearTray(printer.external_tray, 254);
+            bool loaded;
+            if (applyTrayReport(printer.external_tray, session.vtTrayReport, 254, true, loaded)) {
+                session.reportDirty[EXTERNAL_DIRTY_INDEX] |= 1;
+                if (loaded && session.autoSetTrayId < 0 && !structureChanged) {
+                    session.autoSetAmsId = 255;
+                    session.autoSetTrayId = 254;
                 }
             }
         }
+        printer.has_external = external;
 
-        // Prüfe die externe Spule -- Check the external spool
-        JsonObject vtTray = doc["print"]["vt_tray"];
-        if (doc["print"]["vt_tray"].is<JsonObject>()) {
-            for (int i = 0; i < ams_count; i++) {
-                if (ams_data[i].ams_id == 255) {
-                    if (vtTray["tray_type"].as<String>() == "") ams_data[i].trays[0].setting_id = "";
-                    if (vtTray["setting_id"].isNull()) vtTray["setting_id"] = "";
-                    if (vtTray["tray_info_idx"].as<String>() != ams_data[i].trays[0].tray_info_idx ||
-                        vtTray["tray_type"].as<String>() != ams_data[i].trays[0].tray_type ||
-                        vtTray["tray_color"].as<String>() != ams_data[i].trays[0].tray_color ||
-                        (vtTray["setting_id"].as<String>() != "" && vtTray["setting_id"].as<String>() != ams_data[i].trays[0].setting_id) ||
-                        (vtTray["tray_type"].as<String>() != "" && vtTray["cali_idx"].as<String>() != ams_data[i].trays[0].cali_idx)) {
-                        hasChanges = true;
-
-                        if (bambuCredentials.autosend_enable && autoSetToBambuSpoolId > 0 && hasChanges)
-                        {
-                            autoSetSpool(autoSetToBambuSpoolId, 254);
-                        }
-                    }
-                    break;
-                }
-            }
-        }
+        autoSet = bambuAutoSend.enable && autoSetToBambuSpoolId > 0 && session.autoSetTrayId >= 0;
+    }
 
-        if (!hasChanges) return;
+    if (parser.hasStatusField(AMS_STATUS_TRAY_NOW)) {
+        uint8_t trayNow = (uint8_t)atoi(parser.statusField(AMS_STATUS_TRAY_NOW));
+        if (trayNow != printer.tray_now) {
+            printer.tray_now = trayNow;
+            session.reportTrayNowChanged = true;
+        }
+    }
 
-        updateAmsWsData(doc, amsArray, ams_count, vtTray);
+    // Der letzte Abfall von remain kann im selben Bericht wie das Druckende kommen
+    // The last drop of remain may arrive in the same report as the end of the print
+    bool printing = session.printing;
+    if (parser.hasPrintField(AMS_PRINT_GCODE_STATE)) {
+        session.printing = strcmp(parser.printField(AMS_PRINT_GCODE_STATE), "RUNNING") == 0;
+        printing |= session.printing;
+    }
+    for (int i = 0; i < printer.ams_count; i++) {
+        for (int j = 0; j < 4; j++) {
+            if (!(session.reportDirty[i] & (1 << j))) continue;
+            const TrayData& tray = printer.ams_data[i].trays[j];
+            consumptionTrayReport(session.printer, i, j, tray.remain, tray.tray_type[0] != '\0', printing);
+        }
+    }
+    if (printer.has_external && session.reportDirty[EXTERNAL_DIRTY_INDEX]) {
+        consumptionTrayReport(session.printer, 255, 254, printer.external_tray.remain, printer.external_tray.tray_type[0] != '\0', printing);
     }
-    
+
     // Neue Bedingung für ams_filament_setting -- New condition for ams_filament_setting
-    if (doc["print"]["command"] == "ams_filament_setting") {
-        int amsId = doc["print"]["ams_id"].as<int>();
-        int trayId = doc["print"]["tray_id"].as<int>();
-        String settingId = (doc["print"]["setting_id"].is<String>()) ? doc["print"]["setting_id"].as<String>() : "";
+    if (parser.hasPrintField(AMS_PRINT_COMMAND) && strcmp(parser.printField(AMS_PRINT_COMMAND), "ams_filament_setting") == 0) {
+        int amsId = atoi(parser.printField(AMS_PRINT_AMS_ID));
+        int trayId = atoi(parser.printField(AMS_PRINT_TRAY_ID));
+        const char* settingId = parser.printField(AMS_PRINT_SETTING_ID);
+        TrayData* tray = nullptr;
 
         // Finde das entsprechende AMS und Tray -- Find the appropriate AMS and tray
-        for (int i = 0; i < ams_count; i++) {
-            if (ams_data[i].ams_id == amsId) {
-                if (trayId == 254)
-                {
-                    // Suche AMS mit ID 255 (externe Spule) -- Search AMS with ID 255 (external spool)
-                    for (int j = 0; j < ams_count; j++) {
-                        if (ams_data[j].ams_id == 255) {
-                            ams_data[j].trays[0].setting_id = settingId;
-                            break;
-                        }
-                    }
-                }
-                else
-                {
-                    ams_data[i].trays[trayId].setting_id = settingId;
-                }
-               
-                // Sende an WebSocket Clients -- Send to WebSocket clients
-                Serial.println("Filament setting updated");
-                sendAmsData(nullptr);
-                break;
+        if (trayId == 254) {
+            // Externe Spule (AMS ID 255) -- External spool (AMS ID 255)
+            if (printer.has_external) {
+                tray = &printer.external_tray;
+                session.reportDirty[EXTERNAL_DIRTY_INDEX] |= 1;
             }
+        } else if (amsId >= 0 && amsId < printer.ams_count && trayId >= 0 && trayId < 4) {
+            tray = &printer.ams_data[amsId].trays[trayId];
+            session.reportDirty[amsId] |= (1 << trayId);
+        }
+
+        if (tray) {
+            copyTrayField(tray->setting_id, sizeof(tray->setting_id), settingId);
+            tray->hash = trayHash(*tray);
+            LOG_I(LOG_MOD_BAMBU, "Filament setting updated");
         }
     }
+
+    BambuReportStats& stats = printer.stats;
+    uint32_t elapsed = session.reportUs + (micros() - start);
+    stats.reports++;
+    if (!parsed) stats.parseErrors++;
+    stats.totalUs += elapsed;
+    if (elapsed > stats.maxUs) stats.maxUs = elapsed;
+    bambuUnlockAmsData();
+
+    metricsInc(parsed ? parsedMetrics[session.printer] : droppedMetrics[session.printer]);
+    metricsObserve(reportTimeMetric, elapsed);
+
+    if (autoSet)
+    {
+        autoSetSpool(session.printer, autoSetToBambuSpoolId, session.autoSetAmsId, session.autoSetTrayId);
+    }
+
+    // Neue Clients bekommen den Snapshot beim Verbinden, sonst nur Deltas
+    // New clients get the snapshot on connect, otherwise only deltas are sent
+    if (structureChanged) 
+    {
+        LOG_I(LOG_MOD_BAMBU, "AMS layout changed, printer %u", session.printer);
+        sendPrinterAmsData(session.printer, nullptr);
+    } 
+    else 
+    {
+        sendAmsTrayDeltas(session);
+    }
 }
 
-void reconnect() {
-    // Loop until we're reconnected
-    uint8_t retries = 0;
-    while (!client.connected()) {
-        Serial.println("Attempting MQTT re/connection...");
-        bambu_connected = false;
-        oledShowTopRow();
+// Wartezeit mit Jitter, damit mehrere Geräte nicht im Gleichtakt neu verbinden
+// Delay with jitter so several devices do not reconnect in lockstep
+static void scheduleReconnect(BambuSession& session) {
+    session.tls.stop();
+    session.link = BAMBU_LINK_BACKOFF;
+    bambuPrinters[session.printer].connected = false;
 
-        // Attempt to connect
-        String clientId = bambuCredentials.serial + "_" + String(random(0, 100));
-        if (client.connect(clientId.c_str(), BAMBU_USERNAME, bambuCredentials.accesscode.c_str())) {
-            Serial.println("MQTT re/connected");
-
-            client.subscribe(("device/"+bambuCredentials.serial+"/report").c_str());
-            bambu_connected = true;
-            oledShowTopRow();
-        } else {
-            Serial.print("failed, rc=");
-            Serial.print(client.state());
-            Serial.println(" try again in 5 seconds");
-            bambu_connected = false;
-            oledShowTopRow();
-            
-            yield();
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
-            if (retries > 5) {
-                Serial.println("Disable Bambu MQTT Task after 5 retries");
-                //vTaskSuspend(BambuMqttTask);
-                vTaskDelete(BambuMqttTask);
-                break;
+    uint32_t delayMs = session.backoff / 2 + (uint32_t)random(session.backoff / 2 + 1);
+    session.nextAttempt = millis() + delayMs;
+    session.backoff = min((uint32_t)(session.backoff * 2), (uint32_t)BAMBU_RECONNECT_BACKOFF_MAX);
+
+    LOG_I(LOG_MOD_BAMBU, "Bambu Drucker %u: nächster Versuch in %lu ms", session.printer, (unsigned long)delayMs);
+}
+
+// Ein Schritt der Zustandsmaschine, kehrt sofort zurück -- One step of the state machine, returns immediately
+static void serviceSession(BambuSession& session) {
+    switch (session.link) {
+        case BAMBU_LINK_BACKOFF:
+            if ((long)(millis() - session.nextAttempt) < 0) return;
+
+            LOG_I(LOG_MOD_BAMBU, "Attempting MQTT re/connection, printer %u", session.printer);
+            if (!session.tls.beginConnect(session.credentials.ip.c_str(), BAMBU_MQTT_PORT)) {
+                scheduleReconnect(session);
+                return;
+            }
+            session.link = BAMBU_LINK_TLS;
+            return;
+
+        case BAMBU_LINK_TLS: {
+            int ret = session.tls.pollConnect();
+            if (ret == 0) return;
+
+            String clientId = session.credentials.serial + "_" + String(random(0, 100));
+            if (ret < 0 || !session.mqtt.startSession(clientId.c_str(), BAMBU_USERNAME, session.credentials.accesscode.c_str())) {
+                LOG_W(LOG_MOD_BAMBU, "Printer %u TLS connect failed", session.printer);
+                scheduleReconnect(session);
+                return;
+            }
+            session.link = BAMBU_LINK_MQTT;
+            return;
+        }
+
+        case BAMBU_LINK_MQTT: {
+            int ret = session.mqtt.pollSession();
+            if (ret == 0) return;
+
+            if (ret < 0) {
+                LOG_W(LOG_MOD_BAMBU, "Printer %u failed, rc=%d", session.printer, session.mqtt.state());
+                scheduleReconnect(session);
+                return;
             }
 
-            retries++;
+            session.mqtt.subscribe(("device/" + session.credentials.serial + "/report").c_str());
+            // Vollständigen Bericht anfordern, danach kommen nur noch Teilberichte
+            // Request a full report, afterwards the printer only sends partial ones
+            session.mqtt.publish(("device/" + session.credentials.serial + "/request").c_str(),
+                                 "{\"pushing\":{\"sequence_id\":\"0\",\"command\":\"pushall\"}}");
+            session.link = BAMBU_LINK_ONLINE;
+            session.backoff = BAMBU_RECONNECT_BACKOFF_MIN;
+            bambuPrinters[session.printer].stats.tlsHeap = session.tls.heapUsed();
+            bambuPrinters[session.printer].connected = true;
+            LOG_I(LOG_MOD_BAMBU, "MQTT re/connected, printer %u", session.printer);
+            return;
         }
+
+        case BAMBU_LINK_ONLINE:
+            if (session.mqtt.loop()) return;
+
+            LOG_W(LOG_MOD_BAMBU, "MQTT connection lost, printer %u, rc=%d", session.printer, session.mqtt.state());
+            scheduleReconnect(session);
+            return;
+    }
+}
+
+// Übernimmt neue oder gelöschte Zugangsdaten, nur im MQTT-Task aufrufen
+// Applies new or removed credentials, only call from the MQTT task
+static void applySessionReloads() {
+    uint8_t mask = takeSessionReloads();
+
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        if (!(mask & (1 << i))) continue;
+
+        freePrinterState(i);
+
+        bambuLockAmsData();
+        bool configured = bambuPrinterConfigured(i);
+        BambuCredentials credentials = bambuPrinters[i].credentials;
+        bambuUnlockAmsData();
+        if (!configured) continue;
+
+        BambuSession* session = new BambuSession(i);
+        session->credentials = credentials;
+        session->tls.setFingerprint(credentials.fingerprint.c_str());
+        session->nextAttempt = millis();
+        session->mqtt.setCallbacks(mqtt_message_begin, mqtt_message_data, mqtt_message_end, session);
+        session->parser.setTrayCallback(mqtt_tray_callback, session);
+        bambuSessions[i] = session;
+        LOG_I(LOG_MOD_BAMBU, "MQTT-Client initialisiert, printer %u", i);
+    }
+}
+
+// Baut alle Sessions ab und beendet den Task; läuft im MQTT-Task selbst
+// Tears all sessions down and ends the task; runs in the MQTT task itself
+static void stopMqttTask() {
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        freePrinterState(i);
+    }
+    BambuPublish msg;
+    while (publishQueue && xQueueReceive(publishQueue, &msg, 0) == pdTRUE) {
+        free(msg.payload);
     }
+    updateConnectedState();
+
+    LOG_I(LOG_MOD_BAMBU, "Bambu MQTT Task beendet");
+    metricsForgetTask(BambuMqttTask);
+    BambuMqttTask = NULL;
+    mqttStopRequested = false;
+    xSemaphoreGive(mqttStopped);
+    vTaskDelete(NULL);
 }
 
 void mqtt_loop(void * parameter) {
-    Serial.println("Bambu MQTT Task gestartet");
+    LOG_I(LOG_MOD_BAMBU, "Bambu MQTT Task gestartet");
     for(;;) {
-        if (pauseBambuMqttTask) {
-            vTaskDelay(10000);
+        // Pause in kurzen Schritten, damit bambuStopMqtt() nicht warten muss
+        // Pause in short steps so bambuStopMqtt() does not have to wait
+        for (int i = 0; i < 100 && pauseBambuMqttTask && !mqttStopRequested; i++) {
+            vTaskDelay(100);
         }
+        if (mqttStopRequested) stopMqttTask();
+
+        applySessionReloads();
+        servicePublishQueue();
+        serviceAutoSet();
 
-        if (!client.connected()) {
-            reconnect();
+        // Alle Drucker reihum bedienen -- Service all printers round-robin
+        bool busy = false;
+        for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+            BambuSession* session = bambuSessions[i];
+            if (!session) continue;
+
+            serviceSession(*session);
+            busy |= session->link == BAMBU_LINK_TLS || session->link == BAMBU_LINK_MQTT || session->mqtt.receiving();
             yield();
             esp_task_wdt_reset();
-            vTaskDelay(100);
         }
-        client.loop();
-        yield();
-        esp_task_wdt_reset();
-        vTaskDelay(100);
+
+        updateConnectedState();
+        // Während eines Handshakes oder halb empfangenen Berichts öfter nachsehen
+        // Poll more often while a handshake or a partially received report is pending
+        vTaskDelay(busy ? 10 : 100);
     }
 }
 
 bool setupMqtt() {
-    // Wenn Bambu Daten vorhanden -- If Bambu data is available
-    //bool success = loadBambuCredentials();
+    bool anyConfigured = false;
+
+    if (!amsDataMutex) amsDataMutex = xSemaphoreCreateMutex();
+    if (!publishQueue) publishQueue = xQueueCreate(BAMBU_PUBLISH_QUEUE_LENGTH, sizeof(BambuPublish));
+    if (!mqttStopped) mqttStopped = xSemaphoreCreateBinary();
+    loadOwnFilaments();
+
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        // Wenn Bambu Daten vorhanden -- If Bambu data is available
+        if (!bambuPrinterConfigured(i)) continue;
+        anyConfigured = true;
+        requestSessionReload(i);
+    }
 
-    if (bambuCredentials.ip != "" && bambuCredentials.accesscode != "" && bambuCredentials.serial != "") 
-    {
-        oledShowProgressBar(4, 7, DISPLAY_BOOT_TEXT, "Bambu init");
-        bambuDisabled = false;
-        sslClient.setCACert(root_ca);
-        sslClient.setInsecure();
-        client.setServer(bambuCredentials.ip.c_str(), 8883);
-
-        // Verbinden mit dem MQTT-Server -- Connecting to the MQTT server
-        bool connected = true;
-        String clientId = String(bambuCredentials.serial) + "_" + String(random(0, 100));
-        if (client.connect(bambuCredentials.ip.c_str(), BAMBU_USERNAME, bambuCredentials.accesscode.c_str())) 
-        {
-            client.setCallback(mqtt_callback);
-            client.setBufferSize(15488);
-            client.subscribe(("device/"+bambuCredentials.serial+"/report").c_str());
-            Serial.println("MQTT-Client initialisiert");
-
-            oledShowMessage("Bambu Connected");
-            bambu_connected = true;
-            oledShowTopRow();
-
-            xTaskCreatePinnedToCore(
-                mqtt_loop, /* Function to implement the task */
-                "BambuMqtt", /* Name of the task */
-                8192,  /* Stack size in words */
-                NULL,  /* Task input parameter */
-                mqttTaskPrio,  /* Priority of the task */
-                &BambuMqttTask,  /* Task handle. */
-                mqttTaskCore); /* Core where the task should run */
-        } 
-        else 
-        {
-            Serial.println("Fehler: Konnte sich nicht beim MQTT-Server anmelden -- Error: Could not connect to the MQTT server");
-            oledShowMessage("Bambu Connection Failed");
-            vTaskDelay(2000 / portTICK_PERIOD_MS);
-            connected = false;
-            oledShowTopRow();
-            autoSetToBambuSpoolId = 0;
-        }
+    bambuDisabled = !anyConfigured;
+    oledShowTopRow();
 
-        if (!connected) return false;
-    } 
-    else 
-    {
-        bambuDisabled = true;
-        return false;
-    }
+    if (!anyConfigured) return false;
+
+    // Verbunden wird im Task, setupMqtt() kehrt sofort zurück
+    // Connecting happens in the task, setupMqtt() returns immediately
+    if (!BambuMqttTask) oledShowProgressBar(4, 7, DISPLAY_BOOT_TEXT, "Bambu init");
+    startMqttTask();
     return true;
 }
 
+// Baut alle Sessions neu auf und versucht sofort zu verbinden -- Rebuilds all sessions and retries immediately
 void bambu_restart() {
-    Serial.println("Bambu restart");
+    LOG_I(LOG_MOD_BAMBU, "Bambu restart");
+    setupMqtt();
+}
 
-    if (BambuMqttTask) {
-        vTaskDelete(BambuMqttTask);
-        delay(10);
+// Der Task räumt selbst auf: ein vTaskDelete() von außen könnte amsDataMutex gesperrt lassen
+// und würde die mbedtls-Kontexte der Sessions nie freigeben
+// The task cleans up itself: a vTaskDelete() from outside could leave amsDataMutex locked
+// and would never free the sessions' mbedtls contexts
+bool bambuStopMqtt() {
+    if (!BambuMqttTask || !mqttStopped) return true;
+
+    xSemaphoreTake(mqttStopped, 0);
+    mqttStopRequested = true;
+    if (xSemaphoreTake(mqttStopped, pdMS_TO_TICKS(BAMBU_STOP_TIMEOUT)) != pdTRUE) {
+        LOG_W(LOG_MOD_BAMBU, "Bambu MQTT Task reagiert nicht -- Bambu MQTT task does not respond");
+        return false;
     }
-    setupMqtt();
-}
\ No newline at end of file
+    return true;
+}
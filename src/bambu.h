@@ -3,51 +3,86 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-
-struct TrayData {
-    uint8_t id;
-    String tray_info_idx;
-    String tray_type;
-    String tray_sub_brands;
-    String tray_color;
-    int nozzle_temp_min;
-    int nozzle_temp_max;
-    String setting_id;
-    String cali_idx;
-};
+#include "config.h"
+#include "json_writer.h"
+#include "ams_tray.h"
 
 struct BambuCredentials {
     String ip;
     String serial;
     String accesscode;
-    bool autosend_enable;
-    int autosend_time;
+    String fingerprint;     // SHA-256 des Druckerzertifikats als Hex, leer = kein Pinning
+};
+
+// Auto-Send gilt für alle Drucker -- auto send applies to all printers
+struct BambuAutoSend {
+    bool enable;
+    int time;
 };
 
-#define MAX_AMS 17  // 16 normale AMS + 1 externe Spule
-extern String amsJsonData;  // Für die vorbereiteten JSON-Daten
+#define MAX_AMS 17  // 16 normale AMS + 1 externe Spule, ams_data hält nur die normalen
 
 struct AMSData {
     uint8_t ams_id;
     TrayData trays[4]; // Annahme: Maximal 4 Trays pro AMS
 };
 
-extern bool bambu_connected;
+// Zähler für Lasttests mit scripts/bambu_simulator.py -- counters for load tests with scripts/bambu_simulator.py
+struct BambuReportStats {
+    uint32_t reports;
+    uint32_t bytes;
+    uint32_t parseErrors;
+    uint32_t maxUs;         // längste Verarbeitungszeit eines Berichts -- longest processing time of one report
+    uint64_t totalUs;
+    uint32_t tlsHeap;       // Heap der TLS-Sitzung nach dem Handshake -- heap of the TLS session after the handshake
+};
+
+// Öffentlicher Zustand pro Drucker, die Verbindung selbst liegt in bambu.cpp
+// Public per-printer state, the connection itself lives in bambu.cpp
+struct BambuPrinter {
+    BambuCredentials credentials;
+    bool connected;
+    int ams_count;          // Anzahl normaler AMS, Index = AMS-ID -- number of regular AMS units, index = AMS id
+    uint8_t ams_capacity;   // Anzahl Einträge in ams_data
+    AMSData* ams_data;      // wächst bei Bedarf, maximal MAX_AMS - 1
+    bool has_external;      // externe Spule (vt_tray) gemeldet -- external spool (vt_tray) reported
+    TrayData external_tray;
+    uint8_t tray_now;       // aktives Tray laut Drucker (AMS * 4 + Tray, 254 extern), TRAY_NOW_NONE wenn keins
+    BambuReportStats stats; // unter bambuLockAmsData() lesen -- read under bambuLockAmsData()
+};
+
+extern bool bambu_connected;    // mindestens ein Drucker verbunden -- at least one printer connected
 
-extern int ams_count;
-extern AMSData ams_data[MAX_AMS];
+extern BambuPrinter bambuPrinters[BAMBU_MAX_PRINTERS];
+extern BambuAutoSend bambuAutoSend;
 //extern bool autoSendToBambu;
 extern int autoSetToBambuSpoolId;
 extern bool bambuDisabled;
-extern BambuCredentials bambuCredentials;
 
-bool removeBambuCredentials();
+bool removeBambuCredentials(uint8_t printer);
 bool loadBambuCredentials();
-bool saveBambuCredentials(const String& bambu_ip, const String& bambu_serialnr, const String& bambu_accesscode, const bool autoSend, const String& autoSendTime);
+bool saveBambuCredentials(uint8_t printer, const String& bambu_ip, const String& bambu_serialnr, const String& bambu_accesscode, const String& bambu_fingerprint, const bool autoSend, const String& autoSendTime);
+bool bambuFingerprintValid(const String& fingerprint);
+bool bambuPrinterConfigured(uint8_t printer);
+// Startet den MQTT-Task, der alle Drucker selbstständig (wieder) verbindet
+// Starts the MQTT task, which (re)connects all printers on its own
 bool setupMqtt();
 void mqtt_loop(void * parameter);
 bool setBambuSpool(String payload);
+// Holt die Spooldaten im Hintergrund, damit Auto-Set beim Traywechsel sofort senden kann
+// Fetches the spool data in the background so auto set can publish right away on a tray change
+void bambuPrepareAutoSet(int spoolId);
 void bambu_restart();
+void serializeAmsData(uint8_t printer, JsonWriter& json);
+// Schützt ams_data und Zugangsdaten gegen den MQTT-Task -- guards ams_data and credentials against the MQTT task
+void bambuLockAmsData();
+void bambuUnlockAmsData();
+// Für den async_tcp-Task: false nach timeoutMs, dann nicht entsperren
+// For the async_tcp task: false after timeoutMs, do not unlock then
+bool bambuTryLockAmsData(uint32_t timeoutMs);
+// Beendet den MQTT-Task und gibt alle Sessions frei, z.B. vor dem OTA-Update
+// Stops the MQTT task and frees all sessions, e.g. before an OTA update
+bool bambuStopMqtt();
 
 extern TaskHandle_t BambuMqttTask;
 #endif
@@ -0,0 +1,61 @@
+#include "bambu_filament.h"
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "bambu_filament_index.h"
+
+// Binäre Suche in einer sortierten Tabelle -- binary search in a sorted table
+static const FilamentIndexEntry* findFilamentEntry(const FilamentIndexEntry* table, size_t count, const char* needle, bool byKey) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(byKey ? table[mid].key : table[mid].value, needle);
+        if (cmp == 0) return &table[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return nullptr;
+}
+
+const char* findFilamentName(const char* key) {
+    const FilamentIndexEntry* entry = findFilamentEntry(filamentByKey, FILAMENT_BY_KEY_COUNT, key, true);
+    return entry ? entry->value : nullptr;
+}
+
+FilamentResult lookupFilament(const char* brand, const char* type) {
+    // 1. Erst versuchen wir die exakte Brand + Type Kombination zu finden -- 1. First we try to find the exact brand + type combination
+    const char* prefix = nullptr;
+    if (strcmp(brand, "Bambu") == 0 || strcmp(brand, "Bambulab") == 0) prefix = "Bambu";
+    else if (strcmp(brand, "PolyLite") == 0) prefix = "PolyLite";
+    else if (strcmp(brand, "eSUN") == 0) prefix = "eSUN";
+    else if (strcmp(brand, "Overture") == 0) prefix = "Overture";
+    else if (strcmp(brand, "PolyTerra") == 0) prefix = "PolyTerra";
+
+    if (prefix) {
+        char searchKey[64];
+        snprintf(searchKey, sizeof(searchKey), "%s %s", prefix, type);
+        const FilamentIndexEntry* entry = findFilamentEntry(filamentByValue, FILAMENT_BY_VALUE_COUNT, searchKey, false);
+        if (entry) return {entry->key, entry->value};
+    }
+
+    // 2. Wenn nicht gefunden, nach bekannten Typen im Input suchen -- If not found, search the input for known types
+    // Führende/abschließende Leerzeichen ignorieren -- ignore leading/trailing whitespace
+    while (isspace((unsigned char)*type)) type++;
+    size_t typeLen = strlen(type);
+    while (typeLen > 0 && isspace((unsigned char)type[typeLen - 1])) typeLen--;
+
+    char typeStr[64];
+    if (typeLen >= sizeof(typeStr)) typeLen = sizeof(typeStr) - 1;
+    memcpy(typeStr, type, typeLen);
+    typeStr[typeLen] = '\0';
+
+    for (size_t i = 0; i < FILAMENT_KNOWN_TYPES_COUNT; i++) {
+        if (strstr(typeStr, filamentKnownTypes[i].value)) {
+            return {filamentKnownTypes[i].key, filamentKnownTypes[i].value};
+        }
+    }
+
+    // 3. Wenn immer noch nichts gefunden, gebe GFL99 zurück (Generic PLA) -- 3. If still nothing found, return GFL99 (Generic PLA)
+    return {"GFL99", "PLA"};
+}
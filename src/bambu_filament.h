@@ -0,0 +1,23 @@
+#ifndef BAMBU_FILAMENT_H
+#define BAMBU_FILAMENT_H
+
+#include <stddef.h>
+
+// Zuordnung Marke + Typ -> Bambu Filament-IDX über die vorab erzeugten Tabellen
+// aus bambu_filament_index.h, ohne Dateizugriff und ohne JSON.
+// Maps brand + type to a Bambu filament idx using the pregenerated tables from
+// bambu_filament_index.h, without file access and without JSON.
+
+struct FilamentResult {
+    const char* key;
+    const char* type;
+};
+
+// Exakter Filament-IDX, nullptr wenn unbekannt -- exact filament idx, nullptr if unknown
+const char* findFilamentName(const char* key);
+
+// Schritte 1-3 der Suche, eigene Filamente prüft findFilamentIdx() in bambu.cpp vorher
+// Steps 1-3 of the lookup, findFilamentIdx() in bambu.cpp checks own filaments first
+FilamentResult lookupFilament(const char* brand, const char* type);
+
+#endif
@@ -0,0 +1,373 @@
+#include "bambu_tls.h"
+#include <WiFi.h>
+#include "lwip/sockets.h"
+#include "logger.h"
+
+BambuTlsClient::BambuTlsClient()
+    : _state(TLS_IDLE), _connectStart(0), _handshakeStart(0), _peekByte(-1), _rngReady(false), _sslReady(false),
+      _hasSession(false), _pinEnabled(false),
+      _heapBefore(0), _heapUsed(0) {
+    mbedtls_net_init(&_net);
+    mbedtls_ssl_config_init(&_conf);
+    mbedtls_ssl_session_init(&_session);
+    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&_ctrDrbg);
+}
+
+BambuTlsClient::~BambuTlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_config_free(&_conf);
+    mbedtls_ctr_drbg_free(&_ctrDrbg);
+    mbedtls_entropy_free(&_entropy);
+}
+
+void BambuTlsClient::fatal(const char* what, int ret) {
+    LOG_W(LOG_MOD_BAMBU, "Bambu TLS: %s fehlgeschlagen -- failed (%d)", what, ret);
+    stop();
+}
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool BambuTlsClient::parseFingerprint(const char* hex, uint8_t* out) {
+    size_t len = 0;
+    int high = -1;
+
+    for (; *hex; hex++) {
+        if (*hex == ':' || *hex == ' ') continue;
+        int nibble = hexNibble(*hex);
+        if (nibble < 0 || len >= BAMBU_TLS_FINGERPRINT_LEN) return false;
+        if (high < 0) {
+            high = nibble;
+        } else {
+            out[len++] = (uint8_t)((high << 4) | nibble);
+            high = -1;
+        }
+    }
+    return len == BAMBU_TLS_FINGERPRINT_LEN && high < 0;
+}
+
+bool BambuTlsClient::setFingerprint(const char* hex) {
+    if (!hex || hex[0] == '\0') {
+        _pinEnabled = false;
+        return true;
+    }
+    _pinEnabled = parseFingerprint(hex, _pin);
+    return _pinEnabled;
+}
+
+void BambuTlsClient::clearSession() {
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_session_init(&_session);
+    _hasSession = false;
+}
+
+// Statt einer Zertifikatskette nur ein Hash-Vergleich -- a hash comparison instead of a chain walk
+bool BambuTlsClient::verifyFingerprint() {
+    const mbedtls_x509_crt* cert = mbedtls_ssl_get_peer_cert(&_ssl);
+    uint8_t digest[BAMBU_TLS_FINGERPRINT_LEN];
+
+    if (!cert) return !_pinEnabled;
+    if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), cert->raw.p, cert->raw.len, digest) != 0) return !_pinEnabled;
+
+    if (_pinEnabled) return memcmp(digest, _pin, sizeof(digest)) == 0;
+
+    // Ohne Pinning den Fingerprint ausgeben, damit er übernommen werden kann
+    // Without pinning print the fingerprint so it can be copied into the settings
+    char hex[sizeof(digest) * 2 + 1];
+    for (size_t i = 0; i < sizeof(digest); i++) snprintf(hex + i * 2, 3, "%02X", digest[i]);
+    LOG_I(LOG_MOD_BAMBU, "Bambu TLS: Zertifikat SHA-256 %s", hex);
+    return true;
+}
+
+void BambuTlsClient::cacheSession() {
+    clearSession();
+    _hasSession = mbedtls_ssl_get_session(&_ssl, &_session) == 0;
+}
+
+bool BambuTlsClient::checkTimeout() {
+    if (millis() - _connectStart <= BAMBU_TLS_CONNECT_TIMEOUT) return false;
+    fatal("connect timeout", (int)_state);
+    return true;
+}
+
+bool BambuTlsClient::setupSsl() {
+    int ret;
+
+    // RNG und Konfiguration einmal pro Client, der SSL-Kontext (mit seinen Puffern) pro Verbindung
+    // RNG and config once per client, the SSL context (with its buffers) per connection
+    if (!_rngReady) {
+        ret = mbedtls_ctr_drbg_seed(&_ctrDrbg, mbedtls_entropy_func, &_entropy, (const unsigned char*)"bambu", 5);
+        if (ret != 0) {
+            fatal("RNG seed", ret);
+            return false;
+        }
+        ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+        if (ret != 0) {
+            fatal("SSL config", ret);
+            return false;
+        }
+        // Drucker nutzen selbstsignierte Zertifikate -- printers use self-signed certificates
+        mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_ctrDrbg);
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+        // Kleinere Records anfordern: mit MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH schrumpft mbedtls die
+        // Puffer nach dem Handshake, sonst begrenzt es nur die Recordgröße des Druckers
+        // Request smaller records: with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH mbedtls shrinks the
+        // buffers after the handshake, otherwise it only bounds the printer's record size
+        mbedtls_ssl_conf_max_frag_len(&_conf, BAMBU_TLS_MAX_FRAG_LEN);
+#endif
+        _rngReady = true;
+    }
+
+    _heapBefore = ESP.getFreeHeap();
+    mbedtls_ssl_init(&_ssl);
+    _sslReady = true;
+    ret = mbedtls_ssl_setup(&_ssl, &_conf);
+    if (ret != 0) {
+        fatal("SSL setup", ret);
+        return false;
+    }
+    mbedtls_ssl_set_bio(&_ssl, &_net, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    // Gespeicherte Session anbieten, der Drucker entscheidet über die Wiederaufnahme
+    // Offer the cached session, the printer decides whether to resume it
+    if (_hasSession && mbedtls_ssl_set_session(&_ssl, &_session) != 0) clearSession();
+
+    _handshakeStart = millis();
+    return true;
+}
+
+bool BambuTlsClient::beginConnect(const char* host, uint16_t port) {
+    IPAddress ip;
+
+    stop();
+
+    // Drucker werden per IP eingetragen, DNS nur als Rückfall -- printers are configured by IP, DNS only as fallback
+    if (!ip.fromString(host) && !WiFi.hostByName(host, ip)) {
+        LOG_W(LOG_MOD_BAMBU, "Bambu TLS: Host %s nicht gefunden -- host not found", host);
+        return false;
+    }
+
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        LOG_E(LOG_MOD_BAMBU, "Bambu TLS: socket() fehlgeschlagen -- failed (%d)", errno);
+        return false;
+    }
+    _net.fd = fd;
+
+    int one = 1;
+    lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+
+    if (lwip_connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        fatal("TCP connect", errno);
+        return false;
+    }
+
+    _connectStart = millis();
+    _state = TLS_TCP_CONNECTING;
+    return true;
+}
+
+int BambuTlsClient::pollConnect() {
+    switch (_state) {
+        case TLS_CONNECTED:
+            return 1;
+
+        case TLS_IDLE:
+            return -1;
+
+        case TLS_TCP_CONNECTING: {
+            fd_set wfds;
+            struct timeval tv = { 0, 0 };
+            FD_ZERO(&wfds);
+            FD_SET(_net.fd, &wfds);
+
+            int ret = lwip_select(_net.fd + 1, NULL, &wfds, NULL, &tv);
+            if (ret < 0) {
+                fatal("select", errno);
+                return -1;
+            }
+            if (ret == 0) return checkTimeout() ? -1 : 0;
+
+            int err = 0;
+            socklen_t len = sizeof(err);
+            lwip_getsockopt(_net.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                fatal("TCP connect", err);
+                return -1;
+            }
+
+            if (!setupSsl()) return -1;
+            _state = TLS_HANDSHAKE;
+        }
+        // fall through
+
+        case TLS_HANDSHAKE: {
+            // Jeder Aufruf führt den Handshake so weit wie ohne Warten möglich
+            // Each call advances the handshake as far as possible without waiting
+            int ret = mbedtls_ssl_handshake(&_ssl);
+            if (ret == 0) {
+                if (!verifyFingerprint()) {
+                    clearSession();
+                    fatal("Fingerprint", 0);
+                    return -1;
+                }
+                LOG_I(LOG_MOD_BAMBU, "Bambu TLS: Handshake in %lu ms%s", millis() - _handshakeStart,
+                      _hasSession ? " (Session angeboten -- session offered)" : "");
+                cacheSession();
+                // Grobe Messung, andere Tasks allokieren nebenher -- rough measurement, other tasks allocate meanwhile
+                uint32_t heapNow = ESP.getFreeHeap();
+                _heapUsed = (_heapBefore > heapNow) ? _heapBefore - heapNow : 0;
+                LOG_I(LOG_MOD_BAMBU, "Bambu TLS: Sitzung belegt -- session uses ~%lu B Heap", (unsigned long)_heapUsed);
+                _state = TLS_CONNECTED;
+                return 1;
+            }
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                return checkTimeout() ? -1 : 0;
+            }
+            // Eine abgelehnte Session nicht noch einmal anbieten -- do not offer a rejected session again
+            clearSession();
+            fatal("TLS handshake", ret);
+            return -1;
+        }
+    }
+    return -1;
+}
+
+int BambuTlsClient::blockingConnect(const char* host, uint16_t port, int32_t timeout) {
+    if (!beginConnect(host, port)) return 0;
+
+    unsigned long start = millis();
+    int ret;
+    while ((ret = pollConnect()) == 0) {
+        if (timeout > 0 && millis() - start > (unsigned long)timeout) {
+            stop();
+            return 0;
+        }
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    return ret == 1;
+}
+
+int BambuTlsClient::connect(IPAddress ip, uint16_t port) {
+    return blockingConnect(ip.toString().c_str(), port, BAMBU_TLS_CONNECT_TIMEOUT);
+}
+
+int BambuTlsClient::connect(const char* host, uint16_t port) {
+    return blockingConnect(host, port, BAMBU_TLS_CONNECT_TIMEOUT);
+}
+
+int BambuTlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return blockingConnect(ip.toString().c_str(), port, timeout);
+}
+
+int BambuTlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    return blockingConnect(host, port, timeout);
+}
+
+size_t BambuTlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t BambuTlsClient::write(const uint8_t* buf, size_t size) {
+    size_t written = 0;
+    unsigned long start = millis();
+
+    if (_state != TLS_CONNECTED) return 0;
+
+    // Socket ist nicht-blockierend: bei vollem Sendefenster kurz warten
+    // Socket is non-blocking: wait briefly while the send window is full
+    while (written < size) {
+        int ret = mbedtls_ssl_write(&_ssl, buf + written, size - written);
+        if (ret > 0) {
+            written += ret;
+            continue;
+        }
+        if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) {
+            fatal("TLS write", ret);
+            break;
+        }
+        if (millis() - start > BAMBU_TLS_WRITE_TIMEOUT) {
+            fatal("TLS write timeout", ret);
+            break;
+        }
+        vTaskDelay(1);
+    }
+    return written;
+}
+
+int BambuTlsClient::available() {
+    int pending = (_peekByte >= 0) ? 1 : 0;
+
+    if (_state != TLS_CONNECTED) return pending;
+
+    // Liest ggf. einen neuen Record ein, ohne Daten zu entnehmen -- reads a new record if needed without consuming data
+    int ret = mbedtls_ssl_read(&_ssl, NULL, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        fatal("TLS read", ret);
+        return pending;
+    }
+    return pending + (int)mbedtls_ssl_get_bytes_avail(&_ssl);
+}
+
+int BambuTlsClient::read(uint8_t* buf, size_t size) {
+    int got = 0;
+
+    if (size == 0) return 0;
+
+    if (_peekByte >= 0) {
+        buf[got++] = (uint8_t)_peekByte;
+        _peekByte = -1;
+        if (size == 1) return got;
+    }
+    if (_state != TLS_CONNECTED) return got > 0 ? got : -1;
+
+    int ret = mbedtls_ssl_read(&_ssl, buf + got, size - got);
+    if (ret > 0) return got + ret;
+    // 0 heißt: Gegenstelle hat ohne close_notify geschlossen -- 0 means the peer closed without close_notify
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        fatal("TLS read", ret);
+    }
+    return got > 0 ? got : -1;
+}
+
+int BambuTlsClient::read() {
+    uint8_t b;
+    return (read(&b, 1) == 1) ? b : -1;
+}
+
+int BambuTlsClient::peek() {
+    if (_peekByte < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) _peekByte = b;
+    }
+    return _peekByte;
+}
+
+void BambuTlsClient::stop() {
+    if (_sslReady) {
+        if (_state == TLS_CONNECTED) mbedtls_ssl_close_notify(&_ssl);
+        mbedtls_ssl_free(&_ssl);
+        _sslReady = false;
+    }
+    mbedtls_net_free(&_net);
+    _state = TLS_IDLE;
+    _peekByte = -1;
+}
+
+uint8_t BambuTlsClient::connected() {
+    return _state == TLS_CONNECTED;
+}
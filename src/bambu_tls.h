@@ -0,0 +1,91 @@
+#ifndef BAMBU_TLS_H
+#define BAMBU_TLS_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/md.h"
+
+// TLS-Verbindung zum Drucker, deren Aufbau schrittweise und ohne Blockieren läuft:
+// beginConnect() startet den TCP-Connect, pollConnect() treibt Connect und Handshake voran.
+// TLS connection to the printer that is set up step by step without blocking:
+// beginConnect() starts the TCP connect, pollConnect() advances connect and handshake.
+// Die letzte TLS-Session bleibt im RAM und wird beim nächsten Verbinden wieder angeboten.
+// The last TLS session stays in RAM and is offered again on the next connect.
+
+#define BAMBU_TLS_CONNECT_TIMEOUT   10000   // ms für TCP-Connect + Handshake
+#define BAMBU_TLS_WRITE_TIMEOUT     5000    // ms bis ein volles Sendefenster aufgibt
+#define BAMBU_TLS_FINGERPRINT_LEN   32      // SHA-256 über das DER-Zertifikat
+#define BAMBU_TLS_MAX_FRAG_LEN      MBEDTLS_SSL_MAX_FRAG_LEN_4096   // angeforderte Recordgröße (RFC 6066)
+
+class BambuTlsClient : public Client {
+public:
+    BambuTlsClient();
+    ~BambuTlsClient();
+
+    bool beginConnect(const char* host, uint16_t port);
+    int pollConnect();      // 1 verbunden, 0 läuft noch, -1 fehlgeschlagen
+    bool connecting() const { return _state == TLS_TCP_CONNECTING || _state == TLS_HANDSHAKE; }
+
+    // Hex, Trennzeichen ':' und ' ' erlaubt; leer schaltet das Pinning ab -- hex, ':' and ' ' separators allowed; empty disables pinning
+    bool setFingerprint(const char* hex);
+    static bool parseFingerprint(const char* hex, uint8_t* out);
+    void clearSession();
+    // Heap-Verbrauch der letzten Verbindung nach dem Handshake -- heap used by the last connection after the handshake
+    uint32_t heapUsed() const { return _heapUsed; }
+
+    // Client-Schnittstelle, connect() blockiert bis zum Timeout
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char* host, uint16_t port);
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char* host, uint16_t port, int32_t timeout);
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush() {}
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+private:
+    typedef enum {
+        TLS_IDLE,
+        TLS_TCP_CONNECTING,
+        TLS_HANDSHAKE,
+        TLS_CONNECTED
+    } TlsState;
+
+    bool setupSsl();
+    bool checkTimeout();
+    int blockingConnect(const char* host, uint16_t port, int32_t timeout);
+    void fatal(const char* what, int ret);
+    bool verifyFingerprint();
+    void cacheSession();
+
+    TlsState _state;
+    unsigned long _connectStart;
+    unsigned long _handshakeStart;
+    int _peekByte;
+    bool _rngReady;
+    bool _sslReady;
+    bool _hasSession;
+    bool _pinEnabled;
+    uint8_t _pin[BAMBU_TLS_FINGERPRINT_LEN];
+    uint32_t _heapBefore;
+    uint32_t _heapUsed;
+
+    mbedtls_net_context _net;
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _conf;
+    mbedtls_ssl_session _session;   // zwischengespeichert für die Wiederaufnahme -- cached for resumption
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _ctrDrbg;
+};
+
+#endif
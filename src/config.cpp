@@ -53,4 +53,19 @@ uint8_t mqttTaskPrio = 1;
 
 uint8_t scaleTaskCore = 0;
 uint8_t scaleTaskPrio = 1;
+
+uint8_t spoolmanHealthTaskCore = 0;
+uint8_t spoolmanHealthTaskPrio = 0;
+
+uint8_t wsDispatchTaskCore = 1;
+uint8_t wsDispatchTaskPrio = 1;
+
+uint8_t wsCommandTaskCore = 0;
+uint8_t wsCommandTaskPrio = 1;
+
+uint8_t logTaskCore = 0;
+uint8_t logTaskPrio = 0;
+
+uint8_t otaWriteTaskCore = 0;
+uint8_t otaWriteTaskPrio = 2;
 // ***** Task Prios
@@ -15,6 +15,7 @@
 #define NVS_KEY_BAMBU_IP                    "bambuIp"
 #define NVS_KEY_BAMBU_ACCESSCODE            "bambuCode"
 #define NVS_KEY_BAMBU_SERIAL                "bambuSerial"
+#define NVS_KEY_BAMBU_FINGERPRINT           "bambuPin"
 #define NVS_KEY_BAMBU_AUTOSEND_ENABLE       "autosendEnable"
 #define NVS_KEY_BAMBU_AUTOSEND_TIME         "autosendTime"
 
@@ -22,8 +23,18 @@
 #define NVS_KEY_CALIBRATION                 "cal_value"
 #define NVS_KEY_AUTOTARE                    "auto_tare"
 #define SCALE_DEFAULT_CALIBRATION_VALUE     430.0f;
+#define SCALE_SAMPLE_INTERVAL               50U     // ms zwischen is_ready() Abfragen des Scale-Tasks
+#define SCALE_STABLE_SAMPLES                5U      // Fenster für das stable-Flag
+#define SCALE_STABLE_TOLERANCE              1.0f    // g Spannweite im Fenster, die noch als stabil gilt
 
 #define BAMBU_USERNAME                      "bblp"
+#define BAMBU_MAX_PRINTERS                  4       // Drucker pro Gerät, NVS-Schlüssel ab Index 1 mit Suffix
+#define BAMBU_MQTT_PORT                     8883
+#define BAMBU_RECONNECT_BACKOFF_MIN         1000U   // erste Wartezeit nach einem Fehlversuch, verdoppelt sich
+#define BAMBU_RECONNECT_BACKOFF_MAX         60000U
+#define BAMBU_LOCK_TIMEOUT                  500U    // ms, so lange warten Web-Handler höchstens auf die AMS-Daten
+#define BAMBU_STOP_TIMEOUT                  3000U   // ms, Wartezeit auf das Ende des MQTT-Tasks vor dem OTA-Update
+#define BAMBU_PUBLISH_QUEUE_LENGTH          8       // ausgehende Nachrichten für den MQTT-Task, weitere werden abgelehnt
 
 #define OLED_RESET                          -1      // Reset pin # (or -1 if sharing Arduino reset pin)
 #define SCREEN_ADDRESS                      0x3CU   // See datasheet for Address; 0x3D for 128x64, 0x3C for 128x32
@@ -36,6 +47,36 @@
 #define WIFI_CHECK_INTERVAL                 60000U
 #define DISPLAY_UPDATE_INTERVAL             1000U
 #define SPOOLMAN_HEALTHCHECK_INTERVAL       60000U
+#define SPOOLMAN_HEALTHCHECK_RETRY_MIN      5000U
+#define SPOOLMAN_HEALTHCHECK_RETRY_MAX      300000U
+#define SPOOLMAN_CIRCUIT_FAILURE_THRESHOLD  3U
+#define SPOOLMAN_HEALTHCHECK_TIMEOUT        3000U
+
+#define CONSUMPTION_MAX_TRAYS               16      // gleichzeitig verfolgte Trays -- trays tracked at once
+#define CONSUMPTION_FLUSH_INTERVAL          300000U // höchstens eine /use Buchung pro Spule in diesem Abstand
+#define CONSUMPTION_MIN_GRAMS               1.0f    // kleinere Mengen weiter sammeln -- keep collecting smaller amounts
+
+#define WS_MAX_CLIENTS                      8       // wie DEFAULT_MAX_WS_CLIENTS von AsyncWebSocket
+#define WS_CLIENT_QUEUE_DEPTH               8       // wartende Nachrichten pro Client, danach fliegt die älteste
+#define WS_CLIENT_MIN_SPACE                 1024U   // freier TCP-Sendepuffer, bevor die nächste Nachricht rausgeht
+#define WS_DISPATCH_INTERVAL                50U     // ms, erneuter Versuch für Clients ohne Platz
+#define WS_STREAM_TICK                      10U     // ms, Takt des Dispatchers solange ein Gewichts-Stream läuft
+#define WS_STREAM_RATE_MAX                  20U     // Hz, höchste Rate pro Client
+#define WS_COMMAND_QUEUE_LENGTH             4       // wartende WebSocket-Befehle, weitere bekommen "busy"
+#define SSE_RECONNECT_MS                    3000U   // retry-Feld für /events Clients
+#define METRICS_MAX                         48      // registrierte Metriken insgesamt -- registered metrics in total
+#define METRICS_MAX_BUCKETS                 10      // Grenzen pro Histogramm, +Inf kommt dazu
+#define OTA_WRITE_BUFFERS                   3       // Empfangspuffer für das OTA-Update, einer füllt sich während der Rest geflasht wird
+#define OTA_WRITE_BUFFER_SIZE               4096U   // ein Flash-Sektor -- one flash sector
+#define OTA_WRITE_TIMEOUT                   3000U   // ms Wartezeit im async_tcp-Task auf Puffer/Ende, deutlich unter dem 10 s WDT
+#define NFC_PAYLOAD_MAX                     888U    // Nutzdaten eines NTAG216, größere JSON-Daten werden abgelehnt
+#define API_PAYLOAD_MAX                     256U    // Nutzlast einer Spoolman/OctoPrint-Anfrage
+#define LOG_BUFFER_SIZE                     4096U   // Ringpuffer für Log-Zeilen, volle Puffer verwerfen neue Zeilen
+#define LOG_LINE_MAX                        256     // längere Zeilen werden abgeschnitten -- longer lines are truncated
+#define LOG_DEFAULT_LEVEL                   2       // 0 error, 1 warn, 2 info, 3 debug
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL                       3       // höhere Stufen entfallen beim Kompilieren -- higher levels are compiled out
+#endif
 
 extern const uint8_t PN532_IRQ;
 extern const uint8_t PN532_RESET;
@@ -78,5 +119,20 @@ extern uint8_t mqttTaskPrio;
 extern uint8_t scaleTaskCore;
 extern uint8_t scaleTaskPrio;
 
+extern uint8_t spoolmanHealthTaskCore;
+extern uint8_t spoolmanHealthTaskPrio;
+
+extern uint8_t wsDispatchTaskCore;
+extern uint8_t wsDispatchTaskPrio;
+
+extern uint8_t wsCommandTaskCore;
+extern uint8_t wsCommandTaskPrio;
+
+extern uint8_t logTaskCore;
+extern uint8_t logTaskPrio;
+
+extern uint8_t otaWriteTaskCore;
+extern uint8_t otaWriteTaskPrio;
+
 extern uint16_t defaultScaleCalibrationValue;
 #endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "consumption.h"
+#include "config.h"
+#include "api.h"
+#include "logger.h"
+
+struct TrackedTray {
+    int spoolId;            // 0 = frei -- free
+    uint8_t printer;
+    int16_t amsId;          // -1 = Spule entnommen, wartet nur noch auf die letzte Buchung -- spool removed, only waits for its last booking
+    int16_t trayId;
+    int8_t lastRemain;      // -1 = noch kein Bezugswert -- no reference value yet
+    float spoolWeight;      // Filamentgewicht der vollen Spule in g -- filament weight of the full spool in g
+    float pendingGrams;     // noch nicht an Spoolman gemeldet -- not yet reported to Spoolman
+    unsigned long lastFlush;
+};
+
+// Stand pro Spule seit dem letzten Wiegen -- per-spool state since the last weigh-in
+struct SpoolRecord {
+    int spoolId;            // 0 = frei -- free
+    uint32_t weighIn;       // Generation des letzten Wiegens -- generation of the last weigh-in
+    uint16_t weight;        // zuletzt gewogen in g, 0 = unbekannt -- last weighed in g, 0 = unknown
+    float estimatedGrams;   // geschätzter Verbrauch seit dem letzten Wiegen -- estimated use since the last weigh-in
+};
+
+static TrackedTray trackedTrays[CONSUMPTION_MAX_TRAYS];
+static SpoolRecord spoolRecords[CONSUMPTION_MAX_TRAYS];
+static uint32_t consumptionGeneration = 0;     // zählt Wiegevorgänge -- counts weigh-ins
+static portMUX_TYPE consumptionMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Nur innerhalb von consumptionMux aufrufen -- only call inside consumptionMux
+static TrackedTray* findTray(uint8_t printer, int amsId, int trayId) {
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (t.spoolId && t.printer == printer && t.amsId == amsId && t.trayId == trayId) return &t;
+    }
+    return nullptr;
+}
+
+// Nur innerhalb von consumptionMux aufrufen. Ist die Tabelle voll, wird die am längsten
+// nicht gewogene Spule ersetzt. -- Only call inside consumptionMux. If the table is full,
+// the spool weighed longest ago is replaced.
+static SpoolRecord* findRecord(int spoolId, bool create) {
+    SpoolRecord* oldest = &spoolRecords[0];
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS; i++) {
+        SpoolRecord& r = spoolRecords[i];
+        if (r.spoolId == spoolId) return &r;
+        if (oldest->spoolId && (!r.spoolId || r.weighIn < oldest->weighIn)) oldest = &r;
+    }
+    if (!create) return nullptr;
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->spoolId = spoolId;
+    return oldest;
+}
+
+static void detachTray(TrackedTray& t) {
+    t.amsId = -1;
+    t.trayId = -1;
+    if (t.pendingGrams <= 0) t.spoolId = 0;
+}
+
+void consumptionAssignTray(uint8_t printer, int amsId, int trayId, int spoolId, float spoolWeight, int8_t remain) {
+    // Ohne Spulengewicht lässt sich remain% nicht umrechnen -- without a spool weight remain% cannot be converted
+    if (spoolId <= 0 || spoolWeight <= 0) {
+        LOG_W(LOG_MOD_API, "Verbrauch: kein Spulengewicht für Spule %d -- no spool weight", spoolId);
+        return;
+    }
+
+    bool assigned = false;
+    portENTER_CRITICAL(&consumptionMux);
+    // Eine Spule steckt nur in einem Tray, ein Tray hält nur eine Spule -- a spool sits in one tray, a tray holds one spool
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (!t.spoolId || t.amsId < 0) continue;
+        if (t.spoolId == spoolId || (t.printer == printer && t.amsId == amsId && t.trayId == trayId)) detachTray(t);
+    }
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS && !assigned; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (t.spoolId) continue;
+        t.spoolId = spoolId;
+        t.printer = printer;
+        t.amsId = amsId;
+        t.trayId = trayId;
+        t.lastRemain = remain;
+        t.spoolWeight = spoolWeight;
+        t.pendingGrams = 0;
+        t.lastFlush = millis();
+        assigned = true;
+    }
+    portEXIT_CRITICAL(&consumptionMux);
+
+    if (!assigned) LOG_W(LOG_MOD_API, "Verbrauch: zu viele Trays verfolgt -- too many trays tracked");
+}
+
+void consumptionTrayReport(uint8_t printer, int amsId, int trayId, int8_t remain, bool loaded, bool printing) {
+    portENTER_CRITICAL(&consumptionMux);
+    TrackedTray* t = findTray(printer, amsId, trayId);
+    if (t) {
+        if (!loaded) {
+            detachTray(*t);
+        } else if (remain >= 0) {
+            // Nur sinkende Werte während des Drucks zählen, sonst neuer Bezugswert (z.B. Spule neu eingelesen)
+            // Only falling values while printing count, otherwise a new reference value (e.g. spool read again)
+            if (printing && t->lastRemain >= 0 && remain < t->lastRemain) {
+                float grams = (t->lastRemain - remain) * t->spoolWeight / 100.0f;
+                t->pendingGrams += grams;
+                findRecord(t->spoolId, true)->estimatedGrams += grams;
+            }
+            t->lastRemain = remain;
+        }
+    }
+    portEXIT_CRITICAL(&consumptionMux);
+}
+
+void consumptionWeighIn(int spoolId, uint16_t weight) {
+    float dropped = 0;
+    float estimated = 0;
+    uint16_t lastWeight = 0;
+
+    portENTER_CRITICAL(&consumptionMux);
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (t.spoolId != spoolId) continue;
+        dropped += t.pendingGrams;
+        t.pendingGrams = 0;
+        if (t.amsId < 0) t.spoolId = 0;
+    }
+    // Eine noch laufende Buchung stammt jetzt aus einer alten Generation -- a booking still in flight now belongs to an old generation
+    SpoolRecord* r = findRecord(spoolId, true);
+    estimated = r->estimatedGrams;
+    lastWeight = r->weight;
+    r->weighIn = ++consumptionGeneration;
+    r->weight = weight;
+    r->estimatedGrams = 0;
+    portEXIT_CRITICAL(&consumptionMux);
+
+    if (dropped > 0) LOG_I(LOG_MOD_API, "Verbrauch: Wiegen ersetzt %.1f g Schätzung für Spule %d -- weigh-in replaces the estimate", dropped, spoolId);
+    // Die Spule selbst kürzt sich heraus, beide Werte sind Bruttogewichte -- the spool itself cancels out, both values are gross weights
+    if (lastWeight > 0 && estimated > 0) {
+        float measured = (float)lastWeight - weight;
+        LOG_I(LOG_MOD_API, "Verbrauch: Spule %d geschätzt %.1f g, gewogen %.1f g, Abweichung %+.1f g -- estimated, measured, delta",
+              spoolId, estimated, measured, estimated - measured);
+    }
+}
+
+void consumptionRestore(int spoolId, float grams, uint32_t generation) {
+    bool restored = false;
+    bool stale = false;
+
+    portENTER_CRITICAL(&consumptionMux);
+    // Seit dem Abschicken gewogen: das Gewicht enthält die Menge schon -- weighed since sending: the weight already includes it
+    const SpoolRecord* r = findRecord(spoolId, false);
+    if (r && r->weighIn > generation) stale = true;
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS && !restored && !stale; i++) {
+        if (trackedTrays[i].spoolId != spoolId) continue;
+        trackedTrays[i].pendingGrams += grams;
+        restored = true;
+    }
+    // Spule ist nicht mehr zugeordnet: als entnommenen Eintrag ablegen -- spool no longer assigned: keep it as a removed entry
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS && !restored && !stale; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (t.spoolId) continue;
+        memset(&t, 0, sizeof(t));
+        t.spoolId = spoolId;
+        t.amsId = -1;
+        t.trayId = -1;
+        t.lastRemain = -1;
+        t.pendingGrams = grams;
+        t.lastFlush = millis();
+        restored = true;
+    }
+    portEXIT_CRITICAL(&consumptionMux);
+
+    if (stale) LOG_I(LOG_MOD_API, "Verbrauch: %.1f g für Spule %d durch Wiegen überholt -- superseded by weigh-in", grams, spoolId);
+    else if (!restored) LOG_W(LOG_MOD_API, "Verbrauch: %.1f g für Spule %d verworfen -- dropped", grams, spoolId);
+}
+
+void consumptionLoop() {
+    if (spoolmanApiState != API_IDLE || spoolmanCircuitOpen()) return;
+
+    unsigned long now = millis();
+    int spoolId = 0;
+    float grams = 0;
+    uint32_t generation;
+
+    portENTER_CRITICAL(&consumptionMux);
+    generation = consumptionGeneration;
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS && !spoolId; i++) {
+        const TrackedTray& t = trackedTrays[i];
+        if (t.spoolId && t.pendingGrams >= CONSUMPTION_MIN_GRAMS && now - t.lastFlush >= CONSUMPTION_FLUSH_INTERVAL) spoolId = t.spoolId;
+    }
+    // Alle Einträge derselben Spule in einer Buchung zusammenfassen -- combine all entries of the same spool into one booking
+    for (uint8_t i = 0; i < CONSUMPTION_MAX_TRAYS && spoolId; i++) {
+        TrackedTray& t = trackedTrays[i];
+        if (t.spoolId != spoolId) continue;
+        grams += t.pendingGrams;
+        t.pendingGrams = 0;
+        t.lastFlush = now;
+        if (t.amsId < 0) t.spoolId = 0;
+    }
+    portEXIT_CRITICAL(&consumptionMux);
+
+    if (spoolId && !updateSpoolUse(spoolId, grams, generation)) consumptionRestore(spoolId, grams, generation);
+}
@@ -0,0 +1,24 @@
+#ifndef CONSUMPTION_H
+#define CONSUMPTION_H
+
+#include <Arduino.h>
+
+// Schätzt den Filamentverbrauch während des Drucks aus remain% der AMS-Trays und bucht
+// ihn gesammelt per /spool/<id>/use in Spoolman, höchstens einmal pro Spule und Intervall.
+// Estimates filament consumption while printing from the AMS tray remain% and books it
+// in batches via /spool/<id>/use in Spoolman, at most once per spool and interval.
+
+// Spule wurde per Auto-Set in dieses Tray gesetzt -- spool was auto-set into this tray
+void consumptionAssignTray(uint8_t printer, int amsId, int trayId, int spoolId, float spoolWeight, int8_t remain);
+// Neuer Stand eines Trays aus dem MQTT-Bericht -- new tray state from the MQTT report
+void consumptionTrayReport(uint8_t printer, int amsId, int trayId, int8_t remain, bool loaded, bool printing);
+// Wiegen ersetzt die Schätzung, noch nicht gebuchte Mengen verfallen -- weighing replaces the estimate, unbooked amounts are dropped
+void consumptionWeighIn(int spoolId, uint16_t weight);
+// Fehlgeschlagene Buchung für den nächsten Versuch zurücklegen, außer die Spule wurde seit
+// generation gewogen -- put back a failed booking for the next attempt, unless the spool
+// was weighed since generation
+void consumptionRestore(int spoolId, float grams, uint32_t generation);
+// Aus loop() aufrufen, sendet höchstens eine Buchung -- call from loop(), sends at most one booking
+void consumptionLoop();
+
+#endif
@@ -0,0 +1,196 @@
+#include "gzip_inflater.h"
+#include "esp32/rom/crc.h"
+
+// gzip-Header-Flags (RFC 1952) -- gzip header flags
+#define GZIP_FLAG_HCRC      0x02
+#define GZIP_FLAG_EXTRA     0x04
+#define GZIP_FLAG_NAME      0x08
+#define GZIP_FLAG_COMMENT   0x10
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+GzipInflater::GzipInflater()
+    : _sink(nullptr), _ctx(nullptr), _state(FAILED), _tinfl(nullptr), _window(nullptr), _error(nullptr) {
+}
+
+GzipInflater::~GzipInflater() {
+    end();
+}
+
+bool GzipInflater::begin(GzipSink sink, void* ctx) {
+    end();
+    _tinfl = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    _window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+    if (!_tinfl || !_window) {
+        end();
+        _error = "Kein Speicher zum Entpacken -- no memory to inflate";
+        return false;
+    }
+    tinfl_init(_tinfl);
+
+    _sink = sink;
+    _ctx = ctx;
+    _state = HEADER;
+    _windowOfs = 0;
+    _flags = 0;
+    _fieldPos = 0;
+    _extraLen = 0;
+    _crc = 0;
+    _outSize = 0;
+    _trailerLen = 0;
+    _hasImageInfo = false;
+    _imageSize = 0;
+    _error = nullptr;
+
+    mbedtls_md_init(&_sha);
+    mbedtls_md_setup(&_sha, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&_sha);
+    return true;
+}
+
+void GzipInflater::end() {
+    if (_window) mbedtls_md_free(&_sha);
+    free(_tinfl);
+    free(_window);
+    _tinfl = nullptr;
+    _window = nullptr;
+}
+
+bool GzipInflater::fail(const char* error) {
+    _state = FAILED;
+    _error = error;
+    return false;
+}
+
+// Header-Teile der Reihe nach, fehlende überspringen -- header parts in order, skipping absent ones
+void GzipInflater::enter(State state) {
+    _fieldPos = 0;
+    if (state == EXTRA_LEN && !(_flags & GZIP_FLAG_EXTRA)) state = NAME;
+    if (state == NAME && !(_flags & GZIP_FLAG_NAME)) state = COMMENT;
+    if (state == COMMENT && !(_flags & GZIP_FLAG_COMMENT)) state = HEADER_CRC;
+    if (state == HEADER_CRC && !(_flags & GZIP_FLAG_HCRC)) state = DEFLATE;
+    // Ohne Referenz-SHA kein Update, abgelehnt bevor etwas geschrieben wird
+    // No update without a reference SHA, rejected before anything is written
+    if (state == DEFLATE && !_hasImageInfo) {
+        fail("gzip ohne Image-Info, mit scripts/compress_image.py erzeugen -- gzip without image info, create it with scripts/compress_image.py");
+        return;
+    }
+    _state = state;
+}
+
+void GzipInflater::headerByte(uint8_t c) {
+    switch (_state) {
+        case HEADER:
+            // ID1 ID2 CM FLG MTIME(4) XFL OS, nur Deflate (CM 8) -- deflate only
+            if ((_fieldPos == 0 && c != 0x1f) || (_fieldPos == 1 && c != 0x8b) || (_fieldPos == 2 && c != 8)) {
+                fail("Kein gzip-Abbild -- not a gzip image");
+                return;
+            }
+            if (_fieldPos == 3) _flags = c;
+            if (++_fieldPos == 10) enter(EXTRA_LEN);
+            break;
+        case EXTRA_LEN:
+            _extraLen |= (uint16_t)c << (8 * _fieldPos);
+            if (++_fieldPos == 2) {
+                if (_extraLen) {
+                    _fieldPos = 0;
+                    _state = EXTRA;
+                } else {
+                    enter(NAME);
+                }
+            }
+            break;
+        case EXTRA:
+            if (_fieldPos < sizeof(_extra)) _extra[_fieldPos] = c;
+            if (++_fieldPos == _extraLen) {
+                // SI1 SI2 LEN(2) Daten -- SI1 SI2 LEN(2) data
+                if (_extraLen >= sizeof(_extra) && _extra[0] == GZIP_IMAGE_INFO_ID1 && _extra[1] == GZIP_IMAGE_INFO_ID2 &&
+                    (_extra[2] | (_extra[3] << 8)) == GZIP_IMAGE_INFO_LEN) {
+                    _imageSize = readLe32(_extra + 4);
+                    memcpy(_imageSha, _extra + 8, sizeof(_imageSha));
+                    _hasImageInfo = true;
+                }
+                enter(NAME);
+            }
+            break;
+        case NAME:
+            if (c == 0) enter(COMMENT);
+            break;
+        case COMMENT:
+            if (c == 0) enter(HEADER_CRC);
+            break;
+        case HEADER_CRC:
+            if (++_fieldPos == 2) enter(DEFLATE);
+            break;
+        default:
+            break;
+    }
+}
+
+bool GzipInflater::inflate(const uint8_t* data, size_t len) {
+    for (;;) {
+        size_t inBytes = len;
+        size_t outBytes = TINFL_LZ_DICT_SIZE - _windowOfs;
+        // Das Fenster ist zugleich der Ausgabepuffer und läuft ringförmig -- the window doubles as the circular output buffer
+        tinfl_status status = tinfl_decompress(_tinfl, data, &inBytes, _window, _window + _windowOfs, &outBytes,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        data += inBytes;
+        len -= inBytes;
+
+        if (outBytes) {
+            const uint8_t* out = _window + _windowOfs;
+            _crc = crc32_le(_crc, out, outBytes);
+            mbedtls_md_update(&_sha, out, outBytes);
+            _outSize += outBytes;
+            _windowOfs = (_windowOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+            if (!_sink(out, outBytes, _ctx)) return fail("Schreiben abgebrochen -- write aborted");
+        }
+
+        if (status < TINFL_STATUS_DONE) return fail("Ungültige Deflate-Daten -- invalid deflate data");
+        if (status == TINFL_STATUS_DONE) {
+            _state = DONE;
+            return true;
+        }
+        // Eingabe verbraucht, sonst ist nur das Fenster voll -- input used up, otherwise only the window is full
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) return true;
+    }
+}
+
+bool GzipInflater::write(const uint8_t* data, size_t len) {
+    if (_state == FAILED) return false;
+
+    // Der Trailer sind die letzten 8 Bytes, egal wie weit tinfl vorausgelesen hat
+    // The trailer is the last 8 bytes, no matter how far tinfl read ahead
+    if (len >= sizeof(_trailer)) {
+        memcpy(_trailer, data + len - sizeof(_trailer), sizeof(_trailer));
+        _trailerLen = sizeof(_trailer);
+    } else if (len) {
+        uint8_t keep = min((size_t)_trailerLen, sizeof(_trailer) - len);
+        memmove(_trailer, _trailer + _trailerLen - keep, keep);
+        memcpy(_trailer + keep, data, len);
+        _trailerLen = keep + len;
+    }
+
+    while (len && _state < DEFLATE) {
+        headerByte(*data++);
+        len--;
+    }
+    if (_state == FAILED) return false;
+    if (_state == DEFLATE && len) return inflate(data, len);
+    return true;
+}
+
+bool GzipInflater::finish() {
+    if (_state == FAILED) return false;
+    if (_state != DONE || _trailerLen < sizeof(_trailer)) return fail("Unvollständiges gzip-Abbild -- incomplete gzip image");
+    if (readLe32(_trailer) != _crc) return fail("CRC32 falsch -- CRC32 mismatch");
+    if (readLe32(_trailer + 4) != (uint32_t)_outSize) return fail("Länge falsch -- length mismatch");
+
+    uint8_t digest[32];
+    mbedtls_md_finish(&_sha, digest);
+    if (_imageSize != _outSize) return fail("Länge falsch -- length mismatch");
+    if (memcmp(digest, _imageSha, sizeof(digest)) != 0) return fail("SHA-256 falsch -- SHA-256 mismatch");
+    return true;
+}
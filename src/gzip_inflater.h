@@ -0,0 +1,83 @@
+#ifndef GZIP_INFLATER_H
+#define GZIP_INFLATER_H
+
+#include <Arduino.h>
+#include "mbedtls/md.h"
+#include "esp32/rom/miniz.h"
+
+// Entpackt einen gzip-Strom stückweise mit dem tinfl aus dem ROM -- inflates a gzip stream piecewise with the ROM tinfl
+//
+// Die Eingabe darf beliebig zerteilt ankommen, die Ausgabe geht in Blöcken bis zur Fenstergröße
+// (32 KB) an den Sink. Geprüft werden CRC32 und Länge aus dem gzip-Trailer, dazu SHA-256 und
+// Länge des entpackten Abbilds aus dem Header von scripts/compress_image.py. gzip ohne diese
+// Angaben wird schon am Header abgelehnt.
+// Input may arrive split anywhere, output goes to the sink in blocks of up to the window size
+// (32 KB). CRC32 and length from the gzip trailer are checked, plus SHA-256 and length of the
+// inflated image from the header written by scripts/compress_image.py. gzip without them is
+// rejected at the header already.
+//
+// Speicher: Fenster und Decoder zusammen etwa 43 KB, nur zwischen begin() und end()
+// Memory: window and decoder take about 43 KB together, only between begin() and end()
+
+#define GZIP_IMAGE_INFO_ID1     'F'     // FEXTRA-Unterfeld von compress_image.py -- FEXTRA subfield of compress_image.py
+#define GZIP_IMAGE_INFO_ID2     'M'
+#define GZIP_IMAGE_INFO_LEN     36      // uint32 Länge (LE) + SHA-256 -- uint32 length (LE) + SHA-256
+
+// false bricht das Entpacken ab -- false aborts inflating
+typedef bool (*GzipSink)(const uint8_t* data, size_t len, void* ctx);
+
+class GzipInflater {
+public:
+    GzipInflater();
+    ~GzipInflater();
+
+    static bool isGzip(const uint8_t* data, size_t len) { return len >= 2 && data[0] == 0x1f && data[1] == 0x8b; }
+
+    bool begin(GzipSink sink, void* ctx);
+    // false bei kaputtem Strom oder wenn der Sink abbricht -- false on a broken stream or when the sink aborts
+    bool write(const uint8_t* data, size_t len);
+    // Nach der letzten Eingabe: Strom vollständig und alle Prüfsummen stimmen
+    // After the last input: stream complete and all checksums match
+    bool finish();
+    void end();
+
+    // Aus dem Header, gültig sobald die ersten Ausgabedaten den Sink erreichen
+    // From the header, valid once the first output reaches the sink
+    bool hasImageInfo() const { return _hasImageInfo; }
+    uint32_t imageSize() const { return _imageSize; }
+    size_t outputSize() const { return _outSize; }
+    const char* error() const { return _error; }
+
+private:
+    enum State { HEADER, EXTRA_LEN, EXTRA, NAME, COMMENT, HEADER_CRC, DEFLATE, DONE, FAILED };
+
+    bool fail(const char* error);
+    void enter(State state);
+    void headerByte(uint8_t c);
+    bool inflate(const uint8_t* data, size_t len);
+
+    GzipSink _sink;
+    void* _ctx;
+    State _state;
+    tinfl_decompressor* _tinfl;
+    uint8_t* _window;
+    size_t _windowOfs;
+
+    uint8_t _flags;
+    uint16_t _fieldPos;
+    uint16_t _extraLen;
+    uint8_t _extra[4 + GZIP_IMAGE_INFO_LEN];   // Unterfeld-Kopf + Daten -- subfield head + data
+
+    uint32_t _crc;
+    size_t _outSize;
+    uint8_t _trailer[8];
+    uint8_t _trailerLen;
+
+    mbedtls_md_context_t _sha;
+    bool _hasImageInfo;
+    uint32_t _imageSize;
+    uint8_t _imageSha[32];
+    const char* _error;
+};
+
+#endif
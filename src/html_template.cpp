@@ -0,0 +1,208 @@
+#include "html_template.h"
+#include <LittleFS.h>
+#include <memory>
+#include <vector>
+
+#define TEMPLATE_ADLER_BASE 65521UL
+
+// zlib-Header: deflate, 32K Fenster, beste Kompression -- zlib header: deflate, 32K window, best compression
+static const uint8_t zlibHeader[2] = { 0x78, 0xDA };
+
+struct TemplateSegment {
+    uint32_t offset;        // ab Dateianfang -- from the start of the file
+    uint32_t length;        // komprimiert -- compressed
+    uint32_t rawLength;
+    uint32_t adler;
+    char name[HTML_TEMPLATE_NAME_LEN];
+};
+
+typedef enum {
+    TPL_ZLIB_HEADER,
+    TPL_STATIC,
+    TPL_VALUE_HEADER,
+    TPL_VALUE,
+    TPL_TRAILER,
+    TPL_DONE
+} TemplatePhase;
+
+struct TemplateStream {
+    File file;
+    std::vector<TemplateSegment> segments;
+    std::vector<String> values;     // Wert hinter Segment i -- value after segment i
+    uint8_t trailer[4];             // Adler-32 über die ganze Seite, big endian
+    TemplatePhase phase = TPL_ZLIB_HEADER;
+    size_t segment = 0;
+    size_t pos = 0;                 // Fortschritt innerhalb der aktuellen Phase -- progress within the current phase
+    uint8_t valueHeader[5];
+
+    ~TemplateStream() {
+        if (file) file.close();
+    }
+};
+
+static uint32_t adlerUpdate(uint32_t adler, const uint8_t* data, size_t len) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    for (size_t i = 0; i < len; i++) {
+        a = (a + data[i]) % TEMPLATE_ADLER_BASE;
+        b = (b + a) % TEMPLATE_ADLER_BASE;
+    }
+    return a | (b << 16);
+}
+
+// Adler-32 von A+B aus den Prüfsummen von A und B, wie adler32_combine() in zlib
+// Adler-32 of A+B from the checksums of A and B, like adler32_combine() in zlib
+static uint32_t adlerCombine(uint32_t adler1, uint32_t adler2, uint32_t len2) {
+    uint32_t rem = len2 % TEMPLATE_ADLER_BASE;
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % TEMPLATE_ADLER_BASE);
+    sum1 += (adler2 & 0xFFFF) + TEMPLATE_ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + TEMPLATE_ADLER_BASE - rem;
+    if (sum1 >= TEMPLATE_ADLER_BASE) sum1 -= TEMPLATE_ADLER_BASE;
+    if (sum1 >= TEMPLATE_ADLER_BASE) sum1 -= TEMPLATE_ADLER_BASE;
+    if (sum2 >= (TEMPLATE_ADLER_BASE << 1)) sum2 -= (TEMPLATE_ADLER_BASE << 1);
+    if (sum2 >= TEMPLATE_ADLER_BASE) sum2 -= TEMPLATE_ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool loadTemplate(TemplateStream& stream, const char* path, HtmlTemplateValue values) {
+    stream.file = LittleFS.open(path, "r");
+    if (!stream.file) {
+        Serial.println("Fehler: Vorlage nicht gefunden -- template not found: " + String(path));
+        return false;
+    }
+
+    uint8_t header[8];
+    if (stream.file.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "FTP1", 4) != 0) {
+        Serial.println("Fehler: ungültige Vorlage -- invalid template: " + String(path));
+        return false;
+    }
+    uint16_t count = header[4] | (header[5] << 8);
+    if (count == 0 || count > HTML_TEMPLATE_MAX_SEGMENTS) return false;
+
+    stream.segments.resize(count);
+    stream.values.resize(count);
+    uint32_t adler = 1;
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t entry[16 + HTML_TEMPLATE_NAME_LEN];
+        if (stream.file.read(entry, sizeof(entry)) != sizeof(entry)) return false;
+
+        TemplateSegment& segment = stream.segments[i];
+        segment.offset = readLe32(entry);
+        segment.length = readLe32(entry + 4);
+        segment.rawLength = readLe32(entry + 8);
+        segment.adler = readLe32(entry + 12);
+        memcpy(segment.name, entry + 16, HTML_TEMPLATE_NAME_LEN);
+        segment.name[HTML_TEMPLATE_NAME_LEN - 1] = '\0';
+
+        // Die Prüfsumme steht vor dem ersten Byte fest -- the checksum is known before the first byte is sent
+        adler = adlerCombine(adler, segment.adler, segment.rawLength);
+        if (i + 1 < count) {
+            String& value = stream.values[i];
+            value = values(segment.name);
+            // Ein Stored-Block fasst höchstens 65535 Bytes -- a stored block holds at most 65535 bytes
+            if (value.length() > 0xFFFF) value = value.substring(0, 0xFFFF);
+            adler = adlerUpdate(adler, (const uint8_t*)value.c_str(), value.length());
+        }
+    }
+
+    stream.trailer[0] = adler >> 24;
+    stream.trailer[1] = adler >> 16;
+    stream.trailer[2] = adler >> 8;
+    stream.trailer[3] = adler;
+    return true;
+}
+
+// Kopiert den Rest einer Quelle ab stream.pos, true wenn sie vollständig geschrieben ist
+// Copies the rest of a source from stream.pos, true once it is written completely
+static bool copyPart(TemplateStream& stream, const uint8_t* src, size_t srcLen, uint8_t* buffer, size_t maxLen, size_t& written) {
+    size_t n = min(srcLen - stream.pos, maxLen - written);
+    memcpy(buffer + written, src + stream.pos, n);
+    written += n;
+    stream.pos += n;
+    if (stream.pos < srcLen) return false;
+    stream.pos = 0;
+    return true;
+}
+
+static size_t fillTemplate(TemplateStream& stream, uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (written < maxLen && stream.phase != TPL_DONE) {
+        switch (stream.phase) {
+            case TPL_ZLIB_HEADER:
+                if (copyPart(stream, zlibHeader, sizeof(zlibHeader), buffer, maxLen, written)) stream.phase = TPL_STATIC;
+                break;
+
+            case TPL_STATIC: {
+                const TemplateSegment& segment = stream.segments[stream.segment];
+                size_t n = min((size_t)(segment.length - stream.pos), maxLen - written);
+                if (n > 0) {
+                    stream.file.seek(segment.offset + stream.pos);
+                    size_t got = stream.file.read(buffer + written, n);
+                    if (got != n) {
+                        Serial.println("Fehler beim Lesen der Vorlage -- error reading template");
+                        stream.phase = TPL_DONE;
+                        break;
+                    }
+                    written += n;
+                    stream.pos += n;
+                }
+                if (stream.pos < segment.length) break;
+
+                stream.pos = 0;
+                if (stream.segment + 1 >= stream.segments.size()) {
+                    stream.phase = TPL_TRAILER;
+                    break;
+                }
+                // Nicht-finaler Stored-Block: BTYPE 00, LEN, NLEN -- non-final stored block: BTYPE 00, LEN, NLEN
+                uint16_t len = stream.values[stream.segment].length();
+                uint16_t nlen = ~len;
+                stream.valueHeader[0] = 0x00;
+                stream.valueHeader[1] = len & 0xFF;
+                stream.valueHeader[2] = len >> 8;
+                stream.valueHeader[3] = nlen & 0xFF;
+                stream.valueHeader[4] = nlen >> 8;
+                stream.phase = TPL_VALUE_HEADER;
+                break;
+            }
+
+            case TPL_VALUE_HEADER:
+                if (copyPart(stream, stream.valueHeader, sizeof(stream.valueHeader), buffer, maxLen, written)) stream.phase = TPL_VALUE;
+                break;
+
+            case TPL_VALUE: {
+                const String& value = stream.values[stream.segment];
+                if (copyPart(stream, (const uint8_t*)value.c_str(), value.length(), buffer, maxLen, written)) {
+                    stream.segment++;
+                    stream.phase = TPL_STATIC;
+                }
+                break;
+            }
+
+            case TPL_TRAILER:
+                if (copyPart(stream, stream.trailer, sizeof(stream.trailer), buffer, maxLen, written)) stream.phase = TPL_DONE;
+                break;
+
+            case TPL_DONE:
+                break;
+        }
+    }
+
+    return written;
+}
+
+AsyncWebServerResponse* beginTemplateResponse(AsyncWebServerRequest* request, const char* path, const char* contentType, HtmlTemplateValue values) {
+    std::shared_ptr<TemplateStream> stream = std::make_shared<TemplateStream>();
+    if (!loadTemplate(*stream, path, values)) return nullptr;
+
+    AsyncWebServerResponse* response = request->beginChunkedResponse(contentType, [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return fillTemplate(*stream, buffer, maxLen);
+    });
+    response->addHeader("Content-Encoding", "deflate");
+    return response;
+}
@@ -0,0 +1,21 @@
+#ifndef HTML_TEMPLATE_H
+#define HTML_TEMPLATE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+// Streamt eine von scripts/gzip_files.py erzeugte .tpl-Vorlage komprimiert (Content-Encoding: deflate)
+// und setzt die Platzhalter dabei ein. Der Speicherbedarf hängt nur von den Werten ab, nicht von der Seite.
+// Streams a .tpl template produced by scripts/gzip_files.py compressed (Content-Encoding: deflate)
+// and splices in the placeholder values. Memory use depends on the values only, not on the page size.
+
+#define HTML_TEMPLATE_NAME_LEN      24
+#define HTML_TEMPLATE_MAX_SEGMENTS  32
+
+// Liefert den Wert für einen Platzhalter, "" wenn unbekannt -- returns the value for a placeholder, "" if unknown
+typedef String (*HtmlTemplateValue)(const char* name);
+
+// nullptr, wenn die Vorlage fehlt oder ungültig ist -- nullptr if the template is missing or invalid
+AsyncWebServerResponse* beginTemplateResponse(AsyncWebServerRequest* request, const char* path, const char* contentType, HtmlTemplateValue values);
+
+#endif
@@ -0,0 +1,146 @@
+#include "json_writer.h"
+
+JsonWriter::JsonWriter(char* out, size_t cap)
+    : _out(out), _cap(cap), _len(0), _depth(0), _hasItems(0), _keyPending(false) {
+}
+
+void JsonWriter::put(char c) {
+    if (_out && _len + 1 < _cap) _out[_len] = c;
+    _len++;
+}
+
+void JsonWriter::raw(const char* str) {
+    while (*str) put(*str++);
+}
+
+void JsonWriter::str(const char* value) {
+    put('"');
+    for (; *value; value++) {
+        char c = *value;
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(c);
+        } else if ((uint8_t)c < 0x20) {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            raw(esc);
+        } else {
+            put(c);
+        }
+    }
+    put('"');
+}
+
+// Komma und Schlüssel vor jedem Wert -- comma and key ahead of every value
+void JsonWriter::item(const char* key) {
+    if (_keyPending) {
+        _keyPending = false;
+        return;
+    }
+    uint16_t bit = 1U << _depth;
+    if (_hasItems & bit) put(',');
+    _hasItems |= bit;
+    if (key) {
+        str(key);
+        put(':');
+    }
+}
+
+JsonWriter& JsonWriter::beginObject(const char* key) {
+    item(key);
+    put('{');
+    if (_depth < JSON_WRITER_MAX_DEPTH - 1) _depth++;
+    _hasItems &= ~(1U << _depth);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    if (_depth > 0) _depth--;
+    put('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray(const char* key) {
+    item(key);
+    put('[');
+    if (_depth < JSON_WRITER_MAX_DEPTH - 1) _depth++;
+    _hasItems &= ~(1U << _depth);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    if (_depth > 0) _depth--;
+    put(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(const char* key, const char* value) {
+    item(key);
+    if (value) {
+        str(value);
+    } else {
+        raw("null");
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(const char* key, bool value) {
+    item(key);
+    raw(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(const char* key, int value) {
+    return add(key, (long)value);
+}
+
+JsonWriter& JsonWriter::add(const char* key, unsigned int value) {
+    return add(key, (unsigned long)value);
+}
+
+JsonWriter& JsonWriter::add(const char* key, long value) {
+    char tmp[12];
+    snprintf(tmp, sizeof(tmp), "%ld", value);
+    item(key);
+    raw(tmp);
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(const char* key, unsigned long value) {
+    char tmp[12];
+    snprintf(tmp, sizeof(tmp), "%lu", value);
+    item(key);
+    raw(tmp);
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(const char* key, double value, uint8_t decimals) {
+    item(key);
+    // NaN und Unendlich gibt es in JSON nicht -- JSON has no NaN or infinity
+    if (isnan(value) || isinf(value)) {
+        raw("null");
+        return *this;
+    }
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimals, value);
+    raw(tmp);
+    return *this;
+}
+
+JsonWriter& JsonWriter::addRaw(const char* key, const char* json) {
+    item(key);
+    raw(json);
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+    item(name);
+    _keyPending = true;
+    return *this;
+}
+
+const char* JsonWriter::c_str() {
+    if (!_out || _cap == 0) return "";
+    _out[min(_len, _cap - 1)] = '\0';
+    return _out;
+}
@@ -0,0 +1,68 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+// JSON direkt in einen Puffer des Aufrufers -- JSON straight into a caller-owned buffer
+//
+// Für Antworten und Nutzlasten, die nur geschrieben und nie gelesen werden: kein JsonDocument,
+// kein String, keine Heap-Allokation. Kommas setzt der Writer selbst, Strings werden escaped.
+// For responses and payloads that are only written, never read: no JsonDocument, no String,
+// no heap allocation. The writer inserts the commas itself and escapes strings.
+//
+//   char out[64];
+//   JsonWriter json(out, sizeof(out));
+//   json.beginObject().add("type", "heartbeat").add("freeHeap", 123).endObject();
+//   if (!json.overflowed()) send(json.c_str(), json.length());
+//
+// Mit out == nullptr wird nur die Länge gezählt, um danach einen passenden Puffer anzulegen.
+// With out == nullptr only the length is counted, to allocate a matching buffer afterwards.
+// Ein Byte von cap bleibt für das abschließende '\0' -- one byte of cap is kept for the closing '\0'.
+// key == nullptr für Array-Elemente und den äußersten Wert -- key == nullptr for array elements and the outermost value.
+
+#define JSON_WRITER_MAX_DEPTH   16
+
+class JsonWriter {
+public:
+    JsonWriter(char* out, size_t cap);
+
+    JsonWriter& beginObject(const char* key = nullptr);
+    JsonWriter& endObject();
+    JsonWriter& beginArray(const char* key = nullptr);
+    JsonWriter& endArray();
+
+    // value == nullptr schreibt null -- value == nullptr writes null
+    JsonWriter& add(const char* key, const char* value);
+    JsonWriter& add(const char* key, bool value);
+    JsonWriter& add(const char* key, int value);
+    JsonWriter& add(const char* key, unsigned int value);
+    JsonWriter& add(const char* key, long value);
+    JsonWriter& add(const char* key, unsigned long value);
+    JsonWriter& add(const char* key, double value, uint8_t decimals);
+    // Bereits serialisiertes JSON unverändert übernehmen -- insert already serialized JSON unchanged
+    JsonWriter& addRaw(const char* key, const char* json);
+    // Nur den Schlüssel, der Wert folgt mit key == nullptr, etwa aus einer eigenen Funktion
+    // Only the key, the value follows with key == nullptr, e.g. from a function of its own
+    JsonWriter& key(const char* name);
+
+    // Länge ohne '\0', auch wenn der Puffer übergelaufen ist -- length without '\0', even after an overflow
+    size_t length() const { return _len; }
+    bool overflowed() const { return _out && _len >= _cap; }
+    // Abgeschlossen mit '\0', bei Überlauf abgeschnitten -- terminated with '\0', truncated on overflow
+    const char* c_str();
+
+private:
+    void put(char c);
+    void raw(const char* str);
+    void str(const char* value);
+    void item(const char* key);
+
+    char* _out;
+    size_t _cap;
+    size_t _len;
+    uint8_t _depth;
+    uint16_t _hasItems;     // ein Bit pro Ebene: Komma vor dem nächsten Eintrag -- one bit per level: comma before the next entry
+    bool _keyPending;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "logger.h"
+#include <atomic>
+#include <freertos/ringbuf.h>
+#include "ws_topics.h"
+#include "metrics.h"
+
+typedef struct {
+    uint32_t timestamp;
+    uint8_t level;
+    uint8_t module;
+    char text[LOG_LINE_MAX];
+} LogEntry;
+
+static const char* const levelNames[LOG_LEVEL_COUNT] = { "error", "warn", "info", "debug" };
+static const char levelChars[LOG_LEVEL_COUNT] = { 'E', 'W', 'I', 'D' };
+static const char* const moduleNames[LOG_MOD_COUNT] = { "web", "nfc", "bambu", "api", "scale" };
+
+volatile uint8_t logLevels[LOG_MOD_COUNT] = { LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL };
+
+static RingbufHandle_t logBuffer = NULL;
+static TaskHandle_t logTask = NULL;
+static std::atomic<uint32_t> droppedLines(0);
+
+static void printEntry(const LogEntry& entry) {
+    Serial.printf("[%lu.%03lu] %c %s: %s\n", (unsigned long)(entry.timestamp / 1000), (unsigned long)(entry.timestamp % 1000),
+                  levelChars[entry.level], moduleNames[entry.module], entry.text);
+}
+
+static void publishEntry(const LogEntry& entry) {
+    wsPublishJson(WS_TOPIC_LOG, [&](JsonWriter& json) {
+        json.beginObject()
+            .add("type", "log")
+            .add("t", entry.timestamp)
+            .add("level", levelNames[entry.level])
+            .add("module", moduleNames[entry.module])
+            .add("msg", entry.text)
+            .endObject();
+    });
+}
+
+// Nur dieser Task wartet auf Serial -- only this task waits for Serial
+static void logWriterLoop(void *parameter) {
+    for (;;) {
+        size_t size = 0;
+        LogEntry *entry = (LogEntry*)xRingbufferReceive(logBuffer, &size, portMAX_DELAY);
+        if (!entry) continue;
+
+        printEntry(*entry);
+        if (wsHasSubscribers(WS_TOPIC_LOG)) publishEntry(*entry);
+        vRingbufferReturnItem(logBuffer, entry);
+
+        uint32_t dropped = droppedLines.exchange(0, std::memory_order_relaxed);
+        if (dropped) Serial.printf("... %lu Log-Zeilen verworfen -- log lines dropped\n", (unsigned long)dropped);
+    }
+}
+
+void logInit() {
+    if (logBuffer) return;
+    logBuffer = xRingbufferCreate(LOG_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (!logBuffer) {
+        Serial.println("Kein Speicher für den Log-Puffer -- No memory for the log buffer");
+        return;
+    }
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        logWriterLoop, /* Function to implement the task */
+        "LogWriter", /* Name of the task */
+        4096,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        logTaskPrio,  /* Priority of the task */
+        &logTask,  /* Task handle. */
+        logTaskCore); /* Core where the task should run */
+
+    if (result != pdPASS) {
+        Serial.println("Fehler beim Erstellen des LogWriter-Tasks");
+        vRingbufferDelete(logBuffer);
+        logBuffer = NULL;
+    } else {
+        metricsRegisterTask("LogWriter", logTask);
+    }
+}
+
+void logWrite(LogModule module, LogLevel level, const char* format, ...) {
+    LogEntry entry;
+    entry.timestamp = millis();
+    entry.level = level;
+    entry.module = module;
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(entry.text, sizeof(entry.text), format, args);
+    va_end(args);
+    if (len < 0) return;
+    len = min(len, LOG_LINE_MAX - 1);
+
+    // Vor logInit() direkt ausgeben -- print directly before logInit()
+    if (!logBuffer) {
+        printEntry(entry);
+        return;
+    }
+    if (xRingbufferSend(logBuffer, &entry, offsetof(LogEntry, text) + len + 1, 0) != pdTRUE) {
+        droppedLines.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static int findName(const char* const names[], uint8_t count, const char* name) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+bool logSetLevel(const char* module, const char* level) {
+    if (!module || !level) return false;
+    int levelIndex = findName(levelNames, LOG_LEVEL_COUNT, level);
+    if (levelIndex < 0) return false;
+
+    if (strcmp(module, "all") == 0) {
+        for (uint8_t i = 0; i < LOG_MOD_COUNT; i++) logLevels[i] = levelIndex;
+        return true;
+    }
+    int moduleIndex = findName(moduleNames, LOG_MOD_COUNT, module);
+    if (moduleIndex < 0) return false;
+    logLevels[moduleIndex] = levelIndex;
+    return true;
+}
+
+void logLevelsToJson(JsonWriter& json) {
+    json.beginObject();
+    for (uint8_t i = 0; i < LOG_MOD_COUNT; i++) {
+        json.add(moduleNames[i], levelNames[logLevels[i]]);
+    }
+    json.endObject();
+}
@@ -0,0 +1,56 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include "json_writer.h"
+#include "config.h"
+
+// Gepufferte Log-Ausgabe -- buffered logging
+//
+// LOG_I(LOG_MOD_NFC, "Tag %s", uid) formatiert in einen Ringpuffer und kehrt sofort zurück,
+// der LogWriter-Task schreibt die Zeilen später auf Serial und an Abonnenten des WebSocket-Themas "log".
+// LOG_I(LOG_MOD_NFC, "Tag %s", uid) formats into a ring buffer and returns at once, the LogWriter
+// task later writes the lines to Serial and to subscribers of the WebSocket topic "log".
+// Ist der Puffer voll, wird die Zeile verworfen statt zu warten -- a full buffer drops the line instead of waiting.
+// Nicht streng lock-free: xRingbufferSend kopiert unter dem kurzen Spinlock des Ringpuffers.
+// Not strictly lock-free: xRingbufferSend copies under the ring buffer's short spinlock.
+// Abgeschaltete Stufen kosten einen Vergleich, die Argumente werden nicht ausgewertet; Stufen über
+// LOG_MAX_LEVEL entfallen ganz. Disabled levels cost one compare and the arguments are not evaluated;
+// levels above LOG_MAX_LEVEL are compiled out.
+
+typedef enum {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+} LogLevel;
+
+typedef enum {
+    LOG_MOD_WEB,
+    LOG_MOD_NFC,
+    LOG_MOD_BAMBU,
+    LOG_MOD_API,        // Spoolman/OctoPrint-Anfragen und Verbrauchsbuchung -- Spoolman/OctoPrint requests and consumption booking
+    LOG_MOD_SCALE,
+    LOG_MOD_COUNT
+} LogModule;
+
+extern volatile uint8_t logLevels[LOG_MOD_COUNT];
+
+#define LOG_ENABLED(module, level)  ((level) <= LOG_MAX_LEVEL && (level) <= logLevels[module])
+#define LOG_AT(module, level, ...)  do { if (LOG_ENABLED(module, level)) logWrite(module, level, __VA_ARGS__); } while (0)
+#define LOG_E(module, ...)          LOG_AT(module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_W(module, ...)          LOG_AT(module, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_I(module, ...)          LOG_AT(module, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_D(module, ...)          LOG_AT(module, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+void logInit();
+void logWrite(LogModule module, LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+// Stufe zur Laufzeit setzen, module "all" für alle; false bei unbekanntem Namen
+// Set a level at runtime, module "all" for every module; false for an unknown name
+bool logSetLevel(const char* module, const char* level);
+// Objekt {"web":"info",...} als nächster Wert -- object {"web":"info",...} as the next value
+void logLevelsToJson(JsonWriter& json);
+
+#endif
@@ -12,6 +12,9 @@
 #include "scale.h"
 #include "esp_task_wdt.h"
 #include "commonFS.h"
+#include "consumption.h"
+#include "metrics.h"
+#include "logger.h"
 
 bool mainTaskWasPaused = 0;
 uint8_t scaleTareCounter = 0;
@@ -28,6 +31,12 @@ void setup() {
   Serial.printf("ESP32 Chip ID = %04X", (uint16_t)(chipid >> 32)); //print High 2 bytes
   Serial.printf("%08X\n", (uint32_t)chipid); //print Low 4bytes.
 
+  // Laufzeit-Metriken für /metrics -- runtime metrics for /metrics
+  metricsInit();
+  // Log-Zeilen gehen ab hier über den LogWriter-Task -- from here on log lines go through the LogWriter task
+  logInit();
+  metricsRegisterTask("loopTask", xTaskGetCurrentTaskHandle());
+
   // Initialize SPIFFS
   initializeFileSystem();
 
@@ -98,7 +107,6 @@ int16_t lastWeight = 0;
 // WIFI check variables
 unsigned long lastWifiCheckTime = 0;
 unsigned long lastTopRowUpdateTime = 0;
-unsigned long lastSpoolmanHealcheckTime = 0;
 
 // Button debounce variables
 unsigned long lastButtonPress = 0;
@@ -127,29 +135,25 @@ void loop() {
     oledShowTopRow();
   }
 
-  // Periodic spoolman health check
-  if (intervalElapsed(currentMillis, lastSpoolmanHealcheckTime, SPOOLMAN_HEALTHCHECK_INTERVAL)) 
+  // Fehler aus dem Spoolman Health-Task anzeigen, nur loop() zeichnet auf das Display
+  if (spoolmanExtraFieldsFailed) 
   {
-    checkSpoolmanInstance();
+    spoolmanExtraFieldsFailed = false;
+    oledShowMessage("Spoolman Error creating Extrafields");
   }
 
   // Wenn Bambu auto set Spool aktiv
-  if (bambuCredentials.autosend_enable && autoSetToBambuSpoolId > 0) 
+  if (bambuAutoSend.enable && autoSetToBambuSpoolId > 0) 
   {
-    if (!bambuDisabled && !bambu_connected) 
-    {
-      bambu_restart();
-    }
-
     if (intervalElapsed(currentMillis, lastAutoSetBambuAmsTime, autoSetBambuAmsInterval)) 
     {
       if (nfcReaderState == NFC_IDLE)
       {
         lastAutoSetBambuAmsTime = currentMillis;
-        oledShowMessage("Auto Set         " + String(bambuCredentials.autosend_time - autoAmsCounter) + "s");
+        oledShowMessage("Auto Set         " + String(bambuAutoSend.time - autoAmsCounter) + "s");
         autoAmsCounter++;
 
-        if (autoAmsCounter >= bambuCredentials.autosend_time) 
+        if (autoAmsCounter >= bambuAutoSend.time) 
         {
           autoSetToBambuSpoolId = 0;
           autoAmsCounter = 0;
@@ -175,7 +179,7 @@ void loop() {
     // Ausgabe der Waage auf Display
     if(pauseMainTask == 0)
     {
-      if (mainTaskWasPaused || (weight != lastWeight && nfcReaderState == NFC_IDLE && (!bambuCredentials.autosend_enable || autoSetToBambuSpoolId == 0)))
+      if (mainTaskWasPaused || (weight != lastWeight && nfcReaderState == NFC_IDLE && (!bambuAutoSend.enable || autoSetToBambuSpoolId == 0)))
       {
         (weight < 2) ? ((weight < -2) ? oledShowMessage("!! -0") : oledShowWeight(0)) : oledShowWeight(weight);
       }
@@ -222,6 +226,7 @@ void loop() {
       weigthCouterToApi = 0;
     }
     
+    if (weight != lastWeight) sendWeight(weight);
     lastWeight = weight;
 
     // Wenn ein Tag mit SM id erkannte wurde und der Waage Counter anspricht an SM Senden
@@ -235,7 +240,7 @@ void loop() {
         weightSend = 1;
         
         // Set Bambu spool ID for auto-send if enabled
-        if (bambuCredentials.autosend_enable) 
+        if (bambuAutoSend.enable) 
         {
           autoSetToBambuSpoolId = activeSpoolId.toInt();
         }
@@ -253,6 +258,9 @@ void loop() {
       sendOctoUpdate = false;
     }
   }
+
+  // Geschätzten Verbrauch aus den AMS-Berichten buchen
+  consumptionLoop();
   
   esp_task_wdt_reset();
 }
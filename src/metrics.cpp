@@ -0,0 +1,177 @@
+#include "metrics.h"
+
+#ifndef VERSION
+  #define VERSION "1.1.0"
+#endif
+
+static Metric registry[METRICS_MAX];
+static std::atomic<uint8_t> metricCount(0);
+static portMUX_TYPE metricsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Felder vollständig setzen, bevor der Eintrag gezählt wird -- fill all fields before the entry is counted
+static Metric* registerMetric(const char* name, const char* help, MetricType type, const char* label, const char* labelValue,
+                              MetricReadFn read, void* ctx, const uint32_t* bounds, uint8_t bucketCount, uint32_t scale) {
+    Metric* metric = nullptr;
+
+    portENTER_CRITICAL(&metricsMux);
+    uint8_t index = metricCount.load(std::memory_order_relaxed);
+    if (index < METRICS_MAX) {
+        metric = &registry[index];
+        metric->name = name;
+        metric->help = help;
+        metric->label = label;
+        metric->labelValue = labelValue;
+        metric->type = type;
+        metric->read = read;
+        metric->ctx = ctx;
+        metric->bounds = bounds;
+        metric->bucketCount = min(bucketCount, (uint8_t)METRICS_MAX_BUCKETS);
+        metric->scale = scale ? scale : 1;
+        metricCount.store(index + 1, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&metricsMux);
+
+    if (!metric) Serial.printf("Metrik-Registry voll, %s fehlt -- metrics registry full\n", name);
+    return metric;
+}
+
+Metric* metricsCounter(const char* name, const char* help, const char* label, const char* labelValue) {
+    return registerMetric(name, help, METRIC_COUNTER, label, labelValue, nullptr, nullptr, nullptr, 0, 1);
+}
+
+Metric* metricsGauge(const char* name, const char* help, MetricReadFn read, void* ctx, const char* label, const char* labelValue) {
+    return registerMetric(name, help, METRIC_GAUGE, label, labelValue, read, ctx, nullptr, 0, 1);
+}
+
+Metric* metricsHistogram(const char* name, const char* help, const uint32_t* bounds, uint8_t bucketCount, uint32_t scale,
+                         const char* label, const char* labelValue) {
+    return registerMetric(name, help, METRIC_HISTOGRAM, label, labelValue, nullptr, nullptr, bounds, bucketCount, scale);
+}
+
+void metricsObserve(Metric* metric, uint32_t value) {
+    if (!metric) return;
+    uint8_t bucket = 0;
+    while (bucket < metric->bucketCount && value > metric->bounds[bucket]) bucket++;
+    metric->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    metric->sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+static uint32_t readStackHighWater(void *ctx) {
+    // Auf dem ESP32 in Bytes -- in bytes on the ESP32
+    return uxTaskGetStackHighWaterMark((TaskHandle_t)ctx);
+}
+
+void metricsRegisterTask(const char* name, TaskHandle_t task) {
+    if (!task) return;
+    metricsGauge("filaman_task_stack_free_min_bytes", "Lowest free stack of a task since boot",
+                 readStackHighWater, task, "task", name);
+}
+
+void metricsForgetTask(TaskHandle_t task) {
+    uint8_t count = metricCount.load(std::memory_order_acquire);
+    portENTER_CRITICAL(&metricsMux);
+    for (uint8_t i = 0; i < count; i++) {
+        if (registry[i].read == readStackHighWater && registry[i].ctx == task) registry[i].ctx = nullptr;
+    }
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+static uint32_t readFreeHeap(void *ctx) { return ESP.getFreeHeap(); }
+static uint32_t readMinFreeHeap(void *ctx) { return ESP.getMinFreeHeap(); }
+static uint32_t readLargestBlock(void *ctx) { return ESP.getMaxAllocHeap(); }
+static uint32_t readUptime(void *ctx) { return millis() / 1000; }
+static uint32_t readOne(void *ctx) { return 1; }
+
+void metricsInit() {
+    metricsGauge("filaman_build_info", "Firmware version", readOne, nullptr, "version", VERSION);
+    metricsGauge("filaman_uptime_seconds", "Seconds since boot", readUptime);
+    metricsGauge("filaman_heap_free_bytes", "Free heap", readFreeHeap);
+    metricsGauge("filaman_heap_min_free_bytes", "Lowest free heap since boot", readMinFreeHeap);
+    metricsGauge("filaman_heap_largest_block_bytes", "Largest allocatable heap block", readLargestBlock);
+}
+
+// Festkomma ohne Gleitkomma-printf: value / scale -- fixed point without float printf: value / scale
+static void printScaled(Print& out, uint32_t value, uint32_t scale) {
+    if (scale <= 1) {
+        out.print(value);
+        return;
+    }
+    int digits = 0;
+    for (uint32_t s = scale; s > 1; s /= 10) digits++;
+    out.printf("%lu.%0*lu", (unsigned long)(value / scale), digits, (unsigned long)(value % scale));
+}
+
+static void printLabels(Print& out, const Metric& metric, bool open) {
+    if (metric.label) {
+        out.printf("{%s=\"%s\"", metric.label, metric.labelValue);
+        if (!open) out.print('}');
+    } else if (open) {
+        out.print('{');
+    }
+}
+
+static void writeSample(Print& out, const Metric& metric) {
+    if (metric.type != METRIC_HISTOGRAM) {
+        uint32_t value;
+        if (metric.read == readStackHighWater) {
+            // Prüfen und Lesen im selben kritischen Abschnitt: metricsForgetTask() läuft vor vTaskDelete()
+            // und kann sich so nicht dazwischenschieben -- check and read in the same critical section:
+            // metricsForgetTask() runs before vTaskDelete() and cannot slip in between
+            portENTER_CRITICAL(&metricsMux);
+            TaskHandle_t task = (TaskHandle_t)metric.ctx;
+            value = task ? readStackHighWater(task) : 0;
+            portEXIT_CRITICAL(&metricsMux);
+            // Gelöschter Task -- deleted task
+            if (!task) return;
+        } else {
+            value = metric.read ? metric.read(metric.ctx) : metric.value.load(std::memory_order_relaxed);
+        }
+        out.print(metric.name);
+        printLabels(out, metric, false);
+        out.printf(" %lu\n", (unsigned long)value);
+        return;
+    }
+
+    // Prometheus erwartet kumulierte Buckets; +Inf und _count aus derselben Summe, damit sie übereinstimmen
+    // Prometheus expects cumulative buckets; +Inf and _count come from the same total so they match
+    uint32_t total = 0;
+    for (uint8_t i = 0; i <= metric.bucketCount; i++) {
+        total += metric.buckets[i].load(std::memory_order_relaxed);
+        out.printf("%s_bucket", metric.name);
+        printLabels(out, metric, true);
+        out.print(metric.label ? ",le=\"" : "le=\"");
+        if (i < metric.bucketCount) {
+            printScaled(out, metric.bounds[i], metric.scale);
+        } else {
+            out.print("+Inf");
+        }
+        out.printf("\"} %lu\n", (unsigned long)total);
+    }
+    out.printf("%s_sum", metric.name);
+    printLabels(out, metric, false);
+    out.print(' ');
+    printScaled(out, metric.sum.load(std::memory_order_relaxed), metric.scale);
+    out.printf("\n%s_count", metric.name);
+    printLabels(out, metric, false);
+    out.printf(" %lu\n", (unsigned long)total);
+}
+
+void metricsWrite(Print& out) {
+    static const char* const typeNames[] = { "counter", "gauge", "histogram" };
+    uint8_t count = metricCount.load(std::memory_order_acquire);
+
+    // Alle Einträge einer Familie direkt hinter HELP und TYPE -- all entries of a family right after HELP and TYPE
+    for (uint8_t i = 0; i < count; i++) {
+        bool seen = false;
+        for (uint8_t j = 0; j < i && !seen; j++) {
+            seen = strcmp(registry[j].name, registry[i].name) == 0;
+        }
+        if (seen) continue;
+
+        out.printf("# HELP %s %s\n# TYPE %s %s\n", registry[i].name, registry[i].help,
+                   registry[i].name, typeNames[registry[i].type]);
+        for (uint8_t j = i; j < count; j++) {
+            if (strcmp(registry[j].name, registry[i].name) == 0) writeSample(out, registry[j]);
+        }
+    }
+}
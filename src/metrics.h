@@ -0,0 +1,73 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Laufzeit-Metriken im Prometheus-Textformat -- runtime metrics in Prometheus text format
+//
+// Jedes Modul registriert seine Zähler, Messwerte und Histogramme einmal beim Start und
+// erhöht sie danach ohne Sperre aus beliebigen Tasks. /metrics liest sie nur.
+// Every module registers its counters, gauges and histograms once at startup and then
+// updates them lock-free from any task. /metrics only reads them.
+// Namen, Hilfetexte und Labels müssen statische Strings sein -- names, help texts and labels
+// must be static strings. Metriken gleichen Namens bilden eine Familie mit je einem Label.
+// Metrics with the same name form one family, each with its own label value.
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} MetricType;
+
+// Liefert den aktuellen Wert eines Gauges beim Abruf -- returns a gauge's current value when scraped
+typedef uint32_t (*MetricReadFn)(void *ctx);
+
+typedef struct {
+    const char* name;
+    const char* help;
+    const char* label;
+    const char* labelValue;
+    MetricType type;
+    std::atomic<uint32_t> value;
+    MetricReadFn read;
+    void* ctx;
+    // Histogramm: Obergrenzen in Einheiten, scale Einheiten pro Basiseinheit (1000 für ms -> s)
+    // Histogram: upper bounds in units, scale units per base unit (1000 for ms -> s)
+    const uint32_t* bounds;
+    uint8_t bucketCount;
+    uint32_t scale;
+    std::atomic<uint32_t> buckets[METRICS_MAX_BUCKETS + 1];
+    std::atomic<uint32_t> sum;
+} Metric;
+
+// Alle liefern nullptr wenn die Registry voll ist; die Update-Funktionen ignorieren nullptr
+// All return nullptr when the registry is full; the update functions ignore nullptr
+Metric* metricsCounter(const char* name, const char* help, const char* label = nullptr, const char* labelValue = nullptr);
+Metric* metricsGauge(const char* name, const char* help, MetricReadFn read = nullptr, void* ctx = nullptr,
+                     const char* label = nullptr, const char* labelValue = nullptr);
+Metric* metricsHistogram(const char* name, const char* help, const uint32_t* bounds, uint8_t bucketCount, uint32_t scale,
+                         const char* label = nullptr, const char* labelValue = nullptr);
+
+// Freier Stack-Tiefststand eines Tasks -- minimum free stack of a task
+void metricsRegisterTask(const char* name, TaskHandle_t task);
+// Vor vTaskDelete() aufrufen, der Eintrag verschwindet dann aus /metrics
+// Call before vTaskDelete(), the entry then disappears from /metrics
+void metricsForgetTask(TaskHandle_t task);
+
+inline void metricsInc(Metric* metric, uint32_t n = 1) {
+    if (metric) metric->value.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void metricsSet(Metric* metric, uint32_t value) {
+    if (metric) metric->value.store(value, std::memory_order_relaxed);
+}
+
+void metricsObserve(Metric* metric, uint32_t value);
+
+// Heap und Laufzeit -- heap and uptime
+void metricsInit();
+void metricsWrite(Print& out);
+
+#endif
@@ -0,0 +1,353 @@
+#include "mqtt_stream.h"
+
+#define MQTT_PACKET_CONNECT     0x10
+#define MQTT_PACKET_CONNACK     0x20
+#define MQTT_PACKET_PUBLISH     0x30
+#define MQTT_PACKET_PUBACK      0x40
+#define MQTT_PACKET_SUBSCRIBE   0x82
+#define MQTT_PACKET_PINGREQ     0xC0
+#define MQTT_PACKET_PINGRESP    0xD0
+#define MQTT_PACKET_DISCONNECT  0xE0
+
+MqttStreamClient::MqttStreamClient(Client& client)
+    : _client(client), _keepAlive(MQTT_STREAM_KEEPALIVE), _state(MQTT_STREAM_DISCONNECTED),
+      _nextPacketId(1), _lastOutbound(0), _lastInbound(0), _connectStart(0), _pingOutstanding(false),
+      _connackReceived(false), _connackCode(0),
+      _onBegin(nullptr), _onData(nullptr), _onEnd(nullptr), _cbCtx(nullptr),
+      _rxState(RX_HEADER) {
+}
+
+void MqttStreamClient::setKeepAlive(uint16_t seconds) {
+    _keepAlive = seconds;
+}
+
+void MqttStreamClient::setCallbacks(MessageBeginCallback onBegin, MessageDataCallback onData, MessageEndCallback onEnd, void* ctx) {
+    _onBegin = onBegin;
+    _onData = onData;
+    _onEnd = onEnd;
+    _cbCtx = ctx;
+}
+
+size_t MqttStreamClient::putString(uint8_t* buf, size_t pos, const char* str) {
+    size_t len = strlen(str);
+    buf[pos++] = (uint8_t)(len >> 8);
+    buf[pos++] = (uint8_t)(len & 0xFF);
+    memcpy(buf + pos, str, len);
+    return pos + len;
+}
+
+bool MqttStreamClient::writePacket(uint8_t header, const uint8_t* head, size_t headLen, const uint8_t* body, size_t bodyLen) {
+    // Fester Header + variabler Teil in einem write(), Payload separat -- fixed + variable header in one write, payload separately
+    uint8_t buf[5 + MQTT_STREAM_TOPIC_LEN + 8];
+    size_t remaining = headLen + bodyLen;
+    size_t pos = 0;
+
+    if (headLen > sizeof(buf) - 5) return false;
+
+    buf[pos++] = header;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        if (remaining > 0) digit |= 0x80;
+        buf[pos++] = digit;
+    } while (remaining > 0);
+
+    if (headLen > 0) {
+        memcpy(buf + pos, head, headLen);
+        pos += headLen;
+    }
+
+    if (_client.write(buf, pos) != pos) return false;
+    if (bodyLen > 0 && _client.write(body, bodyLen) != bodyLen) return false;
+
+    _lastOutbound = millis();
+    return true;
+}
+
+bool MqttStreamClient::startSession(const char* clientId, const char* user, const char* pass) {
+    uint8_t buf[160];
+    size_t pos = 0;
+
+    if (strlen(clientId) + strlen(user) + strlen(pass) + 16 > sizeof(buf) || !_client.connected()) {
+        fail(MQTT_STREAM_CONNECT_FAILED);
+        return false;
+    }
+
+    // Variabler Header: Protokollname, Level 4, Flags, Keepalive
+    pos = putString(buf, pos, "MQTT");
+    buf[pos++] = 0x04;
+    buf[pos++] = 0x02 | 0x80 | 0x40;    // clean session, username, password
+    buf[pos++] = (uint8_t)(_keepAlive >> 8);
+    buf[pos++] = (uint8_t)(_keepAlive & 0xFF);
+    pos = putString(buf, pos, clientId);
+    pos = putString(buf, pos, user);
+    pos = putString(buf, pos, pass);
+
+    _rxState = RX_HEADER;
+    _connackReceived = false;
+    _pingOutstanding = false;
+
+    if (!writePacket(MQTT_PACKET_CONNECT, nullptr, 0, buf, pos)) {
+        fail(MQTT_STREAM_CONNECT_FAILED);
+        return false;
+    }
+
+    _connectStart = millis();
+    _state = MQTT_STREAM_CONNECTING;
+    return true;
+}
+
+int MqttStreamClient::pollSession() {
+    if (_state == MQTT_STREAM_CONNECTED) return 1;
+    if (_state != MQTT_STREAM_CONNECTING) return -1;
+
+    processIncoming();
+    if (_state != MQTT_STREAM_CONNECTING) return -1;
+
+    if (!_connackReceived) {
+        if (millis() - _connectStart > MQTT_STREAM_TIMEOUT || !_client.connected()) {
+            fail(MQTT_STREAM_CONNECTION_TIMEOUT);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (_connackCode != 0) {
+        fail(_connackCode);
+        return -1;
+    }
+
+    _lastInbound = millis();
+    _state = MQTT_STREAM_CONNECTED;
+    return 1;
+}
+
+void MqttStreamClient::disconnect() {
+    if (_client.connected()) {
+        uint8_t packet[2] = { MQTT_PACKET_DISCONNECT, 0x00 };
+        _client.write(packet, sizeof(packet));
+    }
+    _client.stop();
+    _state = MQTT_STREAM_DISCONNECTED;
+}
+
+void MqttStreamClient::fail(int state) {
+    _client.stop();
+    _state = state;
+    _rxState = RX_HEADER;
+}
+
+bool MqttStreamClient::connected() {
+    if (_state != MQTT_STREAM_CONNECTED) return false;
+    if (!_client.connected()) {
+        fail(MQTT_STREAM_CONNECTION_LOST);
+        return false;
+    }
+    return true;
+}
+
+bool MqttStreamClient::subscribe(const char* topic) {
+    uint8_t buf[2 + 2 + MQTT_STREAM_TOPIC_LEN + 1];
+    size_t pos = 0;
+
+    if (!connected() || strlen(topic) > MQTT_STREAM_TOPIC_LEN) return false;
+
+    buf[pos++] = (uint8_t)(_nextPacketId >> 8);
+    buf[pos++] = (uint8_t)(_nextPacketId & 0xFF);
+    if (++_nextPacketId == 0) _nextPacketId = 1;
+    pos = putString(buf, pos, topic);
+    buf[pos++] = 0x00;  // QoS 0
+
+    return writePacket(MQTT_PACKET_SUBSCRIBE, nullptr, 0, buf, pos);
+}
+
+bool MqttStreamClient::publish(const char* topic, const char* payload) {
+    uint8_t head[2 + MQTT_STREAM_TOPIC_LEN];
+
+    if (!connected() || strlen(topic) > MQTT_STREAM_TOPIC_LEN) return false;
+
+    size_t headLen = putString(head, 0, topic);
+    return writePacket(MQTT_PACKET_PUBLISH, head, headLen, (const uint8_t*)payload, strlen(payload));
+}
+
+bool MqttStreamClient::loop() {
+    if (!connected()) return false;
+
+    unsigned long now = millis();
+    unsigned long keepAliveMs = (unsigned long)_keepAlive * 1000UL;
+
+    if (_pingOutstanding && now - _lastInbound > keepAliveMs + keepAliveMs / 2) {
+        fail(MQTT_STREAM_CONNECTION_TIMEOUT);
+        return false;
+    }
+
+    if (!_pingOutstanding && (now - _lastOutbound >= keepAliveMs || now - _lastInbound >= keepAliveMs)) {
+        uint8_t packet[2] = { MQTT_PACKET_PINGREQ, 0x00 };
+        if (_client.write(packet, sizeof(packet)) != sizeof(packet)) {
+            fail(MQTT_STREAM_CONNECTION_LOST);
+            return false;
+        }
+        _lastOutbound = now;
+        _pingOutstanding = true;
+    }
+
+    processIncoming();
+    return connected();
+}
+
+void MqttStreamClient::processIncoming() {
+    size_t budget = MQTT_STREAM_LOOP_BUDGET;
+
+    while (budget > 0) {
+        int avail = _client.available();
+        if (avail <= 0) return;
+
+        switch (_rxState) {
+            case RX_HEADER: {
+                int b = _client.read();
+                if (b < 0) return;
+                budget--;
+                _rxHeader = (uint8_t)b;
+                _rxRemaining = 0;
+                _rxLenShift = 0;
+                _rxState = RX_LENGTH;
+                break;
+            }
+
+            case RX_LENGTH: {
+                int b = _client.read();
+                if (b < 0) return;
+                budget--;
+                _rxRemaining |= (uint32_t)(b & 0x7F) << _rxLenShift;
+                _rxLenShift += 7;
+                if (!(b & 0x80)) {
+                    startPacket();
+                } else if (_rxLenShift > 21) {
+                    fail(MQTT_STREAM_CONNECTION_LOST);
+                    return;
+                }
+                break;
+            }
+
+            case RX_TOPIC_LEN:
+            case RX_PACKET_ID: {
+                int b = _client.read();
+                if (b < 0) return;
+                budget--;
+                _rxRemaining--;
+                _rxSmall[_rxSmallLen++] = (uint8_t)b;
+                if (_rxSmallLen < 2) break;
+
+                if (_rxState == RX_TOPIC_LEN) {
+                    _rxTopicLen = ((uint16_t)_rxSmall[0] << 8) | _rxSmall[1];
+                    // Topic und Paket-ID müssen ins Paket passen, sonst läuft _rxRemaining über
+                    // Topic and packet id must fit into the packet, otherwise _rxRemaining wraps around
+                    if ((uint32_t)_rxTopicLen + ((_rxHeader & 0x06) ? 2 : 0) > _rxRemaining) {
+                        fail(MQTT_STREAM_CONNECTION_LOST);
+                        return;
+                    }
+                    _rxTopicPos = 0;
+                    _rxTopic[0] = '\0';
+                    _rxState = RX_TOPIC;
+                    if (_rxTopicLen == 0) beginPayload();
+                } else {
+                    // QoS 1: Empfang bestätigen -- acknowledge QoS 1 delivery
+                    uint8_t ack[4] = { MQTT_PACKET_PUBACK, 0x02, _rxSmall[0], _rxSmall[1] };
+                    _client.write(ack, sizeof(ack));
+                    _lastOutbound = millis();
+                    _rxSmallLen = 0;
+                    beginPayload();
+                }
+                break;
+            }
+
+            case RX_TOPIC: {
+                size_t n = min((size_t)avail, (size_t)(_rxTopicLen - _rxTopicPos));
+                n = min(n, min(sizeof(_chunk), budget));
+                int got = _client.read(_chunk, n);
+                if (got <= 0) return;
+                budget -= got;
+                _rxRemaining -= got;
+                for (int i = 0; i < got; i++, _rxTopicPos++) {
+                    if (_rxTopicPos < MQTT_STREAM_TOPIC_LEN - 1) {
+                        _rxTopic[_rxTopicPos] = (char)_chunk[i];
+                        _rxTopic[_rxTopicPos + 1] = '\0';
+                    }
+                }
+                if (_rxTopicPos >= _rxTopicLen) {
+                    if ((_rxHeader & 0x06) != 0) {
+                        _rxSmallLen = 0;
+                        _rxState = RX_PACKET_ID;
+                    } else {
+                        beginPayload();
+                    }
+                }
+                break;
+            }
+
+            case RX_PAYLOAD: {
+                size_t n = min((size_t)avail, (size_t)_rxRemaining);
+                n = min(n, min(sizeof(_chunk), budget));
+                int got = _client.read(_chunk, n);
+                if (got <= 0) return;
+                budget -= got;
+                _rxRemaining -= got;
+                if (_onData) _onData(_chunk, got, _cbCtx);
+                if (_rxRemaining == 0) {
+                    if (_onEnd) _onEnd(_cbCtx);
+                    _rxState = RX_HEADER;
+                }
+                break;
+            }
+
+            case RX_CONTROL: {
+                int b = _client.read();
+                if (b < 0) return;
+                budget--;
+                _rxRemaining--;
+                if (_rxSmallLen < sizeof(_rxSmall)) _rxSmall[_rxSmallLen++] = (uint8_t)b;
+                if (_rxRemaining == 0) handleControl();
+                break;
+            }
+        }
+    }
+}
+
+void MqttStreamClient::startPacket() {
+    _lastInbound = millis();
+    _rxSmallLen = 0;
+
+    if ((_rxHeader & 0xF0) == MQTT_PACKET_PUBLISH) {
+        _rxState = RX_TOPIC_LEN;
+        if (_rxRemaining < 2) fail(MQTT_STREAM_CONNECTION_LOST);
+    } else {
+        _rxState = RX_CONTROL;
+        if (_rxRemaining == 0) handleControl();
+    }
+}
+
+void MqttStreamClient::beginPayload() {
+    if (_onBegin) _onBegin(_rxTopic, _rxRemaining, _cbCtx);
+    if (_rxRemaining == 0) {
+        if (_onEnd) _onEnd(_cbCtx);
+        _rxState = RX_HEADER;
+    } else {
+        _rxState = RX_PAYLOAD;
+    }
+}
+
+void MqttStreamClient::handleControl() {
+    switch (_rxHeader & 0xF0) {
+        case MQTT_PACKET_CONNACK:
+            _connackReceived = true;
+            _connackCode = (_rxSmallLen >= 2) ? _rxSmall[1] : 0xFF;
+            break;
+        case MQTT_PACKET_PINGRESP:
+            _pingOutstanding = false;
+            break;
+        default:
+            // SUBACK, UNSUBACK etc. werden nicht ausgewertet
+            break;
+    }
+    _rxState = RX_HEADER;
+}
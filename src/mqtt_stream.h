@@ -0,0 +1,99 @@
+#ifndef MQTT_STREAM_H
+#define MQTT_STREAM_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Minimaler MQTT 3.1.1 Client (QoS 0), der eingehende PUBLISH-Payloads in
+// kleinen Stücken an Callbacks weiterreicht statt sie komplett zu puffern.
+// Minimal MQTT 3.1.1 client (QoS 0) that hands incoming PUBLISH payloads to
+// callbacks in small chunks instead of buffering the whole message.
+
+#define MQTT_STREAM_CHUNK_SIZE      256     // Größe eines Payload-Stücks
+#define MQTT_STREAM_TOPIC_LEN       64
+#define MQTT_STREAM_LOOP_BUDGET     4096    // Max. Bytes pro loop()-Aufruf
+#define MQTT_STREAM_KEEPALIVE       15      // Sekunden
+#define MQTT_STREAM_TIMEOUT         5000    // ms für CONNACK
+
+// Bis auf CONNECTING gleiche Werte wie PubSubClient::state() -- same values as PubSubClient::state() except CONNECTING
+#define MQTT_STREAM_CONNECTING             -5      // CONNECT gesendet, CONNACK ausstehend
+#define MQTT_STREAM_CONNECTION_TIMEOUT     -4
+#define MQTT_STREAM_CONNECTION_LOST        -3
+#define MQTT_STREAM_CONNECT_FAILED         -2
+#define MQTT_STREAM_DISCONNECTED           -1
+#define MQTT_STREAM_CONNECTED               0
+
+class MqttStreamClient {
+public:
+    typedef void (*MessageBeginCallback)(const char* topic, uint32_t length, void* ctx);
+    typedef void (*MessageDataCallback)(const uint8_t* data, size_t len, void* ctx);
+    typedef void (*MessageEndCallback)(void* ctx);
+
+    explicit MqttStreamClient(Client& client);
+
+    void setKeepAlive(uint16_t seconds);
+    void setCallbacks(MessageBeginCallback onBegin, MessageDataCallback onData, MessageEndCallback onEnd, void* ctx);
+
+    // Der Client muss bereits verbunden sein; startSession() sendet CONNECT,
+    // pollSession() wartet ohne zu blockieren auf CONNACK (1 verbunden, 0 läuft, -1 Fehler)
+    // The client must already be connected; startSession() sends CONNECT,
+    // pollSession() waits for CONNACK without blocking (1 connected, 0 pending, -1 failed)
+    bool startSession(const char* clientId, const char* user, const char* pass);
+    int pollSession();
+    void disconnect();
+    bool connected();
+    bool subscribe(const char* topic);
+    bool publish(const char* topic, const char* payload);
+    bool loop();
+    int state() const { return _state; }
+    // Ein Paket ist halb empfangen -- a packet is partially received
+    bool receiving() const { return _state == MQTT_STREAM_CONNECTED && _rxState != RX_HEADER; }
+
+private:
+    typedef enum {
+        RX_HEADER,
+        RX_LENGTH,
+        RX_TOPIC_LEN,
+        RX_TOPIC,
+        RX_PACKET_ID,
+        RX_PAYLOAD,
+        RX_CONTROL
+    } RxState;
+
+    bool writePacket(uint8_t header, const uint8_t* head, size_t headLen, const uint8_t* body, size_t bodyLen);
+    static size_t putString(uint8_t* buf, size_t pos, const char* str);
+    void processIncoming();
+    void startPacket();
+    void beginPayload();
+    void handleControl();
+    void fail(int state);
+
+    Client& _client;
+    uint16_t _keepAlive;
+    int _state;
+    uint16_t _nextPacketId;
+    unsigned long _lastOutbound;
+    unsigned long _lastInbound;
+    unsigned long _connectStart;
+    bool _pingOutstanding;
+    bool _connackReceived;
+    uint8_t _connackCode;
+
+    MessageBeginCallback _onBegin;
+    MessageDataCallback _onData;
+    MessageEndCallback _onEnd;
+    void* _cbCtx;
+
+    RxState _rxState;
+    uint8_t _rxHeader;
+    uint32_t _rxRemaining;
+    uint8_t _rxLenShift;
+    uint16_t _rxTopicLen;
+    uint16_t _rxTopicPos;
+    uint8_t _rxSmall[4];
+    uint8_t _rxSmallLen;
+    char _rxTopic[MQTT_STREAM_TOPIC_LEN];
+    uint8_t _chunk[MQTT_STREAM_CHUNK_SIZE];
+};
+
+#endif
@@ -9,6 +9,8 @@
 #include "scale.h"
 #include "bambu.h"
 #include "main.h"
+#include "metrics.h"
+#include "logger.h"
 
 //Adafruit_PN532 nfc(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
 Adafruit_PN532 nfc(PN532_IRQ, PN532_RESET);
@@ -29,6 +31,14 @@ struct NfcWriteParameterType {
   char* payload;
 };
 
+// nfcJsonData gehört dem RFID-Task, andere Tasks lesen nur diese Kopie
+// nfcJsonData belongs to the RFID task, other tasks only read this copy
+static char lastTagJson[NFC_PAYLOAD_MAX + 1] = "";
+static portMUX_TYPE lastTagMux = portMUX_INITIALIZER_UNLOCKED;
+
+static Metric* readsMetric = nullptr;
+static Metric* readFailuresMetric = nullptr;
+
 volatile nfcReaderStateType nfcReaderState = NFC_IDLE;
 // 0 = nicht gelesen
 // 1 = erfolgreich gelesen
@@ -61,24 +71,15 @@ void payloadToJson(uint8_t *data) {
         int max_temp = doc["max_temp"];
         const char* brand = doc["brand"];
   
-        Serial.println();
-        Serial.println("-----------------");
-        Serial.println("JSON-Parsed Data:");
-        Serial.println(color_hex);
-        Serial.println(type);
-        Serial.println(min_temp);
-        Serial.println(max_temp);
-        Serial.println(brand);
-        Serial.println("-----------------");
-        Serial.println();
+        LOG_D(LOG_MOD_NFC, "JSON-Parsed Data: %s %s %d-%d %s", color_hex ? color_hex : "", type ? type : "",
+              min_temp, max_temp, brand ? brand : "");
       } else {
-        Serial.print("deserializeJson() failed: ");
-        Serial.println(error.f_str());
+        LOG_W(LOG_MOD_NFC, "deserializeJson() failed: %s", error.c_str());
       }
 
       doc.clear();
     } else {
-        Serial.println("Kein gültiger JSON-Inhalt gefunden oder fehlerhafte Formatierung.");
+        LOG_W(LOG_MOD_NFC, "Kein gültiger JSON-Inhalt gefunden oder fehlerhafte Formatierung.");
         //writeJsonToTag("{\"version\":\"1.0\",\"protocol\":\"NFC\",\"color_hex\":\"#FFFFFF\",\"type\":\"Example\",\"min_temp\":10,\"max_temp\":30,\"brand\":\"BrandName\"}");
     }
   }
@@ -88,8 +89,7 @@ bool formatNdefTag() {
     bool success = true;
     int pageOffset = 4; // Startseite für NDEF-Daten auf NTAG2xx
   
-    Serial.println();
-    Serial.println("Formatiere NDEF-Tag...");
+    LOG_I(LOG_MOD_NFC, "Formatiere NDEF-Tag...");
   
     // Schreibe die Initialisierungsnachricht auf die ersten Seiten
     for (int i = 0; i < sizeof(ndefInit); i += 4) {
@@ -112,17 +112,15 @@ uint16_t readTagSize()
 
 uint8_t ntag2xx_WriteNDEF(const char *payload) {
   uint16_t tagSize = readTagSize();
-  Serial.print("Tag Size: ");Serial.println(tagSize);
+  LOG_D(LOG_MOD_NFC, "Tag Size: %u", tagSize);
 
   uint8_t pageBuffer[4] = {0, 0, 0, 0};
-  Serial.println("Beginne mit dem Schreiben der NDEF-Nachricht...");
+  LOG_I(LOG_MOD_NFC, "Beginne mit dem Schreiben der NDEF-Nachricht...");
   
   // Figure out how long the string is
   uint8_t len = strlen(payload);
-  Serial.print("Länge der Payload: ");
-  Serial.println(len);
-  
-  Serial.print("Payload: ");Serial.println(payload);
+  LOG_D(LOG_MOD_NFC, "Länge der Payload: %u", len);
+  LOG_D(LOG_MOD_NFC, "Payload: %s", payload);
 
   // Setup the record header
   // See NFCForum-TS-Type-2-Tag_1.1.pdf for details
@@ -139,11 +137,7 @@ uint8_t ntag2xx_WriteNDEF(const char *payload) {
   // Make sure the URI payload will fit in dataLen (include 0xFE trailer)
   if ((len < 1) || (len + 1 > (tagSize - sizeof(pageHeader)))) 
   {
-    Serial.println();
-    Serial.println("!!!!!!!!!!!!!!!!!!!!!!!!");
-    Serial.println("Fehler: Die Nutzlast passt nicht in die Datenlänge.");
-    Serial.println("!!!!!!!!!!!!!!!!!!!!!!!!");
-    Serial.println();
+    LOG_E(LOG_MOD_NFC, "Fehler: Die Nutzlast passt nicht in die Datenlänge.");
     return 0;
   }
 
@@ -152,7 +146,7 @@ uint8_t ntag2xx_WriteNDEF(const char *payload) {
   uint8_t* combinedData = (uint8_t*) malloc(totalSize);
   if (combinedData == NULL) 
   {
-    Serial.println("Fehler: Nicht genug Speicher vorhanden.");
+    LOG_E(LOG_MOD_NFC, "Fehler: Nicht genug Speicher vorhanden.");
     oledShowMessage("Tag too small");
     vTaskDelay(2000 / portTICK_PERIOD_MS);
     return 0;
@@ -176,7 +170,7 @@ uint8_t ntag2xx_WriteNDEF(const char *payload) {
 
     if (!(nfc.ntag2xx_WritePage(4+i, pageBuffer))) 
     {
-      Serial.println("Fehler beim Schreiben der Seite.");
+      LOG_E(LOG_MOD_NFC, "Fehler beim Schreiben der Seite.");
       free(combinedData);
       return 0;
     }
@@ -194,16 +188,24 @@ uint8_t ntag2xx_WriteNDEF(const char *payload) {
   pageBuffer[0] = 0xFE; // NDEF record footer
   if (!(nfc.ntag2xx_WritePage(4+i, pageBuffer))) 
   {
-    Serial.println("Fehler beim Schreiben des End-Bits.");
+    LOG_E(LOG_MOD_NFC, "Fehler beim Schreiben des End-Bits.");
     free(combinedData);
     return 0;
   }
 
-  Serial.println("NDEF-Nachricht erfolgreich geschrieben.");
+  LOG_I(LOG_MOD_NFC, "NDEF-Nachricht erfolgreich geschrieben.");
   free(combinedData);
   return 1;
 }
 
+size_t nfcCopyLastTag(char* out, size_t size) {
+  if (size == 0) return 0;
+  portENTER_CRITICAL(&lastTagMux);
+  size_t len = strlcpy(out, lastTagJson, size);
+  portEXIT_CRITICAL(&lastTagMux);
+  return len < size ? len : size - 1;
+}
+
 bool decodeNdefAndReturnJson(const byte* encodedMessage) {
   oledShowProgressBar(1, octoEnabled?5:4, "Reading", "Decoding data");
 
@@ -223,41 +225,44 @@ bool decodeNdefAndReturnJson(const byte* encodedMessage) {
   if (error) 
   {
     nfcJsonData = "";
-    Serial.println("Fehler beim Verarbeiten des JSON-Dokuments");
-    Serial.print("deserializeJson() failed: ");
-    Serial.println(error.f_str());
+    LOG_W(LOG_MOD_NFC, "Fehler beim Verarbeiten des JSON-Dokuments: %s", error.c_str());
     return false;
   } 
   else 
   {
+    portENTER_CRITICAL(&lastTagMux);
+    strlcpy(lastTagJson, nfcJsonData.c_str(), sizeof(lastTagJson));
+    portEXIT_CRITICAL(&lastTagMux);
+
     // If spoolman is unavailable, there is no point in continuing
     if(spoolmanConnected){
       // Sende die aktualisierten AMS-Daten an alle WebSocket-Clients
-      Serial.println("JSON-Dokument erfolgreich verarbeitet");
-      Serial.println(doc.as<String>());
+      LOG_I(LOG_MOD_NFC, "JSON-Dokument erfolgreich verarbeitet");
+      LOG_D(LOG_MOD_NFC, "%s", nfcJsonData.c_str());
       if (doc["sm_id"].is<String>() && doc["sm_id"] != "") 
       {
         oledShowProgressBar(2, octoEnabled?5:4, "Spool Tag", "Weighing");
-        Serial.println("SPOOL-ID gefunden: " + doc["sm_id"].as<String>());
+        LOG_I(LOG_MOD_NFC, "SPOOL-ID gefunden: %s", doc["sm_id"].as<const char*>());
         activeSpoolId = doc["sm_id"].as<String>();
         lastSpoolId = activeSpoolId;
+        if (bambuAutoSend.enable && !bambuDisabled) bambuPrepareAutoSet(activeSpoolId.toInt());
       }
       else if(doc["location"].is<String>() && doc["location"] != "")
       {
-        Serial.println("Location Tag found!");
+        LOG_I(LOG_MOD_NFC, "Location Tag found!");
         String location = doc["location"].as<String>();
         if(lastSpoolId != ""){
           updateSpoolLocation(lastSpoolId, location);
         }
         else
         {
-          Serial.println("Location update tag scanned without scanning spool before!");
+          LOG_W(LOG_MOD_NFC, "Location update tag scanned without scanning spool before!");
           oledShowProgressBar(1, 1, "Failure", "Scan spool first");
         }
       }
       else 
       {
-        Serial.println("Keine SPOOL-ID gefunden.");
+        LOG_W(LOG_MOD_NFC, "Keine SPOOL-ID gefunden.");
         activeSpoolId = "";
         oledShowProgressBar(1, 1, "Failure", "Unkown tag");
       }
@@ -275,8 +280,8 @@ void writeJsonToTag(void *parameter) {
   NfcWriteParameterType* params = (NfcWriteParameterType*)parameter;
 
   // Gib die erstellte NDEF-Message aus
-  Serial.println("Erstelle NDEF-Message...");
-  Serial.println(params->payload);
+  LOG_I(LOG_MOD_NFC, "Erstelle NDEF-Message...");
+  LOG_D(LOG_MOD_NFC, "%s", params->payload);
 
   nfcReaderState = NFC_WRITING;
 
@@ -325,7 +330,7 @@ void writeJsonToTag(void *parameter) {
     success = ntag2xx_WriteNDEF(params->payload);
     if (success) 
     {
-        Serial.println("NDEF-Message erfolgreich auf den Tag geschrieben");
+        LOG_I(LOG_MOD_NFC, "NDEF-Message erfolgreich auf den Tag geschrieben");
         //oledShowMessage("NFC-Tag written");
         //vTaskDelay(1000 / portTICK_PERIOD_MS);
         nfcReaderState = NFC_WRITE_SUCCESS;
@@ -355,7 +360,7 @@ void writeJsonToTag(void *parameter) {
     } 
     else 
     {
-        Serial.println("Fehler beim Schreiben der NDEF-Message auf den Tag");
+        LOG_E(LOG_MOD_NFC, "Fehler beim Schreiben der NDEF-Message auf den Tag");
         oledShowIcon("failed");
         vTaskDelay(2000 / portTICK_PERIOD_MS);
         nfcReaderState = NFC_WRITE_ERROR;
@@ -363,7 +368,7 @@ void writeJsonToTag(void *parameter) {
   }
   else
   {
-    Serial.println("Fehler: Kein Tag zu schreiben gefunden.");
+    LOG_W(LOG_MOD_NFC, "Fehler: Kein Tag zu schreiben gefunden.");
     oledShowProgressBar(1, 1, "Failure!", "No tag found");
     vTaskDelay(2000 / portTICK_PERIOD_MS);
     nfcReaderState = NFC_IDLE;
@@ -402,7 +407,7 @@ void startWriteJsonToTag(const bool isSpoolTag, const char* payload) {
 }
 
 void scanRfidTask(void * parameter) {
-  Serial.println("RFID Task gestartet");
+  LOG_I(LOG_MOD_NFC, "RFID Task gestartet");
   for(;;) {
     // Wenn geschrieben wird Schleife aussetzen
     if (nfcReaderState != NFC_WRITING && !nfcReadingTaskSuspendRequest && !booting)
@@ -425,9 +430,10 @@ void scanRfidTask(void * parameter) {
         tagProcessed = false;
 
         // Display some basic information about the card
-        Serial.println("Found an ISO14443A card");
+        LOG_I(LOG_MOD_NFC, "Found an ISO14443A card");
 
         nfcReaderState = NFC_READING;
+        metricsInc(readsMetric);
 
         oledShowProgressBar(0, octoEnabled?5:4, "Reading", "Detecting tag");
 
@@ -443,7 +449,7 @@ void scanRfidTask(void * parameter) {
             memset(data, 0, tagSize);
 
             // We probably have an NTAG2xx card (though it could be Ultralight as well)
-            Serial.println("Seems to be an NTAG2xx tag (7 byte UID)");
+            LOG_D(LOG_MOD_NFC, "Seems to be an NTAG2xx tag (7 byte UID)");
             
             uint8_t numPages = readTagSize()/4;
             for (uint8_t i = 4; i < 4+numPages; i++) {
@@ -466,6 +472,7 @@ void scanRfidTask(void * parameter) {
             {
               oledShowProgressBar(1, 1, "Failure", "Unknown tag");
               nfcReaderState = NFC_READ_ERROR;
+              metricsInc(readFailuresMetric);
             }
             else 
             {
@@ -478,13 +485,15 @@ void scanRfidTask(void * parameter) {
           {
             oledShowProgressBar(1, 1, "Failure", "Tag read error");
             nfcReaderState = NFC_READ_ERROR;
+            metricsInc(readFailuresMetric);
           }
         }
         else
         {
           //TBD: Show error here?!
           oledShowProgressBar(1, 1, "Failure", "Unkown tag type");
-          Serial.println("This doesn't seem to be an NTAG2xx tag (UUID length != 7 bytes)!");
+          metricsInc(readFailuresMetric);
+          LOG_W(LOG_MOD_NFC, "This doesn't seem to be an NTAG2xx tag (UUID length != 7 bytes)!");
         }
       }
 
@@ -494,8 +503,8 @@ void scanRfidTask(void * parameter) {
         //uidString = "";
         nfcJsonData = "";
         activeSpoolId = "";
-        Serial.println("Tag entfernt");
-        if (!bambuCredentials.autosend_enable) oledShowWeight(weight);
+        LOG_I(LOG_MOD_NFC, "Tag entfernt");
+        if (!bambuAutoSend.enable) oledShowWeight(weight);
       }
 
       // aktualisieren der Website wenn sich der Status ändert
@@ -504,7 +513,7 @@ void scanRfidTask(void * parameter) {
     else
     {
       nfcReadingTaskSuspendState = true;
-      Serial.println("NFC Reading disabled");
+      LOG_D(LOG_MOD_NFC, "NFC Reading disabled");
       vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
     yield();
@@ -517,14 +526,13 @@ void startNfc() {
   delay(1000);
   unsigned long versiondata = nfc.getFirmwareVersion();  // Lese Versionsnummer der Firmware aus
   if (! versiondata) {                                   // Wenn keine Antwort kommt
-    Serial.println("Kann kein RFID Board finden !");            // Sende Text "Kann kein..." an seriellen Monitor
+    LOG_E(LOG_MOD_NFC, "Kann kein RFID Board finden !");
     oledShowMessage("No RFID Board found");
     vTaskDelay(2000 / portTICK_PERIOD_MS);
   }
   else {
-    Serial.print("Chip PN5 gefunden"); Serial.println((versiondata >> 24) & 0xFF, HEX); // Sende Text und Versionsinfos an seriellen
-    Serial.print("Firmware ver. "); Serial.print((versiondata >> 16) & 0xFF, DEC);      // Monitor, wenn Antwort vom Board kommt
-    Serial.print('.'); Serial.println((versiondata >> 8) & 0xFF, DEC);                  // 
+    LOG_I(LOG_MOD_NFC, "Chip PN5%lX gefunden, Firmware ver. %lu.%lu", (versiondata >> 24) & 0xFF,
+          (versiondata >> 16) & 0xFF, (versiondata >> 8) & 0xFF);
 
     nfc.SAMConfig();
     // Set the max number of retry attempts to read from a card
@@ -533,6 +541,9 @@ void startNfc() {
     //nfc.setPassiveActivationRetries(0x7F);
     //nfc.setPassiveActivationRetries(0xFF);
 
+    readsMetric = metricsCounter("filaman_nfc_reads_total", "NFC tags read");
+    readFailuresMetric = metricsCounter("filaman_nfc_read_failures_total", "NFC tag reads that failed");
+
     BaseType_t result = xTaskCreatePinnedToCore(
       scanRfidTask, /* Function to implement the task */
       "RfidReader", /* Name of the task */
@@ -543,9 +554,10 @@ void startNfc() {
       rfidTaskCore); /* Core where the task should run */
 
       if (result != pdPASS) {
-        Serial.println("Fehler beim Erstellen des RFID Tasks");
+        LOG_E(LOG_MOD_NFC, "Fehler beim Erstellen des RFID Tasks");
     } else {
-        Serial.println("RFID Task erfolgreich erstellt");
+        LOG_I(LOG_MOD_NFC, "RFID Task erfolgreich erstellt");
+        metricsRegisterTask("RfidReader", RfidReaderTask);
     }
   }
 }
\ No newline at end of file
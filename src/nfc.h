@@ -16,6 +16,9 @@ typedef enum{
 void startNfc();
 void scanRfidTask(void * parameter);
 void startWriteJsonToTag(const bool isSpoolTag, const char* payload);
+// Kopie des zuletzt gelesenen Tag-JSON, auch nach dem Entfernen des Tags; liefert die Länge, 0 = noch keiner
+// Copy of the last tag JSON read, kept after the tag was removed; returns the length, 0 = none yet
+size_t nfcCopyLastTag(char* out, size_t size);
 
 extern TaskHandle_t RfidReaderTask;
 extern String nfcJsonData;
@@ -4,6 +4,11 @@
 #include "scale.h"
 #include "bambu.h"
 #include "nfc.h"
+#include "ws_topics.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include "gzip_inflater.h"
+#include "logger.h"
 
 
 // Globale Variablen für Config Backups hinzufügen
@@ -17,6 +22,9 @@ static int currentUpdateCommand = 0;
 static size_t updateTotalSize = 0;
 static size_t updateWritten = 0;
 static bool isSpiffsUpdate = false;
+static bool isCompressedUpdate = false;
+static bool updateFailed = false;
+static GzipInflater updateInflater;
 
 /**
  * Compares two version strings and determines if version1 is less than version2
@@ -54,7 +62,7 @@ void backupJsonConfigs() {
         if (file) {
             bambuCredentialsBackup = file.readString();
             file.close();
-            Serial.println("Bambu credentials backed up");
+            LOG_I(LOG_MOD_WEB, "Bambu credentials backed up");
         }
     }
 
@@ -64,7 +72,7 @@ void backupJsonConfigs() {
         if (file) {
             spoolmanUrlBackup = file.readString();
             file.close();
-            Serial.println("Spoolman URL backed up");
+            LOG_I(LOG_MOD_WEB, "Spoolman URL backed up");
         }
     }
 }
@@ -76,7 +84,7 @@ void restoreJsonConfigs() {
         if (file) {
             file.print(bambuCredentialsBackup);
             file.close();
-            Serial.println("Bambu credentials restored");
+            LOG_I(LOG_MOD_WEB, "Bambu credentials restored");
         }
         bambuCredentialsBackup = ""; // Clear backup
     }
@@ -87,7 +95,7 @@ void restoreJsonConfigs() {
         if (file) {
             file.print(spoolmanUrlBackup);
             file.close();
-            Serial.println("Spoolman URL restored");
+            LOG_I(LOG_MOD_WEB, "Spoolman URL restored");
         }
         spoolmanUrlBackup = ""; // Clear backup
     }
@@ -109,33 +117,259 @@ void sendUpdateProgress(int progress, const char* status = nullptr, const char*
         return;
     }
     
-    String progressMsg = "{\"type\":\"updateProgress\",\"progress\":" + String(progress);
-    if (status) {
-        progressMsg += ",\"status\":\"" + String(status) + "\"";
+    char out[192];
+    JsonWriter progressMsg(out, sizeof(out));
+    progressMsg.beginObject().add("type", "updateProgress").add("progress", progress);
+    if (status) progressMsg.add("status", status);
+    if (message) progressMsg.add("message", message);
+    progressMsg.endObject();
+    if (progressMsg.overflowed()) return;
+
+    // Einmal senden und nicht warten, der Dispatcher fasst Fortschrittsmeldungen über WS_KEY_UPDATE zusammen
+    // Send once without waiting, the dispatcher coalesces progress messages via WS_KEY_UPDATE
+    wsPublishText(WS_TOPIC_UPDATE, progressMsg.c_str(), nullptr, WS_KEY_UPDATE);
+    lastSentProgress = progress;
+}
+
+// Der Upload-Callback läuft im async_tcp-Task. Er kopiert nur in Puffer, geflasht wird im OtaWriter-Task,
+// damit Lösch- und Schreibpausen des Flash den TCP-Empfang nicht direkt aufhalten.
+// The upload callback runs in the async_tcp task. It only copies into buffers, flashing happens in the
+// OtaWriter task so flash erase and write pauses do not hold up TCP receive directly.
+
+#define OTA_CHUNK_STOP  0xFF    // Index, der den OtaWriter beendet -- index that stops the OtaWriter
+
+typedef struct {
+    uint8_t index;      // Puffer in otaBuffers -- buffer in otaBuffers
+    uint16_t len;
+    bool final;
+} OtaChunk;
+
+// Durchsatz eines Updates -- throughput of one update
+typedef struct {
+    uint32_t startMs;
+    uint32_t endMs;
+    uint32_t received;  // Bytes aus dem Upload -- bytes from the upload
+    uint32_t stallMs;   // Empfang wartet auf einen freien Puffer -- receive waits for a free buffer
+    uint32_t flashMs;   // Update.write() im OtaWriter, inkl. Entpacken -- Update.write() in the OtaWriter, incl. inflating
+} OtaStats;
+
+static TaskHandle_t otaWriterTask = NULL;
+static QueueHandle_t otaFreeQueue = NULL;   // freie Puffer-Indizes -- free buffer indices
+static QueueHandle_t otaFullQueue = NULL;   // volle Puffer für den OtaWriter -- full buffers for the OtaWriter
+static SemaphoreHandle_t otaDone = NULL;
+static uint8_t* otaBuffers[OTA_WRITE_BUFFERS];
+static int otaFillIndex = -1;
+static size_t otaFillLen = 0;
+static int otaLastProgress = -1;
+static volatile const char* otaError = nullptr;
+static OtaStats otaStats;
+
+static uint32_t otaKbps() {
+    uint32_t elapsed = (otaStats.endMs ? otaStats.endMs : millis()) - otaStats.startMs;
+    return elapsed ? (uint32_t)((uint64_t)otaStats.received * 1000 / 1024 / elapsed) : 0;
+}
+
+static bool writeInflated(const uint8_t* data, size_t len, void* ctx) {
+    return Update.write((uint8_t*)data, len) == len;
+}
+
+static void otaFreeBuffers() {
+    for (int i = 0; i < OTA_WRITE_BUFFERS; i++) {
+        free(otaBuffers[i]);
+        otaBuffers[i] = nullptr;
+    }
+}
+
+// Fortschritt nach geschriebenen Upload-Bytes, je 10% eine Meldung -- progress by written upload bytes, one message per 10%
+static void otaReportProgress(bool final) {
+    int currentProgress;
+
+    // Berechne den Fortschritt basierend auf dem Update-Typ
+    if (isSpiffsUpdate) {
+        // SPIFFS: 5-75% für Upload
+        currentProgress = 6 + (updateWritten * 100) / updateTotalSize;
+    } else {
+        // Firmware: 0-100% für Upload
+        currentProgress = 1 + (updateWritten * 100) / updateTotalSize;
     }
-    if (message) {
-        progressMsg += ",\"message\":\"" + String(message) + "\"";
+
+    if (currentProgress / 10 != otaLastProgress / 10 || final) {
+        sendUpdateProgress(currentProgress, "uploading");
+        oledShowProgressBar(currentProgress, 100, "Update", "Download");
+        otaLastProgress = currentProgress;
     }
-    progressMsg += "}";
-    
-    if (progress >= 100) {
-        // Sende die Nachricht nur einmal für den Abschluss
-        ws.textAll("{\"type\":\"updateProgress\",\"progress\":100,\"status\":\"success\",\"message\":\"Update successful! Restarting device...\"}");
-        delay(50);
+}
+
+static void otaFinish() {
+    // Prüfsummen des entpackten Abbilds vor Update.end() -- checksums of the inflated image before Update.end()
+    if (isCompressedUpdate) {
+        if (!updateInflater.finish()) {
+            otaError = updateInflater.error();
+            return;
+        }
+        LOG_I(LOG_MOD_WEB, "Update entpackt -- update inflated: %u -> %u Bytes", (unsigned)updateWritten, (unsigned)updateInflater.outputSize());
+    }
+    if (!Update.end(true)) {
+        otaError = "Update finalization failed";
+        return;
+    }
+    if (isSpiffsUpdate) {
+        restoreJsonConfigs();
     }
 
-    // Sende die Nachricht mehrmals mit Verzögerung für wichtige Updates
-    if (status || abs(progress - lastSentProgress) >= 10 || progress == 100) {
-        for (int i = 0; i < 2; i++) {
-            ws.textAll(progressMsg);
-            delay(100);  // Längerer Delay zwischen Nachrichten
+    otaStats.endMs = millis();
+    LOG_I(LOG_MOD_WEB, "Update: %u KB in %lu ms, %u KB/s, Wartezeit -- stall %lu ms, Flash %lu ms",
+                  (unsigned)(otaStats.received / 1024), (unsigned long)(otaStats.endMs - otaStats.startMs),
+                  (unsigned)otaKbps(), (unsigned long)otaStats.stallMs, (unsigned long)otaStats.flashMs);
+}
+
+static void otaWriterLoop(void *parameter) {
+    OtaChunk chunk;
+    for (;;) {
+        xQueueReceive(otaFullQueue, &chunk, portMAX_DELAY);
+        if (chunk.index == OTA_CHUNK_STOP) {
+            if (!otaError) otaError = "Update aborted";
+            break;
+        }
+
+        // Nach einem Fehler nur noch Puffer zurückgeben, bis der Empfang aufhört
+        // After an error only hand buffers back until receive stops
+        if (!otaError && chunk.len) {
+            const uint8_t* data = otaBuffers[chunk.index];
+            uint32_t start = millis();
+            if (isCompressedUpdate) {
+                if (!updateInflater.write(data, chunk.len)) {
+                    otaError = Update.hasError() ? "Write failed" : updateInflater.error();
+                }
+            } else if (Update.write((uint8_t*)data, chunk.len) != chunk.len) {
+                otaError = "Write failed";
+            }
+            otaStats.flashMs += millis() - start;
+            updateWritten += chunk.len;
+            if (!otaError) otaReportProgress(chunk.final);
+        }
+
+        if (chunk.final) {
+            if (!otaError) otaFinish();
+            break;
         }
+        xQueueSend(otaFreeQueue, &chunk.index, 0);
+    }
+
+    if (otaError) {
+        LOG_E(LOG_MOD_WEB, "Update fehlgeschlagen -- update failed: %s", (const char*)otaError);
+        if (Update.isRunning()) Update.abort();
+    }
+    updateInflater.end();
+    otaFreeBuffers();
+    otaWriterTask = NULL;
+    xSemaphoreGive(otaDone);
+    vTaskDelete(NULL);
+}
+
+static bool otaStartWriter() {
+    if (!otaFreeQueue) {
+        otaFreeQueue = xQueueCreate(OTA_WRITE_BUFFERS, sizeof(uint8_t));
+        // Ein Platz mehr, damit OTA_CHUNK_STOP immer passt -- one slot more so OTA_CHUNK_STOP always fits
+        otaFullQueue = xQueueCreate(OTA_WRITE_BUFFERS + 1, sizeof(OtaChunk));
+        otaDone = xSemaphoreCreateBinary();
+    }
+    if (!otaFreeQueue || !otaFullQueue || !otaDone) return false;
+
+    xQueueReset(otaFreeQueue);
+    xQueueReset(otaFullQueue);
+    xSemaphoreTake(otaDone, 0);
+    for (uint8_t i = 0; i < OTA_WRITE_BUFFERS; i++) {
+        otaBuffers[i] = (uint8_t*)malloc(OTA_WRITE_BUFFER_SIZE);
+        if (!otaBuffers[i]) {
+            otaFreeBuffers();
+            return false;
+        }
+        xQueueSend(otaFreeQueue, &i, 0);
+    }
+    otaFillIndex = -1;
+    otaLastProgress = -1;
+    otaError = nullptr;
+    memset(&otaStats, 0, sizeof(otaStats));
+    otaStats.startMs = millis();
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        otaWriterLoop, /* Function to implement the task */
+        "OtaWriter", /* Name of the task */
+        6144,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        otaWriteTaskPrio,  /* Priority of the task */
+        &otaWriterTask,  /* Task handle. */
+        otaWriteTaskCore); /* Core where the task should run */
+
+    if (result != pdPASS) {
+        LOG_E(LOG_MOD_WEB, "Fehler beim Erstellen des OtaWriter-Tasks -- cannot create the OtaWriter task");
+        otaWriterTask = NULL;
+        otaFreeBuffers();
+        return false;
+    }
+    return true;
+}
+
+// Beendet einen laufenden OtaWriter, der dabei das Update abbricht -- stops a running OtaWriter, which aborts the update
+static void otaStopWriter() {
+    if (!otaWriterTask) return;
+    OtaChunk stop = {OTA_CHUNK_STOP, 0, false};
+    xQueueSend(otaFullQueue, &stop, 0);
+    xSemaphoreTake(otaDone, pdMS_TO_TICKS(OTA_WRITE_TIMEOUT));
+    otaFillIndex = -1;
+}
+
+// Kopiert den Upload in Puffer, volle Puffer und das Ende gehen an den OtaWriter
+// Copies the upload into buffers, full buffers and the end go to the OtaWriter
+static const char* otaReceive(const uint8_t* data, size_t len, bool final) {
+    while (len || final) {
+        if (otaFillIndex < 0) {
+            uint8_t index;
+            uint32_t waitStart = millis();
+            if (xQueueReceive(otaFreeQueue, &index, pdMS_TO_TICKS(OTA_WRITE_TIMEOUT)) != pdTRUE) {
+                return "Write timeout";
+            }
+            otaStats.stallMs += millis() - waitStart;
+            otaFillIndex = index;
+            otaFillLen = 0;
+        }
+
+        size_t n = min(len, (size_t)(OTA_WRITE_BUFFER_SIZE - otaFillLen));
+        memcpy(otaBuffers[otaFillIndex] + otaFillLen, data, n);
+        otaFillLen += n;
+        otaStats.received += n;
+        data += n;
+        len -= n;
+
+        bool last = final && !len;
+        if (otaFillLen == OTA_WRITE_BUFFER_SIZE || last) {
+            OtaChunk chunk = {(uint8_t)otaFillIndex, (uint16_t)otaFillLen, last};
+            // Jeder Index steckt höchstens einmal in der Queue, sie läuft nie über
+            // Every index is in the queue at most once, it never overflows
+            xQueueSend(otaFullQueue, &chunk, 0);
+            otaFillIndex = -1;
+            if (last) break;
+        }
+    }
+    return (const char*)otaError;
+}
+
+// Nach einem Fehler werden die restlichen Teile des Uploads ignoriert -- after an error the rest of the upload is ignored
+static void failUpdate(AsyncWebServerRequest *request, const char* message) {
+    char out[128];
+    JsonWriter json(out, sizeof(out));
+    json.beginObject().add("success", false).add("message", message).endObject();
+    request->send(400, "application/json", json.c_str());
+
+    LOG_E(LOG_MOD_WEB, "Update fehlgeschlagen -- update failed: %s", message);
+    if (otaWriterTask) {
+        otaStopWriter();
     } else {
-        ws.textAll(progressMsg);
-        delay(50);
+        if (Update.isRunning()) Update.abort();
+        updateInflater.end();
     }
-    
-    lastSentProgress = progress;
+    updateFailed = true;
 }
 
 void handleUpdate(AsyncWebServer &server) {
@@ -157,107 +391,112 @@ void handleUpdate(AsyncWebServer &server) {
                              size_t index, uint8_t *data, size_t len, bool final) {
 
         // Disable all Tasks
+        // Der MQTT-Task beendet sich selbst und gibt dabei Lock und TLS-Speicher frei
+        // The MQTT task ends itself, releasing its lock and TLS memory
         if (BambuMqttTask != NULL) 
         {
-            Serial.println("Delete BambuMqttTask");
-            vTaskDelete(BambuMqttTask);
-            BambuMqttTask = NULL;
+            LOG_I(LOG_MOD_WEB, "Stop BambuMqttTask");
+            bambuStopMqtt();
         }
         if (ScaleTask) {
-            Serial.println("Delete ScaleTask");
+            LOG_I(LOG_MOD_WEB, "Delete ScaleTask");
+            metricsForgetTask(ScaleTask);
             vTaskDelete(ScaleTask);
             ScaleTask = NULL;
         }
         if (RfidReaderTask) {
-            Serial.println("Delete RfidReaderTask");
+            LOG_I(LOG_MOD_WEB, "Delete RfidReaderTask");
+            metricsForgetTask(RfidReaderTask);
             vTaskDelete(RfidReaderTask);
             RfidReaderTask = NULL;
         }
 
         if (!index) {
+            // Reste eines abgebrochenen Uploads -- leftovers of an aborted upload
+            otaStopWriter();
             updateTotalSize = request->contentLength();
             updateWritten = 0;
             isSpiffsUpdate = (filename.indexOf("website") > -1);
+            updateFailed = false;
+            // gzip erkennt man an den ersten beiden Bytes, nicht am Dateinamen -- gzip is detected by its first two bytes, not the file name
+            isCompressedUpdate = GzipInflater::isGzip(data, len);
+            if (isCompressedUpdate && !updateInflater.begin(writeInflated, nullptr)) {
+                failUpdate(request, updateInflater.error());
+                return;
+            }
             
             if (isSpiffsUpdate) {
                 // Backup vor dem Update
                 sendUpdateProgress(0, "backup", "Backing up configurations...");
-                vTaskDelay(200 / portTICK_PERIOD_MS);
                 backupJsonConfigs();
-                vTaskDelay(200 / portTICK_PERIOD_MS);
                 
                 const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
                 if (!partition || !Update.begin(partition->size, U_SPIFFS)) {
-                    request->send(400, "application/json", "{\"success\":false,\"message\":\"Update initialization failed\"}");
+                    failUpdate(request, "Update initialization failed");
                     return;
                 }
                 sendUpdateProgress(5, "starting", "Starting SPIFFS update...");
-                vTaskDelay(200 / portTICK_PERIOD_MS);
             } else {
-                if (!Update.begin(updateTotalSize)) {
-                    request->send(400, "application/json", "{\"success\":false,\"message\":\"Update initialization failed\"}");
+                // Die entpackte Größe steht erst am Ende fest, die Partition begrenzt
+                // The inflated size is only known at the end, the partition is the limit
+                if (!Update.begin(isCompressedUpdate ? UPDATE_SIZE_UNKNOWN : updateTotalSize)) {
+                    failUpdate(request, "Update initialization failed");
                     return;
                 }
                 sendUpdateProgress(0, "starting", "Starting firmware update...");
-                vTaskDelay(200 / portTICK_PERIOD_MS);
             }
-        }
 
-        if (len) {
-            if (Update.write(data, len) != len) {
-                request->send(400, "application/json", "{\"success\":false,\"message\":\"Write failed\"}");
+            if (!otaStartWriter()) {
+                failUpdate(request, "Update initialization failed");
                 return;
             }
-            
-            updateWritten += len;
-            int currentProgress;
-            
-            // Berechne den Fortschritt basierend auf dem Update-Typ
-            if (isSpiffsUpdate) {
-                // SPIFFS: 5-75% für Upload
-                currentProgress = 6 + (updateWritten * 100) / updateTotalSize;
-            } else {
-                // Firmware: 0-100% für Upload
-                currentProgress = 1 + (updateWritten * 100) / updateTotalSize;
-            }
-            
-            static int lastProgress = -1;
-            if (currentProgress != lastProgress && (currentProgress % 10 == 0 || final)) {
-                sendUpdateProgress(currentProgress, "uploading");
-                oledShowProgressBar(currentProgress, 100, "Update", "Download");
-                vTaskDelay(50 / portTICK_PERIOD_MS);
-                lastProgress = currentProgress;
-            }
         }
 
-        if (final) {
-            if (Update.end(true)) {
-                if (isSpiffsUpdate) {
-                    restoreJsonConfigs();
-                }
-            } else {
-                request->send(400, "application/json", "{\"success\":false,\"message\":\"Update finalization failed\"}");
-            }
+        if (updateFailed) return;
+
+        const char* error = otaReceive(data, len, final);
+        if (error) {
+            failUpdate(request, error);
         }
     });
 
     updateHandler->onRequest([](AsyncWebServerRequest *request) {
-        if (Update.hasError()) {
-            request->send(400, "application/json", "{\"success\":false,\"message\":\"Update failed\"}");
+        // Die Fehlerantwort ging schon beim Upload raus -- the error response already went out during the upload
+        if (updateFailed) return;
+
+        // Der OtaWriter schreibt womöglich noch die letzten Puffer -- the OtaWriter may still be writing the last buffers
+        if (!otaDone || xSemaphoreTake(otaDone, pdMS_TO_TICKS(OTA_WRITE_TIMEOUT)) != pdTRUE) {
+            otaStopWriter();
+            request->send(400, "application/json", "{\"success\":false,\"message\":\"Write timeout\"}");
+            return;
+        }
+        if (otaError || Update.hasError()) {
+            char out[128];
+            JsonWriter json(out, sizeof(out));
+            json.beginObject().add("success", false).add("message", otaError ? (const char*)otaError : "Update failed").endObject();
+            request->send(400, "application/json", json.c_str());
             return;
         }
 
         // Erste 100% Nachricht
-        ws.textAll("{\"type\":\"updateProgress\",\"progress\":100,\"status\":\"success\",\"message\":\"Update successful! Restarting device...\"}");
+        wsPublishText(WS_TOPIC_UPDATE, "{\"type\":\"updateProgress\",\"progress\":100,\"status\":\"success\",\"message\":\"Update successful! Restarting device...\"}", nullptr, WS_KEY_UPDATE);
         vTaskDelay(2000 / portTICK_PERIOD_MS);
         
-        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", 
-            "{\"success\":true,\"message\":\"Update successful! Restarting device...\"}");
+        char out[160];
+        JsonWriter json(out, sizeof(out));
+        json.beginObject()
+            .add("success", true)
+            .add("message", "Update successful! Restarting device...")
+            .add("kbps", otaKbps())
+            .add("stallMs", otaStats.stallMs)
+            .add("flashMs", otaStats.flashMs)
+            .endObject();
+        AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json.c_str());
         response->addHeader("Connection", "close");
         request->send(response);
         
         // Zweite 100% Nachricht zur Sicherheit
-        ws.textAll("{\"type\":\"updateProgress\",\"progress\":100,\"status\":\"success\",\"message\":\"Update successful! Restarting device...\"}");
+        wsPublishText(WS_TOPIC_UPDATE, "{\"type\":\"updateProgress\",\"progress\":100,\"status\":\"success\",\"message\":\"Update successful! Restarting device...\"}", nullptr, WS_KEY_UPDATE);
         
         espRestart();
     });
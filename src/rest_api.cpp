@@ -0,0 +1,223 @@
+#include "rest_api.h"
+#include "ws_topics.h"
+#include "ws_commands.h"
+#include "config.h"
+#include "scale.h"
+#include "nfc.h"
+#include "bambu.h"
+#include "api.h"
+#include "metrics.h"
+#include "json_writer.h"
+
+#ifndef VERSION
+  #define VERSION "1.1.0"
+#endif
+
+AsyncEventSource events("/events");
+
+static const char* const nfcStateNames[] = {
+    "idle", "reading", "read_success", "read_error", "writing", "write_success", "write_error"
+};
+
+// Antwortzeit in ms von den Headern bis zum Schließen der Verbindung -- response time in ms from headers to connection close
+static const uint32_t latencyBuckets[] = { 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 10000 };
+
+typedef enum {
+    REQUEST_PAGE,
+    REQUEST_API,
+    REQUEST_ASSET,
+    REQUEST_OTA,
+    REQUEST_TYPE_COUNT
+} RequestType;
+
+static const char* const requestTypeNames[REQUEST_TYPE_COUNT] = { "page", "api", "asset", "ota" };
+static Metric* latencyMetrics[REQUEST_TYPE_COUNT];
+
+static RequestType classifyRequest(const String& url) {
+    if (url.startsWith("/api/") || url == "/metrics") return REQUEST_API;
+    if (url == "/update") return REQUEST_OTA;
+    if (url.indexOf('.') >= 0) return REQUEST_ASSET;
+    return REQUEST_PAGE;
+}
+
+// Steht vor allen anderen Handlern, behandelt selbst nichts und misst nur die Dauer
+// Sits in front of all other handlers, handles nothing itself and only measures the duration
+class RequestTimer : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        const String& url = request->url();
+        // WebSocket und /events übernehmen die Verbindung -- WebSocket and /events take over the connection
+        if (url == "/ws" || url == "/events") return false;
+
+        Metric *metric = latencyMetrics[classifyRequest(url)];
+        uint32_t start = millis();
+        request->onDisconnect([metric, start]() {
+            metricsObserve(metric, millis() - start);
+        });
+        return false;
+    }
+};
+
+static RequestTimer requestTimer;
+
+static void sendJson(AsyncWebServerRequest *request, JsonDocument& doc) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->addHeader("Cache-Control", "no-store");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+static void handleWeight(AsyncWebServerRequest *request) {
+    ScaleSample sample;
+    scaleLatestSample(sample);
+
+    JsonDocument doc;
+    doc["weight"] = weight;
+    doc["calibrated"] = scaleCalibrated;
+    if (sample.seq) {
+        doc["t"] = sample.timestamp;
+        doc["g"] = roundf(sample.grams * 10.0f) / 10.0f;
+        doc["stable"] = sample.stable;
+    }
+    sendJson(request, doc);
+}
+
+static void handleNfc(AsyncWebServerRequest *request) {
+    nfcReaderStateType state = nfcReaderState;
+
+    JsonDocument doc;
+    doc["state"] = (state < sizeof(nfcStateNames) / sizeof(nfcStateNames[0])) ? nfcStateNames[state] : "unknown";
+    // Zuletzt gelesener Tag, unabhängig vom Zustand -- last tag read, regardless of the state
+    char tag[NFC_PAYLOAD_MAX + 1];
+    size_t len = nfcCopyLastTag(tag, sizeof(tag));
+    if (len) doc["tag"] = serialized(tag, len);
+    sendJson(request, doc);
+}
+
+// Seriennummer kommt aus der Web-Eingabe, der Writer escaped sie -- the serial comes from web input, the writer escapes it
+static void serializeAmsPrinter(uint8_t i, JsonWriter& json) {
+    const BambuPrinter& printer = bambuPrinters[i];
+    json.beginObject()
+        .add("printer", (unsigned int)i)
+        .add("serial", printer.credentials.serial.c_str())
+        .add("connected", printer.connected)
+        .add("trayNow", (unsigned int)printer.tray_now)
+        .key("ams");
+    // Gleiche Nutzlast wie die amsData-Nachricht -- same payload as the amsData message
+    serializeAmsData(i, json);
+    json.endObject();
+}
+
+static void handleAms(AsyncWebServerRequest *request) {
+    // Nicht unbegrenzt warten, der Handler läuft im async_tcp-Task -- do not wait forever, the handler runs in the async_tcp task
+    if (!bambuTryLockAmsData(BAMBU_LOCK_TIMEOUT)) {
+        AsyncWebServerResponse *busy = request->beginResponse(503, "application/json", "{\"error\":\"AMS data busy\"}");
+        busy->addHeader("Cache-Control", "no-store");
+        request->send(busy);
+        return;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->addHeader("Cache-Control", "no-store");
+    response->print("{\"printers\":[");
+
+    bool first = true;
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        if (!bambuPrinterConfigured(i)) continue;
+        if (!first) response->print(",");
+        first = false;
+
+        JsonWriter counter(nullptr, 0);
+        serializeAmsPrinter(i, counter);
+        size_t len = counter.length();
+        char *payload = (char*)malloc(len + 1);
+        if (payload) {
+            JsonWriter json(payload, len + 1);
+            serializeAmsPrinter(i, json);
+            response->write((const uint8_t*)payload, len);
+            free(payload);
+        } else {
+            response->printf("{\"printer\":%u,\"ams\":null}", i);
+        }
+    }
+    bambuUnlockAmsData();
+
+    response->print("]}");
+    request->send(response);
+}
+
+void buildQueueStatus(JsonDocument& doc) {
+    WsClientStats stats[WS_MAX_CLIENTS + 1];
+    uint32_t dropped = 0;
+    uint8_t count = wsQueueStats(stats, WS_MAX_CLIENTS + 1, &dropped);
+
+    doc["freeHeap"] = ESP.getFreeHeap();
+    doc["dropped"] = dropped;
+    doc["commandsPending"] = wsCommandsPending();
+    doc["eventClients"] = events.count();
+    JsonArray clients = doc["clients"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        JsonObject entry = clients.add<JsonObject>();
+        if (stats[i].events) {
+            entry["events"] = true;
+        } else {
+            entry["id"] = stats[i].id;
+            entry["encoding"] = stats[i].binary ? "msgpack" : "json";
+            entry["streamRate"] = stats[i].streamRate;
+        }
+        entry["queued"] = stats[i].queued;
+        entry["maxQueued"] = stats[i].maxQueued;
+        entry["sent"] = stats[i].sent;
+        entry["coalesced"] = stats[i].coalesced;
+        entry["dropped"] = stats[i].dropped;
+    }
+}
+
+static void handleQueue(AsyncWebServerRequest *request) {
+    JsonDocument doc;
+    buildQueueStatus(doc);
+    sendJson(request, doc);
+}
+
+static void handleMetrics(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    response->addHeader("Cache-Control", "no-store");
+    metricsWrite(*response);
+    request->send(response);
+}
+
+static void handleStatus(AsyncWebServerRequest *request) {
+    JsonDocument doc;
+    doc["version"] = VERSION;
+    doc["uptime"] = millis() / 1000;
+    doc["freeHeap"] = ESP.getFreeHeap();
+    doc["bambuConnected"] = bambu_connected;
+    doc["spoolmanConnected"] = spoolmanConnected;
+    sendJson(request, doc);
+}
+
+void setupRestApi(AsyncWebServer &server) {
+    server.on("/api/status", HTTP_GET, handleStatus);
+    server.on("/api/weight", HTTP_GET, handleWeight);
+    server.on("/api/nfc", HTTP_GET, handleNfc);
+    server.on("/api/ams", HTTP_GET, handleAms);
+    server.on("/api/queue", HTTP_GET, handleQueue);
+    server.on("/metrics", HTTP_GET, handleMetrics);
+
+    // Ereignisse kommen aus denselben Warteschlangen wie die WebSocket-Nachrichten
+    // Events come from the same queues as the WebSocket messages
+    events.onConnect([](AsyncEventSourceClient *client) {
+        wsAttachEventSource(&events);
+        client->send("{}", "hello", 0, SSE_RECONNECT_MS);
+    });
+    server.addHandler(&events);
+}
+
+void setupRequestMetrics(AsyncWebServer &server) {
+    for (uint8_t i = 0; i < REQUEST_TYPE_COUNT; i++) {
+        latencyMetrics[i] = metricsHistogram("filaman_http_request_duration_seconds", "HTTP request duration by request type",
+                                             latencyBuckets, sizeof(latencyBuckets) / sizeof(latencyBuckets[0]), 1000,
+                                             "type", requestTypeNames[i]);
+    }
+    server.addHandler(&requestTimer);
+}
@@ -0,0 +1,19 @@
+#ifndef REST_API_H
+#define REST_API_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+
+// JSON-Endpunkte und /events (Server-Sent Events) für Skripte und Dashboards, siehe docs/api.md
+// JSON endpoints and /events (server-sent events) for scripts and dashboards, see docs/api.md
+
+extern AsyncEventSource events;
+
+void setupRestApi(AsyncWebServer &server);
+// Muss vor allen anderen Handlern registriert werden -- must be registered before all other handlers
+void setupRequestMetrics(AsyncWebServer &server);
+// Warteschlangen von WebSocket, /events und WsCommands -- queues of WebSocket, /events and WsCommands
+void buildQueueStatus(JsonDocument& doc);
+
+#endif
@@ -1,3 +1,4 @@
+#include "scale.h"
 #include "nfc.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
@@ -6,6 +7,8 @@
 #include "display.h"
 #include "esp_task_wdt.h"
 #include <Preferences.h>
+#include "metrics.h"
+#include "logger.h"
 
 HX711 scale;
 
@@ -21,10 +24,42 @@ bool scaleCalibrated;
 bool autoTare = true;
 bool scaleCalibrationActive = false;
 
+static ScaleSample latestSample = {};
+static portMUX_TYPE scaleSampleMux = portMUX_INITIALIZER_UNLOCKED;
+static float recentGrams[SCALE_STABLE_SAMPLES];
+static uint8_t recentCount = 0;
+
+// Wird nur vom Scale-Task aufgerufen, Leser kopieren unter der Sperre
+// Only called by the scale task, readers copy under the lock
+static void publishSample(float grams) {
+  memmove(&recentGrams[1], &recentGrams[0], (SCALE_STABLE_SAMPLES - 1) * sizeof(float));
+  recentGrams[0] = grams;
+  if (recentCount < SCALE_STABLE_SAMPLES) recentCount++;
+
+  float low = grams;
+  float high = grams;
+  for (uint8_t i = 1; i < recentCount; i++) {
+    low = min(low, recentGrams[i]);
+    high = max(high, recentGrams[i]);
+  }
+
+  portENTER_CRITICAL(&scaleSampleMux);
+  latestSample.seq++;
+  latestSample.timestamp = millis();
+  latestSample.grams = grams;
+  latestSample.stable = recentCount == SCALE_STABLE_SAMPLES && high - low <= SCALE_STABLE_TOLERANCE;
+  portEXIT_CRITICAL(&scaleSampleMux);
+}
+
+void scaleLatestSample(ScaleSample& out) {
+  portENTER_CRITICAL(&scaleSampleMux);
+  out = latestSample;
+  portEXIT_CRITICAL(&scaleSampleMux);
+}
+
 // ##### Funktionen für Waage #####
 uint8_t setAutoTare(bool autoTareValue) {
-  Serial.print("Set AutoTare to ");
-  Serial.println(autoTareValue);
+  LOG_I(LOG_MOD_SCALE, "Set AutoTare to %d", autoTareValue);
   autoTare = autoTareValue;
 
   // Speichern mit NVS
@@ -37,16 +72,14 @@ uint8_t setAutoTare(bool autoTareValue) {
 }
 
 uint8_t tareScale() {
-  Serial.println("Tare scale");
+  LOG_I(LOG_MOD_SCALE, "Tare scale");
   scale.tare();
   
   return 1;
 }
 
 void scale_loop(void * parameter) {
-  Serial.println("++++++++++++++++++++++++++++++");
-  Serial.println("Scale Loop started");
-  Serial.println("++++++++++++++++++++++++++++++");
+  LOG_I(LOG_MOD_SCALE, "Scale Loop started");
 
   for(;;) {
     if (scale.is_ready()) 
@@ -54,7 +87,7 @@ void scale_loop(void * parameter) {
       // Waage automatisch Taren, wenn zu lange Abweichung
       if (autoTare && scale_tare_counter >= 5) 
       {
-        Serial.println("Auto Tare scale");
+        LOG_D(LOG_MOD_SCALE, "Auto Tare scale");
         scale.tare();
         scale_tare_counter = 0;
       }
@@ -62,7 +95,7 @@ void scale_loop(void * parameter) {
       // Waage manuell Taren
       if (scaleTareRequest == true) 
       {
-        Serial.println("Re-Tare scale");
+        LOG_I(LOG_MOD_SCALE, "Re-Tare scale");
         oledShowMessage("TARE Scale");
         vTaskDelay(pdMS_TO_TICKS(1000));
         scale.tare();
@@ -72,13 +105,16 @@ void scale_loop(void * parameter) {
       }
 
       // Only update weight if median changed more than 1
-      int16_t newWeight = round(scale.get_units());
+      float grams = scale.get_units();
+      publishSample(grams);
+      int16_t newWeight = round(grams);
       if(abs(weight-newWeight) > 1){
         weight = newWeight;
       }
     }
     
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Kurz genug für die 80 SPS Einstellung des HX711 -- short enough for the HX711's 80 SPS setting
+    vTaskDelay(pdMS_TO_TICKS(SCALE_SAMPLE_INTERVAL));
   }
 }
 
@@ -140,6 +176,7 @@ void start_scale(bool touchSensorConnected) {
       Serial.println("Fehler beim Erstellen des ScaleLoop-Tasks");
   } else {
       Serial.println("ScaleLoop-Task erfolgreich erstellt");
+      metricsRegisterTask("ScaleLoop", ScaleTask);
   }
 }
 
@@ -168,8 +205,7 @@ uint8_t calibrate_scale() {
     }
 
     scale.tare();
-    Serial.println("Tare done...");
-    Serial.print("Place a known weight on the scale...");
+    LOG_I(LOG_MOD_SCALE, "Tare done, place a known weight on the scale");
 
     oledShowProgressBar(1, 3, "Scale Cal.", "Place the weight");
 
@@ -180,15 +216,13 @@ uint8_t calibrate_scale() {
     }
     
     float newCalibrationValue = scale.get_units(10);
-    Serial.print("Result: ");
-    Serial.println(newCalibrationValue);
+    LOG_I(LOG_MOD_SCALE, "Result: %.2f", newCalibrationValue);
 
     newCalibrationValue = newCalibrationValue/SCALE_LEVEL_WEIGHT;
 
     if (newCalibrationValue > 0)
     {
-      Serial.print("New calibration value has been set to: ");
-      Serial.println(newCalibrationValue);
+      LOG_I(LOG_MOD_SCALE, "New calibration value has been set to: %.2f", newCalibrationValue);
 
       // Speichern mit NVS
       Preferences preferences;
@@ -201,8 +235,7 @@ uint8_t calibrate_scale() {
       float verifyValue = preferences.getFloat(NVS_KEY_CALIBRATION, 0);
       preferences.end();
 
-      Serial.print("Verified stored value: ");
-      Serial.println(verifyValue);
+      LOG_I(LOG_MOD_SCALE, "Verified stored value: %.2f", verifyValue);
 
       oledShowProgressBar(2, 3, "Scale Cal.", "Remove weight");
 
@@ -230,7 +263,7 @@ uint8_t calibrate_scale() {
     }
     else
     {
-      Serial.println("Calibration value is invalid. Please recalibrate.");
+      LOG_W(LOG_MOD_SCALE, "Calibration value is invalid. Please recalibrate.");
 
       oledShowProgressBar(3, 3, "Failure", "Calibration error");
 
@@ -244,7 +277,7 @@ uint8_t calibrate_scale() {
   }
   else 
   {
-    Serial.println("HX711 not found.");
+    LOG_W(LOG_MOD_SCALE, "HX711 not found.");
     
     oledShowMessage("HX711 not found");
 
@@ -4,8 +4,17 @@
 #include <Arduino.h>
 #include "HX711.h"
 
+// Letzter Messwert des Scale-Tasks, ungeglättet -- latest reading of the scale task, unsmoothed
+typedef struct {
+    uint32_t seq;           // zählt jeden Messwert, 0 = noch keiner -- counts every reading, 0 = none yet
+    uint32_t timestamp;     // millis() der Messung
+    float grams;
+    bool stable;            // die letzten SCALE_STABLE_SAMPLES Werte innerhalb SCALE_STABLE_TOLERANCE
+} ScaleSample;
+
 uint8_t setAutoTare(bool autoTareValue);
-uint8_t start_scale(bool touchSensorConnected);
+void scaleLatestSample(ScaleSample& out);
+void start_scale(bool touchSensorConnected);
 uint8_t calibrate_scale();
 uint8_t tareScale();
 
@@ -13,7 +22,7 @@ extern HX711 scale;
 extern int16_t weight;
 extern uint8_t weigthCouterToApi;
 extern uint8_t scale_tare_counter;
-extern uint8_t scaleTareRequest;
+extern bool scaleTareRequest;
 extern uint8_t pauseMainTask;
 extern bool scaleCalibrated;
 extern bool autoTare;
@@ -0,0 +1,76 @@
+#include "static_assets.h"
+#include <ESPAsyncWebServer.h>
+#include "static_asset_data.h"
+
+// Gehashte URLs ändern sich mit dem Inhalt und dürfen ewig gecacht werden,
+// ungehashte URLs fragt der Browser mit If-None-Match nach
+// Hashed URLs change with the content and may be cached forever,
+// unhashed URLs are revalidated by the browser with If-None-Match
+#define STATIC_ASSET_CACHE_IMMUTABLE    "public, max-age=31536000, immutable"
+#define STATIC_ASSET_CACHE_REVALIDATE   "no-cache"
+
+// Sucht das Asset zu einer URL, hashed = true wenn sie den aktuellen Hash trägt. Seiten aus einem
+// älteren LittleFS-Image fragen evtl. einen anderen Hash an und bekommen den aktuellen Inhalt ohne immutable.
+// Finds the asset for a URL, hashed = true if it carries the current hash. Pages from an older
+// LittleFS image may ask for another hash and get the current content without immutable.
+static const StaticAsset* findAsset(const String& url, bool& hashed) {
+    for (size_t i = 0; i < STATIC_ASSET_COUNT; i++) {
+        if (url == staticAssets[i].hashedPath) {
+            hashed = true;
+            return &staticAssets[i];
+        }
+        if (url == staticAssets[i].path) {
+            hashed = false;
+            return &staticAssets[i];
+        }
+    }
+
+    // name.<hash>.ext -> name.ext
+    int extDot = url.lastIndexOf('.');
+    int hashDot = (extDot > 0) ? url.lastIndexOf('.', extDot - 1) : -1;
+    if (hashDot < 0) return nullptr;
+    String plain = url.substring(0, hashDot) + url.substring(extDot);
+    for (size_t i = 0; i < STATIC_ASSET_COUNT; i++) {
+        if (plain == staticAssets[i].path) {
+            hashed = false;
+            return &staticAssets[i];
+        }
+    }
+    return nullptr;
+}
+
+class StaticAssetHandler : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest *request) override {
+        bool hashed;
+        if (request->method() != HTTP_GET || !findAsset(request->url(), hashed)) return false;
+        // Ohne das verwirft der Server den Header beim Parsen -- without this the server drops the header while parsing
+        request->addInterestingHeader("If-None-Match");
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest *request) override {
+        bool hashed = false;
+        const StaticAsset* asset = findAsset(request->url(), hashed);
+        if (!asset) {
+            request->send(404, "text/plain", "Seite nicht gefunden");
+            return;
+        }
+
+        AsyncWebServerResponse *response;
+        AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+        if (ifNoneMatch && ifNoneMatch->value().indexOf(asset->etag) >= 0) {
+            response = request->beginResponse(304);
+        } else {
+            response = request->beginResponse_P(200, asset->contentType, asset->data, asset->length);
+            response->addHeader("Content-Encoding", "gzip");
+        }
+        response->addHeader("ETag", asset->etag);
+        response->addHeader("Cache-Control", hashed ? STATIC_ASSET_CACHE_IMMUTABLE : STATIC_ASSET_CACHE_REVALIDATE);
+        request->send(response);
+    }
+};
+
+void registerStaticAssets(AsyncWebServer& server) {
+    server.addHandler(new StaticAssetHandler());
+}
@@ -0,0 +1,24 @@
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Eine gzip-komprimierte Datei im Flash, erzeugt von scripts/build_static_assets.py
+// A gzip compressed file in flash, generated by scripts/build_static_assets.py
+struct StaticAsset {
+    const char* path;           // z.B. "/style.css"
+    const char* hashedPath;     // z.B. "/style.0123456789abcdef.css", darf immutable gecacht werden
+    const char* contentType;
+    const char* etag;           // Inhalts-Hash in Anführungszeichen -- content hash in quotes
+    const uint8_t* data;
+    size_t length;
+};
+
+class AsyncWebServer;
+
+// Ein Handler für alle Dateien der Tabelle, mit ETag/If-None-Match -> 304
+// One handler for every file in the table, with ETag/If-None-Match -> 304
+void registerStaticAssets(AsyncWebServer& server);
+
+#endif
@@ -12,6 +12,14 @@
 #include "ota.h"
 #include "config.h"
 #include "debug.h"
+#include "html_template.h"
+#include "static_assets.h"
+#include "ws_topics.h"
+#include "ws_commands.h"
+#include "rest_api.h"
+#include "metrics.h"
+#include "logger.h"
+#include "json_writer.h"
 
 
 #ifndef VERSION
@@ -19,7 +27,8 @@
 #endif
 
 // Cache-Control Header definieren
-#define CACHE_CONTROL "max-age=604800" // Cache für 1 Woche
+// Seiten immer nachfragen, sie verweisen auf die gehashten Assets -- always revalidate pages, they reference the hashed assets
+#define CACHE_CONTROL "no-cache"
 
 AsyncWebServer server(webserverPort);
 AsyncWebSocket ws("/ws");
@@ -27,11 +36,32 @@ AsyncWebSocket ws("/ws");
 uint8_t lastSuccess = 0;
 nfcReaderStateType lastnfcReaderState = NFC_IDLE;
 
+// Antwort aus einem Puffer des Aufrufers, der Stream wird genau so groß angelegt
+// Response from a caller-owned buffer, the stream is allocated at exactly that size
+static void sendJson(AsyncWebServerRequest *request, JsonWriter& json) {
+    if (json.overflowed()) {
+        request->send(500, "application/json", "{\"success\": false, \"error\": \"Response too large\"}");
+        return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream("application/json", json.length());
+    response->write((const uint8_t*)json.c_str(), json.length());
+    request->send(response);
+}
+
+static void replyJson(AsyncWebSocketClient *client, JsonWriter& json) {
+    if (json.overflowed()) {
+        LOG_E(LOG_MOD_WEB, "WebSocket-Antwort zu groß -- WebSocket reply too large");
+        return;
+    }
+    wsReplyText(client, json.c_str());
+}
+
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
     HEAP_DEBUG_MESSAGE("onWsEvent begin");
     if (type == WS_EVT_CONNECT) {
-        Serial.println("Neuer Client verbunden!");
+        LOG_I(LOG_MOD_WEB, "Neuer Client verbunden!");
+        if (!wsClientConnected(client)) return;
         // Sende die AMS-Daten an den neuen Client
         if (!bambuDisabled) sendAmsData(client);
         sendNfcData();
@@ -40,115 +70,191 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
 
         // Clean up dead connections
         (*server).cleanupClients();
-        Serial.println("Currently connected number of clients: " + String((*server).getClients().size()));
+        LOG_D(LOG_MOD_WEB, "Currently connected number of clients: %u", (unsigned)(*server).getClients().size());
     } else if (type == WS_EVT_DISCONNECT) {
-        Serial.println("Client getrennt.");
+        LOG_I(LOG_MOD_WEB, "Client getrennt.");
+        wsClientDisconnected(client->id());
     } else if (type == WS_EVT_ERROR) {
-        Serial.printf("WebSocket Client #%u error(%u): %s\n", client->id(), *((uint16_t*)arg), (char*)data);
+        LOG_W(LOG_MOD_WEB, "WebSocket Client #%u error(%u): %s", client->id(), *((uint16_t*)arg), (char*)data);
     } else if (type == WS_EVT_PONG) {
-        Serial.printf("WebSocket Client #%u pong\n", client->id());
+        LOG_D(LOG_MOD_WEB, "WebSocket Client #%u pong", client->id());
     } else if (type == WS_EVT_DATA) {
-        String message = String((char*)data);
+        // Binärframes sind MessagePack -- binary frames are MessagePack
+        AwsFrameInfo *info = (AwsFrameInfo*)arg;
         JsonDocument doc;
-        deserializeJson(doc, message);
+        if (info->opcode == WS_BINARY) {
+            deserializeMsgPack(doc, data, len);
+        } else {
+            deserializeJson(doc, (const char*)data, len);
+        }
 
         if (doc["type"] == "heartbeat") {
             // Sende Heartbeat-Antwort
-            ws.text(client->id(), "{"
-                "\"type\":\"heartbeat\","
-                "\"freeHeap\":" + String(ESP.getFreeHeap()/1024) + ","
-                "\"bambu_connected\":" + String(bambu_connected) + ","
-                "\"spoolman_connected\":" + String(spoolmanConnected) + ""
-                "}");
+            char out[96];
+            JsonWriter reply(out, sizeof(out));
+            reply.beginObject()
+                 .add("type", "heartbeat")
+                 .add("freeHeap", ESP.getFreeHeap()/1024)
+                 .add("bambu_connected", bambu_connected ? 1 : 0)
+                 .add("spoolman_connected", spoolmanConnected ? 1 : 0)
+                 .endObject();
+            replyJson(client, reply);
+        }
+
+        else if (doc["type"] == "subscribe") {
+            uint8_t added = wsSubscribe(client, doc);
+            // Neu abonnierte Themen bekommen den aktuellen Stand -- newly subscribed topics get the current state
+            if ((added & WS_TOPIC_BIT(WS_TOPIC_AMS)) && !bambuDisabled) sendAmsData(client);
+        }
+
+        else if (doc["type"] == "bambuStats") {
+            sendBambuStats(client);
+        }
+
+        else if (doc["type"] == "weightStream") {
+            // Messwerte pro Sekunde, 0 beendet den Stream -- samples per second, 0 stops the stream
+            char out[48];
+            JsonWriter reply(out, sizeof(out));
+            reply.beginObject()
+                 .add("type", "weightStream")
+                 .add("rate", wsSetWeightStream(client, doc["rate"] | 0))
+                 .endObject();
+            replyJson(client, reply);
+        }
+
+        else if (doc["type"] == "wsStats") {
+            sendWsStats(client);
+        }
+
+        else if (doc["type"] == "logLevel") {
+            // Ohne module nur die aktuellen Stufen -- without module only the current levels
+            char out[160];
+            JsonWriter reply(out, sizeof(out));
+            reply.beginObject().add("type", "logLevel");
+            if (doc["module"].is<const char*>()) {
+                reply.add("success", logSetLevel(doc["module"].as<const char*>(), doc["level"].as<const char*>()));
+            }
+            reply.key("levels");
+            logLevelsToJson(reply);
+            reply.endObject();
+            replyJson(client, reply);
         }
 
         else if (doc["type"] == "writeNfcTag") {
             if (doc["payload"].is<JsonObject>()) {
                 // Versuche NFC-Daten zu schreiben
-                String payloadString;
-                serializeJson(doc["payload"], payloadString);
-
-                startWriteJsonToTag((doc["tagType"] == "spool") ? true : false, payloadString.c_str());
+                char payload[NFC_PAYLOAD_MAX];
+                if (measureJson(doc["payload"]) >= sizeof(payload)) {
+                    LOG_W(LOG_MOD_WEB, "NFC-Daten zu groß für den Tag -- NFC data too large for the tag");
+                    sendWriteResult(nullptr, 0);
+                } else {
+                    serializeJson(doc["payload"], payload, sizeof(payload));
+                    startWriteJsonToTag((doc["tagType"] == "spool") ? true : false, payload);
+                }
             }
         }
 
+        // Blockierende Befehle laufen im WsCommands-Task -- blocking commands run on the WsCommands task
         else if (doc["type"] == "scale") {
-            uint8_t success = 0;
             if (doc["payload"] == "tare") {
-                success = tareScale();
+                queueWsCommand(client, doc, WS_CMD_SCALE_TARE);
             }
 
             if (doc["payload"] == "calibrate") {
-                success = calibrate_scale();
+                queueWsCommand(client, doc, WS_CMD_SCALE_CALIBRATE);
             }
 
             if (doc["payload"] == "setAutoTare") {
-                success = setAutoTare(doc["enabled"].as<bool>());
-            }
-
-            if (success) {
-                ws.textAll("{\"type\":\"scale\",\"payload\":\"success\"}");
-            } else {
-                ws.textAll("{\"type\":\"scale\",\"payload\":\"error\"}");
+                queueWsCommand(client, doc, WS_CMD_SCALE_AUTOTARE);
             }
         }
 
         else if (doc["type"] == "reconnect") {
             if (doc["payload"] == "bambu") {
-                bambu_restart();
+                queueWsCommand(client, doc, WS_CMD_RECONNECT_BAMBU);
             }
 
             if (doc["payload"] == "spoolman") {
-                initSpoolman();
+                queueWsCommand(client, doc, WS_CMD_RECONNECT_SPOOLMAN);
             }
         }
 
         else if (doc["type"] == "setBambuSpool") {
-            Serial.println(doc["payload"].as<String>());
-            setBambuSpool(doc["payload"]);
+            queueWsCommand(client, doc, WS_CMD_SET_BAMBU_SPOOL, doc["payload"]);
         }
 
         else if (doc["type"] == "setSpoolmanSettings") {
-            Serial.println(doc["payload"].as<String>());
-            if (updateSpoolBambuData(doc["payload"].as<String>())) {
-                ws.textAll("{\"type\":\"setSpoolmanSettings\",\"payload\":\"success\"}");
-            } else {
-                ws.textAll("{\"type\":\"setSpoolmanSettings\",\"payload\":\"error\"}");
-            }
+            queueWsCommand(client, doc, WS_CMD_SET_SPOOLMAN_SETTINGS, doc["payload"]);
         }
 
         else {
-            Serial.println("Unbekannter WebSocket-Typ: " + doc["type"].as<String>());
+            LOG_W(LOG_MOD_WEB, "Unbekannter WebSocket-Typ: %s", doc["type"] | "-");
         }
         doc.clear();
     }
     HEAP_DEBUG_MESSAGE("onWsEvent end");
 }
 
-// Funktion zum Laden und Ersetzen des Headers in einer HTML-Datei
-String loadHtmlWithHeader(const char* filename) {
-    Serial.println("Lade HTML-Datei: " + String(filename));
-    if (!LittleFS.exists(filename)) {
-        Serial.println("Fehler: Datei nicht gefunden!");
-        return "Fehler: Datei nicht gefunden!";
-    }
+// Platzhalter der Waage-Seite -- placeholders of the scale page
+static String waageTemplateValue(const char* name) {
+    if (strcmp(name, "autoTare") == 0) return autoTare ? "checked" : "";
+    return "";
+}
 
-    File file = LittleFS.open(filename, "r");
-    String html = file.readString();
-    file.close();
+// Platzhalter der Spoolman-Seite -- placeholders of the Spoolman page
+static String spoolmanTemplateValue(const char* name) {
+    if (strcmp(name, "spoolmanUrl") == 0) return spoolmanUrl;
+    if (strcmp(name, "spoolmanOctoEnabled") == 0) return octoEnabled ? "checked" : "";
+    if (strcmp(name, "spoolmanOctoUrl") == 0) return octoUrl;
+    if (strcmp(name, "spoolmanOctoToken") == 0) return octoToken;
+    if (strcmp(name, "bambuIp") == 0) return bambuPrinters[0].credentials.ip;
+    if (strcmp(name, "bambuSerial") == 0) return bambuPrinters[0].credentials.serial;
+    if (strcmp(name, "bambuCode") == 0) return bambuPrinters[0].credentials.accesscode;
+    if (strcmp(name, "bambuFingerprint") == 0) return bambuPrinters[0].credentials.fingerprint;
+    if (strcmp(name, "autoSendToBambu") == 0) return bambuAutoSend.enable ? "checked" : "";
+    if (strcmp(name, "autoSendTime") == 0) return (bambuAutoSend.time != 0) ? String(bambuAutoSend.time) : String(BAMBU_DEFAULT_AUTOSEND_TIME);
+
+    if (strcmp(name, "bambuPrinters") == 0) {
+        // Alle Drucker-Slots für die Auswahl im Formular -- All printer slots for the form selector
+        // Die Vorlage erwartet einen String, gebaut wird trotzdem im Stack -- the template expects a String, it is still built on the stack
+        char out[BAMBU_MAX_PRINTERS * 224];
+        JsonWriter printers(out, sizeof(out));
+        printers.beginArray();
+        for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+            printers.beginObject()
+                    .add("ip", bambuPrinters[i].credentials.ip.c_str())
+                    .add("serial", bambuPrinters[i].credentials.serial.c_str())
+                    .add("code", bambuPrinters[i].credentials.accesscode.c_str())
+                    .add("fingerprint", bambuPrinters[i].credentials.fingerprint.c_str())
+                    .endObject();
+        }
+        printers.endArray();
+        return printers.overflowed() ? String("[]") : String(printers.c_str());
+    }
+    return "";
+}
 
-    return html;
+// Sendet eine Vorlage aus scripts/gzip_files.py, die Werte werden beim Streamen eingesetzt
+// Sends a template built by scripts/gzip_files.py, the values are spliced in while streaming
+static void sendTemplate(AsyncWebServerRequest *request, const char* path, HtmlTemplateValue values) {
+    AsyncWebServerResponse *response = beginTemplateResponse(request, path, "text/html", values);
+    if (!response) {
+        request->send(404, "text/plain", "Fehler: Datei nicht gefunden!");
+        return;
+    }
+    request->send(response);
 }
 
 void sendWriteResult(AsyncWebSocketClient *client, uint8_t success) {
-    // Sende Erfolg/Misserfolg an alle Clients
-    String response = "{\"type\":\"writeNfcTag\",\"success\":" + String(success ? "1" : "0") + "}";
-    ws.textAll(response);
+    // Sende Erfolg/Misserfolg an alle Clients, beim Verbinden nur an den neuen
+    wsPublishText(WS_TOPIC_NFC, success ? "{\"type\":\"writeNfcTag\",\"success\":1}" : "{\"type\":\"writeNfcTag\",\"success\":0}", client);
 }
 
 void foundNfcTag(AsyncWebSocketClient *client, uint8_t success) {
     if (success == lastSuccess) return;
-    ws.textAll("{\"type\":\"nfcTag\", \"payload\":{\"found\": " + String(success) + "}}");
+    char message[64];
+    snprintf(message, sizeof(message), "{\"type\":\"nfcTag\", \"payload\":{\"found\": %u}}", success);
+    wsPublishText(WS_TOPIC_NFC, message, nullptr, WS_KEY_NFC_TAG);
     sendNfcData();
     lastSuccess = success;
 }
@@ -158,32 +264,115 @@ void sendNfcData() {
     // TBD: Why is there no status for reading the tag?
     switch(nfcReaderState){
         case NFC_IDLE:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{}}", nullptr, WS_KEY_NFC_DATA);
             break;
         case NFC_READ_SUCCESS:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":" + nfcJsonData + "}");
+            // Tag-Inhalt ist bereits JSON -- the tag content is JSON already
+            wsPublishJson(WS_TOPIC_NFC, [](JsonWriter& json) {
+                json.beginObject().add("type", "nfcData").addRaw("payload", nfcJsonData.c_str()).endObject();
+            }, nullptr, WS_KEY_NFC_DATA);
             break;
         case NFC_READ_ERROR:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{\"error\":\"Empty Tag or Data not readable\"}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{\"error\":\"Empty Tag or Data not readable\"}}", nullptr, WS_KEY_NFC_DATA);
             break;
         case NFC_WRITING:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{\"info\":\"Schreibe Tag...\"}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{\"info\":\"Schreibe Tag...\"}}", nullptr, WS_KEY_NFC_DATA);
             break;
         case NFC_WRITE_SUCCESS:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{\"info\":\"Tag erfolgreich geschrieben\"}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{\"info\":\"Tag erfolgreich geschrieben\"}}", nullptr, WS_KEY_NFC_DATA);
             break;
         case NFC_WRITE_ERROR:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{\"error\":\"Error writing to Tag\"}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{\"error\":\"Error writing to Tag\"}}", nullptr, WS_KEY_NFC_DATA);
             break;
         case DEFAULT:
-            ws.textAll("{\"type\":\"nfcData\", \"payload\":{\"error\":\"Something went wrong\"}}");
+            wsPublishText(WS_TOPIC_NFC, "{\"type\":\"nfcData\", \"payload\":{\"error\":\"Something went wrong\"}}", nullptr, WS_KEY_NFC_DATA);
     }
     lastnfcReaderState = nfcReaderState;
 }
 
+// Schreibt die AMS-Nachricht direkt in den WebSocket-Puffer -- Writes the AMS message straight into the WebSocket buffer
+void sendAmsMessage(const char* type, uint8_t printer, AmsJsonWriter writer, AsyncWebSocketClient *client) {
+    const BambuPrinter& state = bambuPrinters[printer];
+    uint8_t key = (strcmp(type, "amsData") == 0) ? WS_KEY_AMS_DATA(printer) : WS_KEY_AMS_DELTA(printer);
+
+    wsPublishJson(WS_TOPIC_AMS, [&](JsonWriter& json) {
+        json.beginObject()
+            .add("type", type)
+            .add("printer", printer)
+            .add("serial", state.credentials.serial.c_str())
+            .add("trayNow", state.tray_now)
+            .key("payload");
+        writer(printer, json);
+        json.endObject();
+    }, client, key);
+}
+
+void sendPrinterAmsData(uint8_t printer, AsyncWebSocketClient *client) {
+    // Vollständiger Snapshot, nur beim Verbinden oder wenn sich die AMS-Anzahl ändert
+    if (!bambuTryLockAmsData(BAMBU_LOCK_TIMEOUT)) {
+        LOG_W(LOG_MOD_WEB, "AMS-Daten gesperrt, Snapshot ausgelassen -- AMS data locked, snapshot skipped");
+        return;
+    }
+    if (bambuPrinters[printer].ams_count > 0 || bambuPrinters[printer].has_external) sendAmsMessage("amsData", printer, serializeAmsData, client);
+    bambuUnlockAmsData();
+}
+
+// Messwerte für scripts/bambu_simulator.py -- measurements for scripts/bambu_simulator.py
+void sendBambuStats(AsyncWebSocketClient *client) {
+    char out[128 + BAMBU_MAX_PRINTERS * 128];
+    JsonWriter json(out, sizeof(out));
+    json.beginObject()
+        .add("type", "bambuStats")
+        .add("freeHeap", ESP.getFreeHeap())
+        .add("minFreeHeap", ESP.getMinFreeHeap())
+        .add("maxAllocHeap", ESP.getMaxAllocHeap());
+    if (BambuMqttTask) json.add("mqttStackFree", uxTaskGetStackHighWaterMark(BambuMqttTask));
+
+    json.beginArray("printers");
+    // Wie /api/ams: bei belegter Sperre trotzdem antworten -- like /api/ams: reply even when the lock is busy
+    if (!bambuTryLockAmsData(BAMBU_LOCK_TIMEOUT)) {
+        LOG_W(LOG_MOD_WEB, "AMS-Daten gesperrt -- AMS data locked");
+        json.endArray().add("error", "busy").endObject();
+        replyJson(client, json);
+        return;
+    }
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        const BambuReportStats& stats = bambuPrinters[i].stats;
+        json.beginObject()
+            .add("connected", bambuPrinters[i].connected)
+            .add("reports", stats.reports)
+            .add("bytes", stats.bytes)
+            .add("parseErrors", stats.parseErrors)
+            .add("avgUs", stats.reports ? (unsigned long)(stats.totalUs / stats.reports) : 0UL)
+            .add("maxUs", stats.maxUs)
+            .add("tlsHeap", stats.tlsHeap)
+            .endObject();
+    }
+    bambuUnlockAmsData();
+    json.endArray().endObject();
+
+    replyJson(client, json);
+}
+
+// Warteschlangen aller WebSocket-Clients -- queues of all WebSocket clients
+void sendWsStats(AsyncWebSocketClient *client) {
+    JsonDocument doc;
+    doc["type"] = "wsStats";
+    buildQueueStatus(doc);
+    wsReply(client, doc);
+}
+
+// Gewicht nur für Clients, die "weight" abonniert haben -- weight only for clients subscribed to "weight"
+void sendWeight(int16_t weight) {
+    if (!wsHasSubscribers(WS_TOPIC_WEIGHT)) return;
+    char message[48];
+    snprintf(message, sizeof(message), "{\"type\":\"weight\",\"payload\":%d}", weight);
+    wsPublishText(WS_TOPIC_WEIGHT, message, nullptr, WS_KEY_WEIGHT);
+}
+
 void sendAmsData(AsyncWebSocketClient *client) {
-    if (ams_count > 0) {
-        ws.textAll("{\"type\":\"amsData\",\"payload\":" + amsJsonData + "}");
+    for (uint8_t i = 0; i < BAMBU_MAX_PRINTERS; i++) {
+        sendPrinterAmsData(i, client);
     }
 }
 
@@ -192,9 +381,12 @@ void setupWebserver(AsyncWebServer &server) {
     // Deaktiviere alle Debug-Ausgaben
     Serial.setDebugOutput(false);
     
+    // Antwortzeiten für /metrics, vor allen Routen -- response times for /metrics, ahead of all routes
+    setupRequestMetrics(server);
+
     // WebSocket-Optimierungen
-    ws.onEvent(onWsEvent);
-    ws.enable(true);
+    wsDispatchInit();
+    wsCommandsInit();
 
     // Konfiguriere Server für große Uploads
     server.onRequestBody([](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){});
@@ -202,15 +394,14 @@ void setupWebserver(AsyncWebServer &server) {
 
     // Lade die Spoolman-URL beim Booten
     spoolmanUrl = loadSpoolmanUrl();
-    Serial.print("Geladene Spoolman-URL: ");
-    Serial.println(spoolmanUrl);
+    LOG_I(LOG_MOD_WEB, "Geladene Spoolman-URL: %s", spoolmanUrl.c_str());
 
     // Load Bamb credentials:
     loadBambuCredentials();
 
     // Route für about
     server.on("/about", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /about erhalten");
+        LOG_D(LOG_MOD_WEB, "Anfrage für /about erhalten");
         AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/index.html.gz", "text/html");
         response->addHeader("Content-Encoding", "gzip");
         response->addHeader("Cache-Control", CACHE_CONTROL);
@@ -219,20 +410,13 @@ void setupWebserver(AsyncWebServer &server) {
 
     // Route für Waage
     server.on("/waage", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /waage erhalten");
-        //AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/waage.html.gz", "text/html");
-        //response->addHeader("Content-Encoding", "gzip");
-        //response->addHeader("Cache-Control", CACHE_CONTROL);
-
-        String html = loadHtmlWithHeader("/waage.html");
-        html.replace("{{autoTare}}", (autoTare) ? "checked" : "");
-
-        request->send(200, "text/html", html);
+        LOG_D(LOG_MOD_WEB, "Anfrage für /waage erhalten");
+        sendTemplate(request, "/waage.html.tpl", waageTemplateValue);
     });
 
     // Route für RFID
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /rfid erhalten");
+        LOG_D(LOG_MOD_WEB, "Anfrage für /rfid erhalten");
         
         String page = (bambuDisabled) ? "/rfid.html.gz" : "/rfid_bambu.html.gz";
         AsyncWebServerResponse *response = request->beginResponse(LittleFS, page, "text/html");
@@ -240,18 +424,20 @@ void setupWebserver(AsyncWebServer &server) {
         response->addHeader("Content-Encoding", "gzip");
         response->addHeader("Cache-Control", CACHE_CONTROL);
         request->send(response);
-        Serial.println("RFID-Seite gesendet");
+        LOG_D(LOG_MOD_WEB, "RFID-Seite gesendet");
     });
 
     server.on("/api/url", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("API-Aufruf: /api/url");
-        String jsonResponse = "{\"spoolman_url\": \"" + String(spoolmanUrl) + "\"}";
-        request->send(200, "application/json", jsonResponse);
+        LOG_D(LOG_MOD_WEB, "API-Aufruf: /api/url");
+        char out[256];
+        JsonWriter json(out, sizeof(out));
+        json.beginObject().add("spoolman_url", spoolmanUrl.c_str()).endObject();
+        sendJson(request, json);
     });
 
     // Route für WiFi
     server.on("/wifi", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /wifi erhalten");
+        LOG_D(LOG_MOD_WEB, "Anfrage für /wifi erhalten");
         AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/wifi.html.gz", "text/html");
         response->addHeader("Content-Encoding", "gzip");
         response->addHeader("Cache-Control", CACHE_CONTROL);
@@ -260,20 +446,8 @@ void setupWebserver(AsyncWebServer &server) {
 
     // Route für Spoolman Setting
     server.on("/spoolman", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /spoolman erhalten");
-        String html = loadHtmlWithHeader("/spoolman.html");
-        html.replace("{{spoolmanUrl}}", (spoolmanUrl != "") ? spoolmanUrl : "");
-        html.replace("{{spoolmanOctoEnabled}}", octoEnabled ? "checked" : "");
-        html.replace("{{spoolmanOctoUrl}}", (octoUrl != "") ? octoUrl : "");
-        html.replace("{{spoolmanOctoToken}}", (octoToken != "") ? octoToken : "");
-
-        html.replace("{{bambuIp}}", bambuCredentials.ip);            
-        html.replace("{{bambuSerial}}", bambuCredentials.serial);
-        html.replace("{{bambuCode}}", bambuCredentials.accesscode ? bambuCredentials.accesscode : "");
-        html.replace("{{autoSendToBambu}}", bambuCredentials.autosend_enable ? "checked" : "");
-        html.replace("{{autoSendTime}}", (bambuCredentials.autosend_time != 0) ? String(bambuCredentials.autosend_time) : String(BAMBU_DEFAULT_AUTOSEND_TIME));
-
-        request->send(200, "text/html", html);
+        LOG_D(LOG_MOD_WEB, "Anfrage für /spoolman erhalten");
+        sendTemplate(request, "/spoolman.html.tpl", spoolmanTemplateValue);
     });
 
     // Route für das Überprüfen der Spoolman-Instanz
@@ -305,16 +479,25 @@ void setupWebserver(AsyncWebServer &server) {
         octoUrl.trim();
         octoToken.trim();
         
-        bool healthy = saveSpoolmanUrl(url, octoEnabled, octoUrl, octoToken);
-        String jsonResponse = "{\"healthy\": " + String(healthy ? "true" : "false") + "}";
-
-        request->send(200, "application/json", jsonResponse);
+        // Ergebnis kommt über den WebSocket -- the result follows over the WebSocket
+        if (saveSpoolmanUrl(url, octoEnabled, octoUrl, octoToken)) {
+            request->send(202, "application/json", "{\"queued\":true}");
+        } else {
+            request->send(503, "application/json", "{\"queued\":false, \"error\": \"Health monitor not running\"}");
+        }
     });
 
     // Route für das Überprüfen der Bambu-Instanz
     server.on("/api/bambu", HTTP_GET, [](AsyncWebServerRequest *request){
+        // Drucker-Slot, ohne Angabe der erste -- printer slot, defaults to the first one
+        uint8_t printer = request->hasParam("printer") ? request->getParam("printer")->value().toInt() : 0;
+        if (printer >= BAMBU_MAX_PRINTERS) {
+            request->send(400, "application/json", "{\"success\": false, \"error\": \"Invalid printer\"}");
+            return;
+        }
+
         if (request->hasParam("remove")) {
-            if (removeBambuCredentials()) {
+            if (removeBambuCredentials(printer)) {
                 request->send(200, "application/json", "{\"success\": true}");
             } else {
                 request->send(500, "application/json", "{\"success\": false, \"error\": \"Fehler beim Löschen der Bambu-Credentials\"}");
@@ -330,12 +513,15 @@ void setupWebserver(AsyncWebServer &server) {
         String bambu_ip = request->getParam("bambu_ip")->value();
         String bambu_serialnr = request->getParam("bambu_serialnr")->value();
         String bambu_accesscode = request->getParam("bambu_accesscode")->value();
+        // Optional: SHA-256 Fingerprint des Druckerzertifikats -- optional SHA-256 fingerprint of the printer certificate
+        String bambu_fingerprint = request->hasParam("bambu_fingerprint") ? request->getParam("bambu_fingerprint")->value() : "";
         bool autoSend = (request->getParam("autoSend")->value() == "true") ? true : false;
         String autoSendTime = request->getParam("autoSendTime")->value();
         
         bambu_ip.trim();
         bambu_serialnr.trim();
         bambu_accesscode.trim();
+        bambu_fingerprint.trim();
         autoSendTime.trim();
 
         if (bambu_ip.length() == 0 || bambu_serialnr.length() == 0 || bambu_accesscode.length() == 0) {
@@ -343,9 +529,17 @@ void setupWebserver(AsyncWebServer &server) {
             return;
         }
 
-        bool success = saveBambuCredentials(bambu_ip, bambu_serialnr, bambu_accesscode, autoSend, autoSendTime);
+        if (!bambuFingerprintValid(bambu_fingerprint)) {
+            request->send(400, "application/json", "{\"success\": false, \"error\": \"Invalid fingerprint\"}");
+            return;
+        }
+
+        bool queued = saveBambuCredentials(printer, bambu_ip, bambu_serialnr, bambu_accesscode, bambu_fingerprint, autoSend, autoSendTime);
 
-        request->send(200, "application/json", "{\"healthy\": " + String(success ? "true" : "false") + "}");
+        char out[24];
+        JsonWriter json(out, sizeof(out));
+        json.beginObject().add("queued", queued).endObject();
+        sendJson(request, json);
     });
 
     // Route für das Überprüfen der Spoolman-Instanz
@@ -353,69 +547,11 @@ void setupWebserver(AsyncWebServer &server) {
         ESP.restart();
     });
 
-    // Route für das Laden der CSS-Datei
-    server.on("/style.css", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Lade style.css");
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/style.css.gz", "text/css");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("style.css gesendet");
-    });
-
-    // Route für das Logo
-    server.on("/logo.png", HTTP_GET, [](AsyncWebServerRequest *request){
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/logo.png.gz", "image/png");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("logo.png gesendet");
-    });
+    // CSS, JavaScript und Bilder aus dem Flash -- CSS, JavaScript and images from flash
+    registerStaticAssets(server);
 
-    // Route für Favicon
-    server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request){
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/favicon.ico", "image/x-icon");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("favicon.ico gesendet");
-    });
-
-    // Route für spool_in.png
-    server.on("/spool_in.png", HTTP_GET, [](AsyncWebServerRequest *request){
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/spool_in.png.gz", "image/png");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("spool_in.png gesendet");
-    });
-
-    // Route für set_spoolman.png
-    server.on("/set_spoolman.png", HTTP_GET, [](AsyncWebServerRequest *request){
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/set_spoolman.png.gz", "image/png");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("set_spoolman.png gesendet");
-    });
-
-    // Route für JavaScript Dateien
-    server.on("/spoolman.js", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /spoolman.js erhalten");
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/spoolman.js.gz", "text/javascript");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("Spoolman.js gesendet");
-    });
-
-    server.on("/rfid.js", HTTP_GET, [](AsyncWebServerRequest *request){
-        Serial.println("Anfrage für /rfid.js erhalten");
-        AsyncWebServerResponse *response = request->beginResponse(LittleFS,"/rfid.js.gz", "text/javascript");
-        response->addHeader("Content-Encoding", "gzip");
-        response->addHeader("Cache-Control", CACHE_CONTROL);
-        request->send(response);
-        Serial.println("RFID.js gesendet");
-    });
+    // JSON-API und /events für Automatisierung -- JSON API and /events for automation
+    setupRestApi(server);
 
     // Vereinfachter Update-Handler
     server.on("/upgrade", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -428,16 +564,24 @@ void setupWebserver(AsyncWebServer &server) {
     // Update-Handler registrieren
     handleUpdate(server);
 
+    // Log-Anzeige über das WebSocket-Thema "log" -- log viewer on the WebSocket topic "log"
+    server.on("/log", HTTP_GET, [](AsyncWebServerRequest *request) {
+        AsyncWebServerResponse *response = request->beginResponse(LittleFS, "/log.html.gz", "text/html");
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    });
+
     server.on("/api/version", HTTP_GET, [](AsyncWebServerRequest *request){
-        String fm_version = VERSION;
-        String jsonResponse = "{\"version\": \""+ fm_version +"\"}";
-        request->send(200, "application/json", jsonResponse);
+        char out[48];
+        JsonWriter json(out, sizeof(out));
+        json.beginObject().add("version", VERSION).endObject();
+        sendJson(request, json);
     });
 
     // Fehlerbehandlung für nicht gefundene Seiten
     server.onNotFound([](AsyncWebServerRequest *request){
-        Serial.print("404 - Nicht gefunden: ");
-        Serial.println(request->url());
+        LOG_I(LOG_MOD_WEB, "404 - Nicht gefunden: %s", request->url().c_str());
         request->send(404, "text/plain", "Seite nicht gefunden");
     });
 
@@ -448,5 +592,7 @@ void setupWebserver(AsyncWebServer &server) {
 
     // Starte den Webserver
     server.begin();
-    Serial.println("Webserver gestartet");
+    LOG_I(LOG_MOD_WEB, "Webserver gestartet");
+    // AsyncTCP startet seinen Task mit dem ersten Server -- AsyncTCP starts its task with the first server
+    metricsRegisterTask("async_tcp", xTaskGetHandle("async_tcp"));
 }
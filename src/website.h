@@ -24,8 +24,14 @@ void setupWebserver(AsyncWebServer &server);
 
 // WebSocket-Funktionen
 void sendAmsData(AsyncWebSocketClient *client);
+void sendBambuStats(AsyncWebSocketClient *client);
+void sendWsStats(AsyncWebSocketClient *client);
+void sendPrinterAmsData(uint8_t printer, AsyncWebSocketClient *client);
+typedef void (*AmsJsonWriter)(uint8_t printer, JsonWriter& json);
+void sendAmsMessage(const char* type, uint8_t printer, AmsJsonWriter writer, AsyncWebSocketClient *client);
 void sendNfcData();
 void foundNfcTag(AsyncWebSocketClient *client, uint8_t success);
 void sendWriteResult(AsyncWebSocketClient *client, uint8_t success);
+void sendWeight(int16_t weight);
 
 #endif
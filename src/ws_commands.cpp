@@ -0,0 +1,120 @@
+#include "ws_commands.h"
+#include "ws_topics.h"
+#include "config.h"
+#include "api.h"
+#include "bambu.h"
+#include "scale.h"
+#include "metrics.h"
+#include "logger.h"
+
+// Typ der Ergebnisnachricht, wie ihn die Seiten schon kennen -- result message type the pages already know
+static const char* const resultTypes[WS_CMD_COUNT] = {
+    "scale", "scale", "scale", "reconnect", "reconnect", "setBambuSpool", "setSpoolmanSettings"
+};
+
+static QueueHandle_t wsCommandQueue = NULL;
+static TaskHandle_t wsCommandTask = NULL;
+static uint32_t nextRequestId = 0;
+
+static void replyCommand(const WsCommand& cmd, const char* status) {
+    JsonDocument reply;
+    reply["type"] = resultTypes[cmd.type];
+    reply["id"] = cmd.requestId;
+    reply["payload"] = status;
+    wsReply(cmd.clientId, reply);
+}
+
+static bool runCommand(const WsCommand& cmd) {
+    switch (cmd.type) {
+        case WS_CMD_SCALE_TARE:
+            return tareScale();
+        case WS_CMD_SCALE_CALIBRATE:
+            return calibrate_scale();
+        case WS_CMD_SCALE_AUTOTARE:
+            return setAutoTare(cmd.enabled);
+        case WS_CMD_RECONNECT_BAMBU:
+            bambu_restart();
+            return true;
+        case WS_CMD_RECONNECT_SPOOLMAN:
+            return initSpoolman();
+        case WS_CMD_SET_BAMBU_SPOOL:
+            LOG_D(LOG_MOD_WEB, "%s", cmd.payload);
+            return setBambuSpool(String(cmd.payload));
+        case WS_CMD_SET_SPOOLMAN_SETTINGS:
+            LOG_D(LOG_MOD_WEB, "%s", cmd.payload);
+            return updateSpoolBambuData(String(cmd.payload));
+        default:
+            return false;
+    }
+}
+
+static void wsCommandLoop(void *parameter) {
+    WsCommand cmd;
+    for (;;) {
+        if (xQueueReceive(wsCommandQueue, &cmd, portMAX_DELAY) != pdTRUE) continue;
+        bool success = runCommand(cmd);
+        free(cmd.payload);
+        replyCommand(cmd, success ? "success" : "error");
+    }
+}
+
+static uint32_t readPending(void *ctx) {
+    return wsCommandsPending();
+}
+
+void wsCommandsInit() {
+    if (wsCommandTask) return;
+    wsCommandQueue = xQueueCreate(WS_COMMAND_QUEUE_LENGTH, sizeof(WsCommand));
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        wsCommandLoop, /* Function to implement the task */
+        "WsCommands", /* Name of the task */
+        8192,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        wsCommandTaskPrio,  /* Priority of the task */
+        &wsCommandTask,  /* Task handle. */
+        wsCommandTaskCore); /* Core where the task should run */
+
+    if (result != pdPASS) {
+        Serial.println("Fehler beim Erstellen des WsCommands-Tasks");
+    } else {
+        metricsRegisterTask("WsCommands", wsCommandTask);
+    }
+    metricsGauge("filaman_ws_commands_pending", "WebSocket commands waiting for the worker task", readPending);
+}
+
+uint8_t wsCommandsPending() {
+    return wsCommandQueue ? uxQueueMessagesWaiting(wsCommandQueue) : 0;
+}
+
+void queueWsCommand(AsyncWebSocketClient *client, JsonDocument& doc, WsCommandType type, JsonVariantConst payload) {
+    WsCommand cmd = {};
+    cmd.type = type;
+    cmd.clientId = client->id();
+    cmd.requestId = doc["id"].is<uint32_t>() ? doc["id"].as<uint32_t>() : ++nextRequestId;
+    cmd.enabled = doc["enabled"].as<bool>();
+
+    if (!payload.isNull()) {
+        String text = payload.as<String>();
+        cmd.payload = (char*)malloc(text.length() + 1);
+        if (!cmd.payload) {
+            replyCommand(cmd, "error");
+            return;
+        }
+        memcpy(cmd.payload, text.c_str(), text.length() + 1);
+    }
+
+    // Nicht warten, der AsyncTCP-Task darf nicht blockieren -- do not wait, the AsyncTCP task must not block
+    if (!wsCommandQueue || xQueueSend(wsCommandQueue, &cmd, 0) != pdTRUE) {
+        LOG_W(LOG_MOD_WEB, "WebSocket-Befehl verworfen, Warteschlange voll -- WebSocket command dropped, queue full");
+        free(cmd.payload);
+        replyCommand(cmd, "busy");
+        return;
+    }
+
+    JsonDocument queued;
+    queued["type"] = "queued";
+    queued["id"] = cmd.requestId;
+    queued["command"] = resultTypes[type];
+    wsReply(cmd.clientId, queued);
+}
@@ -0,0 +1,39 @@
+#ifndef WS_COMMANDS_H
+#define WS_COMMANDS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+
+// Langsame WebSocket-Befehle laufen im WsCommands-Task statt im AsyncTCP-Callback.
+// Slow WebSocket commands run on the WsCommands task instead of the AsyncTCP callback.
+// Jeder Auftrag trägt eine ID: die "id" der Anfrage oder eine vergebene. Der Client bekommt
+// {"type":"queued","id":N} und später das Ergebnis mit derselben id, nur an ihn selbst.
+// Every job carries an id: the request's "id" or an assigned one. The client gets
+// {"type":"queued","id":N} and later the result with the same id, sent to it alone.
+
+typedef enum {
+    WS_CMD_SCALE_TARE,
+    WS_CMD_SCALE_CALIBRATE,
+    WS_CMD_SCALE_AUTOTARE,
+    WS_CMD_RECONNECT_BAMBU,
+    WS_CMD_RECONNECT_SPOOLMAN,
+    WS_CMD_SET_BAMBU_SPOOL,
+    WS_CMD_SET_SPOOLMAN_SETTINGS,
+    WS_CMD_COUNT
+} WsCommandType;
+
+typedef struct {
+    WsCommandType type;
+    uint32_t clientId;
+    uint32_t requestId;
+    bool enabled;       // für WS_CMD_SCALE_AUTOTARE
+    char *payload;      // JSON-Text oder nullptr, gibt der Worker frei -- JSON text or nullptr, freed by the worker
+} WsCommand;
+
+void wsCommandsInit();
+uint8_t wsCommandsPending();
+// payload wird als JSON kopiert, falls vorhanden -- payload is copied as JSON if present
+void queueWsCommand(AsyncWebSocketClient *client, JsonDocument& doc, WsCommandType type, JsonVariantConst payload = JsonVariantConst());
+
+#endif
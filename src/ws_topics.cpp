@@ -0,0 +1,615 @@
+#include "ws_topics.h"
+#include "website.h"
+#include "config.h"
+#include "scale.h"
+#include "metrics.h"
+#include "logger.h"
+
+typedef struct {
+    AsyncWebSocketMessageBuffer *buffer;
+    uint8_t key;
+    uint8_t topic;
+    bool binary;
+} WsSlot;
+
+typedef struct {
+    uint32_t id;        // 0 = frei -- free
+    uint8_t topics;
+    bool binary;
+    uint8_t count;
+    uint8_t maxCount;
+    uint8_t resyncAms;  // Drucker, deren AMS-Nachricht verworfen wurde -- printers whose AMS message was dropped
+    uint32_t sent;
+    uint32_t coalesced;
+    uint32_t dropped;
+    uint16_t streamInterval;    // ms zwischen zwei Messwerten, 0 = kein Stream -- ms between samples, 0 = no stream
+    uint32_t lastStreamAt;
+    uint32_t lastStreamSeq;
+    WsSlot queue[WS_CLIENT_QUEUE_DEPTH];
+} WsSubscriber;
+
+// Empfänger einer Nachricht, außerhalb der Sperre kopiert -- recipients of one message, copied out of the lock
+typedef struct {
+    uint8_t count;
+    bool anyJson;
+    bool anyBinary;
+    uint32_t ids[WS_MAX_CLIENTS + 1];   // + /events
+    bool binary[WS_MAX_CLIENTS + 1];
+} WsTargets;
+
+static const char* const topicNames[WS_TOPIC_COUNT] = { "weight", "nfc", "ams", "system", "update", "log" };
+
+static WsSubscriber subscribers[WS_MAX_CLIENTS];
+// Alle /events Verbindungen teilen sich einen Eintrag, id ist WS_EVENTS_ID solange welche offen sind
+// All /events connections share one entry, its id is WS_EVENTS_ID while any are open
+static WsSubscriber eventsSubscriber;
+static AsyncEventSource *eventSource = nullptr;
+static uint32_t lastEventId = 0;
+static uint32_t totalDropped = 0;
+static uint8_t streamCount = 0;
+// Schützt Tabelle, Warteschlangen und die Pufferliste von ws -- guards table, queues and the buffer list of ws
+static SemaphoreHandle_t wsQueueMutex = NULL;
+static TaskHandle_t wsDispatchTask = NULL;
+static Metric* droppedMetric = nullptr;
+
+// AsyncWebSocketMessageBuffer zählt Referenzen mit ++/--, lock() ist nur ein Flag
+// AsyncWebSocketMessageBuffer counts references with ++/--, lock() is only a flag
+static void retainBuffer(AsyncWebSocketMessageBuffer *buffer) {
+    (*buffer)++;
+}
+
+static void releaseBuffer(AsyncWebSocketMessageBuffer *buffer) {
+    (*buffer)--;
+}
+
+static bool lockQueues() {
+    return wsQueueMutex && xSemaphoreTake(wsQueueMutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void unlockQueues() {
+    xSemaphoreGive(wsQueueMutex);
+}
+
+static WsSubscriber* findSubscriber(uint32_t id) {
+    if (id == WS_EVENTS_ID) return eventsSubscriber.id ? &eventsSubscriber : nullptr;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (subscribers[i].id == id) return &subscribers[i];
+    }
+    return nullptr;
+}
+
+static void removeSlot(WsSubscriber& sub, uint8_t index) {
+    releaseBuffer(sub.queue[index].buffer);
+    memmove(&sub.queue[index], &sub.queue[index + 1], (sub.count - index - 1) * sizeof(WsSlot));
+    sub.count--;
+}
+
+static void clearQueue(WsSubscriber& sub) {
+    while (sub.count) removeSlot(sub, sub.count - 1);
+}
+
+static bool isAmsKey(uint8_t key) {
+    return (key & 0xF0) == WS_KEY_AMS_DATA(0) || (key & 0xF0) == WS_KEY_AMS_DELTA(0);
+}
+
+// Erwartet gesperrte Warteschlangen -- expects the queues to be locked
+static void enqueue(WsSubscriber& sub, AsyncWebSocketMessageBuffer *buffer, bool binary, uint8_t key, uint8_t topic) {
+    if (key != WS_KEY_NONE && (key & 0xF0) != WS_KEY_AMS_DELTA(0)) {
+        // Ältere Nachricht desselben Zustands ist überholt -- an older message of the same state is stale
+        for (uint8_t i = sub.count; i-- > 0; ) {
+            uint8_t queued = sub.queue[i].key;
+            bool superseded = queued == key || ((key & 0xF0) == WS_KEY_AMS_DATA(0) && queued == WS_KEY_AMS_DELTA(key & 0x0F));
+            if (superseded) {
+                removeSlot(sub, i);
+                sub.coalesced++;
+            }
+        }
+    }
+
+    if (sub.count == WS_CLIENT_QUEUE_DEPTH) {
+        // Langsamer Client: älteste Nachricht verwerfen -- slow client: drop the oldest message
+        if (isAmsKey(sub.queue[0].key)) sub.resyncAms |= 1U << (sub.queue[0].key & 0x0F);
+        removeSlot(sub, 0);
+        sub.dropped++;
+        totalDropped++;
+        metricsInc(droppedMetric);
+    }
+
+    retainBuffer(buffer);
+    sub.queue[sub.count].buffer = buffer;
+    sub.queue[sub.count].key = key;
+    sub.queue[sub.count].topic = topic;
+    sub.queue[sub.count].binary = binary;
+    sub.count++;
+    if (sub.count > sub.maxCount) sub.maxCount = sub.count;
+}
+
+// Erst weitergeben, wenn AsyncWebSocket und TCP-Sendepuffer Platz haben
+// Only hand over once AsyncWebSocket and the TCP send buffer have room
+static bool clientReady(AsyncWebSocketClient *client) {
+    return client->canSend() && client->client() && client->client()->space() >= WS_CLIENT_MIN_SPACE;
+}
+
+static AsyncWebSocketMessageBuffer* packDocument(JsonDocument& doc);
+
+// Hängt den neuesten Messwert bei allen fälligen Stream-Clients an; der Schlüssel ersetzt einen noch
+// wartenden Wert, pro Client liegt also höchstens einer in der Warteschlange.
+// Appends the newest sample for every stream client that is due; the key replaces a sample still
+// waiting, so at most one per client sits in the queue.
+static void streamWeight() {
+    ScaleSample sample;
+    scaleLatestSample(sample);
+    if (sample.seq == 0) return;
+
+    uint32_t now = millis();
+    bool wantJson = false;
+    bool wantBinary = false;
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        const WsSubscriber& sub = subscribers[i];
+        if (sub.id == 0 || sub.streamInterval == 0 || sub.lastStreamSeq == sample.seq) continue;
+        if (now - sub.lastStreamAt < sub.streamInterval) continue;
+        if (sub.binary) {
+            wantBinary = true;
+        } else {
+            wantJson = true;
+        }
+    }
+    unlockQueues();
+    if (!wantJson && !wantBinary) return;
+
+    JsonDocument doc;
+    doc["type"] = "weightSample";
+    doc["t"] = sample.timestamp;
+    doc["g"] = roundf(sample.grams * 10.0f) / 10.0f;
+    doc["stable"] = sample.stable;
+
+    AsyncWebSocketMessageBuffer *json = nullptr;
+    if (wantJson) {
+        size_t len = measureJson(doc);
+        json = wsMakeBuffer(len);
+        if (json) serializeJson(doc, (char*)json->get(), len);
+    }
+    AsyncWebSocketMessageBuffer *packed = wantBinary ? packDocument(doc) : nullptr;
+
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsSubscriber& sub = subscribers[i];
+        if (sub.id == 0 || sub.streamInterval == 0 || sub.lastStreamSeq == sample.seq) continue;
+        if (now - sub.lastStreamAt < sub.streamInterval) continue;
+        AsyncWebSocketMessageBuffer *buffer = sub.binary ? packed : json;
+        if (!buffer) continue;
+        enqueue(sub, buffer, sub.binary, WS_KEY_WEIGHT_SAMPLE, WS_TOPIC_WEIGHT);
+        sub.lastStreamAt = now;
+        sub.lastStreamSeq = sample.seq;
+    }
+    if (json) releaseBuffer(json);
+    if (packed) releaseBuffer(packed);
+    unlockQueues();
+}
+
+// Erwartet gesperrte Warteschlangen; AsyncEventSource puffert selbst pro Verbindung
+// Expects the queues to be locked; AsyncEventSource buffers per connection on its own
+static void dispatchEvents() {
+    WsSubscriber& sub = eventsSubscriber;
+    if (sub.id == 0) return;
+    if (!eventSource || eventSource->count() == 0) {
+        clearQueue(sub);
+        sub.id = 0;
+        return;
+    }
+
+    while (sub.count) {
+        WsSlot& slot = sub.queue[0];
+        // Der Puffer ist nicht nullterminiert -- the buffer is not null-terminated
+        size_t len = slot.buffer->length();
+        char *text = (char*)malloc(len + 1);
+        if (text) {
+            memcpy(text, slot.buffer->get(), len);
+            text[len] = '\0';
+            eventSource->send(text, topicNames[slot.topic], ++lastEventId);
+            free(text);
+        }
+        sub.sent++;
+        removeSlot(sub, 0);
+    }
+}
+
+static void dispatchQueues() {
+    uint32_t resyncIds[WS_MAX_CLIENTS];
+    uint8_t resyncMasks[WS_MAX_CLIENTS];
+    uint8_t resyncCount = 0;
+
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsSubscriber& sub = subscribers[i];
+        if (sub.id == 0) continue;
+        AsyncWebSocketClient *client = ws.client(sub.id);
+        if (!client || client->status() != WS_CONNECTED) continue;
+
+        while (sub.count && clientReady(client)) {
+            WsSlot& slot = sub.queue[0];
+            if (slot.binary) {
+                client->binary(slot.buffer);
+            } else {
+                client->text(slot.buffer);
+            }
+            sub.sent++;
+            removeSlot(sub, 0);
+        }
+
+        // Verworfene AMS-Daten erst nachliefern, wenn der Client aufgeholt hat
+        // Re-send dropped AMS data only once the client has caught up
+        if (sub.resyncAms && sub.count == 0) {
+            resyncIds[resyncCount] = sub.id;
+            resyncMasks[resyncCount] = sub.resyncAms;
+            resyncCount++;
+            sub.resyncAms = 0;
+        }
+    }
+    dispatchEvents();
+    ws._cleanBuffers();
+    unlockQueues();
+
+    for (uint8_t i = 0; i < resyncCount; i++) {
+        AsyncWebSocketClient *client = ws.client(resyncIds[i]);
+        if (!client) continue;
+        for (uint8_t printer = 0; printer < BAMBU_MAX_PRINTERS; printer++) {
+            if (resyncMasks[i] & (1U << printer)) sendPrinterAmsData(printer, client);
+        }
+    }
+}
+
+static void wsDispatchLoop(void *parameter) {
+    for (;;) {
+        // Geweckt bei neuen Nachrichten, sonst regelmäßig für wartende Clients, im Stream-Takt solange
+        // ein Gewichts-Stream läuft -- woken by new messages, otherwise periodically for clients that
+        // were not ready, at stream pace while a weight stream runs
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(streamCount ? WS_STREAM_TICK : WS_DISPATCH_INTERVAL));
+        if (streamCount) streamWeight();
+        dispatchQueues();
+    }
+}
+
+static void wakeDispatcher() {
+    if (wsDispatchTask) xTaskNotifyGive(wsDispatchTask);
+}
+
+// Für /metrics: Clients, wartende Nachrichten und die längste Warteschlange
+// For /metrics: clients, queued messages and the longest queue
+static void countQueues(uint32_t& clients, uint32_t& queued, uint32_t& longest) {
+    clients = queued = longest = 0;
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i <= WS_MAX_CLIENTS; i++) {
+        const WsSubscriber& sub = (i < WS_MAX_CLIENTS) ? subscribers[i] : eventsSubscriber;
+        if (sub.id == 0) continue;
+        if (i < WS_MAX_CLIENTS) clients++;
+        queued += sub.count;
+        longest = max(longest, (uint32_t)sub.count);
+    }
+    unlockQueues();
+}
+
+static uint32_t readClients(void *ctx) {
+    uint32_t clients, queued, longest;
+    countQueues(clients, queued, longest);
+    return clients;
+}
+
+static uint32_t readQueued(void *ctx) {
+    uint32_t clients, queued, longest;
+    countQueues(clients, queued, longest);
+    return queued;
+}
+
+static uint32_t readLongestQueue(void *ctx) {
+    uint32_t clients, queued, longest;
+    countQueues(clients, queued, longest);
+    return longest;
+}
+
+void wsDispatchInit() {
+    if (!wsQueueMutex) wsQueueMutex = xSemaphoreCreateMutex();
+    if (wsDispatchTask) return;
+
+    metricsGauge("filaman_ws_clients", "Connected WebSocket clients", readClients);
+    metricsGauge("filaman_ws_queued_messages", "Messages waiting in all WebSocket and /events queues", readQueued);
+    metricsGauge("filaman_ws_queue_depth_max", "Messages waiting in the longest client queue", readLongestQueue);
+    droppedMetric = metricsCounter("filaman_ws_messages_dropped_total", "Messages dropped because a client queue was full");
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        wsDispatchLoop, /* Function to implement the task */
+        "WsDispatch", /* Name of the task */
+        4096,  /* Stack size in words */
+        NULL,  /* Task input parameter */
+        wsDispatchTaskPrio,  /* Priority of the task */
+        &wsDispatchTask,  /* Task handle. */
+        wsDispatchTaskCore); /* Core where the task should run */
+
+    if (result != pdPASS) {
+        Serial.println("Fehler beim Erstellen des WsDispatch-Tasks");
+    } else {
+        metricsRegisterTask("WsDispatch", wsDispatchTask);
+    }
+}
+
+void wsAttachEventSource(AsyncEventSource *source) {
+    eventSource = source;
+    if (!lockQueues()) return;
+    if (eventsSubscriber.id == 0) {
+        memset(&eventsSubscriber, 0, sizeof(WsSubscriber));
+        eventsSubscriber.id = WS_EVENTS_ID;
+        eventsSubscriber.topics = WS_TOPICS_STATE;
+    }
+    unlockQueues();
+}
+
+bool wsClientConnected(AsyncWebSocketClient *client) {
+    bool added = false;
+    if (lockQueues()) {
+        WsSubscriber *sub = findSubscriber(0);
+        if (sub) {
+            memset(sub, 0, sizeof(WsSubscriber));
+            sub->id = client->id();
+            sub->topics = WS_TOPICS_DEFAULT;
+            added = true;
+        }
+        unlockQueues();
+    }
+
+    if (!added) {
+        LOG_W(LOG_MOD_WEB, "Zu viele WebSocket-Clients -- Too many WebSocket clients");
+        client->close();
+    }
+    return added;
+}
+
+void wsClientDisconnected(uint32_t id) {
+    if (!lockQueues()) return;
+    WsSubscriber *sub = findSubscriber(id);
+    if (sub) {
+        clearQueue(*sub);
+        if (sub->streamInterval) streamCount--;
+        sub->id = 0;
+    }
+    unlockQueues();
+}
+
+// only == 0: alle Abonnenten von topicMask, sonst nur dieser Client falls abonniert
+// only == 0: all subscribers of topicMask, otherwise just that client if subscribed
+static void collectTargets(uint8_t topicMask, uint32_t only, WsTargets& targets) {
+    targets.count = 0;
+    targets.anyJson = false;
+    targets.anyBinary = false;
+
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        const WsSubscriber& sub = subscribers[i];
+        if (sub.id == 0 || (only != 0 && sub.id != only) || !(sub.topics & topicMask)) continue;
+        targets.ids[targets.count] = sub.id;
+        targets.binary[targets.count] = sub.binary;
+        targets.count++;
+        if (sub.binary) {
+            targets.anyBinary = true;
+        } else {
+            targets.anyJson = true;
+        }
+    }
+    if (eventsSubscriber.id && only == 0 && (eventsSubscriber.topics & topicMask)) {
+        targets.ids[targets.count] = WS_EVENTS_ID;
+        targets.binary[targets.count] = false;
+        targets.count++;
+        targets.anyJson = true;
+    }
+    unlockQueues();
+}
+
+AsyncWebSocketMessageBuffer* wsMakeBuffer(size_t len) {
+    // Unter der Sperre gehalten, damit _cleanBuffers() ihn nicht vorher freigibt
+    // Retained under the lock so that _cleanBuffers() cannot free it first
+    if (!lockQueues()) return nullptr;
+    AsyncWebSocketMessageBuffer *buffer = ws.makeBuffer(len);
+    if (buffer) retainBuffer(buffer);
+    unlockQueues();
+    return buffer;
+}
+
+static AsyncWebSocketMessageBuffer* packDocument(JsonDocument& doc) {
+    size_t len = measureMsgPack(doc);
+    AsyncWebSocketMessageBuffer *packed = wsMakeBuffer(len);
+    if (packed) serializeMsgPack(doc, packed->get(), len);
+    return packed;
+}
+
+// Reiht die Puffer ein und gibt die Referenzen des Aufrufers frei
+// Queues the buffers and drops the caller's references
+static void enqueueTargets(const WsTargets& targets, AsyncWebSocketMessageBuffer *json, AsyncWebSocketMessageBuffer *packed, uint8_t key, uint8_t topic) {
+    if (!lockQueues()) return;
+    for (uint8_t i = 0; i < targets.count; i++) {
+        WsSubscriber *sub = findSubscriber(targets.ids[i]);
+        if (!sub || sub->binary != targets.binary[i]) continue;
+        AsyncWebSocketMessageBuffer *buffer = targets.binary[i] ? packed : json;
+        if (buffer) enqueue(*sub, buffer, targets.binary[i], key, topic);
+    }
+    if (json) releaseBuffer(json);
+    if (packed) releaseBuffer(packed);
+    unlockQueues();
+    wakeDispatcher();
+}
+
+static void publishBuffer(const WsTargets& targets, AsyncWebSocketMessageBuffer *buffer, uint8_t key, uint8_t topic) {
+    AsyncWebSocketMessageBuffer *packed = nullptr;
+    if (targets.anyBinary) {
+        // MessagePack aus dem fertigen JSON, einmal für alle Binär-Clients -- once for all binary clients
+        JsonDocument doc;
+        if (!deserializeJson(doc, (const char*)buffer->get(), buffer->length())) packed = packDocument(doc);
+    }
+    enqueueTargets(targets, buffer, packed, key, topic);
+}
+
+void wsPublishBuffer(WsTopic topic, AsyncWebSocketMessageBuffer *buffer, AsyncWebSocketClient *client, uint8_t key) {
+    if (!buffer) return;
+    WsTargets targets;
+    collectTargets(WS_TOPIC_BIT(topic), client ? client->id() : 0, targets);
+    publishBuffer(targets, buffer, key, topic);
+}
+
+void wsPublishText(WsTopic topic, const char* json, AsyncWebSocketClient *client, uint8_t key) {
+    if (!client && !wsHasSubscribers(topic)) return;
+    size_t len = strlen(json);
+    AsyncWebSocketMessageBuffer *buffer = wsMakeBuffer(len);
+    if (!buffer) return;
+    memcpy(buffer->get(), json, len);
+    wsPublishBuffer(topic, buffer, client, key);
+}
+
+static void publishDocument(const WsTargets& targets, JsonDocument& doc, uint8_t key, uint8_t topic) {
+    if (targets.count == 0) return;
+
+    AsyncWebSocketMessageBuffer *json = nullptr;
+    if (targets.anyJson) {
+        size_t len = measureJson(doc);
+        json = wsMakeBuffer(len);
+        if (json) serializeJson(doc, (char*)json->get(), len);
+    }
+    AsyncWebSocketMessageBuffer *packed = targets.anyBinary ? packDocument(doc) : nullptr;
+    enqueueTargets(targets, json, packed, key, topic);
+}
+
+void wsPublish(WsTopic topic, JsonDocument& doc, AsyncWebSocketClient *client, uint8_t key) {
+    WsTargets targets;
+    collectTargets(WS_TOPIC_BIT(topic), client ? client->id() : 0, targets);
+    publishDocument(targets, doc, key, topic);
+}
+
+// Unabhängig von den Themen, auch Clients ohne Abo bekommen die Antwort
+// Regardless of topics, clients without a subscription get the reply as well
+static void replyTarget(uint32_t clientId, WsTargets& targets) {
+    targets = {};
+    if (clientId == 0 || !lockQueues()) return;
+    WsSubscriber *sub = findSubscriber(clientId);
+    if (sub) {
+        targets.count = 1;
+        targets.ids[0] = sub->id;
+        targets.binary[0] = sub->binary;
+        targets.anyBinary = sub->binary;
+        targets.anyJson = !sub->binary;
+    }
+    unlockQueues();
+}
+
+void wsReply(uint32_t clientId, JsonDocument& doc) {
+    WsTargets targets;
+    replyTarget(clientId, targets);
+    publishDocument(targets, doc, WS_KEY_NONE, WS_TOPIC_SYSTEM);
+}
+
+void wsReply(AsyncWebSocketClient *client, JsonDocument& doc) {
+    wsReply(client->id(), doc);
+}
+
+void wsReplyText(AsyncWebSocketClient *client, const char* json) {
+    WsTargets targets;
+    replyTarget(client->id(), targets);
+    if (targets.count == 0) return;
+
+    size_t len = strlen(json);
+    AsyncWebSocketMessageBuffer *buffer = wsMakeBuffer(len);
+    if (!buffer) return;
+    memcpy(buffer->get(), json, len);
+    publishBuffer(targets, buffer, WS_KEY_NONE, WS_TOPIC_SYSTEM);
+}
+
+bool wsHasSubscribers(WsTopic topic) {
+    bool found = false;
+    if (!lockQueues()) return false;
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS && !found; i++) {
+        found = subscribers[i].id != 0 && (subscribers[i].topics & WS_TOPIC_BIT(topic));
+    }
+    if (eventsSubscriber.id && (eventsSubscriber.topics & WS_TOPIC_BIT(topic))) found = true;
+    unlockQueues();
+    return found;
+}
+
+uint8_t wsSubscribe(AsyncWebSocketClient *client, JsonDocument& doc) {
+    uint8_t topics = 0;
+    if (doc["topics"].is<JsonArrayConst>()) {
+        for (JsonVariantConst name : doc["topics"].as<JsonArrayConst>()) {
+            if (name == "all") topics |= WS_TOPICS_STATE;
+            for (uint8_t t = 0; t < WS_TOPIC_COUNT; t++) {
+                if (name == topicNames[t]) topics |= WS_TOPIC_BIT(t);
+            }
+        }
+    } else {
+        topics = WS_TOPICS_DEFAULT;
+    }
+    bool binary = doc["encoding"] == "msgpack";
+
+    uint8_t previous = 0;
+    bool found = false;
+    if (!lockQueues()) return 0;
+    WsSubscriber *sub = findSubscriber(client->id());
+    if (sub) {
+        previous = sub->topics;
+        sub->topics = topics;
+        if (sub->binary != binary) {
+            // Wartende Nachrichten sind in der alten Kodierung -- queued messages use the old encoding
+            clearQueue(*sub);
+            sub->binary = binary;
+        }
+        found = true;
+    }
+    unlockQueues();
+    if (!found) return 0;
+
+    // Bestätigung bereits in der neuen Kodierung -- confirmation already in the new encoding
+    JsonDocument reply;
+    reply["type"] = "subscribed";
+    JsonArray names = reply["topics"].to<JsonArray>();
+    for (uint8_t t = 0; t < WS_TOPIC_COUNT; t++) {
+        if (topics & WS_TOPIC_BIT(t)) names.add(topicNames[t]);
+    }
+    reply["encoding"] = binary ? "msgpack" : "json";
+    wsReply(client, reply);
+
+    return topics & ~previous;
+}
+
+uint8_t wsSetWeightStream(AsyncWebSocketClient *client, uint8_t rate) {
+    if (rate > WS_STREAM_RATE_MAX) rate = WS_STREAM_RATE_MAX;
+    if (!lockQueues()) return 0;
+    WsSubscriber *sub = findSubscriber(client->id());
+    if (!sub) {
+        rate = 0;
+    } else {
+        if (sub->streamInterval) streamCount--;
+        sub->streamInterval = rate ? 1000 / rate : 0;
+        sub->lastStreamAt = millis() - sub->streamInterval;
+        if (sub->streamInterval) streamCount++;
+    }
+    unlockQueues();
+    wakeDispatcher();
+    return rate;
+}
+
+uint8_t wsQueueStats(WsClientStats *out, uint8_t max, uint32_t *dropped) {
+    uint8_t count = 0;
+    if (!lockQueues()) return 0;
+    for (uint8_t i = 0; i <= WS_MAX_CLIENTS && count < max; i++) {
+        const WsSubscriber& sub = (i < WS_MAX_CLIENTS) ? subscribers[i] : eventsSubscriber;
+        if (sub.id == 0) continue;
+        out[count].id = sub.id;
+        out[count].queued = sub.count;
+        out[count].maxQueued = sub.maxCount;
+        out[count].binary = sub.binary;
+        out[count].sent = sub.sent;
+        out[count].coalesced = sub.coalesced;
+        out[count].dropped = sub.dropped;
+        out[count].streamRate = sub.streamInterval ? 1000 / sub.streamInterval : 0;
+        out[count].events = sub.id == WS_EVENTS_ID;
+        count++;
+    }
+    if (dropped) *dropped = totalDropped;
+    unlockQueues();
+    return count;
+}
@@ -0,0 +1,119 @@
+#ifndef WS_TOPICS_H
+#define WS_TOPICS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include "json_writer.h"
+
+// WebSocket-Abonnements pro Client -- per-client WebSocket subscriptions
+//
+// Ein Client wählt mit {"type":"subscribe","topics":["weight","ams"],"encoding":"msgpack"}
+// welche Themen er bekommt und ob als JSON-Text oder MessagePack-Binärframe.
+// A client picks its topics and whether it gets JSON text or MessagePack binary frames.
+// Ohne subscribe gelten alle Themen außer "weight" und "log" als JSON -- without subscribe all topics
+// except "weight" and "log" are sent as JSON, which is what the bundled pages expect.
+// Jede Nachricht wird pro Kodierung genau einmal serialisiert und der Puffer an alle
+// Abonnenten verteilt -- every message is serialized once per encoding and the buffer is shared.
+//
+// Gesendet wird nur aus dem WsDispatch-Task. Jeder Client hat eine begrenzte Warteschlange:
+// Zustandsnachrichten mit gleichem Schlüssel ersetzen die ältere, ist sie voll fliegt die älteste.
+// Only the WsDispatch task sends. Every client has a bounded queue: state messages with the
+// same key replace the older one, when it is full the oldest is dropped.
+
+typedef enum {
+    WS_TOPIC_WEIGHT,
+    WS_TOPIC_NFC,
+    WS_TOPIC_AMS,
+    WS_TOPIC_SYSTEM,
+    WS_TOPIC_UPDATE,
+    WS_TOPIC_LOG,
+    WS_TOPIC_COUNT
+} WsTopic;
+
+#define WS_TOPIC_BIT(topic)     (1U << (topic))
+#define WS_TOPICS_ALL           (WS_TOPIC_BIT(WS_TOPIC_COUNT) - 1)
+// "all" und /events meinen den Gerätezustand, Log-Zeilen nur auf ausdrücklichen Wunsch
+// "all" and /events mean device state, log lines only when asked for explicitly
+#define WS_TOPICS_STATE         (WS_TOPICS_ALL & ~WS_TOPIC_BIT(WS_TOPIC_LOG))
+#define WS_TOPICS_DEFAULT       (WS_TOPICS_STATE & ~WS_TOPIC_BIT(WS_TOPIC_WEIGHT))
+
+// Schlüssel zum Zusammenfassen, WS_KEY_NONE wird nie ersetzt -- coalescing keys, WS_KEY_NONE is never replaced
+#define WS_KEY_NONE             0x00
+#define WS_KEY_WEIGHT           0x01
+#define WS_KEY_NFC_TAG          0x02
+#define WS_KEY_NFC_DATA         0x03
+#define WS_KEY_UPDATE           0x04
+#define WS_KEY_WEIGHT_SAMPLE    0x05
+#define WS_KEY_AMS_DATA(p)      (0x10 | (p))    // Snapshot ersetzt auch wartende Deltas des Druckers
+#define WS_KEY_AMS_DELTA(p)     (0x20 | (p))    // Deltas bauen aufeinander auf, nie ersetzt
+
+#define WS_EVENTS_ID            0xFFFFFFFFUL    // Warteschlange für /events, WebSocket-IDs erreichen das nie
+
+typedef struct {
+    uint32_t id;
+    uint8_t queued;
+    uint8_t maxQueued;
+    bool binary;
+    uint32_t sent;
+    uint32_t coalesced;
+    uint32_t dropped;
+    uint8_t streamRate;
+    bool events;        // gemeinsamer Eintrag aller /events Verbindungen -- shared entry of all /events connections
+} WsClientStats;
+
+void wsDispatchInit();
+bool wsClientConnected(AsyncWebSocketClient *client);
+// Beim Verbinden eines /events Clients: alle Themen außer Gewichts-Streams gehen auch als SSE raus
+// When an /events client connects: all topics except weight streams are sent as SSE as well
+void wsAttachEventSource(AsyncEventSource *source);
+void wsClientDisconnected(uint32_t id);
+
+// Verarbeitet eine subscribe-Nachricht, liefert die neu hinzugekommenen Themen
+// Handles a subscribe message, returns the topics that were newly added
+uint8_t wsSubscribe(AsyncWebSocketClient *client, JsonDocument& doc);
+bool wsHasSubscribers(WsTopic topic);
+
+// client == nullptr verteilt an alle Abonnenten, sonst nur an diesen Client falls abonniert
+// client == nullptr fans out to all subscribers, otherwise only to that client if subscribed
+void wsPublish(WsTopic topic, JsonDocument& doc, AsyncWebSocketClient *client = nullptr, uint8_t key = WS_KEY_NONE);
+void wsPublishText(WsTopic topic, const char* json, AsyncWebSocketClient *client = nullptr, uint8_t key = WS_KEY_NONE);
+// Puffer aus wsMakeBuffer() mit fertigem JSON, wsPublishBuffer() gibt ihn wieder frei
+// Buffer from wsMakeBuffer() holding finished JSON, wsPublishBuffer() releases it again
+AsyncWebSocketMessageBuffer* wsMakeBuffer(size_t len);
+void wsPublishBuffer(WsTopic topic, AsyncWebSocketMessageBuffer *buffer, AsyncWebSocketClient *client = nullptr, uint8_t key = WS_KEY_NONE);
+
+// build(JsonWriter&) läuft zweimal: erst zählt es die Länge, dann schreibt es direkt in den Puffer
+// build(JsonWriter&) runs twice: first it counts the length, then it writes straight into the buffer
+template <typename Build>
+void wsPublishJson(WsTopic topic, Build build, AsyncWebSocketClient *client = nullptr, uint8_t key = WS_KEY_NONE) {
+    if (!client && !wsHasSubscribers(topic)) return;
+    JsonWriter counter(nullptr, 0);
+    build(counter);
+
+    AsyncWebSocketMessageBuffer *buffer = wsMakeBuffer(counter.length());
+    if (!buffer) return;
+    // makeBuffer() legt ein Byte mehr für '\0' an -- makeBuffer() allocates one more byte for '\0'
+    JsonWriter json((char*)buffer->get(), counter.length() + 1);
+    build(json);
+    wsPublishBuffer(topic, buffer, client, key);
+}
+
+// Gewichts-Stream mit rate Messwerten pro Sekunde, 0 beendet ihn; liefert die gültige Rate
+// Weight stream with rate samples per second, 0 stops it; returns the rate in effect
+uint8_t wsSetWeightStream(AsyncWebSocketClient *client, uint8_t rate);
+
+// Antwort an genau einen Client in dessen Kodierung, unabhängig von Themen
+// Reply to exactly one client in its encoding, regardless of topics
+void wsReply(AsyncWebSocketClient *client, JsonDocument& doc);
+// Über die ID, für Antworten aus anderen Tasks, wenn der Client inzwischen weg sein kann
+// By id, for replies from other tasks when the client may be gone by now
+void wsReply(uint32_t clientId, JsonDocument& doc);
+// Fertiges JSON, etwa aus einem JsonWriter; Binär-Clients bekommen es als MessagePack
+// Finished JSON, e.g. from a JsonWriter; binary clients get it as MessagePack
+void wsReplyText(AsyncWebSocketClient *client, const char* json);
+
+// Warteschlangen-Zähler, liefert die Anzahl der Einträge -- queue counters, returns the number of entries
+uint8_t wsQueueStats(WsClientStats *out, uint8_t max, uint32_t *totalDropped);
+
+#endif
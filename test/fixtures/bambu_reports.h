@@ -0,0 +1,50 @@
+// push_status-Berichte im Format eines P1S/X1C mit AMS, gekürzt auf typische Längen
+// push_status reports in the layout a P1S/X1C with AMS sends, trimmed to typical sizes
+//
+// Synthetisch, keine Mitschnitte: von Hand nach dem Feldaufbau echter Berichte geschrieben.
+// Werte wie Seriennummer, tag_uid und tray_uuid sind erfunden, damit keine Gerätedaten im
+// Repository landen; die Feldreihenfolge, Strings statt Zahlen ("remain" als Zahl, "tray_now"
+// als String), leere Slots als {"id":"3"} und die escapten Zeichen in subtask_name entsprechen
+// dem, worauf der Parser reagieren muss.
+// Synthetic, not captured: hand-written after the field layout of real reports. Values like
+// the serial, tag_uid and tray_uuid are made up so no device data ends up in the repository;
+// field order, numbers sent as strings ("remain" as a number, "tray_now" as a string), empty
+// slots as {"id":"3"} and the escaped characters in subtask_name match what the parser must handle.
+// Ein echter Mitschnitt lässt sich mit scripts/bambu_simulator.py --replay abspielen, gehört
+// aber nur anonymisiert hierher -- a real capture can be replayed with
+// scripts/bambu_simulator.py --replay, but only belongs here once anonymized.
+#ifndef BAMBU_REPORTS_H
+#define BAMBU_REPORTS_H
+
+// Voller Bericht (msg 0): ein AMS mit drei belegten und einem leeren Slot, dazu vt_tray
+// Full report (msg 0): one AMS with three loaded and one empty slot, plus vt_tray
+static const char reportFull[] = R"json({"print":{"ams":{"ams":[{"humidity":"4","id":"0","temp":"0.0","tray":[
+{"bed_temp":"0","bed_temp_type":"0","cali_idx":-1,"cols":["F4EE2AFF"],"ctype":0,"drying_temp":"0","drying_time":"0","id":"0","nozzle_temp_max":"230","nozzle_temp_min":"190","remain":85,"state":11,"tag_uid":"5A3F1C0B00000100","total_len":330000,"tray_color":"F4EE2AFF","tray_diameter":"1.75","tray_id_name":"A00-Y2","tray_info_idx":"GFA00","tray_sub_brands":"PLA Basic","tray_temp":"55","tray_time":"8","tray_type":"PLA","tray_uuid":"0D7B5C4F1B2E4C6A9A8E3F2D1C0B0A09","tray_weight":"1000","xcam_info":"AC0D00008C0A0000000080400"},
+{"bed_temp":"0","bed_temp_type":"0","cali_idx":3,"cols":["000000FF"],"ctype":0,"drying_temp":"0","drying_time":"0","id":"1","nozzle_temp_max":"270","nozzle_temp_min":"240","remain":42,"state":11,"tag_uid":"0000000000000000","total_len":330000,"tray_color":"000000FF","tray_diameter":"1.75","tray_id_name":"","tray_info_idx":"GFG99","tray_sub_brands":"","tray_temp":"0","tray_time":"0","tray_type":"PETG","tray_uuid":"00000000000000000000000000000000","tray_weight":"0","xcam_info":"000000000000000000000000","setting_id":"PFUS9ac902733670a9"},
+{"bed_temp":"0","bed_temp_type":"0","cali_idx":-1,"cols":["FFFFFFFF"],"ctype":0,"drying_temp":"0","drying_time":"0","id":"2","nozzle_temp_max":"240","nozzle_temp_min":"190","remain":-1,"state":3,"tag_uid":"0000000000000000","total_len":330000,"tray_color":"FFFFFFFF","tray_diameter":"1.75","tray_id_name":"","tray_info_idx":"GFL03","tray_sub_brands":"","tray_temp":"0","tray_time":"0","tray_type":"PLA","tray_uuid":"00000000000000000000000000000000","tray_weight":"0","xcam_info":"000000000000000000000000"},
+{"id":"3","state":0}]}],
+"ams_exist_bits":"1","insert_flag":true,"power_on_flag":false,"tray_exist_bits":"7","tray_is_bbl_bits":"1","tray_now":"1","tray_pre":"1","tray_read_done_bits":"7","tray_reading_bits":"0","tray_tar":"1","version":4187},
+"ams_rfid_status":6,"ams_status":768,"bed_target_temper":70.0,"bed_temper":69.9,"big_fan1_speed":"0","big_fan2_speed":"0","chamber_temper":32.0,"command":"push_status","cooling_fan_speed":"15","fail_reason":"0","fan_gear":11,"filam_bak":[],"force_upgrade":false,"gcode_file":"/data/Metadata/plate_1.gcode","gcode_file_prepare_percent":"100","gcode_start_time":"1729342110","gcode_state":"RUNNING","heatbreak_fan_speed":"15",
+"hms":[{"attr":50335744,"code":131073}],"home_flag":-1031295272,"hw_switch_state":1,"ipcam":{"ipcam_dev":"1","ipcam_record":"enable","mode_bits":3,"resolution":"1080p","rtsp_url":"disable","timelapse":"disable","tutk_server":"disable"},"layer_num":57,"lifecycle":"product","lights_report":[{"mode":"on","node":"chamber_light"}],"maintain":3,"mc_percent":37,"mc_print_line_number":"46022","mc_print_stage":"2","mc_print_sub_stage":0,"mc_remaining_time":52,"mess_production_state":"active","msg":0,"nozzle_diameter":"0.4","nozzle_target_temper":255.0,"nozzle_temper":254.8,"nozzle_type":"stainless_steel","online":{"ahb":false,"rfid":false,"version":1538433026},"print_error":0,"print_gcode_action":0,"print_real_action":0,"print_type":"local","profile_id":"","project_id":"0","queue_number":0,"sdcard":true,"sequence_id":"2021","spd_lvl":2,"spd_mag":100,"stg":[2,14,1],"stg_cur":0,"subtask_id":"0","subtask_name":"Halterung Überhänge \"final\"","task_id":"0",
+"upgrade_state":{"ahb_new_version_number":"","ams_new_version_number":"","consistency_request":false,"dis_state":0,"err_code":0,"ext_new_version_number":"","force_upgrade":false,"idx":7,"message":"0%, 0B/s","module":"","new_version_state":2,"ota_new_version_number":"","progress":"0","sequence_id":0,"sn":"01P00A123456789","status":"IDLE"},
+"upload":{"file_size":0,"finish_size":0,"message":"Good","oss_url":"","progress":0,"sequence_id":"0903","speed":0,"status":"idle","task_id":"","time_remaining":0,"trouble_id":""},
+"vt_tray":{"bed_temp":"0","bed_temp_type":"0","cali_idx":-1,"id":"254","k":0.019999999552965164,"n":1.0,"nozzle_temp_max":"240","nozzle_temp_min":"190","remain":0,"tag_uid":"0000000000000000","tray_color":"FF8000FF","tray_diameter":"0.00","tray_id_name":"","tray_info_idx":"GFL99","tray_sub_brands":"","tray_temp":"0","tray_time":"0","tray_type":"PLA","tray_uuid":"00000000000000000000000000000000","tray_weight":"0","xcam_info":"000000000000000000000000"},
+"wifi_signal":"-52dBm","xcam":{"allow_skip_parts":false,"buildplate_marker_detector":true,"first_layer_inspector":true,"halt_print_sensitivity":"medium","print_halt":true,"printing_monitor":true,"spaghetti_detector":true},"xcam_status":"0"}})json";
+
+// Teilbericht (msg 1) nach dem Verbrauch an Slot 2: nur geänderte Felder, die Tray-ID steht im Objekt
+// Partial report (msg 1) after usage on slot 2: changed fields only, the tray id is inside the object
+static const char reportPartialRemain[] = R"json({"print":{"ams":{"ams":[{"id":"0","tray":[{"id":"2","remain":63}]}],"tray_now":"2","version":4188},"command":"push_status","msg":1,"sequence_id":"2043"}})json";
+
+// Teilbericht ohne AMS-Daten, kommt etwa jede Sekunde -- partial report without AMS data, arrives about every second
+static const char reportPartialProgress[] = R"json({"print":{"bed_temper":70.0,"command":"push_status","layer_num":58,"mc_percent":38,"mc_remaining_time":51,"msg":1,"nozzle_temper":255.1,"sequence_id":"2044","wifi_signal":"-53dBm"}})json";
+
+// Zwei AMS-Einheiten (X1C), die zweite mit ID 1 -- two AMS units (X1C), the second with id 1
+static const char reportTwoAms[] = R"json({"print":{"ams":{"ams":[
+{"humidity":"5","id":"0","temp":"24.1","tray":[{"id":"0","nozzle_temp_max":"230","nozzle_temp_min":"190","remain":100,"tray_color":"0A2989FF","tray_info_idx":"GFA01","tray_sub_brands":"PLA Matte","tray_type":"PLA"},{"id":"1"},{"id":"2"},{"id":"3"}]},
+{"humidity":"3","id":"1","temp":"23.8","tray":[{"id":"0"},{"id":"1","nozzle_temp_max":"280","nozzle_temp_min":"260","remain":17,"tray_color":"898989FF","tray_info_idx":"GFB00","tray_sub_brands":"","tray_type":"ABS","setting_id":"GFSB00"},{"id":"2"},{"id":"3"}]}],
+"ams_exist_bits":"3","tray_exist_bits":"21","tray_now":"5"},"command":"push_status","gcode_state":"PAUSE","msg":0,"sequence_id":"77"}})json";
+
+// Antwort auf ams_filament_setting -- reply to ams_filament_setting
+static const char reportFilamentSetting[] = R"json({"print":{"ams_id":0,"command":"ams_filament_setting","nozzle_temp_max":240,"nozzle_temp_min":190,"reason":"success","result":"success","sequence_id":"12","setting_id":"GFSL99","tray_color":"FF8000FF","tray_id":2,"tray_info_idx":"GFL99","tray_type":"PLA"}})json";
+
+#endif
@@ -0,0 +1,24 @@
+// Host-Ersatz für die Teile von Arduino.h, die die plattformunabhängigen Module brauchen
+// Host stand-in for the parts of Arduino.h the platform independent modules need
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+// Von den Tests gestellte Uhr -- clock driven by the tests
+inline unsigned long& hostMillis() {
+    static unsigned long now = 0;
+    return now;
+}
+
+inline unsigned long millis() {
+    return hostMillis();
+}
+
+#endif
@@ -0,0 +1,18 @@
+// Host-Ersatz für die Arduino Client-Schnittstelle -- host stand-in for the Arduino Client interface
+#ifndef HOST_CLIENT_H
+#define HOST_CLIENT_H
+
+#include <Arduino.h>
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual uint8_t connected() = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    virtual void stop() = 0;
+};
+
+#endif
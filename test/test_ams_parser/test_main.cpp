@@ -0,0 +1,249 @@
+// AmsReportParser mit Druckerberichten, ganz und an zufälligen Stellen zerteilt
+// AmsReportParser with printer reports, whole and split at random points
+//
+//   pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "ams_parser.h"
+#include "../fixtures/bambu_reports.h"
+
+static std::vector<AmsTrayReport> trays;
+
+void setUp() {}
+void tearDown() {}
+
+static void collectTray(const AmsTrayReport& tray, void* ctx) {
+    trays.push_back(tray);
+}
+
+// Ein Tray als Text, um Durchläufe vergleichen zu können -- one tray as text to compare runs
+static std::string describe(const AmsTrayReport& tray) {
+    char head[48];
+    snprintf(head, sizeof(head), "%u/%d/%u/%04x", tray.amsIndex, tray.amsId, tray.trayIndex, tray.present);
+    std::string out = head;
+    for (int f = 0; f < AMS_FIELD_COUNT; f++) {
+        out += '|';
+        out += tray.values[f];
+    }
+    return out;
+}
+
+static std::vector<std::string> describeAll() {
+    std::vector<std::string> out;
+    for (const AmsTrayReport& tray : trays) out.push_back(describe(tray));
+    return out;
+}
+
+// Feste Stückgrößen: 0 = alles auf einmal -- fixed chunk sizes: 0 = everything at once
+static bool parse(AmsReportParser& parser, const char* report, size_t chunk) {
+    size_t len = strlen(report);
+    trays.clear();
+    parser.begin();
+    if (chunk == 0) chunk = len;
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        parser.feed((const uint8_t*)report + pos, std::min(chunk, len - pos));
+    }
+    return parser.finish();
+}
+
+static bool parseRandom(AmsReportParser& parser, const char* report, unsigned seed) {
+    size_t len = strlen(report);
+    trays.clear();
+    parser.begin();
+    srand(seed);
+    for (size_t pos = 0; pos < len;) {
+        // Meist kleine Stücke wie aus dem TLS-Puffer, ab und zu einzelne Bytes oder große Blöcke
+        // Mostly small chunks as from the TLS buffer, now and then single bytes or large blocks
+        size_t n;
+        switch (rand() % 4) {
+            case 0: n = 1; break;
+            case 1: n = 1 + rand() % 16; break;
+            case 2: n = 1 + rand() % 256; break;
+            default: n = 1 + rand() % 2048; break;
+        }
+        n = std::min(n, len - pos);
+        parser.feed((const uint8_t*)report + pos, n);
+        pos += n;
+    }
+    return parser.finish();
+}
+
+static void assertSplitsMatch(const char* report) {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+
+    TEST_ASSERT_TRUE(parse(parser, report, 0));
+    std::vector<std::string> expected = describeAll();
+
+    for (size_t chunk = 1; chunk <= 64; chunk++) {
+        TEST_ASSERT_TRUE(parse(parser, report, chunk));
+        TEST_ASSERT_TRUE(describeAll() == expected);
+    }
+    for (unsigned seed = 1; seed <= 500; seed++) {
+        TEST_ASSERT_TRUE(parseRandom(parser, report, seed));
+        TEST_ASSERT_TRUE(describeAll() == expected);
+    }
+}
+
+void test_full_report() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    TEST_ASSERT_TRUE(parse(parser, reportFull, 0));
+
+    TEST_ASSERT_EQUAL(5, trays.size());
+    TEST_ASSERT_TRUE(parser.hasAmsList());
+    TEST_ASSERT_EQUAL(1, parser.amsCount());
+    TEST_ASSERT_TRUE(parser.hasUpgradeState());
+    TEST_ASSERT_EQUAL_STRING("push_status", parser.printField(AMS_PRINT_COMMAND));
+    TEST_ASSERT_EQUAL_STRING("0", parser.printField(AMS_PRINT_MSG));
+    TEST_ASSERT_EQUAL_STRING("RUNNING", parser.printField(AMS_PRINT_GCODE_STATE));
+    TEST_ASSERT_EQUAL_STRING("1", parser.statusField(AMS_STATUS_TRAY_NOW));
+    TEST_ASSERT_EQUAL_STRING("1", parser.statusField(AMS_STATUS_EXIST_BITS));
+
+    const AmsTrayReport& first = trays[0];
+    TEST_ASSERT_EQUAL(0, first.amsIndex);
+    TEST_ASSERT_EQUAL(0, first.amsId);
+    TEST_ASSERT_EQUAL(0, first.trayIndex);
+    TEST_ASSERT_EQUAL_STRING("GFA00", first.get(AMS_FIELD_TRAY_INFO_IDX));
+    TEST_ASSERT_EQUAL_STRING("PLA", first.get(AMS_FIELD_TRAY_TYPE));
+    TEST_ASSERT_EQUAL_STRING("PLA Basic", first.get(AMS_FIELD_TRAY_SUB_BRANDS));
+    TEST_ASSERT_EQUAL_STRING("F4EE2AFF", first.get(AMS_FIELD_TRAY_COLOR));
+    TEST_ASSERT_EQUAL_STRING("190", first.get(AMS_FIELD_NOZZLE_TEMP_MIN));
+    TEST_ASSERT_EQUAL_STRING("230", first.get(AMS_FIELD_NOZZLE_TEMP_MAX));
+    TEST_ASSERT_EQUAL_STRING("-1", first.get(AMS_FIELD_CALI_IDX));
+    TEST_ASSERT_EQUAL_STRING("85", first.get(AMS_FIELD_REMAIN));
+    TEST_ASSERT_FALSE(first.has(AMS_FIELD_SETTING_ID));
+
+    TEST_ASSERT_EQUAL_STRING("PFUS9ac902733670a9", trays[1].get(AMS_FIELD_SETTING_ID));
+    TEST_ASSERT_EQUAL_STRING("3", trays[1].get(AMS_FIELD_CALI_IDX));
+    TEST_ASSERT_EQUAL_STRING("-1", trays[2].get(AMS_FIELD_REMAIN));
+
+    // Leerer Slot: nur die ID -- empty slot: only the id
+    TEST_ASSERT_EQUAL(3, trays[3].trayIndex);
+    TEST_ASSERT_EQUAL(1U << AMS_FIELD_ID, trays[3].present);
+
+    const AmsTrayReport& vt = trays[4];
+    TEST_ASSERT_EQUAL(AMS_PARSER_VT_INDEX, vt.amsIndex);
+    TEST_ASSERT_EQUAL_STRING("254", vt.get(AMS_FIELD_ID));
+    TEST_ASSERT_EQUAL_STRING("FF8000FF", vt.get(AMS_FIELD_TRAY_COLOR));
+}
+
+void test_partial_remain_report() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    TEST_ASSERT_TRUE(parse(parser, reportPartialRemain, 0));
+
+    TEST_ASSERT_EQUAL(1, trays.size());
+    TEST_ASSERT_EQUAL_STRING("1", parser.printField(AMS_PRINT_MSG));
+    TEST_ASSERT_FALSE(parser.hasPrintField(AMS_PRINT_GCODE_STATE));
+    TEST_ASSERT_FALSE(parser.hasUpgradeState());
+    TEST_ASSERT_EQUAL_STRING("2", parser.statusField(AMS_STATUS_TRAY_NOW));
+    TEST_ASSERT_FALSE(parser.hasStatusField(AMS_STATUS_EXIST_BITS));
+
+    // Position 0 im Array, die Tray-ID steht im Feld -- position 0 in the array, the tray id is in the field
+    TEST_ASSERT_EQUAL(0, trays[0].trayIndex);
+    TEST_ASSERT_EQUAL_STRING("2", trays[0].get(AMS_FIELD_ID));
+    TEST_ASSERT_EQUAL_STRING("63", trays[0].get(AMS_FIELD_REMAIN));
+    TEST_ASSERT_EQUAL((1U << AMS_FIELD_ID) | (1U << AMS_FIELD_REMAIN), trays[0].present);
+}
+
+void test_partial_progress_report() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    TEST_ASSERT_TRUE(parse(parser, reportPartialProgress, 0));
+
+    TEST_ASSERT_EQUAL(0, trays.size());
+    TEST_ASSERT_FALSE(parser.hasAmsList());
+    TEST_ASSERT_EQUAL_STRING("1", parser.printField(AMS_PRINT_MSG));
+}
+
+void test_two_ams_units() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    TEST_ASSERT_TRUE(parse(parser, reportTwoAms, 0));
+
+    TEST_ASSERT_EQUAL(8, trays.size());
+    TEST_ASSERT_EQUAL(2, parser.amsCount());
+    TEST_ASSERT_EQUAL(1, trays[5].amsIndex);
+    TEST_ASSERT_EQUAL(1, trays[5].amsId);
+    TEST_ASSERT_EQUAL(1, trays[5].trayIndex);
+    TEST_ASSERT_EQUAL_STRING("GFB00", trays[5].get(AMS_FIELD_TRAY_INFO_IDX));
+    TEST_ASSERT_EQUAL_STRING("GFSB00", trays[5].get(AMS_FIELD_SETTING_ID));
+    TEST_ASSERT_EQUAL_STRING("PAUSE", parser.printField(AMS_PRINT_GCODE_STATE));
+}
+
+void test_filament_setting_reply() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    TEST_ASSERT_TRUE(parse(parser, reportFilamentSetting, 0));
+
+    TEST_ASSERT_EQUAL(0, trays.size());
+    TEST_ASSERT_EQUAL_STRING("ams_filament_setting", parser.printField(AMS_PRINT_COMMAND));
+    TEST_ASSERT_EQUAL_STRING("0", parser.printField(AMS_PRINT_AMS_ID));
+    TEST_ASSERT_EQUAL_STRING("2", parser.printField(AMS_PRINT_TRAY_ID));
+    TEST_ASSERT_EQUAL_STRING("GFSL99", parser.printField(AMS_PRINT_SETTING_ID));
+}
+
+void test_random_chunk_boundaries() {
+    assertSplitsMatch(reportFull);
+    assertSplitsMatch(reportPartialRemain);
+    assertSplitsMatch(reportPartialProgress);
+    assertSplitsMatch(reportTwoAms);
+    assertSplitsMatch(reportFilamentSetting);
+}
+
+void test_escapes_and_long_values() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+    const char* report = "{\"print\":{\"vt_tray\":{\"tray_sub_brands\":\"Caf\\u00e9 \\\"Rot\\\"\","
+                         "\"tray_type\":\"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\",\"remain\":null}}}";
+    TEST_ASSERT_TRUE(parse(parser, report, 0));
+    TEST_ASSERT_EQUAL(1, trays.size());
+    TEST_ASSERT_EQUAL_STRING("Caf\xc3\xa9 \"Rot\"", trays[0].get(AMS_FIELD_TRAY_SUB_BRANDS));
+    // Auf AMS_PARSER_VALUE_LEN gekürzt -- truncated to AMS_PARSER_VALUE_LEN
+    TEST_ASSERT_EQUAL(AMS_PARSER_VALUE_LEN - 1, strlen(trays[0].get(AMS_FIELD_TRAY_TYPE)));
+    TEST_ASSERT_TRUE(trays[0].has(AMS_FIELD_REMAIN));
+    TEST_ASSERT_EQUAL_STRING("", trays[0].get(AMS_FIELD_REMAIN));
+}
+
+void test_broken_reports() {
+    AmsReportParser parser;
+    parser.setTrayCallback(collectTray, nullptr);
+
+    // Abgeschnittener Bericht, etwa nach einem Verbindungsabbruch -- truncated report, e.g. after a lost connection
+    std::string truncated(reportFull, sizeof(reportFull) / 2);
+    TEST_ASSERT_FALSE(parse(parser, truncated.c_str(), 0));
+
+    TEST_ASSERT_FALSE(parse(parser, "{\"print\":{\"msg\":0,}}", 0));
+    TEST_ASSERT_FALSE(parse(parser, "{\"print\":{\"msg\" 0}}", 0));
+    TEST_ASSERT_FALSE(parse(parser, "{\"print\":{}}}", 0));
+
+    // Zu tief verschachtelt -- nested too deeply
+    std::string deep;
+    for (int i = 0; i < AMS_PARSER_MAX_DEPTH + 1; i++) deep += "[";
+    for (int i = 0; i < AMS_PARSER_MAX_DEPTH + 1; i++) deep += "]";
+    TEST_ASSERT_FALSE(parse(parser, deep.c_str(), 0));
+
+    // Danach wieder ein gültiger Bericht -- a valid report afterwards
+    TEST_ASSERT_TRUE(parse(parser, reportPartialRemain, 0));
+    TEST_ASSERT_EQUAL(1, trays.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_report);
+    RUN_TEST(test_partial_remain_report);
+    RUN_TEST(test_partial_progress_report);
+    RUN_TEST(test_two_ams_units);
+    RUN_TEST(test_filament_setting_reply);
+    RUN_TEST(test_random_chunk_boundaries);
+    RUN_TEST(test_escapes_and_long_values);
+    RUN_TEST(test_broken_reports);
+    return UNITY_END();
+}
@@ -0,0 +1,418 @@
+// Spielt den push_status-Strom von scripts/bambu_simulator.py über MqttStreamClient,
+// AmsReportParser und applyTrayReport() ab und misst Durchsatz, Latenz pro Bericht und Heap.
+// Replays the push_status stream of scripts/bambu_simulator.py through MqttStreamClient,
+// AmsReportParser and applyTrayReport() and measures throughput, per-report latency and heap.
+//
+//   pio test -e native -f test_bambu_replay -v    (-v zeigt die Messwerte -- -v shows the numbers)
+//
+// Den Strom erzeugt scripts/build_bambu_stream.py als pre:-Skript, ohne PlatformIO vorher
+// python scripts/build_bambu_stream.py aufrufen -- the stream is generated by
+// scripts/build_bambu_stream.py as a pre: script, without PlatformIO run it by hand first.
+//
+// Nicht enthalten: TLS, Sperren, WebSocket-Deltas und Auto-Set aus bambu.cpp; die Zuordnung
+// der Trays und die AMS-Anzahl unten folgen mqtt_tray_callback() und mqtt_message_end().
+// Not included: TLS, locking, WebSocket deltas and auto-set from bambu.cpp; the tray mapping
+// and AMS count below follow mqtt_tray_callback() and mqtt_message_end().
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+#include "mqtt_stream.h"
+#include "ams_parser.h"
+#include "ams_tray.h"
+
+#define STREAM_FILE     "test/fixtures/bambu_stream.jsonl"
+#define REPORT_TOPIC    "device/SIM00000001/report"
+#define REPLAY_PASSES   10
+#define REPLAY_UNITS    16      // MAX_AMS - 1 auf dem Gerät -- MAX_AMS - 1 on the device
+#define RECORD_SIZE     1460    // größtes Stück pro available(), wie ein TCP-Segment -- largest piece per available(), like a TCP segment
+
+// Heap-Zähler für operator new, nur während der Messung aktiv -- heap counter for operator new, only active while measuring
+static std::atomic<bool> trackHeap(false);
+static size_t heapCurrent = 0;
+static size_t heapPeak = 0;
+static size_t heapAllocs = 0;
+
+void* operator new(size_t size) {
+    // Größe vor dem Block merken, damit delete sie abziehen kann -- keep the size in front of the block for delete
+    size_t* block = (size_t*)malloc(size + sizeof(max_align_t));
+    if (!block) throw std::bad_alloc();
+    *block = size;
+    if (trackHeap) {
+        heapCurrent += size;
+        heapAllocs++;
+        heapPeak = std::max(heapPeak, heapCurrent);
+    }
+    return (char*)block + sizeof(max_align_t);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    size_t* block = (size_t*)((char*)ptr - sizeof(max_align_t));
+    if (trackHeap && heapCurrent >= *block) heapCurrent -= *block;
+    free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// Liefert nur die Bytes bis limit, und davon höchstens RECORD_SIZE am Stück
+// Reveals only the bytes up to limit, at most RECORD_SIZE of them at a time
+class ReplayClient : public Client {
+public:
+    std::vector<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    size_t rxPos = 0;
+    size_t limit = 0;
+    bool open = true;
+
+    uint8_t connected() override { return open; }
+    int available() override {
+        if (!open || rxPos >= limit) return 0;
+        return (int)std::min((size_t)RECORD_SIZE, limit - rxPos);
+    }
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t* buf, size_t size) override {
+        size_t n = std::min(size, (size_t)available());
+        memcpy(buf, rx.data() + rxPos, n);
+        rxPos += n;
+        return (int)n;
+    }
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!open) return 0;
+        tx.insert(tx.end(), buf, buf + size);
+        return size;
+    }
+    void stop() override { open = false; }
+};
+
+// Zustand eines Druckers wie BambuPrinter, mit festem Platz statt realloc
+// State of one printer like BambuPrinter, with fixed storage instead of realloc
+struct ReplayPrinter {
+    AmsReportParser parser;
+    TrayData trays[REPLAY_UNITS][4];
+    int amsCount;
+    int capacity;
+    bool hasExternal;
+    TrayData external;
+    uint8_t trayNow;
+
+    // Zustand des laufenden Berichts -- state of the report in progress
+    int prevAmsCount;
+    int maxUnit;
+    bool vtStaged;
+    AmsTrayReport vtReport;
+    bool fullReport;
+    uint32_t reports;
+    uint32_t parseErrors;
+};
+
+static void ensureCapacity(ReplayPrinter& printer, int count) {
+    for (int i = printer.capacity; i < count && i < REPLAY_UNITS; i++) {
+        for (int j = 0; j < 4; j++) clearTray(printer.trays[i][j], j);
+    }
+    printer.capacity = std::max(printer.capacity, std::min(count, REPLAY_UNITS));
+}
+
+static void onTray(const AmsTrayReport& tray, void* ctx) {
+    ReplayPrinter& printer = *(ReplayPrinter*)ctx;
+    if (tray.amsIndex == AMS_PARSER_VT_INDEX) {
+        printer.vtReport = tray;
+        printer.vtStaged = true;
+        return;
+    }
+
+    int unit = (tray.amsId >= 0) ? tray.amsId : tray.amsIndex;
+    int trayId = tray.has(AMS_FIELD_ID) ? atoi(tray.get(AMS_FIELD_ID)) : tray.trayIndex;
+    if (unit >= REPLAY_UNITS || trayId < 0 || trayId >= 4) return;
+
+    ensureCapacity(printer, unit + 1);
+    if (unit + 1 > printer.maxUnit) printer.maxUnit = unit + 1;
+    bool loaded;
+    applyTrayReport(printer.trays[unit][trayId], tray, trayId, false, loaded);
+}
+
+static void beginReport(ReplayPrinter& printer) {
+    printer.prevAmsCount = printer.amsCount;
+    printer.maxUnit = 0;
+    printer.vtStaged = false;
+    printer.fullReport = false;
+    printer.parser.begin();
+}
+
+static int reportedAmsCount(const ReplayPrinter& printer) {
+    const AmsReportParser& parser = printer.parser;
+    if (parser.hasStatusField(AMS_STATUS_EXIST_BITS)) {
+        unsigned long bits = strtoul(parser.statusField(AMS_STATUS_EXIST_BITS), nullptr, 16);
+        int count = 0;
+        while (bits) {
+            count++;
+            bits >>= 1;
+        }
+        return count;
+    }
+    if (printer.fullReport) return parser.amsCount();
+    return std::max(printer.prevAmsCount, printer.maxUnit);
+}
+
+static void endReport(ReplayPrinter& printer) {
+    AmsReportParser& parser = printer.parser;
+    bool parsed = parser.finish();
+    printer.reports++;
+    if (!parsed) printer.parseErrors++;
+
+    printer.fullReport = parsed && parser.hasAmsList() &&
+                         (!parser.hasPrintField(AMS_PRINT_MSG) || strcmp(parser.printField(AMS_PRINT_MSG), "0") == 0);
+
+    if (parsed && (parser.hasAmsList() || parser.hasStatusField(AMS_STATUS_EXIST_BITS) || printer.vtStaged)) {
+        int count = std::min(reportedAmsCount(printer), REPLAY_UNITS);
+        ensureCapacity(printer, count);
+        for (int i = count; i < printer.prevAmsCount; i++) {
+            for (int j = 0; j < 4; j++) clearTray(printer.trays[i][j], j);
+        }
+        printer.amsCount = count;
+
+        bool hadExternal = printer.hasExternal;
+        bool external = printer.vtStaged || (hadExternal && !printer.fullReport);
+        if (printer.vtStaged) {
+            if (!hadExternal) clearTray(printer.external, 254);
+            bool loaded;
+            applyTrayReport(printer.external, printer.vtReport, 254, true, loaded);
+        }
+        printer.hasExternal = external;
+    }
+
+    if (parser.hasStatusField(AMS_STATUS_TRAY_NOW)) printer.trayNow = (uint8_t)atoi(parser.statusField(AMS_STATUS_TRAY_NOW));
+}
+
+static void resetPrinter(ReplayPrinter& printer) {
+    printer.amsCount = 0;
+    printer.capacity = 0;
+    printer.hasExternal = false;
+    clearTray(printer.external, 254);
+    printer.trayNow = 255;
+    printer.reports = 0;
+    printer.parseErrors = 0;
+    printer.parser.setTrayCallback(onTray, &printer);
+}
+
+static void onBegin(const char* topic, uint32_t length, void* ctx) { beginReport(*(ReplayPrinter*)ctx); }
+static void onData(const uint8_t* data, size_t len, void* ctx) { ((ReplayPrinter*)ctx)->parser.feed(data, len); }
+static void onEnd(void* ctx) { endReport(*(ReplayPrinter*)ctx); }
+
+static std::vector<std::string> payloads;
+static ReplayPrinter printer;
+static ReplayPrinter fresh;
+
+void setUp() {
+    hostMillis() = 1000;
+    resetPrinter(printer);
+}
+
+void tearDown() {}
+
+// Zeilen {"t": ..., "payload": {...}} aus --dump/--replay, der Payload bleibt Byte für Byte erhalten
+// Lines {"t": ..., "payload": {...}} from --dump/--replay, the payload is kept byte for byte
+static bool loadStream() {
+    std::ifstream file(STREAM_FILE);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t key = line.find("\"payload\":");
+        size_t end = line.find_last_of('}');
+        if (key == std::string::npos || end == std::string::npos || end <= key) continue;
+        size_t start = line.find('{', key);
+        payloads.push_back(line.substr(start, end - start));
+    }
+    return !payloads.empty();
+}
+
+static void putLength(std::vector<uint8_t>& out, uint32_t len) {
+    do {
+        uint8_t digit = len % 128;
+        len /= 128;
+        if (len > 0) digit |= 0x80;
+        out.push_back(digit);
+    } while (len > 0);
+}
+
+// PUBLISH QoS 0 wie vom Broker, liefert das Ende des Pakets -- QoS 0 PUBLISH as sent by the broker, returns the end of the packet
+static size_t appendPublish(std::vector<uint8_t>& out, const char* topic, const std::string& payload) {
+    size_t topicLen = strlen(topic);
+    out.push_back(0x30);
+    putLength(out, 2 + topicLen + payload.size());
+    out.push_back((uint8_t)(topicLen >> 8));
+    out.push_back((uint8_t)topicLen);
+    out.insert(out.end(), topic, topic + topicLen);
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out.size();
+}
+
+// Verbunden und mit allen Paketen im Empfangspuffer; ends[i] = Ende von Bericht i
+// Connected and with all packets in the receive buffer; ends[i] = end of report i
+static void connect(MqttStreamClient& mqtt, ReplayClient& client, std::vector<size_t>& ends) {
+    mqtt.setCallbacks(onBegin, onData, onEnd, &printer);
+    TEST_ASSERT_TRUE(mqtt.startSession("filaman", "bblp", "12345678"));
+    client.rx = { 0x20, 0x02, 0x00, 0x00 };
+    client.limit = client.rx.size();
+    TEST_ASSERT_EQUAL(1, mqtt.pollSession());
+
+    for (const std::string& payload : payloads) ends.push_back(appendPublish(client.rx, REPORT_TOPIC, payload));
+}
+
+// Bericht i freigeben und loop() bis er ausgewertet ist -- release report i and loop() until it has been applied
+static void deliver(MqttStreamClient& mqtt, ReplayClient& client, size_t end, uint32_t expected) {
+    client.limit = end;
+    for (int i = 0; i < 10000 && printer.reports < expected && mqtt.connected(); i++) mqtt.loop();
+}
+
+static bool sameTray(const TrayData& a, const TrayData& b) {
+    // setting_id fehlt absichtlich: eine leere setting_id im Bericht behält den alten Wert
+    // setting_id is left out on purpose: an empty setting_id in a report keeps the old value
+    return strcmp(a.tray_info_idx, b.tray_info_idx) == 0 && strcmp(a.tray_type, b.tray_type) == 0 &&
+           strcmp(a.tray_sub_brands, b.tray_sub_brands) == 0 && a.tray_color == b.tray_color &&
+           a.flags == b.flags && a.remain == b.remain && a.cali_idx == b.cali_idx &&
+           a.nozzle_temp_min == b.nozzle_temp_min && a.nozzle_temp_max == b.nozzle_temp_max;
+}
+
+static bool hasSubBrand(const ReplayPrinter& state, const std::string& name) {
+    for (int a = 0; a < state.amsCount; a++) {
+        for (int t = 0; t < 4; t++) {
+            if (name == state.trays[a][t].tray_sub_brands) return true;
+        }
+    }
+    return state.hasExternal && name == state.external.tray_sub_brands;
+}
+
+// Der Simulator hängt bei jedem Spulenwechsel einen Marker "sim#N" an tray_sub_brands, er muss
+// danach im Stand stehen -- the simulator appends a marker "sim#N" to tray_sub_brands on every
+// spool swap, it must show up in the state afterwards
+static uint32_t checkMarkers(const std::string& payload, const char* context) {
+    static const char key[] = "\"tray_sub_brands\": \"";
+    uint32_t found = 0;
+    for (size_t pos = payload.find(key); pos != std::string::npos; pos = payload.find(key, pos + 1)) {
+        size_t start = pos + sizeof(key) - 1;
+        std::string name = payload.substr(start, payload.find('"', start) - start);
+        if (name.find("sim#") == std::string::npos) continue;
+        TEST_ASSERT_TRUE_MESSAGE(hasSubBrand(printer, name), context);
+        found++;
+    }
+    return found;
+}
+
+// Nach jedem vollen Bericht muss der aus Deltas gewachsene Stand dem Bericht allein entsprechen
+// After every full report the state built from deltas must match the report on its own
+void test_replay_matches_full_reports() {
+    ReplayClient client;
+    MqttStreamClient mqtt(client);
+    std::vector<size_t> ends;
+    connect(mqtt, client, ends);
+
+    uint32_t checked = 0;
+    uint32_t markers = 0;
+    for (size_t i = 0; i < payloads.size(); i++) {
+        deliver(mqtt, client, ends[i], i + 1);
+        TEST_ASSERT_EQUAL_MESSAGE(i + 1, printer.reports, "Bericht nicht ausgewertet -- report not applied");
+
+        char context[48];
+        snprintf(context, sizeof(context), "Bericht -- report %u", (unsigned)i);
+        markers += checkMarkers(payloads[i], context);
+        if (!printer.fullReport) continue;
+
+        resetPrinter(fresh);
+        beginReport(fresh);
+        fresh.parser.feed((const uint8_t*)payloads[i].data(), payloads[i].size());
+        endReport(fresh);
+
+        TEST_ASSERT_EQUAL_MESSAGE(fresh.amsCount, printer.amsCount, context);
+        TEST_ASSERT_EQUAL_MESSAGE(fresh.hasExternal, printer.hasExternal, context);
+        for (int a = 0; a < printer.amsCount; a++) {
+            for (int t = 0; t < 4; t++) TEST_ASSERT_TRUE_MESSAGE(sameTray(fresh.trays[a][t], printer.trays[a][t]), context);
+        }
+        if (printer.hasExternal) TEST_ASSERT_TRUE_MESSAGE(sameTray(fresh.external, printer.external), context);
+        checked++;
+    }
+
+    TEST_ASSERT_EQUAL(0, printer.parseErrors);
+    TEST_ASSERT_TRUE(mqtt.connected());
+    TEST_ASSERT_TRUE(checked > 10);
+    TEST_ASSERT_TRUE(markers > 10);
+}
+
+// Berichte pro Sekunde, Latenz vom Freigeben der Bytes bis zum übernommenen Stand, Heap dabei
+// Reports per second, latency from releasing the bytes until the state is applied, heap meanwhile
+void test_replay_throughput() {
+    ReplayClient client;
+    MqttStreamClient mqtt(client);
+    std::vector<size_t> ends;
+    connect(mqtt, client, ends);
+    size_t streamStart = client.limit;
+    size_t bytes = ends.back() - streamStart;
+
+    std::vector<double> latencies;
+    latencies.reserve(payloads.size() * REPLAY_PASSES);
+    heapCurrent = heapPeak = heapAllocs = 0;
+
+    trackHeap = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < REPLAY_PASSES; pass++) {
+        client.rxPos = client.limit = streamStart;
+        for (size_t i = 0; i < payloads.size(); i++) {
+            auto t0 = std::chrono::steady_clock::now();
+            deliver(mqtt, client, ends[i], pass * payloads.size() + i + 1);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    trackHeap = false;
+
+    TEST_ASSERT_EQUAL(payloads.size() * REPLAY_PASSES, printer.reports);
+    TEST_ASSERT_EQUAL(0, printer.parseErrors);
+
+    std::sort(latencies.begin(), latencies.end());
+    double p50 = latencies[latencies.size() / 2];
+    double p95 = latencies[latencies.size() * 95 / 100];
+    double p99 = latencies[latencies.size() * 99 / 100];
+    size_t state = sizeof(MqttStreamClient) + sizeof(ReplayPrinter);
+
+    char message[256];
+    snprintf(message, sizeof(message),
+             "%u Berichte -- reports, %.1f MB: %.0f Berichte/s -- reports/s (%.1f MB/s), Latenz -- latency "
+             "p50 %.1f us, p95 %.1f us, p99 %.1f us, max %.1f us",
+             (unsigned)printer.reports, bytes * REPLAY_PASSES / 1e6, printer.reports / elapsed,
+             bytes * REPLAY_PASSES / 1e6 / elapsed, p50, p95, p99, latencies.back());
+    TEST_MESSAGE(message);
+    snprintf(message, sizeof(message),
+             "Heap-Spitze -- peak heap %u B in %u Allokationen -- allocations, fester Zustand -- fixed state %u B "
+             "(MqttStreamClient %u B, Parser %u B)",
+             (unsigned)heapPeak, (unsigned)heapAllocs, (unsigned)state,
+             (unsigned)sizeof(MqttStreamClient), (unsigned)sizeof(AmsReportParser));
+    TEST_MESSAGE(message);
+
+    // Die Pipeline puffert nie einen ganzen Bericht -- the pipeline never buffers a whole report
+    TEST_ASSERT_EQUAL(0, heapPeak);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    if (!loadStream()) {
+        printf("%s nicht gefunden, python scripts/build_bambu_stream.py im Projektverzeichnis aufrufen -- "
+               "not found, run python scripts/build_bambu_stream.py in the project directory\n", STREAM_FILE);
+        return UNITY_END() + 1;
+    }
+    RUN_TEST(test_replay_matches_full_reports);
+    RUN_TEST(test_replay_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// lookupFilament() gegen die frühere lineare Suche über bambu_filaments.json
+// lookupFilament() against the former linear search over bambu_filaments.json
+//
+//   pio test -e native -v    (-v zeigt die Laufzeiten -- -v shows the timings)
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include "bambu_filament.h"
+
+#define FILAMENT_JSON   "html/bambu_filaments.json"
+
+typedef std::vector<std::pair<std::string, std::string>> FilamentList;
+
+static std::string filamentJson;
+
+void setUp() {}
+void tearDown() {}
+
+// Flaches {"GFxxx":"Name"} Objekt, mehr braucht die Datei nicht -- flat {"GFxxx":"Name"} object, all the file needs
+static FilamentList parseFilaments(const std::string& json) {
+    FilamentList out;
+    std::string strings[2];
+    int field = 0;
+    for (size_t i = 0; i < json.size(); i++) {
+        if (json[i] != '"') continue;
+        std::string value;
+        for (i++; i < json.size() && json[i] != '"'; i++) {
+            if (json[i] == '\\' && i + 1 < json.size()) i++;
+            value += json[i];
+        }
+        strings[field++] = value;
+        if (field == 2) {
+            out.emplace_back(strings[0], strings[1]);
+            field = 0;
+        }
+    }
+    return out;
+}
+
+static std::string trim(const std::string& s) {
+    size_t start = 0;
+    size_t end = s.size();
+    while (start < end && isspace((unsigned char)s[start])) start++;
+    while (end > start && isspace((unsigned char)s[end - 1])) end--;
+    return s.substr(start, end - start);
+}
+
+// Der Ablauf von findFilamentIdx() vor dem generierten Index, inklusive Parsen pro Aufruf
+// The findFilamentIdx() flow before the generated index, including the parse per call
+static std::pair<std::string, std::string> oldFindFilament(const std::string& brand, const std::string& type) {
+    FilamentList doc = parseFilaments(filamentJson);
+
+    std::string searchKey;
+    if (brand == "Bambu" || brand == "Bambulab") searchKey = "Bambu " + type;
+    else if (brand == "PolyLite") searchKey = "PolyLite " + type;
+    else if (brand == "eSUN") searchKey = "eSUN " + type;
+    else if (brand == "Overture") searchKey = "Overture " + type;
+    else if (brand == "PolyTerra") searchKey = "PolyTerra " + type;
+
+    for (const auto& kv : doc) {
+        if (kv.second == searchKey) return kv;
+    }
+
+    std::vector<std::string> knownTypes;
+    for (const auto& kv : doc) {
+        std::string value = kv.second;
+        size_t space = value.find(' ');
+        if (space != std::string::npos) value = value.substr(space + 1);
+        if (!value.empty()) knownTypes.push_back(value);
+    }
+
+    std::string typeStr = trim(type);
+    for (const std::string& knownType : knownTypes) {
+        if (typeStr.find(knownType) != std::string::npos) {
+            for (const auto& kv : doc) {
+                if (kv.second.find(knownType) != std::string::npos) return {kv.first, knownType};
+            }
+        }
+    }
+    return {"GFL99", "PLA"};
+}
+
+static const char* const brands[] = { "Bambu", "Bambulab", "PolyLite", "eSUN", "Overture", "PolyTerra", "Generic", "" };
+
+// Alle Namen aus der Datei, ohne Marke und ein paar Slicer-Schreibweisen
+// All names from the file, without brand, and a few slicer spellings
+static std::vector<std::string> sampleTypes() {
+    std::vector<std::string> types;
+    for (const auto& kv : parseFilaments(filamentJson)) {
+        types.push_back(kv.second);
+        size_t space = kv.second.find(' ');
+        if (space != std::string::npos) types.push_back(kv.second.substr(space + 1));
+    }
+    const char* const extra[] = { " PLA Matte ", "PETG HF", "PLA+", "Support W", "Unknown", "", "  ", "TPU 95A HF" };
+    for (const char* e : extra) types.push_back(e);
+    return types;
+}
+
+static void test_matches_linear_search() {
+    std::vector<std::string> types = sampleTypes();
+    size_t compared = 0;
+
+    for (const char* brand : brands) {
+        for (const std::string& type : types) {
+            std::pair<std::string, std::string> expected = oldFindFilament(brand, type);
+            FilamentResult actual = lookupFilament(brand, type.c_str());
+            std::string context = std::string(brand) + " / '" + type + "'";
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.first.c_str(), actual.key, context.c_str());
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.second.c_str(), actual.type, context.c_str());
+            compared++;
+        }
+    }
+    TEST_ASSERT_TRUE(compared > 100);
+}
+
+static void test_find_filament_name() {
+    for (const auto& kv : parseFilaments(filamentJson)) {
+        const char* name = findFilamentName(kv.first.c_str());
+        TEST_ASSERT_NOT_NULL_MESSAGE(name, kv.first.c_str());
+    }
+    TEST_ASSERT_NULL(findFilamentName("GFX42"));
+    TEST_ASSERT_NULL(findFilamentName(""));
+}
+
+// Laufzeit pro Aufruf, alt gegen neu -- time per call, old versus new
+static void test_benchmark() {
+    std::vector<std::string> types = sampleTypes();
+    const int rounds = 20;
+    volatile size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const char* brand : brands) {
+            for (const std::string& type : types) sink += oldFindFilament(brand, type).first.size();
+        }
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const char* brand : brands) {
+            for (const std::string& type : types) sink += strlen(lookupFilament(brand, type.c_str()).key);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double calls = (double)rounds * (sizeof(brands) / sizeof(brands[0])) * types.size();
+    double oldNs = std::chrono::duration<double, std::nano>(mid - start).count() / calls;
+    double newNs = std::chrono::duration<double, std::nano>(end - mid).count() / calls;
+    char message[128];
+    snprintf(message, sizeof(message), "findFilamentIdx: alt -- old %.0f ns, neu -- new %.0f ns pro Aufruf -- per call (x%.0f)",
+             oldNs, newNs, newNs > 0 ? oldNs / newNs : 0.0);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(newNs < oldNs);
+}
+
+int main(int argc, char** argv) {
+    std::ifstream file(FILAMENT_JSON);
+    std::stringstream content;
+    content << file.rdbuf();
+    filamentJson = content.str();
+
+    UNITY_BEGIN();
+    if (filamentJson.empty()) {
+        printf("%s nicht gefunden, aus dem Projektverzeichnis starten -- not found, run from the project directory\n", FILAMENT_JSON);
+        return UNITY_END() + 1;
+    }
+    RUN_TEST(test_matches_linear_search);
+    RUN_TEST(test_find_filament_name);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
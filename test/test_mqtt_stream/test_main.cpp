@@ -0,0 +1,248 @@
+// MqttStreamClient gegen einen Fake-Client, der Pakete in zufälligen Stücken liefert
+// MqttStreamClient against a fake client that delivers packets in random chunks
+//
+//   pio test -e native
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "mqtt_stream.h"
+#include "../fixtures/bambu_reports.h"
+
+#define REPORT_TOPIC    "device/01P00A123456789/report"
+
+// Liefert pro available() nur ein Stück des Empfangspuffers, wie ein TLS-Record
+// Reveals only a piece of the receive buffer per available(), like a TLS record
+class FakeClient : public Client {
+public:
+    std::vector<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    size_t rxPos = 0;
+    size_t window = 0;
+    size_t maxWindow = 0;
+    bool open = true;
+
+    uint8_t connected() override { return open; }
+    int available() override {
+        if (!open || rxPos >= rx.size()) return 0;
+        if (window == 0) {
+            window = maxWindow ? 1 + rand() % maxWindow : rx.size() - rxPos;
+            window = std::min(window, rx.size() - rxPos);
+        }
+        return (int)window;
+    }
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t* buf, size_t size) override {
+        size_t n = std::min(size, (size_t)available());
+        memcpy(buf, rx.data() + rxPos, n);
+        rxPos += n;
+        window -= n;
+        return (int)n;
+    }
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!open) return 0;
+        tx.insert(tx.end(), buf, buf + size);
+        return size;
+    }
+    void stop() override { open = false; }
+
+    void push(const std::vector<uint8_t>& packet) { rx.insert(rx.end(), packet.begin(), packet.end()); }
+};
+
+struct Received {
+    std::string topic;
+    uint32_t announced;
+    std::string payload;
+    int ended;
+};
+
+static std::vector<Received> messages;
+
+static void onBegin(const char* topic, uint32_t length, void* ctx) {
+    messages.push_back({topic, length, "", 0});
+}
+
+static void onData(const uint8_t* data, size_t len, void* ctx) {
+    messages.back().payload.append((const char*)data, len);
+}
+
+static void onEnd(void* ctx) {
+    messages.back().ended++;
+}
+
+void setUp() {
+    messages.clear();
+    hostMillis() = 1000;
+}
+
+void tearDown() {}
+
+static void putLength(std::vector<uint8_t>& out, uint32_t len) {
+    do {
+        uint8_t digit = len % 128;
+        len /= 128;
+        if (len > 0) digit |= 0x80;
+        out.push_back(digit);
+    } while (len > 0);
+}
+
+static std::vector<uint8_t> publishPacket(const char* topic, const char* payload, uint8_t qos = 0) {
+    size_t topicLen = strlen(topic);
+    size_t payloadLen = strlen(payload);
+    std::vector<uint8_t> out = { (uint8_t)(0x30 | (qos << 1)) };
+    putLength(out, 2 + topicLen + (qos ? 2 : 0) + payloadLen);
+    out.push_back((uint8_t)(topicLen >> 8));
+    out.push_back((uint8_t)topicLen);
+    out.insert(out.end(), topic, topic + topicLen);
+    if (qos) {
+        out.push_back(0x12);
+        out.push_back(0x34);
+    }
+    out.insert(out.end(), payload, payload + payloadLen);
+    return out;
+}
+
+// CONNECT senden und CONNACK annehmen -- send CONNECT and accept CONNACK
+static void connect(MqttStreamClient& mqtt, FakeClient& client) {
+    mqtt.setCallbacks(onBegin, onData, onEnd, nullptr);
+    TEST_ASSERT_TRUE(mqtt.startSession("filaman", "bblp", "12345678"));
+    TEST_ASSERT_EQUAL(0x10, client.tx[0]);
+    TEST_ASSERT_EQUAL(0, mqtt.pollSession());
+    client.push({ 0x20, 0x02, 0x00, 0x00 });
+    TEST_ASSERT_EQUAL(1, mqtt.pollSession());
+    TEST_ASSERT_EQUAL(MQTT_STREAM_CONNECTED, mqtt.state());
+    client.tx.clear();
+}
+
+static void drain(MqttStreamClient& mqtt, FakeClient& client) {
+    for (int i = 0; i < 100000 && client.rxPos < client.rx.size() && mqtt.connected(); i++) {
+        mqtt.loop();
+    }
+}
+
+void test_reports_in_random_chunks() {
+    const char* reports[] = { reportFull, reportPartialRemain, reportPartialProgress, reportTwoAms, reportFilamentSetting };
+    const size_t count = sizeof(reports) / sizeof(reports[0]);
+
+    for (unsigned seed = 1; seed <= 200; seed++) {
+        srand(seed);
+        messages.clear();
+        FakeClient client;
+        client.maxWindow = (seed % 3 == 0) ? 8 : 1500;
+        MqttStreamClient mqtt(client);
+        connect(mqtt, client);
+
+        for (size_t i = 0; i < count; i++) client.push(publishPacket(REPORT_TOPIC, reports[i]));
+        drain(mqtt, client);
+
+        TEST_ASSERT_TRUE(mqtt.connected());
+        TEST_ASSERT_EQUAL(count, messages.size());
+        for (size_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL_STRING(REPORT_TOPIC, messages[i].topic.c_str());
+            TEST_ASSERT_EQUAL(strlen(reports[i]), messages[i].announced);
+            TEST_ASSERT_TRUE(messages[i].payload == reports[i]);
+            TEST_ASSERT_EQUAL(1, messages[i].ended);
+        }
+    }
+}
+
+void test_qos1_is_acknowledged() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    connect(mqtt, client);
+
+    client.push(publishPacket(REPORT_TOPIC, reportPartialRemain, 1));
+    drain(mqtt, client);
+
+    TEST_ASSERT_EQUAL(1, messages.size());
+    TEST_ASSERT_TRUE(messages[0].payload == reportPartialRemain);
+    const uint8_t puback[] = { 0x40, 0x02, 0x12, 0x34 };
+    TEST_ASSERT_EQUAL(sizeof(puback), client.tx.size());
+    TEST_ASSERT_EQUAL_MEMORY(puback, client.tx.data(), sizeof(puback));
+}
+
+void test_long_topic_is_truncated() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    connect(mqtt, client);
+
+    std::string topic(MQTT_STREAM_TOPIC_LEN + 20, 't');
+    client.push(publishPacket(topic.c_str(), "{}"));
+    drain(mqtt, client);
+
+    TEST_ASSERT_EQUAL(1, messages.size());
+    TEST_ASSERT_EQUAL(MQTT_STREAM_TOPIC_LEN - 1, messages[0].topic.size());
+    TEST_ASSERT_TRUE(messages[0].payload == "{}");
+}
+
+// Topic-Länge größer als das Paket: Verbindung trennen statt _rxRemaining überlaufen zu lassen
+// Topic length larger than the packet: drop the connection instead of wrapping _rxRemaining
+void test_topic_longer_than_packet() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    connect(mqtt, client);
+
+    client.push({ 0x30, 0x05, 0x00, 0x10, 'a', 'b', 'c' });
+    client.push(publishPacket(REPORT_TOPIC, reportFull));
+    drain(mqtt, client);
+
+    TEST_ASSERT_EQUAL(MQTT_STREAM_CONNECTION_LOST, mqtt.state());
+    TEST_ASSERT_FALSE(client.open);
+    TEST_ASSERT_EQUAL(0, messages.size());
+}
+
+// QoS 1 braucht zwei Bytes Paket-ID nach dem Topic -- QoS 1 needs two bytes of packet id after the topic
+void test_missing_packet_id() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    connect(mqtt, client);
+
+    client.push({ 0x32, 0x05, 0x00, 0x03, 'a', 'b', 'c' });
+    drain(mqtt, client);
+
+    TEST_ASSERT_EQUAL(MQTT_STREAM_CONNECTION_LOST, mqtt.state());
+    TEST_ASSERT_EQUAL(0, messages.size());
+}
+
+void test_keepalive_ping() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    connect(mqtt, client);
+
+    hostMillis() += MQTT_STREAM_KEEPALIVE * 1000UL;
+    TEST_ASSERT_TRUE(mqtt.loop());
+    TEST_ASSERT_EQUAL(2, client.tx.size());
+    TEST_ASSERT_EQUAL(0xC0, client.tx[0]);
+
+    // Ohne PINGRESP gilt die Verbindung nach 1,5 Keepalives als tot -- without PINGRESP the link is dead after 1.5 keepalives
+    hostMillis() += MQTT_STREAM_KEEPALIVE * 1000UL;
+    TEST_ASSERT_FALSE(mqtt.loop());
+    TEST_ASSERT_EQUAL(MQTT_STREAM_CONNECTION_TIMEOUT, mqtt.state());
+}
+
+void test_connack_refused() {
+    FakeClient client;
+    MqttStreamClient mqtt(client);
+    TEST_ASSERT_TRUE(mqtt.startSession("filaman", "bblp", "wrong"));
+    client.push({ 0x20, 0x02, 0x00, 0x05 });
+    TEST_ASSERT_EQUAL(-1, mqtt.pollSession());
+    TEST_ASSERT_EQUAL(5, mqtt.state());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reports_in_random_chunks);
+    RUN_TEST(test_qos1_is_acknowledged);
+    RUN_TEST(test_long_topic_is_truncated);
+    RUN_TEST(test_topic_longer_than_packet);
+    RUN_TEST(test_missing_packet_id);
+    RUN_TEST(test_keepalive_ping);
+    RUN_TEST(test_connack_refused);
+    return UNITY_END();
+}